@@ -0,0 +1,207 @@
+#include "assembler.h"
+
+/**
+ * @brief Opens the `.am` output file for writing through segments.
+ *
+ * @param writer Pointer to the writer to initialize.
+ * @param file_name Name of the output file.
+ * @return TRUE if the file was opened, FALSE otherwise.
+ */
+BOOLEAN am_writer_open(AM_WRITER * writer , char * file_name){
+    writer->count = 0;
+    writer->owned_count = 0;
+    writer->failed = FALSE;
+    writer->buffer = NULL;
+    writer->length = 0;
+    writer->capacity = 0;
+    writer->forward = NULL;
+    writer->arena = NULL;
+    writer->partial_length = 0;
+    writer->fd = open(file_name , O_WRONLY | O_CREAT | O_TRUNC , 0666);
+    if(writer->fd < 0){
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/**
+ * @brief Prepares a writer that collects the output in memory instead of a file.
+ *
+ * Used for included files, whose preprocessed text is kept in the include cache.
+ *
+ * @param writer Pointer to the writer to initialize.
+ */
+void am_writer_open_memory(AM_WRITER * writer){
+    writer->fd = -1;
+    writer->count = 0;
+    writer->owned_count = 0;
+    writer->failed = FALSE;
+    writer->buffer = NULL;
+    writer->length = 0;
+    writer->capacity = 0;
+    writer->forward = NULL;
+    writer->arena = NULL;
+    writer->partial_length = 0;
+}
+
+/**
+ * @brief Forwards text to the next pipeline stage, cut into lines the way fgets cuts them.
+ *
+ * A line ends after a '\n' or once it holds MAX_FILE_LINE_LENGTH - 1 characters, so the
+ * next stage reads exactly the lines it would read from the `.am` file. The text is copied
+ * a line at a time: a whole line goes straight to the arena, and only the start of a line
+ * split between two calls waits in the partial line.
+ *
+ * @param writer Pointer to the writer.
+ * @param text The text to forward.
+ * @param length Number of characters of the text.
+ */
+void am_writer_forward(AM_WRITER * writer , char * text , int length){
+    char * end = text + length;
+    char * newline = NULL;
+    int take;
+
+    while(text < end){
+        /* Take the rest of the line, up to what the partial line can still hold */
+        newline = memchr(text , '\n' , end - text);
+        take = (newline != NULL) ? (int)(newline - text) + 1 : (int)(end - text);
+        if(take > MAX_FILE_LINE_LENGTH - 1 - writer->partial_length){
+            take = MAX_FILE_LINE_LENGTH - 1 - writer->partial_length;
+            newline = NULL;
+        }
+        if(newline == NULL && writer->partial_length + take < MAX_FILE_LINE_LENGTH - 1){
+            /* The line goes on in the next call */
+            memcpy(writer->partial + writer->partial_length , text , take);
+            writer->partial_length += take;
+        }
+        else if(writer->partial_length == 0){
+            line_ring_push(writer->forward , arena_copy(writer->arena , text , take) , take);
+        }
+        else{
+            memcpy(writer->partial + writer->partial_length , text , take);
+            writer->partial_length += take;
+            line_ring_push(writer->forward , arena_copy(writer->arena , writer->partial , writer->partial_length) , writer->partial_length);
+            writer->partial_length = 0;
+        }
+        text += take;
+    }
+}
+
+/**
+ * @brief Adds a segment of text to the output.
+ *
+ * The text is not copied: the writer keeps a reference to it until the next flush.
+ * Owned text (a line read from the source) is freed by the writer once it is written,
+ * while macro bodies are only referenced, so expanding a macro never copies its lines.
+ * The segments are written when the batch is full.
+ *
+ * @param writer Pointer to the writer.
+ * @param text The text of the segment.
+ * @param length Number of characters of the segment.
+ * @param owned TRUE if the writer should free the text after writing it, FALSE otherwise.
+ */
+void am_writer_add(AM_WRITER * writer , char * text , int length , BOOLEAN owned){
+    /* Hand the text to the next pipeline stage while it is still alive */
+    if(writer->forward != NULL){
+        am_writer_forward(writer , text , length);
+    }
+    /* Empty segments are not written, owned text is still released */
+    if(length == 0){
+        if(owned == TRUE){
+            free(text);
+        }
+        return;
+    }
+    writer->segments[writer->count].iov_base = text;
+    writer->segments[writer->count].iov_len = length;
+    writer->count++;
+    if(owned == TRUE){
+        writer->owned[writer->owned_count++] = text;
+    }
+    /* Write the batch once it is full */
+    if(writer->count == AM_WRITER_SEGMENTS){
+        am_writer_flush(writer);
+    }
+}
+
+/**
+ * @brief Writes all pending segments with `writev` and releases the owned text.
+ *
+ * Partial writes are resumed from the first segment that was not fully written.
+ * A memory writer appends the segments to its buffer instead.
+ *
+ * @param writer Pointer to the writer.
+ */
+void am_writer_flush(AM_WRITER * writer){
+    struct iovec * segment = writer->segments;
+    int left = writer->count;
+    long written;
+    char * grown = NULL;
+    int i;
+
+    /* Append the segments to the buffer of a memory writer */
+    while(writer->fd < 0 && left > 0){
+        if(writer->length + (long)segment->iov_len + 1 > writer->capacity){
+            grown = realloc(writer->buffer , 2 * (writer->capacity + segment->iov_len + 1));
+            if(grown == NULL){
+                print_error(MEMORY_ALLOCATION_FAILED , NO_LINE);
+                exit(1);
+            }
+            writer->buffer = grown;
+            writer->capacity = 2 * (writer->capacity + segment->iov_len + 1);
+        }
+        memcpy(writer->buffer + writer->length , segment->iov_base , segment->iov_len);
+        writer->length += segment->iov_len;
+        writer->buffer[writer->length] = '\0';
+        segment++;
+        left--;
+    }
+
+    while(left > 0 && writer->failed == FALSE){
+        written = writev(writer->fd , segment , left);
+        if(written < 0){
+            writer->failed = TRUE;
+            break;
+        }
+        /* Skip the segments that were fully written */
+        while(left > 0 && written >= (long)segment->iov_len){
+            written -= segment->iov_len;
+            segment++;
+            left--;
+        }
+        /* Continue from the middle of a partially written segment */
+        if(left > 0){
+            segment->iov_base = (char *)segment->iov_base + written;
+            segment->iov_len -= written;
+        }
+    }
+
+    for(i = 0 ; i < writer->owned_count ; i++){
+        free(writer->owned[i]);
+    }
+    writer->count = 0;
+    writer->owned_count = 0;
+}
+
+/**
+ * @brief Flushes the pending segments and closes the output file.
+ *
+ * @param writer Pointer to the writer.
+ * @return TRUE if all the output was written, FALSE otherwise.
+ */
+BOOLEAN am_writer_close(AM_WRITER * writer){
+    am_writer_flush(writer);
+    /* Forward the last line, when it has no '\n' */
+    if(writer->forward != NULL && writer->partial_length > 0){
+        line_ring_push(writer->forward , arena_copy(writer->arena , writer->partial , writer->partial_length) , writer->partial_length);
+        writer->partial_length = 0;
+    }
+    /* The buffer of a memory writer is kept for its owner */
+    if(writer->fd < 0){
+        return TRUE;
+    }
+    if(close(writer->fd) != 0){
+        writer->failed = TRUE;
+    }
+    return (writer->failed == TRUE) ? FALSE : TRUE;
+}
@@ -0,0 +1,399 @@
+#include "assembler.h"
+
+/* Sources read from the input archive (--archive), shared by every file of the run */
+INPUT_ARCHIVE input_archive = {NULL , 0 , NULL , 0 , NULL , 0};
+
+/* Results written to the output archive (--output-archive) */
+OUTPUT_ARCHIVE output_archive = {NULL , NULL , 0 , NULL , NULL , NULL , 0 , 0 , FALSE};
+
+/**
+ * @brief Reads a number field of a tar header: octal text, or base-256 for large values.
+ *
+ * @param field The field.
+ * @param length Length of the field.
+ * @return The number, or -1 if the field is not a number.
+ */
+long tar_Number(const unsigned char * field , int length){
+    long value = 0;
+    int i = 0;
+
+    /* Base-256: the high bit of the first byte is set, the rest is big-endian */
+    if(field[0] & 0x80){
+        value = field[0] & 0x7F;
+        for(i = 1 ; i < length ; i++){
+            value = (value << 8) | field[i];
+        }
+        return value;
+    }
+    while(i < length && field[i] == ' '){
+        i++;
+    }
+    for( ; i < length && field[i] >= '0' && field[i] <= '7' ; i++){
+        value = value * 8 + (field[i] - '0');
+    }
+    /* The digits end with a space or a null character */
+    if(i < length && field[i] != ' ' && field[i] != '\0'){
+        return -1;
+    }
+    return value;
+}
+
+/**
+ * @brief Compares two archive members by name (for qsort and bsearch).
+ *
+ * @param first Pointer to the first member pointer.
+ * @param second Pointer to the second member pointer.
+ * @return Negative, zero or positive, like strcmp.
+ */
+int compare_Archive_Members(const void * first , const void * second){
+    return strcmp((*(ARCHIVE_MEMBER * const *)first)->name , (*(ARCHIVE_MEMBER * const *)second)->name);
+}
+
+/**
+ * @brief Compares two archive members by name, then by their place in the archive (for qsort).
+ *
+ * @param first Pointer to the first member pointer.
+ * @param second Pointer to the second member pointer.
+ * @return Negative, zero or positive.
+ */
+int order_Archive_Members(const void * first , const void * second){
+    ARCHIVE_MEMBER * first_member = *(ARCHIVE_MEMBER * const *)first;
+    ARCHIVE_MEMBER * second_member = *(ARCHIVE_MEMBER * const *)second;
+    int result = strcmp(first_member->name , second_member->name);
+
+    if(result != 0){
+        return result;
+    }
+    return (first_member < second_member) ? -1 : (first_member > second_member) ? 1 : 0;
+}
+
+/**
+ * @brief Maps a tar archive of sources and indexes its members, without extracting them.
+ *
+ * Regular files are indexed in archive order, their text stays in the mapping. GNU long
+ * names are supported, other special entries (directories, links, pax headers) are skipped.
+ * When several members have the same name, the last one is used, as tar extracts it.
+ *
+ * @param path Path of the archive.
+ * @return TRUE if the archive was indexed, FALSE otherwise (the error is reported).
+ */
+BOOLEAN open_Input_Archive(char * path){
+    const unsigned char * header = NULL;
+    char long_name[TAR_NAME_LENGTH];
+    struct stat file_stat;
+    ARCHIVE_MEMBER * member = NULL;
+    long offset = 0 , size;
+    int capacity = 0 , fd , i;
+
+    fd = open(path , O_RDONLY);
+    if(fd < 0 || fstat(fd , &file_stat) != 0){
+        report_error(FAILED_TO_OPEN_FILE , path , NO_LINE);
+        if(fd >= 0){
+            close(fd);
+        }
+        return FALSE;
+    }
+    input_archive.size = file_stat.st_size;
+    input_archive.data = (input_archive.size > 0) ? mmap(NULL , input_archive.size , PROT_READ , MAP_PRIVATE , fd , 0) : NULL;
+    close(fd);
+    if(input_archive.data == MAP_FAILED){
+        input_archive.data = NULL;
+        report_error(FAILED_TO_OPEN_FILE , path , NO_LINE);
+        return FALSE;
+    }
+
+    long_name[0] = '\0';
+    while(offset + TAR_BLOCK_SIZE <= input_archive.size){
+        header = (const unsigned char *)input_archive.data + offset;
+        /* The archive ends with a zero block */
+        if(header[0] == '\0'){
+            break;
+        }
+        size = tar_Number(header + 124 , 12);
+        if(size < 0 || offset + TAR_BLOCK_SIZE + size > input_archive.size){
+            report_error(INVALID_ARCHIVE , path , NO_LINE);
+            close_Input_Archive();
+            return FALSE;
+        }
+
+        if(header[156] == 'L'){
+            /* GNU long name of the next member */
+            memset(long_name , '\0' , sizeof(long_name));
+            memcpy(long_name , header + TAR_BLOCK_SIZE , (size < TAR_NAME_LENGTH) ? size : TAR_NAME_LENGTH - 1);
+        }
+        else if(header[156] == '0' || header[156] == '\0'){
+            if(input_archive.count == capacity){
+                capacity = 2 * capacity + 64;
+                member = realloc(input_archive.members , capacity * sizeof(ARCHIVE_MEMBER));
+                if(member == NULL){
+                    print_error(MEMORY_ALLOCATION_FAILED , NO_LINE);
+                    exit(1);
+                }
+                input_archive.members = member;
+            }
+            member = &input_archive.members[input_archive.count++];
+            memset(member->name , '\0' , sizeof(member->name));
+            if(long_name[0] != '\0'){
+                strcpy(member->name , long_name);
+            }
+            else if(memcmp(header + 257 , "ustar" , 5) == 0 && header[345] != '\0'){
+                /* ustar names are split into a prefix and a name */
+                sprintf(member->name , "%.155s/%.100s" , (const char *)header + 345 , (const char *)header);
+            }
+            else{
+                memcpy(member->name , header , 100);
+            }
+            /* Names written as "./prog.as" are looked up as "prog.as" */
+            while(strncmp(member->name , "./" , 2) == 0){
+                memmove(member->name , member->name + 2 , strlen(member->name + 2) + 1);
+            }
+            member->text = (const char *)header + TAR_BLOCK_SIZE;
+            member->size = size;
+            long_name[0] = '\0';
+        }
+        else{
+            long_name[0] = '\0';
+        }
+        offset += TAR_BLOCK_SIZE + (size + TAR_BLOCK_SIZE - 1) / TAR_BLOCK_SIZE * TAR_BLOCK_SIZE;
+    }
+
+    /* Sort pointers to the members by name, for the lookups */
+    input_archive.sorted = generic_malloc((input_archive.count + 1) * sizeof(ARCHIVE_MEMBER *));
+    for(i = 0 ; i < input_archive.count ; i++){
+        input_archive.sorted[i] = &input_archive.members[i];
+    }
+    qsort(input_archive.sorted , input_archive.count , sizeof(ARCHIVE_MEMBER *) , order_Archive_Members);
+    /* Of the members of the same name, keep the last one of the archive */
+    input_archive.sorted_count = 0;
+    for(i = 0 ; i < input_archive.count ; i++){
+        if(i + 1 < input_archive.count && strcmp(input_archive.sorted[i]->name , input_archive.sorted[i + 1]->name) == 0){
+            continue;
+        }
+        input_archive.sorted[input_archive.sorted_count++] = input_archive.sorted[i];
+    }
+    return TRUE;
+}
+
+/**
+ * @brief Finds a member of the input archive by path.
+ *
+ * @param path Path of the member (e.g. "prog.as").
+ * @return Pointer to the member, or NULL if there is no input archive or no such member.
+ */
+ARCHIVE_MEMBER * find_Archive_Member(char * path){
+    ARCHIVE_MEMBER key;
+    ARCHIVE_MEMBER * key_ptr = &key;
+    ARCHIVE_MEMBER ** found = NULL;
+
+    if(input_archive.sorted_count == 0 || strlen(path) >= sizeof(key.name)){
+        return NULL;
+    }
+    strcpy(key.name , path);
+    found = bsearch(&key_ptr , input_archive.sorted , input_archive.sorted_count , sizeof(ARCHIVE_MEMBER *) , compare_Archive_Members);
+    return (found != NULL) ? *found : NULL;
+}
+
+/**
+ * @brief Hides a member of the input archive, so the file of the same path is read from disk instead.
+ *
+ * A source named on the command line is read from disk: the member of the same name is
+ * neither assembled nor included.
+ *
+ * @param path Path of the member (e.g. "prog.as").
+ */
+void hide_Archive_Member(char * path){
+    ARCHIVE_MEMBER * member = find_Archive_Member(path);
+    int i;
+
+    if(member == NULL){
+        return;
+    }
+    for(i = 0 ; input_archive.sorted[i] != member ; i++);
+    memmove(&input_archive.sorted[i] , &input_archive.sorted[i + 1] , (input_archive.sorted_count - i - 1) * sizeof(ARCHIVE_MEMBER *));
+    input_archive.sorted_count--;
+}
+
+/**
+ * @brief Collects the names of the sources of the input archive: its ".as" members, without the suffix.
+ *
+ * @param names Array receiving the names (to free), in archive order.
+ * @return Number of names.
+ */
+int archive_Source_Names(char *** names){
+    int count = 0 , i , length;
+
+    *names = generic_malloc((input_archive.count + 1) * sizeof(char *));
+    for(i = 0 ; i < input_archive.count ; i++){
+        length = strlen(input_archive.members[i].name);
+        if(length > 3 && strcmp(input_archive.members[i].name + length - 3 , ".as") == 0 &&
+           find_Archive_Member(input_archive.members[i].name) == &input_archive.members[i]){
+            (*names)[count] = generic_malloc(length - 2);
+            memcpy((*names)[count] , input_archive.members[i].name , length - 3);
+            (*names)[count][length - 3] = '\0';
+            count++;
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief Unmaps the input archive and frees its index.
+ */
+void close_Input_Archive(void){
+    if(input_archive.data != NULL){
+        munmap(input_archive.data , input_archive.size);
+    }
+    free(input_archive.members);
+    free(input_archive.sorted);
+    input_archive.data = NULL;
+    input_archive.size = 0;
+    input_archive.members = NULL;
+    input_archive.sorted = NULL;
+    input_archive.count = 0;
+    input_archive.sorted_count = 0;
+}
+
+/**
+ * @brief Stores a number as a little-endian number of a given size.
+ *
+ * @param bytes The bytes receiving the number.
+ * @param value The number.
+ * @param size Number of bytes.
+ */
+void archive_put_number(unsigned char * bytes , unsigned long value , int size){
+    int i;
+
+    for(i = 0 ; i < size ; i++){
+        bytes[i] = value & 0xFF;
+        value >>= 8;
+    }
+}
+
+/**
+ * @brief Creates the output archive, which receives the bundles of every file.
+ *
+ * @param path Path of the archive.
+ * @return TRUE if the archive was created, FALSE otherwise (the error is reported).
+ */
+BOOLEAN open_Output_Archive(char * path){
+    unsigned char header[ARCHIVE_HEADER_SIZE];
+
+    output_archive.fptr = fopen(path , "wb");
+    if(output_archive.fptr == NULL){
+        report_error(FAILED_TO_OPEN_FILE , path , NO_LINE);
+        return FALSE;
+    }
+    output_archive.path = path;
+    output_archive.failed = FALSE;
+    /* The header is written again once the index is known */
+    memset(header , 0 , sizeof(header));
+    if(fwrite(header , 1 , sizeof(header) , output_archive.fptr) != sizeof(header)){
+        output_archive.failed = TRUE;
+    }
+    output_archive.offset = ARCHIVE_HEADER_SIZE;
+    return TRUE;
+}
+
+/**
+ * @brief Writes a bundle of output files: to the output archive as members, or to stdout.
+ *
+ * The bundle holds frames made by output_close: a `PATH LENGTH` line followed by the
+ * LENGTH bytes of the file. Each frame becomes a member of the archive.
+ *
+ * @param bundle Pointer to the bundle.
+ */
+void write_Bundle(OUTPUT_FILE * bundle){
+    char * frame = bundle->text;
+    char * end = bundle->text + bundle->length;
+    char * line_end = NULL;
+    char * space = NULL;
+    long length;
+
+    if(output_archive.fptr == NULL){
+        fwrite(bundle->text , 1 , bundle->length , stdout);
+        fflush(stdout);
+        return;
+    }
+    while(frame < end){
+        line_end = memchr(frame , '\n' , end - frame);
+        *line_end = '\0';
+        space = strrchr(frame , ' ');
+        *space = '\0';
+        length = atol(space + 1);
+
+        if(output_archive.count == output_archive.capacity){
+            output_archive.capacity = 2 * output_archive.capacity + 256;
+            output_archive.names = realloc(output_archive.names , output_archive.capacity * sizeof(char *));
+            output_archive.offsets = realloc(output_archive.offsets , output_archive.capacity * sizeof(long));
+            output_archive.lengths = realloc(output_archive.lengths , output_archive.capacity * sizeof(long));
+            if(output_archive.names == NULL || output_archive.offsets == NULL || output_archive.lengths == NULL){
+                print_error(MEMORY_ALLOCATION_FAILED , NO_LINE);
+                exit(1);
+            }
+        }
+        output_archive.names[output_archive.count] = generic_malloc(strlen(frame) + 1);
+        strcpy(output_archive.names[output_archive.count] , frame);
+        output_archive.offsets[output_archive.count] = output_archive.offset;
+        output_archive.lengths[output_archive.count] = length;
+        output_archive.count++;
+
+        if(fwrite(line_end + 1 , 1 , length , output_archive.fptr) != (size_t)length){
+            output_archive.failed = TRUE;
+        }
+        output_archive.offset += length;
+        frame = line_end + 1 + length;
+    }
+}
+
+/**
+ * @brief Writes the index and the header of the output archive and closes it.
+ *
+ * @return TRUE if the whole archive was written, FALSE otherwise (the error is reported).
+ */
+BOOLEAN close_Output_Archive(void){
+    unsigned char header[ARCHIVE_HEADER_SIZE];
+    unsigned char entry[ARCHIVE_INDEX_ENTRY_SIZE];
+    int i;
+
+    if(output_archive.fptr == NULL){
+        return TRUE;
+    }
+
+    /* The index follows the members */
+    for(i = 0 ; i < output_archive.count ; i++){
+        archive_put_number(entry , output_archive.offsets[i] , 8);
+        archive_put_number(entry + 8 , output_archive.lengths[i] , 8);
+        archive_put_number(entry + 16 , strlen(output_archive.names[i]) , 4);
+        if(fwrite(entry , 1 , sizeof(entry) , output_archive.fptr) != sizeof(entry) ||
+           fwrite(output_archive.names[i] , 1 , strlen(output_archive.names[i]) , output_archive.fptr) != strlen(output_archive.names[i])){
+            output_archive.failed = TRUE;
+        }
+        free(output_archive.names[i]);
+    }
+
+    memcpy(header , ARCHIVE_MAGIC , 4);
+    archive_put_number(header + 4 , ARCHIVE_VERSION , 4);
+    archive_put_number(header + 8 , output_archive.count , 4);
+    archive_put_number(header + 12 , 0 , 4);
+    archive_put_number(header + 16 , output_archive.offset , 8);
+    if(fseek(output_archive.fptr , 0 , SEEK_SET) != 0 || fwrite(header , 1 , sizeof(header) , output_archive.fptr) != sizeof(header)){
+        output_archive.failed = TRUE;
+    }
+    if(fclose(output_archive.fptr) != 0){
+        output_archive.failed = TRUE;
+    }
+    if(output_archive.failed == TRUE){
+        report_error(FAILED_TO_WRITE_FILE , output_archive.path , NO_LINE);
+    }
+
+    free(output_archive.names);
+    free(output_archive.offsets);
+    free(output_archive.lengths);
+    output_archive.fptr = NULL;
+    output_archive.names = NULL;
+    output_archive.offsets = NULL;
+    output_archive.lengths = NULL;
+    output_archive.count = 0;
+    output_archive.capacity = 0;
+    return (output_archive.failed == TRUE) ? FALSE : TRUE;
+}
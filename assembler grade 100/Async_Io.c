@@ -0,0 +1,801 @@
+/* The raw io_uring system calls are not declared in strict ANSI mode */
+#define _GNU_SOURCE
+#include "assembler.h"
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+
+/* The I/O backend of the process */
+IO_BACKEND io_backend = {FALSE , FALSE , 0 , -1};
+
+/* Number of temporary output files created, to give each one its own name */
+long temp_counter = 0;
+
+/**
+ * @brief Sets up the I/O backend of the run.
+ *
+ * With asynchronous I/O, an io_uring ring is set up with a table of registered file slots,
+ * so a file is opened, read or written and closed by three linked operations submitted at
+ * once. When the ring cannot be set up (an old kernel, a sandbox or another system), the
+ * same requests are served synchronously.
+ *
+ * @param options Options of the run.
+ */
+void io_init(ASSEMBLER_OPTIONS * options){
+    io_backend.enabled = options->async_io;
+    io_backend.uring = FALSE;
+    io_backend.depth = options->prefetch_depth;
+    io_backend.ring_fd = -1;
+    io_backend.unsubmitted = 0;
+    io_backend.prefetched = NULL;
+    io_backend.writes = NULL;
+    io_backend.failed_writes = 0;
+    memset(io_backend.slot_used , 0 , sizeof(io_backend.slot_used));
+    pthread_mutex_init(&io_backend.lock , NULL);
+    if(io_backend.enabled == TRUE){
+        io_backend.uring = io_uring_Setup();
+    }
+}
+
+/**
+ * @brief Sets up the io_uring ring and its registered file slots.
+ *
+ * @return TRUE if the ring is ready, FALSE to use the synchronous fallback.
+ */
+BOOLEAN io_uring_Setup(void){
+#ifdef __linux__
+    struct io_uring_params params;
+    int files[IO_FILE_SLOTS];
+    int i;
+
+    memset(&params , 0 , sizeof(params));
+    io_backend.ring_fd = syscall(__NR_io_uring_setup , IO_RING_ENTRIES , &params);
+    if(io_backend.ring_fd < 0){
+        return FALSE;
+    }
+
+    io_backend.sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    io_backend.cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    /* Both rings share one mapping when the kernel allows it */
+    if(params.features & IORING_FEAT_SINGLE_MMAP){
+        if(io_backend.cq_ring_size > io_backend.sq_ring_size){
+            io_backend.sq_ring_size = io_backend.cq_ring_size;
+        }
+        io_backend.cq_ring_size = 0;
+    }
+    io_backend.sq_ring = mmap(NULL , io_backend.sq_ring_size , PROT_READ | PROT_WRITE , MAP_SHARED , io_backend.ring_fd , IORING_OFF_SQ_RING);
+    io_backend.cq_ring = io_backend.sq_ring;
+    if(io_backend.sq_ring != MAP_FAILED && io_backend.cq_ring_size != 0){
+        io_backend.cq_ring = mmap(NULL , io_backend.cq_ring_size , PROT_READ | PROT_WRITE , MAP_SHARED , io_backend.ring_fd , IORING_OFF_CQ_RING);
+    }
+    io_backend.sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    io_backend.sqes = mmap(NULL , io_backend.sqes_size , PROT_READ | PROT_WRITE , MAP_SHARED , io_backend.ring_fd , IORING_OFF_SQES);
+    if(io_backend.sq_ring == MAP_FAILED || io_backend.cq_ring == MAP_FAILED || io_backend.sqes == MAP_FAILED){
+        io_uring_Teardown();
+        return FALSE;
+    }
+
+    io_backend.sq_tail = (unsigned *)((char *)io_backend.sq_ring + params.sq_off.tail);
+    io_backend.sq_mask = (unsigned *)((char *)io_backend.sq_ring + params.sq_off.ring_mask);
+    io_backend.sq_array = (unsigned *)((char *)io_backend.sq_ring + params.sq_off.array);
+    io_backend.cq_head = (unsigned *)((char *)io_backend.cq_ring + params.cq_off.head);
+    io_backend.cq_tail = (unsigned *)((char *)io_backend.cq_ring + params.cq_off.tail);
+    io_backend.cq_mask = (unsigned *)((char *)io_backend.cq_ring + params.cq_off.ring_mask);
+    io_backend.cqes = (char *)io_backend.cq_ring + params.cq_off.cqes;
+
+    /* Empty slots, filled by the opens of the requests */
+    for(i = 0 ; i < IO_FILE_SLOTS ; i++){
+        files[i] = -1;
+    }
+    if(syscall(__NR_io_uring_register , io_backend.ring_fd , IORING_REGISTER_FILES , files , IO_FILE_SLOTS) < 0){
+        io_uring_Teardown();
+        return FALSE;
+    }
+    return TRUE;
+#else
+    return FALSE;
+#endif
+}
+
+/**
+ * @brief Unmaps the rings and closes the io_uring file descriptor.
+ */
+void io_uring_Teardown(void){
+    if(io_backend.sqes != NULL && io_backend.sqes != MAP_FAILED){
+        munmap(io_backend.sqes , io_backend.sqes_size);
+    }
+    if(io_backend.cq_ring != NULL && io_backend.cq_ring != MAP_FAILED && io_backend.cq_ring != io_backend.sq_ring){
+        munmap(io_backend.cq_ring , io_backend.cq_ring_size);
+    }
+    if(io_backend.sq_ring != NULL && io_backend.sq_ring != MAP_FAILED){
+        munmap(io_backend.sq_ring , io_backend.sq_ring_size);
+    }
+    io_backend.sqes = io_backend.cq_ring = io_backend.sq_ring = NULL;
+    if(io_backend.ring_fd >= 0){
+        close(io_backend.ring_fd);
+    }
+    io_backend.ring_fd = -1;
+    io_backend.uring = FALSE;
+}
+
+/**
+ * @brief Hands the queued entries to the kernel and, when asked to, waits for a completion.
+ *
+ * Called with the backend lock held.
+ *
+ * @param wait TRUE to wait for at least one completion, FALSE otherwise.
+ */
+void io_uring_Enter(BOOLEAN wait){
+#ifdef __linux__
+    long submitted;
+
+    submitted = syscall(__NR_io_uring_enter , io_backend.ring_fd , io_backend.unsubmitted , (wait == TRUE) ? 1 : 0 ,
+                        (wait == TRUE) ? IORING_ENTER_GETEVENTS : 0 , NULL , 0);
+    if(submitted > 0){
+        io_backend.unsubmitted -= submitted;
+    }
+#endif
+}
+
+/**
+ * @brief Queues the linked open, read or write, and close operations of a request.
+ *
+ * The file is opened straight into the registered slot of the request, so the read or
+ * write can use it without waiting for the open to complete. The close is hard linked,
+ * so the slot is released even when the read or write fails. Called with the backend lock held.
+ *
+ * @param request Pointer to the request.
+ */
+void io_uring_Queue(IO_REQUEST * request){
+#ifdef __linux__
+    struct io_uring_sqe * sqe = NULL;
+    unsigned tail = *io_backend.sq_tail;
+    int i;
+
+    for(i = 0 ; i < 3 ; i++){
+        sqe = (struct io_uring_sqe *)io_backend.sqes + ((tail + i) & *io_backend.sq_mask);
+        memset(sqe , 0 , sizeof(*sqe));
+        /* The operation is kept in the low bits of the user data */
+        sqe->user_data = (unsigned long)request | i;
+        io_backend.sq_array[(tail + i) & *io_backend.sq_mask] = (tail + i) & *io_backend.sq_mask;
+    }
+
+    sqe = (struct io_uring_sqe *)io_backend.sqes + (tail & *io_backend.sq_mask);
+    sqe->opcode = IORING_OP_OPENAT;
+    sqe->fd = AT_FDCWD;
+    sqe->addr = (unsigned long)request->path;
+    sqe->open_flags = (request->type == IO_READ) ? O_RDONLY : (O_WRONLY | O_CREAT | O_TRUNC);
+    sqe->len = 0666;
+    sqe->file_index = request->slot + 1;
+    sqe->flags = IOSQE_IO_LINK;
+
+    sqe = (struct io_uring_sqe *)io_backend.sqes + ((tail + 1) & *io_backend.sq_mask);
+    sqe->opcode = (request->type == IO_READ) ? IORING_OP_READ : IORING_OP_WRITE;
+    sqe->fd = request->slot;
+    sqe->addr = (unsigned long)request->text;
+    sqe->len = request->length;
+    sqe->off = 0;
+    sqe->flags = IOSQE_FIXED_FILE | IOSQE_IO_HARDLINK;
+
+    sqe = (struct io_uring_sqe *)io_backend.sqes + ((tail + 2) & *io_backend.sq_mask);
+    sqe->opcode = IORING_OP_CLOSE;
+    sqe->file_index = request->slot + 1;
+
+    request->pending = 3;
+    __atomic_store_n(io_backend.sq_tail , tail + 3 , __ATOMIC_RELEASE);
+    io_backend.unsubmitted += 3;
+#endif
+}
+
+/**
+ * @brief Takes the completions from the ring and updates their requests.
+ *
+ * Called with the backend lock held.
+ */
+void io_uring_Reap(void){
+#ifdef __linux__
+    struct io_uring_cqe * cqe = NULL;
+    IO_REQUEST * request = NULL;
+    unsigned head = *io_backend.cq_head;
+    int operation;
+
+    while(head != __atomic_load_n(io_backend.cq_tail , __ATOMIC_ACQUIRE)){
+        cqe = (struct io_uring_cqe *)io_backend.cqes + (head & *io_backend.cq_mask);
+        request = (IO_REQUEST *)(unsigned long)(cqe->user_data & ~3UL);
+        operation = cqe->user_data & 3UL;
+        /* Keep the first error of the request, or the size of the transfer */
+        if(cqe->res < 0 && request->result >= 0){
+            request->result = cqe->res;
+        }
+        else if(operation == 1 && request->result >= 0){
+            request->result = cqe->res;
+        }
+        request->pending--;
+        if(request->pending == 0){
+            io_backend.slot_used[request->slot] = 0;
+            request->slot = -1;
+            io_Complete(request);
+        }
+        head++;
+    }
+    __atomic_store_n(io_backend.cq_head , head , __ATOMIC_RELEASE);
+#endif
+}
+
+/**
+ * @brief Finishes a request whose operations completed.
+ *
+ * A request that failed on the ring (a short transfer, or a kernel without direct
+ * descriptors) is served again synchronously. A replacing write puts its temporary
+ * file in place of the target with commit_Temp_File. A finished write is released, unless it
+ * failed, in which case it is kept for io_finish to report. Called with the backend lock held.
+ *
+ * @param request Pointer to the request.
+ */
+void io_Complete(IO_REQUEST * request){
+    IO_REQUEST ** link = NULL;
+    int fd;
+
+    if(request->result != request->length){
+        io_Serve_Sync(request);
+    }
+    /* Put a replaced file in place once it is completely written */
+    if(request->target[0] != '\0'){
+        fd = (request->result == request->length) ? open(request->path , O_WRONLY) : -1;
+        if(fd < 0 || commit_Temp_File(fd , request->path , request->target) == FALSE){
+            unlink(request->path);
+            request->result = -1;
+        }
+    }
+    request->done = TRUE;
+    if(request->type == IO_WRITE && request->result == request->length){
+        for(link = &io_backend.writes ; *link != NULL ; link = &(*link)->next){
+            if(*link == request){
+                *link = request->next;
+                break;
+            }
+        }
+        io_release(request);
+    }
+}
+
+/**
+ * @brief Reads or writes the file of a request with plain system calls.
+ *
+ * @param request Pointer to the request.
+ */
+void io_Serve_Sync(IO_REQUEST * request){
+    long done = 0 , count;
+    int fd;
+
+    request->result = -1;
+    if(request->type == IO_READ){
+        fd = open(request->path , O_RDONLY);
+    }
+    else{
+        fd = open(request->path , O_WRONLY | O_CREAT | O_TRUNC , 0666);
+    }
+    if(fd < 0){
+        return;
+    }
+    while(done < request->length){
+        if(request->type == IO_READ){
+            count = read(fd , request->text + done , request->length - done);
+        }
+        else{
+            count = write(fd , request->text + done , request->length - done);
+        }
+        if(count <= 0){
+            break;
+        }
+        done += count;
+    }
+    if(close(fd) == 0 && done == request->length){
+        request->result = done;
+    }
+}
+
+/**
+ * @brief Starts a request: on the ring when there is one, synchronously otherwise.
+ *
+ * Waits for a free registered file slot when all of them are in use.
+ *
+ * @param request Pointer to the request.
+ */
+void io_Start(IO_REQUEST * request){
+    int i;
+
+    pthread_mutex_lock(&io_backend.lock);
+    if(request->type == IO_WRITE){
+        request->next = io_backend.writes;
+        io_backend.writes = request;
+    }
+    /* Files larger than a single transfer are served synchronously */
+    if(io_backend.uring == FALSE || request->length > INT_MAX){
+        io_Serve_Sync(request);
+        io_Complete(request);
+        pthread_mutex_unlock(&io_backend.lock);
+        return;
+    }
+    while(request->slot < 0){
+        for(i = 0 ; i < IO_FILE_SLOTS && request->slot < 0 ; i++){
+            if(io_backend.slot_used[i] == 0){
+                io_backend.slot_used[i] = 1;
+                request->slot = i;
+            }
+        }
+        /* Every slot is in use: wait for a request to complete */
+        if(request->slot < 0){
+            io_uring_Enter(TRUE);
+            io_uring_Reap();
+        }
+    }
+    io_uring_Queue(request);
+    io_uring_Enter(FALSE);
+    pthread_mutex_unlock(&io_backend.lock);
+}
+
+/**
+ * @brief Creates a request for a whole file.
+ *
+ * @param type IO_READ or IO_WRITE.
+ * @param path Path of the file.
+ * @param text The text to write, or NULL for a read.
+ * @param length Length of the text.
+ * @return Pointer to the new request.
+ */
+IO_REQUEST * io_Create(int type , char * path , char * text , long length){
+    IO_REQUEST * request = generic_malloc(sizeof(IO_REQUEST));
+
+    request->type = type;
+    memset(request->path , '\0' , sizeof(request->path));
+    strncpy(request->path , path , sizeof(request->path) - 1);
+    memset(request->target , '\0' , sizeof(request->target));
+    request->text = text;
+    request->length = length;
+    request->slot = -1;
+    request->pending = 0;
+    request->result = 0;
+    request->done = FALSE;
+    request->next = NULL;
+    return request;
+}
+
+/**
+ * @brief Starts reading a whole file into memory.
+ *
+ * @param path Path of the file.
+ * @return Pointer to the request, or NULL if the file cannot be read.
+ */
+IO_REQUEST * io_read_file(char * path){
+    IO_REQUEST * request = NULL;
+    struct stat file_stat;
+    char * text = NULL;
+
+    if(stat(path , &file_stat) != 0 || !S_ISREG(file_stat.st_mode)){
+        return NULL;
+    }
+    text = generic_malloc(file_stat.st_size + 1);
+    text[file_stat.st_size] = '\0';
+    request = io_Create(IO_READ , path , text , file_stat.st_size);
+    io_Start(request);
+    return request;
+}
+
+/**
+ * @brief Starts writing a whole file, which completes while the assembler goes on.
+ *
+ * @param path Path of the file.
+ * @param text The text to write (owned by the request from now on).
+ * @param length Length of the text.
+ */
+void io_write_file(char * path , char * text , long length){
+    io_Start(io_Create(IO_WRITE , path , text , length));
+}
+
+/**
+ * @brief Starts replacing a file: the text is written to a temporary file, which is then renamed over it.
+ *
+ * @param path Path of the file.
+ * @param text The text to write (owned by the request from now on).
+ * @param length Length of the text.
+ */
+void io_replace_file(char * path , char * text , long length){
+    IO_REQUEST * request = io_Create(IO_WRITE , path , text , length);
+
+    strcpy(request->target , path);
+    temp_Path(request->path , path);
+    io_Start(request);
+}
+
+/**
+ * @brief Waits for a request to complete.
+ *
+ * The waiting thread holds the backend lock while it waits on the ring, so a completion
+ * is never taken by one thread while another one sleeps waiting for it.
+ *
+ * @param request Pointer to the request.
+ */
+void io_wait(IO_REQUEST * request){
+    pthread_mutex_lock(&io_backend.lock);
+    while(request->done == FALSE){
+        io_uring_Reap();
+        if(request->done == FALSE){
+            io_uring_Enter(TRUE);
+        }
+    }
+    pthread_mutex_unlock(&io_backend.lock);
+}
+
+/**
+ * @brief Frees a request and its text.
+ *
+ * @param request Pointer to the request.
+ */
+void io_release(IO_REQUEST * request){
+    if(request != NULL){
+        free(request->text);
+        free(request);
+    }
+}
+
+/**
+ * @brief Starts reading a source file ahead of its turn.
+ *
+ * Does nothing without asynchronous I/O, or when the file is already read ahead.
+ *
+ * @param file_name Name of the source file, without the ".as" suffix.
+ */
+void io_prefetch(char * file_name){
+    IO_REQUEST * request = NULL;
+    char * file_as = NULL;
+
+    /* Standard input cannot be read ahead, members of the input archive are already mapped */
+    if(io_backend.enabled == FALSE || strcmp(file_name , STDIN_NAME) == 0){
+        return;
+    }
+    file_as = add_suffix(file_name , ".as");
+    if(find_Archive_Member(file_as) != NULL){
+        free(file_as);
+        return;
+    }
+    pthread_mutex_lock(&io_backend.lock);
+    for(request = io_backend.prefetched ; request != NULL ; request = request->next){
+        if(strcmp(request->path , file_as) == 0){
+            break;
+        }
+    }
+    pthread_mutex_unlock(&io_backend.lock);
+
+    if(request == NULL){
+        request = io_read_file(file_as);
+        if(request != NULL){
+            pthread_mutex_lock(&io_backend.lock);
+            request->next = io_backend.prefetched;
+            io_backend.prefetched = request;
+            pthread_mutex_unlock(&io_backend.lock);
+        }
+    }
+    free(file_as);
+}
+
+/**
+ * @brief Takes a source file that was read ahead.
+ *
+ * @param path Path of the source file.
+ * @return Pointer to the completed request (to release with io_release), or NULL if the
+ * file was not read ahead or could not be read.
+ */
+IO_REQUEST * io_take_prefetched(char * path){
+    IO_REQUEST * request = NULL , ** link = NULL;
+
+    if(io_backend.enabled == FALSE){
+        return NULL;
+    }
+    pthread_mutex_lock(&io_backend.lock);
+    for(link = &io_backend.prefetched ; *link != NULL ; link = &(*link)->next){
+        if(strcmp((*link)->path , path) == 0){
+            request = *link;
+            *link = request->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&io_backend.lock);
+
+    if(request == NULL){
+        return NULL;
+    }
+    io_wait(request);
+    if(request->result != request->length){
+        io_release(request);
+        return NULL;
+    }
+    return request;
+}
+
+/**
+ * @brief Waits for every write, reports the files that could not be written and shuts the backend down.
+ *
+ * @return TRUE if every output file was written, FALSE otherwise.
+ */
+BOOLEAN io_finish(void){
+    IO_REQUEST * request = NULL;
+
+    if(io_backend.enabled == FALSE){
+        return (io_backend.failed_writes == 0) ? TRUE : FALSE;
+    }
+    /* Successful writes are released when they complete, failed ones stay in the list */
+    pthread_mutex_lock(&io_backend.lock);
+    request = io_backend.writes;
+    while(request != NULL){
+        io_uring_Reap();
+        for(request = io_backend.writes ; request != NULL && request->done == TRUE ; request = request->next);
+        if(request != NULL){
+            io_uring_Enter(TRUE);
+        }
+    }
+    pthread_mutex_unlock(&io_backend.lock);
+    while(io_backend.writes != NULL){
+        request = io_backend.writes;
+        io_backend.writes = request->next;
+        report_error(FAILED_TO_WRITE_FILE , (request->target[0] != '\0') ? request->target : request->path , NO_LINE);
+        io_release(request);
+        io_backend.failed_writes++;
+    }
+    /* Files read ahead but never assembled */
+    while(io_backend.prefetched != NULL){
+        request = io_backend.prefetched;
+        io_backend.prefetched = request->next;
+        io_wait(request);
+        io_release(request);
+    }
+    io_uring_Teardown();
+    pthread_mutex_destroy(&io_backend.lock);
+    return (io_backend.failed_writes == 0) ? TRUE : FALSE;
+}
+
+/**
+ * @brief Starts collecting an output file in memory.
+ *
+ * @param output Pointer to the output file.
+ */
+void output_open(OUTPUT_FILE * output){
+    output->text = NULL;
+    output->length = 0;
+    output->capacity = 0;
+}
+
+/**
+ * @brief Writes a string to an output file.
+ *
+ * @param output Pointer to the output file.
+ * @param text The string to write.
+ */
+void output_write(OUTPUT_FILE * output , char * text){
+    output_append(output , text , strlen(text));
+}
+
+/**
+ * @brief Writes bytes to an output file.
+ *
+ * @param output Pointer to the output file.
+ * @param text The bytes to write (may hold null characters).
+ * @param length Number of bytes.
+ */
+void output_append(OUTPUT_FILE * output , const char * text , long length){
+    char * grown = NULL;
+
+    if(output->length + length > output->capacity){
+        grown = realloc(output->text , 2 * (output->capacity + length));
+        if(grown == NULL){
+            print_error(MEMORY_ALLOCATION_FAILED , NO_LINE);
+            exit(1);
+        }
+        output->text = grown;
+        output->capacity = 2 * (output->capacity + length);
+    }
+    memcpy(output->text + output->length , text , length);
+    output->length += length;
+}
+
+/**
+ * @brief Checks whether a file already holds exactly the given text.
+ *
+ * The sizes are compared first, so a changed file is usually detected without reading it.
+ *
+ * @param path Path of the file.
+ * @param text The text.
+ * @param length Length of the text.
+ * @return TRUE if the file exists with the same bytes, FALSE otherwise.
+ */
+BOOLEAN file_Has_Content(char * path , char * text , long length){
+    char block[OUTPUT_COMPARE_BLOCK];
+    struct stat file_stat;
+    long done = 0 , count;
+    BOOLEAN same = TRUE;
+    int fd;
+
+    if(stat(path , &file_stat) != 0 || !S_ISREG(file_stat.st_mode) || (long)file_stat.st_size != length){
+        return FALSE;
+    }
+    fd = open(path , O_RDONLY);
+    if(fd < 0){
+        return FALSE;
+    }
+    while(done < length && same == TRUE){
+        count = read(fd , block , (length - done < OUTPUT_COMPARE_BLOCK) ? length - done : OUTPUT_COMPARE_BLOCK);
+        if(count <= 0 || memcmp(block , text + done , count) != 0){
+            same = FALSE;
+        }
+        done += (count > 0) ? count : 0;
+    }
+    close(fd);
+    return same;
+}
+
+/**
+ * @brief Builds the name of the temporary file an output is written to before it replaces the file.
+ *
+ * The temporary file is in the same directory, so the rename that replaces the file is atomic.
+ *
+ * @param temp Buffer of IO_PATH_LENGTH characters receiving the name.
+ * @param path Path of the output file.
+ */
+void temp_Path(char * temp , char * path){
+    sprintf(temp , "%.*s.%ld.%ld.tmp" , MAX_FILE_LINE_LENGTH - 1 , path , (long)getpid() ,
+            (long)__atomic_fetch_add(&temp_counter , 1 , __ATOMIC_RELAXED));
+}
+
+/**
+ * @brief Flushes the directory holding a file to disk, so a rename into it survives a crash.
+ *
+ * Some file systems cannot flush a directory; the rename is then left to them.
+ *
+ * @param path Path of the file.
+ */
+void sync_Directory(char * path){
+    char directory[IO_PATH_LENGTH];
+    char * slash = NULL;
+    int fd;
+
+    strncpy(directory , path , sizeof(directory) - 1);
+    directory[sizeof(directory) - 1] = '\0';
+    slash = strrchr(directory , '/');
+    if(slash == NULL){
+        strcpy(directory , ".");
+    }
+    else{
+        slash[(slash == directory) ? 1 : 0] = '\0';
+    }
+    fd = open(directory , O_RDONLY);
+    if(fd >= 0){
+        fsync(fd);
+        close(fd);
+    }
+}
+
+/**
+ * @brief Puts a completely written temporary file in place of the file it replaces.
+ *
+ * The temporary file takes the permissions of the file it replaces, is flushed to disk
+ * and closed, and only then renamed over it; the directory is flushed after the rename.
+ * After a crash the file is either the old one or the new one, never an empty one.
+ * The temporary file is removed when any step fails.
+ *
+ * @param fd Open descriptor of the temporary file (closed here).
+ * @param temp Path of the temporary file.
+ * @param path Path of the file to replace.
+ * @return TRUE if the file was replaced, FALSE otherwise.
+ */
+BOOLEAN commit_Temp_File(int fd , char * temp , char * path){
+    struct stat file_stat;
+    BOOLEAN result = TRUE;
+
+    if(stat(path , &file_stat) == 0 && fchmod(fd , file_stat.st_mode & 07777) != 0){
+        result = FALSE;
+    }
+    if(fsync(fd) != 0){
+        result = FALSE;
+    }
+    if(close(fd) != 0 || result == FALSE || rename(temp , path) != 0){
+        unlink(temp);
+        return FALSE;
+    }
+    sync_Directory(path);
+    return TRUE;
+}
+
+/**
+ * @brief Replaces a file with the given text: written to a temporary file, then renamed over it.
+ *
+ * Readers of the file see either the old or the new content, never a partly written file,
+ * even after a crash, and the new file keeps the permissions of the old one.
+ *
+ * @param path Path of the file.
+ * @param text The text to write.
+ * @param length Length of the text.
+ * @return TRUE if the file was replaced, FALSE otherwise.
+ */
+BOOLEAN replace_File(char * path , char * text , long length){
+    char temp[IO_PATH_LENGTH];
+    long done = 0 , count;
+    BOOLEAN result = TRUE;
+    int fd;
+
+    temp_Path(temp , path);
+    fd = open(temp , O_WRONLY | O_CREAT | O_EXCL , 0666);
+    if(fd < 0){
+        return FALSE;
+    }
+    while(done < length && result == TRUE){
+        count = write(fd , text + done , length - done);
+        if(count <= 0){
+            result = FALSE;
+        }
+        done += (count > 0) ? count : 0;
+    }
+    if(result == FALSE){
+        close(fd);
+        unlink(temp);
+        return FALSE;
+    }
+    return commit_Temp_File(fd , temp , path);
+}
+
+/**
+ * @brief Closes an output file, writing it only when its content changed.
+ *
+ * An unchanged file keeps its modification time, so tools that rebuild from the outputs
+ * see nothing to do. A changed file is replaced atomically, right away or through the
+ * I/O backend with asynchronous I/O. With `--stdout` the file is added to the bundle of
+ * the current file instead, as a `PATH LENGTH` line followed by the LENGTH bytes.
+ *
+ * @param output Pointer to the output file.
+ * @param path Path of the file.
+ */
+void output_close(OUTPUT_FILE * output , char * path){
+    DIAGNOSTICS * diagnostics = get_current_diagnostics();
+    char frame[IO_PATH_LENGTH + 24];
+
+    if(diagnostics != NULL && diagnostics->bundle_outputs == TRUE){
+        sprintf(frame , "%.*s %ld\n" , IO_PATH_LENGTH - 1 , path , output->length);
+        output_write(&diagnostics->bundle , frame);
+        output_append(&diagnostics->bundle , output->text , output->length);
+        free(output->text);
+    }
+    else if(file_Has_Content(path , output->text , output->length) == TRUE){
+        free(output->text);
+    }
+    else if(io_backend.enabled == TRUE){
+        io_replace_file(path , output->text , output->length);
+    }
+    else{
+        if(replace_File(path , output->text , output->length) == FALSE){
+            report_error(FAILED_TO_WRITE_FILE , path , NO_LINE);
+            __atomic_fetch_add(&io_backend.failed_writes , 1 , __ATOMIC_RELAXED);
+        }
+        free(output->text);
+    }
+    output->text = NULL;
+}
+
+/**
+ * @brief Closes an output file that turned out empty and removes the file of an earlier run.
+ *
+ * With `--stdout` the file is left out of the bundle and nothing is removed.
+ *
+ * @param output Pointer to the output file.
+ * @param path Path of the file.
+ * @return TRUE if no file is left, FALSE if it could not be removed.
+ */
+BOOLEAN output_discard(OUTPUT_FILE * output , char * path){
+    DIAGNOSTICS * diagnostics = get_current_diagnostics();
+
+    free(output->text);
+    output->text = NULL;
+    if(diagnostics != NULL && diagnostics->bundle_outputs == TRUE){
+        return TRUE;
+    }
+    return (remove(path) == 0 || errno == ENOENT) ? TRUE : FALSE;
+}
@@ -0,0 +1,503 @@
+#include "assembler.h"
+
+/* Diagnostics each thread reports into (NULL outside of a file) */
+pthread_key_t diagnostics_key;
+pthread_once_t diagnostics_key_once = PTHREAD_ONCE_INIT;
+
+/* Error messages in the order of their codes, code 0 is kept for unknown messages */
+const char * error_messages[] = {
+    "",
+    FAILED_TO_OPEN_FILE,
+    MEMORY_ALLOCATION_FAILED,
+    FAILED_TO_REMOVE_FILE,
+    INVALID_MACRO_NAME,
+    CANNOT_BE_RESERVED_WORD,
+    EXTRANOUS_TEXT_AFTER_END_OF_MACRO,
+    EXCEEDED_MACRO_NAME_LENGTH,
+    INVALID_LABEL,
+    ILLEGAL_LABEL_NAME_LENGTH,
+    EXTRANOUS_TEXT_AFTER_STOP_COMMAND,
+    EXTRANOUS_TEXT_AFTER_RTS_COMMAND,
+    INVALID_OPERAND,
+    MISSING_OPERAND,
+    INVALID_NUMBER,
+    INVALID_OPERAND_NAME,
+    MACRO_NAME_ALREADY_DEFINED,
+    LABEL_ALREADY_DEFINED,
+    MISSING_QUOTE,
+    MISSING_STRING,
+    INVALID_CHARACTER,
+    NOT_A_LABEL,
+    MISSING_PARAMETER,
+    IS_NOT_A_NUMBER,
+    INVALID_COMMA,
+    MISSING_NUMBER,
+    MISSING_MACRO_NAME,
+    NUMBER_OUT_OF_BOUND,
+    ALREADY_DEFINED_AS_EXTERN,
+    ALREADY_DEFINED_AS_ENTRY,
+    MISSING_LABEL,
+    FILE_LENGTH_EXCEED,
+    INVALID_FILL_COUNT,
+    INVALID_INCBIN_OPERANDS,
+    FAILED_TO_OPEN_INCBIN_FILE,
+    INCBIN_OUT_OF_RANGE,
+    UNKNOWN_OPTION,
+    LABEL_NOT_DEFINED,
+    UNDEFINED_INSTRUCTION_NAME,
+    TOO_MANY_ERRORS,
+    FAILED_TO_WRITE_FILE,
+    INVALID_MACRO_LIBRARY,
+    NOT_A_MACRO_DEFINITION,
+    MISSING_END_OF_MACRO,
+    INVALID_INCLUDE,
+    FAILED_TO_OPEN_INCLUDE_FILE,
+    INCLUDE_TOO_DEEP,
+    INCLUDED_FILE_HAS_ERRORS,
+    FAILED_TO_START_THREAD,
+    INVALID_JOBS,
+    INVALID_OUTPUT,
+    STDIN_NEEDS_STDOUT,
+    INVALID_ARCHIVE,
+    PROGRAM_TOO_LARGE
+};
+
+/**
+ * @brief Creates the key holding the current diagnostics of each thread.
+ */
+void create_diagnostics_key(void){
+    pthread_key_create(&diagnostics_key , NULL);
+}
+
+/**
+ * @brief Makes a diagnostics buffer the current one of the calling thread.
+ *
+ * Each thread of a pipeline reports into a buffer of its own.
+ *
+ * @param diagnostics Pointer to the diagnostics buffer, or NULL for none.
+ */
+void set_current_diagnostics(DIAGNOSTICS * diagnostics){
+    pthread_once(&diagnostics_key_once , create_diagnostics_key);
+    pthread_setspecific(diagnostics_key , diagnostics);
+}
+
+/**
+ * @brief Returns the current diagnostics buffer of the calling thread.
+ *
+ * @return Pointer to the diagnostics buffer, or NULL outside of a file.
+ */
+DIAGNOSTICS * get_current_diagnostics(void){
+    pthread_once(&diagnostics_key_once , create_diagnostics_key);
+    return pthread_getspecific(diagnostics_key);
+}
+
+/**
+ * @brief Initializes an empty diagnostics buffer.
+ *
+ * @param diagnostics Pointer to the diagnostics buffer.
+ */
+void open_diagnostics(DIAGNOSTICS * diagnostics){
+    output_open(&diagnostics->text);
+    diagnostics->count = 0;
+    diagnostics->streaming = FALSE;
+    diagnostics->stream = NULL;
+    output_open(&diagnostics->bundle);
+    memset(diagnostics->code_messages , 0 , sizeof(diagnostics->code_messages));
+    diagnostics->recording = FALSE;
+    diagnostics->entries = NULL;
+    diagnostics->capacity = 0;
+}
+
+/**
+ * @brief Prepares a diagnostics buffer for a new file and makes it the current one.
+ *
+ * The text and the bundle of the buffer are kept between files, so only the counters
+ * are reset. With `--stdout` the diagnostics go to stderr; with `--stdout` or
+ * `--output-archive` the output files are collected in the bundle.
+ *
+ * @param diagnostics Pointer to the diagnostics buffer (reused from file to file).
+ * @param file_name Name of the source file.
+ * @param options Options of the run (error limit and output format).
+ */
+void begin_diagnostics(DIAGNOSTICS * diagnostics , char * file_name , ASSEMBLER_OPTIONS * options){
+    memset(diagnostics->file_name , '\0' , sizeof(diagnostics->file_name));
+    strncpy(diagnostics->file_name , file_name , sizeof(diagnostics->file_name) - 1);
+    diagnostics->text.length = 0;
+    diagnostics->count = 0;
+    diagnostics->max_errors = options->max_errors;
+    diagnostics->format = options->diagnostics_format;
+    diagnostics->limit_reached = FALSE;
+    diagnostics->stream = (options->to_stdout == TRUE) ? stderr : stdout;
+    diagnostics->bundle_outputs = options->bundle_outputs;
+    diagnostics->bundle.length = 0;
+    set_current_diagnostics(diagnostics);
+}
+
+/**
+ * @brief Returns the code of an error message.
+ *
+ * @param error_message The error message (one of the error message definitions).
+ * @return The code of the message, or 0 for an unknown message.
+ */
+int error_code(const char * error_message){
+    int i;
+    int count = sizeof(error_messages) / sizeof(error_messages[0]);
+
+    for(i = 1 ; i < count ; i++){
+        if(strcmp(error_messages[i] , error_message) == 0){
+            return i;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Returns the code of an error message, remembering it by the address of the message.
+ *
+ * The messages are string constants, so a message reported again has the same address
+ * and its code is found without comparing strings.
+ *
+ * @param diagnostics The diagnostics buffer holding the cache.
+ * @param error_message The error message (one of the error message definitions).
+ * @return The code of the message, or 0 for an unknown message.
+ */
+int diagnostic_code(DIAGNOSTICS * diagnostics , const char * error_message){
+    int slot = (int)(((unsigned long)error_message >> 2) % DIAGNOSTIC_CODE_CACHE);
+
+    if(diagnostics->code_messages[slot] != error_message){
+        diagnostics->codes[slot] = error_code(error_message);
+        diagnostics->code_messages[slot] = error_message;
+    }
+    return diagnostics->codes[slot];
+}
+
+/**
+ * @brief Appends formatted diagnostics to the text of a diagnostics buffer.
+ *
+ * A streaming buffer writes its text once it fills a chunk, so a file with many errors
+ * does not hold them all in memory. Without memory to grow the text, the diagnostics
+ * collected so far and the new ones are written right away instead.
+ *
+ * @param diagnostics Pointer to the diagnostics buffer.
+ * @param text The formatted diagnostics.
+ * @param length Length of the text.
+ */
+void append_diagnostic_text(DIAGNOSTICS * diagnostics , const char * text , long length){
+    FILE * stream = (diagnostics->stream != NULL) ? diagnostics->stream : stdout;
+    char * grown = NULL;
+
+    if(diagnostics->streaming == TRUE && diagnostics->text.length + length > DIAGNOSTICS_CHUNK){
+        fwrite(diagnostics->text.text , 1 , diagnostics->text.length , stream);
+        diagnostics->text.length = 0;
+    }
+    if(diagnostics->text.length + length > diagnostics->text.capacity){
+        grown = realloc(diagnostics->text.text , 2 * (diagnostics->text.capacity + length));
+        if(grown == NULL){
+            fwrite(diagnostics->text.text , 1 , diagnostics->text.length , stream);
+            fwrite(text , 1 , length , stream);
+            fflush(stream);
+            diagnostics->text.length = 0;
+            return;
+        }
+        diagnostics->text.text = grown;
+        diagnostics->text.capacity = 2 * (diagnostics->text.capacity + length);
+    }
+    memcpy(diagnostics->text.text + diagnostics->text.length , text , length);
+    diagnostics->text.length += length;
+}
+
+/**
+ * @brief Adds a diagnostic to the current file.
+ *
+ * The diagnostic is formatted right away and appended to the text of the current file.
+ * When the number of errors reaches the limit of the file, a single TOO_MANY_ERRORS
+ * diagnostic is added and any further error is dropped. Errors reported outside of a
+ * file are printed right away.
+ *
+ * @param error_message The error message (one of the error message definitions).
+ * @param detail Additional text appended to the message (e.g. a label name), or NULL.
+ * @param line The line number, or NO_LINE.
+ */
+void report_error(const char * error_message , const char * detail , int line){
+    DIAGNOSTICS * diagnostics = get_current_diagnostics();
+    DIAGNOSTIC entry;
+
+    /* Errors after the limit are dropped */
+    if(diagnostics != NULL && diagnostics->limit_reached == TRUE){
+        return;
+    }
+
+    /* Fill the entry */
+    entry.code = (diagnostics != NULL) ? diagnostic_code(diagnostics , error_message) : error_code(error_message);
+    entry.line = line;
+    memset(entry.message , '\0' , sizeof(entry.message));
+    strncpy(entry.message , error_message , sizeof(entry.message) - 1);
+    if(detail != NULL){
+        strncat(entry.message , ": " , sizeof(entry.message) - strlen(entry.message) - 1);
+        strncat(entry.message , detail , sizeof(entry.message) - strlen(entry.message) - 1);
+    }
+    entry.file[0] = '\0';
+    report_diagnostic(&entry);
+}
+
+/**
+ * @brief Adds a diagnostic that is already filled in to the current file.
+ *
+ * A recording buffer (that of an included file being preprocessed) keeps the entry as
+ * it is, so it can be reported again to every file including it; any other buffer
+ * formats it right away. The errors of an included file are reported this way to each
+ * of its includers, and count towards their error limit.
+ *
+ * @param entry The diagnostic (its code, line, message and file).
+ */
+void report_diagnostic(DIAGNOSTIC * entry){
+    DIAGNOSTICS * diagnostics = get_current_diagnostics();
+    DIAGNOSTICS standalone;
+    DIAGNOSTIC limit , * grown = NULL;
+    char output[MAX_DIAGNOSTIC_OUTPUT];
+
+    /* Errors after the limit are dropped */
+    if(diagnostics != NULL && diagnostics->limit_reached == TRUE){
+        return;
+    }
+
+    /* Outside of a file there is nothing to collect into */
+    if(diagnostics == NULL){
+        memset(&standalone , 0 , sizeof(standalone));
+        standalone.format = DIAGNOSTICS_TEXT;
+        format_diagnostic(&standalone , entry , output);
+        fputs(output , stdout);
+        return;
+    }
+    if(diagnostics->recording == TRUE){
+        if(diagnostics->count == diagnostics->capacity){
+            grown = realloc(diagnostics->entries , sizeof(DIAGNOSTIC) * 2 * (diagnostics->capacity + 4));
+            if(grown == NULL){
+                print_error(MEMORY_ALLOCATION_FAILED , NO_LINE);
+                exit(1);
+            }
+            diagnostics->entries = grown;
+            diagnostics->capacity = 2 * (diagnostics->capacity + 4);
+        }
+        diagnostics->entries[diagnostics->count] = *entry;
+    }
+    else{
+        append_diagnostic_text(diagnostics , output , format_diagnostic(diagnostics , entry , output));
+    }
+    diagnostics->count++;
+
+    /* Stop collecting once the limit is reached; the includers of a recorded file add the TOO_MANY_ERRORS of their own */
+    if(diagnostics->max_errors != NO_ERROR_LIMIT && diagnostics->count >= diagnostics->max_errors){
+        if(diagnostics->recording == FALSE){
+            limit.code = diagnostic_code(diagnostics , TOO_MANY_ERRORS);
+            limit.line = NO_LINE;
+            strcpy(limit.message , TOO_MANY_ERRORS);
+            limit.file[0] = '\0';
+            append_diagnostic_text(diagnostics , output , format_diagnostic(diagnostics , &limit , output));
+            diagnostics->count++;
+        }
+        diagnostics->limit_reached = TRUE;
+    }
+}
+
+/**
+ * @brief Checks whether the current file reached its error limit.
+ *
+ * @return TRUE if checking the current file should stop, FALSE otherwise.
+ */
+BOOLEAN diagnostics_limit_reached(void){
+    DIAGNOSTICS * diagnostics = get_current_diagnostics();
+
+    if(diagnostics != NULL && diagnostics->limit_reached == TRUE){
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/**
+ * @brief Copies a string into a JSON string literal, escaping special characters.
+ *
+ * @param output Output buffer (at least six times the length of the string, plus three).
+ * @param text The string to copy.
+ * @return The number of characters written.
+ */
+int json_string(char * output , const char * text){
+    int length = 0;
+
+    output[length++] = '"';
+    while(*text != '\0'){
+        if(*text == '"' || *text == '\\'){
+            output[length++] = '\\';
+            output[length++] = *text;
+        }
+        else if((unsigned char)*text < ' '){
+            length += sprintf(output + length , "\\u%04x" , (unsigned char)*text);
+        }
+        else{
+            output[length++] = *text;
+        }
+        text++;
+    }
+    output[length++] = '"';
+    output[length] = '\0';
+    return length;
+}
+
+/**
+ * @brief Writes a non-negative number in decimal, padded with zeros to a minimum number of digits.
+ *
+ * The text form of a diagnostic is built with this instead of `sprintf`, which costs more
+ * than the rest of reporting an error.
+ *
+ * @param output Output buffer.
+ * @param value The number.
+ * @param digits Minimum number of digits.
+ * @return The number of characters written.
+ */
+int format_number(char * output , int value , int digits){
+    char reversed[16];
+    int count = 0;
+    int length = 0;
+
+    do{
+        reversed[count++] = (char)('0' + value % 10);
+        value /= 10;
+    }while(value > 0 || count < digits);
+    while(count > 0){
+        output[length++] = reversed[--count];
+    }
+    return length;
+}
+
+/**
+ * @brief Formats a single diagnostic in text or JSON-lines form.
+ *
+ * Text form: `File: <file> , Line: <line> , Error E<code>: <message>`, where the file is
+ * the source being assembled, or the included file the error is in. The file part is left
+ * out for an error outside of any file (e.g. an output that could not be written), and
+ * the line part when the line is unknown.
+ * JSON form: `{"file": ..., "line": ..., "code": ..., "message": ...}`, with the same file,
+ * where an unknown file or line is null.
+ *
+ * @param diagnostics The diagnostics buffer the entry belongs to.
+ * @param entry The diagnostic to format.
+ * @param output Output buffer of MAX_DIAGNOSTIC_OUTPUT characters.
+ * @return The number of characters written.
+ */
+int format_diagnostic(DIAGNOSTICS * diagnostics , DIAGNOSTIC * entry , char * output){
+    const char * file = (entry->file[0] != '\0') ? entry->file : diagnostics->file_name;
+    int length = 0;
+
+    if(diagnostics->format == DIAGNOSTICS_JSON){
+        length += sprintf(output + length , "{\"file\": ");
+        length += (file[0] != '\0') ? json_string(output + length , file) : sprintf(output + length , "null");
+        length += (entry->line != NO_LINE) ? sprintf(output + length , ", \"line\": %d" , entry->line) : sprintf(output + length , ", \"line\": null");
+        length += sprintf(output + length , ", \"code\": \"E%03d\", \"message\": " , entry->code);
+        length += json_string(output + length , entry->message);
+        length += sprintf(output + length , "}\n");
+        return length;
+    }
+
+    if(file[0] != '\0'){
+        memcpy(output , "File: " , 6);
+        length = 6;
+        strcpy(output + length , file);
+        length += strlen(file);
+        memcpy(output + length , " , " , 3);
+        length += 3;
+    }
+    if(entry->line != NO_LINE){
+        memcpy(output + length , "Line: " , 6);
+        length += 6;
+        length += format_number(output + length , entry->line , 1);
+        memcpy(output + length , " , " , 3);
+        length += 3;
+    }
+    memcpy(output + length , "Error E" , 7);
+    length += 7;
+    length += format_number(output + length , entry->code , 3);
+    output[length++] = ':';
+    output[length++] = ' ';
+    strcpy(output + length , entry->message);
+    length += strlen(entry->message);
+    output[length++] = '\n';
+    output[length] = '\0';
+    return length;
+}
+
+/**
+ * @brief Writes all diagnostics of the current file at once and empties the buffer.
+ *
+ * The diagnostics were formatted as they were reported, so their text is written with a
+ * single call and the output of a file is never interleaved with other output. The bundle
+ * of output files, if any, is written right after, to stdout or to the output archive.
+ *
+ * @param diagnostics Pointer to the diagnostics buffer.
+ */
+void flush_diagnostics(DIAGNOSTICS * diagnostics){
+    FILE * stream = (diagnostics->stream != NULL) ? diagnostics->stream : stdout;
+
+    if(diagnostics->text.length > 0){
+        fwrite(diagnostics->text.text , 1 , diagnostics->text.length , stream);
+        fflush(stream);
+        diagnostics->text.length = 0;
+    }
+    diagnostics->count = 0;
+    if(diagnostics->bundle.length > 0){
+        write_Bundle(&diagnostics->bundle);
+        diagnostics->bundle.length = 0;
+    }
+}
+
+/**
+ * @brief Moves the diagnostics of one buffer to the end of another.
+ *
+ * Used to join the diagnostics of pipeline stages in the order the sequential
+ * assembler reports them.
+ *
+ * @param diagnostics The buffer receiving the diagnostics.
+ * @param other The buffer whose diagnostics are moved (emptied).
+ */
+void append_diagnostics(DIAGNOSTICS * diagnostics , DIAGNOSTICS * other){
+    if(other->text.length > 0){
+        append_diagnostic_text(diagnostics , other->text.text , other->text.length);
+    }
+    diagnostics->count += other->count;
+    if(other->limit_reached == TRUE){
+        diagnostics->limit_reached = TRUE;
+    }
+    other->text.length = 0;
+    other->count = 0;
+}
+
+/**
+ * @brief Flushes the current diagnostics buffer, if any.
+ *
+ * Registered with `atexit`, so errors collected before a fatal error are not lost.
+ */
+void flush_current_diagnostics(void){
+    DIAGNOSTICS * diagnostics = get_current_diagnostics();
+
+    if(diagnostics != NULL){
+        flush_diagnostics(diagnostics);
+    }
+}
+
+/**
+ * @brief Frees the memory held by a diagnostics buffer.
+ *
+ * @param diagnostics Pointer to the diagnostics buffer.
+ */
+void free_diagnostics(DIAGNOSTICS * diagnostics){
+    if(get_current_diagnostics() == diagnostics){
+        set_current_diagnostics(NULL);
+    }
+    free(diagnostics->text.text);
+    output_open(&diagnostics->text);
+    diagnostics->count = 0;
+    free(diagnostics->bundle.text);
+    output_open(&diagnostics->bundle);
+    free(diagnostics->entries);
+    diagnostics->entries = NULL;
+    diagnostics->capacity = 0;
+}
@@ -53,11 +53,12 @@ int extract_Label(char *line, char *label, char delimiter , int line_counter)
  * It allocates memory for the new node, initializes the label and address, 
  * and appends the node to the end of the list.
  *
- * @param label_list Pointer to the head of the LABEL_LIST linked list.
+ * @param label_list Pointer to the head of the LABEL_LIST linked list, or to the `next` link of its last node (then appending takes constant time).
  * @param label The label name to insert into the list.
  * @param address The address associated with the label.
+ * @param type The type of the line the label was defined on.
  */
-void insert_Label_List(LABEL_LIST **label_list, char *label, int address)
+void insert_Label_List(LABEL_LIST **label_list, char *label, int address, int type)
 {
     LABEL_LIST *ptr = NULL;
     LABEL_LIST *new_node = generic_malloc(sizeof(LABEL_LIST));
@@ -67,6 +68,7 @@ void insert_Label_List(LABEL_LIST **label_list, char *label, int address)
     strcpy(new_node->label, label);  
     new_node->label[MAX_LABEL_SIZE - 1] = '\0';           
     new_node->addr = address;
+    new_node->type = type;
     new_node->next = NULL;
 
     /* If the list is empty, set the new node as the head */
@@ -88,6 +90,48 @@ void insert_Label_List(LABEL_LIST **label_list, char *label, int address)
 
 }
 
+/**
+ * @brief Checks whether a label was defined on a data directive.
+ *
+ * @param label Pointer to the label node.
+ * @return TRUE if the label points into the data image, FALSE otherwise.
+ */
+BOOLEAN is_Data_Label(LABEL_LIST *label)
+{
+    switch(label->type)
+    {
+        case IS_STRING:
+        case IS_DATA:
+        case IS_FILL:
+        case IS_ZERO:
+        case IS_INCBIN:
+            return TRUE;
+    }
+    return FALSE;
+}
+
+/**
+ * @brief Turns the data addresses of data labels into final memory addresses.
+ *
+ * Data labels are recorded with their data address during the first pass, because the
+ * data image is placed after the code and its start is only known once all the code
+ * was counted (data address 1 is stored right after the last command).
+ *
+ * @param label_list Head of the LABEL_LIST linked list.
+ * @param IC The final instruction counter.
+ */
+void relocate_Data_Labels(LABEL_LIST *label_list, int IC)
+{
+    while(label_list != NULL)
+    {
+        if(is_Data_Label(label_list) == TRUE)
+        {
+            label_list->addr += IC - 1;
+        }
+        label_list = label_list->next;
+    }
+}
+
 /**
  * @brief Determines the type of line in the assembly source code.
  *
@@ -140,6 +184,24 @@ int get_Line_Type(char *line, COMMAND *commands_table, int *skip, COMMAND **comm
         (*skip) += strlen(".data"); /* Update skip for .data */
         return IS_DATA;/* Return the type as IS_DATA */
     }
+
+    if (strncmp(line, ".fill", strlen(".fill")) == 0 ) /* Check if the line is a .fill directive */
+    {
+        (*skip) += strlen(".fill"); /* Update skip for .fill */
+        return IS_FILL;/* Return the type as IS_FILL */
+    }
+
+    if (strncmp(line, ".zero", strlen(".zero")) == 0 ) /* Check if the line is a .zero directive */
+    {
+        (*skip) += strlen(".zero"); /* Update skip for .zero */
+        return IS_ZERO;/* Return the type as IS_ZERO */
+    }
+
+    if (strncmp(line, ".incbin", strlen(".incbin")) == 0 ) /* Check if the line is an .incbin directive */
+    {
+        (*skip) += strlen(".incbin"); /* Update skip for .incbin */
+        return IS_INCBIN;/* Return the type as IS_INCBIN */
+    }
     /* If no match is found, return UNDEFINED_INSTRUCTION */
     return UNDEFINED_INSTRUCTION;
 }
@@ -225,12 +287,30 @@ void insert_Extern_List(EXTERN_LIST **extern_list, char *line , int line_counter
 }
 
 void add_to_instruction_list(MACHINE_CODE_INSTRUCTION **instruction_list , int address , MILA mila){
+    add_run_to_instruction_list(instruction_list , address , mila , 1);
+}
+
+/**
+ * @brief Adds a run of identical words to the MACHINE_CODE_INSTRUCTION list.
+ *
+ * The run is stored as a single node holding the value and the number of words it covers,
+ * so a `.fill`/`.zero` directive costs the same memory regardless of its length. The run is
+ * only expanded word by word when the object file is written.
+ *
+ * @param instruction_list Pointer to the head of the MACHINE_CODE_INSTRUCTION linked list, or to the `next` link of its last node (then appending takes constant time).
+ * @param address The address of the first word of the run.
+ * @param mila The value stored in every word of the run.
+ * @param count The number of words in the run.
+ */
+void add_run_to_instruction_list(MACHINE_CODE_INSTRUCTION **instruction_list , int address , MILA mila , int count){
     MACHINE_CODE_INSTRUCTION *ptr = NULL;
     MACHINE_CODE_INSTRUCTION *new_node = generic_malloc(sizeof(MACHINE_CODE_INSTRUCTION));
 
     /* Initialize the new node */
     new_node->addr = address;
     new_node->mila = mila;
+    new_node->count = count;
+    new_node->words = NULL;
     new_node->next = NULL;
 
     /* If the list is empty, set the new node as the head */
@@ -299,10 +379,11 @@ int extract_String(MACHINE_CODE_INSTRUCTION **instruction_list, char *line, int
 int extract_Data(MACHINE_CODE_INSTRUCTION **instruction_list, char *line, int *address)
 {
     char *number;
+    char *cursor = line;
     MILA mila;
 
     /* Extract the first token (number) from the line */
-    number = strtok(line, ",\n");
+    number = next_Token(&cursor, ",\n");
    
     /* Walk through the other tokens (numbers separated by commas) */
     while(number != NULL ) 
@@ -313,12 +394,174 @@ int extract_Data(MACHINE_CODE_INSTRUCTION **instruction_list, char *line, int *a
         
         (*address)++;
         /* Get the next token (number) from the line */
-        number = strtok(NULL, ",\n");
+        number = next_Token(&cursor, ",\n");
     }
 
     return FALSE;
 }
 
+/**
+ * @brief Extracts a `.fill` or `.zero` directive and records it as a single run.
+ *
+ * `.fill count,value` reserves `count` words holding `value`, and `.zero count` reserves
+ * `count` words holding zero. Only one instruction node is created for the whole run,
+ * and the data counter is advanced by `count`.
+ *
+ * @param instruction_list Pointer to the head of the MACHINE_CODE_INSTRUCTION linked list.
+ * @param line The operands of the directive (after the directive name).
+ * @param type The directive type (IS_FILL or IS_ZERO).
+ * @param address Pointer to the current address, which is advanced by the run length.
+ * @return Always returns FALSE to indicate successful extraction.
+ */
+int extract_Fill(MACHINE_CODE_INSTRUCTION **instruction_list, char *line, int type, int *address)
+{
+    MILA mila;
+    int count;
+
+    /* The run length always comes first */
+    count = atoi(line);
+
+    /* .fill carries the value after the comma, .zero always stores zero */
+    mila.mila = 0;
+    if(type == IS_FILL)
+    {
+        mila.mila = atoi(strchr(line , ',') + 1);
+    }
+
+    add_run_to_instruction_list(instruction_list , *address , mila , count);
+    (*address) += count;
+
+    return FALSE;
+}
+
+/**
+ * @brief Copies the contents of a binary file into the instruction list.
+ *
+ * `.incbin "file",offset,length` reads `length` bytes of `file` starting at `offset` and
+ * stores them as a single instruction node holding one word per byte (the same layout
+ * `.string` uses for characters). The offset defaults to 0 and the length to the rest of
+ * the file. A relative path is taken from the directory of the source, not from the
+ * current directory. The file is mapped, like macro libraries and binary objects, and
+ * the bytes of the range are widened into words straight from the mapping, so the data
+ * never goes through the text parsing used for `.data`.
+ *
+ * The file is opened only here: its size bounds the range, and the words left in memory
+ * bound the length.
+ *
+ * @param instruction_list Pointer to the head of the MACHINE_CODE_INSTRUCTION linked list.
+ * @param source_name Name of the source file, or NULL for standard input.
+ * @param line The operands of the directive (after the directive name), already validated by `Incbin_Examine`.
+ * @param address Pointer to the current address, which is advanced by the number of bytes copied.
+ * @param words_left Number of words left in memory after the code and data so far.
+ * @param line_counter The current line number (used for error reporting).
+ * @return Returns FALSE if the file was copied, TRUE if an error was printed.
+ */
+int extract_Incbin(MACHINE_CODE_INSTRUCTION **instruction_list, char *source_name, char *line, int *address, int words_left, int line_counter)
+{
+    char path[MAX_FILE_LINE_LENGTH];
+    char *operands, *full_path, *slash = NULL;
+    unsigned char *bytes;
+    long offset = 0, length = -1, size, i, directory = 0;
+    MACHINE_CODE_INSTRUCTION *ptr = NULL;
+    struct stat file_stat;
+    MILA mila;
+    int fd;
+
+    memset(path , '\0' , sizeof(path));
+
+    /* Copy the file name from between the quotes */
+    operands = strchr(line + 1 , '"');
+    strncpy(path , line + 1 , operands - line - 1);
+
+    /* A relative path starts from the directory of the source */
+    if(source_name != NULL && path[0] != '/')
+    {
+        slash = strrchr(source_name , '/');
+        directory = (slash != NULL) ? slash - source_name + 1 : 0;
+    }
+    full_path = generic_malloc(directory + strlen(path) + 1);
+    if(directory > 0)
+    {
+        memcpy(full_path , source_name , directory);
+    }
+    strcpy(full_path + directory , path);
+
+    /* Read the optional offset and length */
+    operands = strchr(operands , ',');
+    if(operands != NULL)
+    {
+        offset = atol(operands + 1);
+        operands = strchr(operands + 1 , ',');
+        if(operands != NULL)
+        {
+            length = atol(operands + 1);
+        }
+    }
+
+    fd = open(full_path , O_RDONLY);
+    free(full_path);
+    if(fd < 0 || fstat(fd , &file_stat) != 0)
+    {
+        print_error(FAILED_TO_OPEN_INCBIN_FILE, line_counter);
+        if(fd >= 0)
+        {
+            close(fd);
+        }
+        return TRUE;
+    }
+    size = file_stat.st_size;
+
+    /* Without an explicit length, copy up to the end of the file */
+    if(length < 0)
+    {
+        length = size - offset;
+    }
+    if(offset > size || length < 0 || offset + length > size)
+    {
+        print_error(INCBIN_OUT_OF_RANGE, line_counter);
+        close(fd);
+        return TRUE;
+    }
+    if(length > words_left)
+    {
+        print_error(PROGRAM_TOO_LARGE, line_counter);
+        close(fd);
+        return TRUE;
+    }
+    if(length == 0)
+    {
+        close(fd);
+        return FALSE;
+    }
+
+    /* Map the file, then widen every byte of the range into a word */
+    bytes = mmap(NULL , size , PROT_READ , MAP_PRIVATE , fd , 0);
+    close(fd);
+    if(bytes == MAP_FAILED)
+    {
+        print_error(FAILED_TO_OPEN_INCBIN_FILE, line_counter);
+        return TRUE;
+    }
+
+    mila.mila = 0;
+    add_run_to_instruction_list(instruction_list , *address , mila , (int)length);
+    /* The new node is the last one in the list */
+    ptr = *instruction_list;
+    while(ptr->next != NULL)
+    {
+        ptr = ptr->next;
+    }
+    ptr->words = generic_malloc(length * sizeof(MILA));
+    for(i = 0 ; i < length ; i++)
+    {
+        ptr->words[i].mila = bytes[offset + i];
+    }
+    munmap(bytes , size);
+
+    (*address) += (int)length;
+    return FALSE;
+}
+
 /**
  * @brief Converts an assembly command line into machine code and adds it to the command list.
  *
@@ -359,7 +602,7 @@ int convert_Command(MACHINE_CODE_COMMAND **command_list, const char **registers,
             type_src =  operand_Type_Identifier(registers, src_op);
             type_dest =  operand_Type_Identifier(registers, dest_op);
             /* Generate the machine code (MILA) for the command and operands */
-            generate_Mila(command_list, command->code, src_op, type_src, dest_op, type_dest, IC);
+            generate_Mila(command_list, command->code, src_op, type_src, dest_op, type_dest, IC, line_counter);
             break;
         
          /* Single operand commands (e.g., CLR, NOT, INC, JMP, etc.) */
@@ -377,14 +620,14 @@ int convert_Command(MACHINE_CODE_COMMAND **command_list, const char **registers,
             /* Identify the type of the destination operand */
             type_dest =  operand_Type_Identifier(registers, dest_op);
             /* Generate the machine code (MILA) for the command and destination operand */
-            generate_Mila(command_list, command->code, NULL, NONE, dest_op, type_dest, IC);
+            generate_Mila(command_list, command->code, NULL, NONE, dest_op, type_dest, IC, line_counter);
             break;
 
         /* Commands with no operands (e.g., RTS, STOP) */
         case RTS:
         case STOP:
             /* Generate the machine code (MILA) for commands with no operands */
-            generate_Mila(command_list, command->code, NULL, NONE, NULL, NONE, IC);
+            generate_Mila(command_list, command->code, NULL, NONE, NULL, NONE, IC, line_counter);
     }
 
 
@@ -399,17 +642,19 @@ int convert_Command(MACHINE_CODE_COMMAND **command_list, const char **registers,
  * to the end of the linked list of machine code commands. If the list is empty, the new node 
  * becomes the head.
  *
- * @param command_list Pointer to the head of the MACHINE_CODE_COMMAND linked list.
+ * @param command_list Pointer to the head of the MACHINE_CODE_COMMAND linked list, or to the `next` link of its last node (then appending takes constant time).
  * @param addr The address associated with the command.
  * @param label The label associated with the command, if any.
  * @param binary_code The binary representation of the machine code (MILA).
  * @param type The type of the command (e.g., type of addressing or instruction format).
+ * @param line The source line the command was read from.
  */
-void insert_Command_List(MACHINE_CODE_COMMAND **command_list , int addr, char label[MAX_LABEL_SIZE] , MILA binary_code , int type)
+void insert_Command_List(MACHINE_CODE_COMMAND **command_list , int addr, char label[MAX_LABEL_SIZE] , MILA binary_code , int type , int line)
 {
     MACHINE_CODE_COMMAND * ptr = NULL;
     MACHINE_CODE_COMMAND * new_node = generic_malloc(sizeof(MACHINE_CODE_COMMAND) );
     new_node->addr = addr;
+    new_node->line = line;
     memset(new_node->label , '\0' ,sizeof(new_node->label));
     strcpy(new_node->label , label);
     new_node->type = type;
@@ -445,8 +690,9 @@ void insert_Command_List(MACHINE_CODE_COMMAND **command_list , int addr, char la
  * @param dest_op The destination operand (if applicable).
  * @param type_dest The addressing type of the destination operand.
  * @param IC Pointer to the instruction counter (incremented as new instructions are added).
+ * @param line_counter The source line of the command.
  */
-void generate_Mila(MACHINE_CODE_COMMAND **command_list, CODES command_code, char *src_op, int type_src, char *dest_op, int type_dest, int *IC)
+void generate_Mila(MACHINE_CODE_COMMAND **command_list, CODES command_code, char *src_op, int type_src, char *dest_op, int type_dest, int *IC, int line_counter)
 {
     MILA new_mila;
     new_mila.mila = A;/* Initialize the MILA value with default value A */
@@ -455,7 +701,7 @@ void generate_Mila(MACHINE_CODE_COMMAND **command_list, CODES command_code, char
     if(command_code >= RTS)
     {
         new_mila.mila |= shift_Bits(command_code, OPCODE);  /* Encode the command opcode */               
-        insert_Command_List(command_list, *IC, "\0", new_mila, type_src);   /* Insert the command into the list */
+        insert_Command_List(command_list, *IC, "\0", new_mila, type_src, line_counter);   /* Insert the command into the list */
         (*IC)++;
         return;  
     }
@@ -467,7 +713,7 @@ void generate_Mila(MACHINE_CODE_COMMAND **command_list, CODES command_code, char
         new_mila.mila |= shift_Bits(MASK128, type_src);
         new_mila.mila |= shift_Bits(MASK8, type_dest);
         new_mila.mila |= shift_Bits(command_code, OPCODE);                
-        insert_Command_List(command_list, *IC, "\0", new_mila, type_src);/* Insert the command */
+        insert_Command_List(command_list, *IC, "\0", new_mila, type_src, line_counter);/* Insert the command */
         
         (*IC)++;
 
@@ -480,7 +726,7 @@ void generate_Mila(MACHINE_CODE_COMMAND **command_list, CODES command_code, char
             new_mila.mila = A;
             new_mila.mila |= shift_Bits(get_Operand_Value(type_dest, dest_op), 3);/* Encode destination operand */
             new_mila.mila |= shift_Bits(get_Operand_Value(type_src, src_op), 6);/* Encode source operand */
-            insert_Command_List(command_list, *IC, "\0", new_mila, NONE);/* Insert operands as a single instruction */
+            insert_Command_List(command_list, *IC, "\0", new_mila, NONE, line_counter);/* Insert operands as a single instruction */
             (*IC)++;
             return;
         }
@@ -499,7 +745,7 @@ void generate_Mila(MACHINE_CODE_COMMAND **command_list, CODES command_code, char
            new_mila.mila |= shift_Bits(get_Operand_Value(type_src, src_op), 6); /* Encode register/pointer */
         }
 
-        insert_Command_List(command_list, *IC, src_op, new_mila, type_src);/* Insert source operand */
+        insert_Command_List(command_list, *IC, src_op, new_mila, type_src, line_counter);/* Insert source operand */
         new_mila.mila = 0;
         (*IC)++;
 
@@ -514,7 +760,7 @@ void generate_Mila(MACHINE_CODE_COMMAND **command_list, CODES command_code, char
             
         }
         
-        insert_Command_List(command_list, *IC, dest_op, new_mila, type_dest);
+        insert_Command_List(command_list, *IC, dest_op, new_mila, type_dest, line_counter);
         (*IC)++;
     }
     /* Handle single operand commands (e.g., PRN, JMP) */
@@ -522,7 +768,7 @@ void generate_Mila(MACHINE_CODE_COMMAND **command_list, CODES command_code, char
     {
         new_mila.mila |= shift_Bits(MASK8, type_dest);
         new_mila.mila |= shift_Bits(command_code, OPCODE);           
-        insert_Command_List(command_list, *IC, "\0", new_mila, type_src);
+        insert_Command_List(command_list, *IC, "\0", new_mila, type_src, line_counter);
        
         (*IC)++;
 
@@ -535,7 +781,7 @@ void generate_Mila(MACHINE_CODE_COMMAND **command_list, CODES command_code, char
             new_mila.mila = A;
             new_mila.mila |= shift_Bits(get_Operand_Value(type_dest, dest_op), 3);/* Encode operand */
         }
-        insert_Command_List(command_list, *IC, dest_op, new_mila, type_dest);
+        insert_Command_List(command_list, *IC, dest_op, new_mila, type_dest, line_counter);
         (*IC)++;
         
     }
@@ -660,11 +906,8 @@ unsigned short shift_Bits(unsigned short num,unsigned short steps)
 /**
  * @brief Performs the first pass over the assembly file to process labels, directives, and commands.
  *
- * This function reads the assembly source file line by line, extracting labels, directives, and commands.
- * It performs checks on the syntax of labels, `.entry`, `.extern`, `.string`, `.data`, and commands. 
- * The information is stored in the ASSEMBLER_TABLE, including labels, instructions, and machine code commands.
- * 
- * If the first pass completes without errors, it triggers the second pass.
+ * This function opens the preprocessed file, runs the first pass over its lines and,
+ * if the first pass completes without errors, triggers the second pass.
  *
  * @param assembler Pointer to the ASSEMBLER_TABLE that stores labels, commands, instructions, etc.
  * @param file_name The name of the assembly source file.
@@ -672,10 +915,75 @@ unsigned short shift_Bits(unsigned short num,unsigned short steps)
  */
 void firstpass(ASSEMBLER_TABLE **assembler, char *file_name ,char * file_name_no_ending)
 {
-    FILE *fptr = NULL;
+    LINE_SOURCE source;
+    int IC = 100, DC = 1;
+    BOOLEAN error_flag = TRUE;
+
+    /* Open the am file */
+    source.ring = NULL;
+    source.text = NULL;
+    source.fptr = fopen(file_name, "r");
+    if(source.fptr == NULL)
+    {
+        print_error(FAILED_TO_OPEN_FILE , NO_LINE);
+        return;
+    }
+
+    error_flag = First_Pass_Lines(assembler , &source , &IC , &DC);
+
+    /* Close the file after processing */
+    fclose(source.fptr);
+    source.fptr = NULL;
+
+    /* If no errors were encountered, proceed to the second pass */
+    if(error_flag == TRUE){
+        finish_First_Pass(assembler , file_name_no_ending , IC , DC);
+    }
+}
+
+/**
+ * @brief Completes the first pass and runs the second pass.
+ *
+ * Pools the strings when asked to, places the data image after the code and
+ * triggers the second pass.
+ *
+ * @param assembler Pointer to the ASSEMBLER_TABLE.
+ * @param file_name_no_ending The base name of the file without the file extension.
+ * @param IC The instruction counter at the end of the first pass.
+ * @param DC The data counter at the end of the first pass.
+ */
+void finish_First_Pass(ASSEMBLER_TABLE **assembler , char * file_name_no_ending , int IC , int DC)
+{
+    /* Share identical strings before the data image is placed after the code */
+    if((*assembler)->options->pool_strings == TRUE){
+        pool_Strings(*assembler , &DC);
+    }
+    relocate_Data_Labels((*assembler)->label_head , IC);
+    Second_Pass(assembler ,file_name_no_ending , IC , DC);
+}
+
+/**
+ * @brief Runs the first pass over the lines of the preprocessed source.
+ *
+ * This function reads the preprocessed source line by line, extracting labels, directives, and commands.
+ * It performs checks on the syntax of labels, `.entry`, `.extern`, `.string`, `.data`, `.fill`, `.zero`,
+ * `.incbin` and commands. The information is stored in the ASSEMBLER_TABLE, including labels, instructions, and machine code commands.
+ *
+ * @param assembler Pointer to the ASSEMBLER_TABLE that stores labels, commands, instructions, etc.
+ * @param source The preprocessed source (the .am file, or the ring of the preprocessor stage).
+ * @param IC_out Pointer receiving the instruction counter.
+ * @param DC_out Pointer receiving the data counter.
+ * @return TRUE if no errors were found, FALSE otherwise.
+ */
+BOOLEAN First_Pass_Lines(ASSEMBLER_TABLE **assembler , LINE_SOURCE * source , int * IC_out , int * DC_out)
+{
     char line[MAX_FILE_LINE_LENGTH], label[MAX_LABEL_SIZE];
     int IC = 100, DC = 1, skip = 0, line_counter = 1,label_skip = 0 , type = 0;
     BOOLEAN error_flag = TRUE , error = TRUE; /* Flags to track errors during the first pass */
+    /* Links the next label, command and instruction are stored in, so appending does not walk the lists */
+    LABEL_LIST ** label_end = &((*assembler)->label_head);
+    MACHINE_CODE_COMMAND ** command_end = &((*assembler)->command_head);
+    MACHINE_CODE_INSTRUCTION ** instruction_end = &((*assembler)->instruction_head);
 
     /* Register names for operand identification */
     const char *registers[] = 
@@ -717,16 +1025,8 @@ void firstpass(ASSEMBLER_TABLE **assembler, char *file_name ,char * file_name_no
     memset(label, '\0', sizeof(label));
     memset(line, '\0', sizeof(line));
 
-    /* Open the am file */
-    fptr = fopen(file_name, "r");
-    if(fptr == NULL)
-    {
-        print_error(FAILED_TO_OPEN_FILE , NO_LINE);
-        return;
-    }
-   
-   /* Process each line of the am file */
-    while( fgets(line , MAX_FILE_LINE_LENGTH , fptr) != NULL)
+   /* Process each line of the am file, until the error limit of the file is reached */
+    while( read_Line(source , line , MAX_FILE_LINE_LENGTH) != NULL && diagnostics_limit_reached() == FALSE)
     {   
         /* Extract the label (if any) from the line */
         skip = extract_Label(line, label, ':' , line_counter);
@@ -754,7 +1054,7 @@ void firstpass(ASSEMBLER_TABLE **assembler, char *file_name ,char * file_name_no
                 if (label_skip != NO_LABEL)
                 {
                     /* Add the label to the label list with IC + DC */
-                    insert_Label_List(&((*assembler)->label_head), label, IC + DC ); /* Might cause an error (*assembler)->label_head */
+                    insert_Label_List(label_end, label, IC + DC , type); /* Might cause an error (*assembler)->label_head */
                 }
                 /* Examine the .entry directive for errors */
                 error += Entry_Examine(line + label_skip +strlen(".entry"), line_counter , *assembler , registers);
@@ -770,7 +1070,7 @@ void firstpass(ASSEMBLER_TABLE **assembler, char *file_name ,char * file_name_no
                 if (label_skip != NO_LABEL)
                 {
                     /* Add the label to the label list with IC + DC */
-                    insert_Label_List(&((*assembler)->label_head), label, IC + DC ); /* Might cause an error (*assembler)->label_head */
+                    insert_Label_List(label_end, label, IC + DC , type); /* Might cause an error (*assembler)->label_head */
                 }
                 error += Extern_Examine(line + label_skip +strlen(".extern"), line_counter , *assembler , registers);
                 if(error == TRUE){
@@ -783,13 +1083,18 @@ void firstpass(ASSEMBLER_TABLE **assembler, char *file_name ,char * file_name_no
                 /* Handle .string directive */
                 if (label_skip != NO_LABEL)
                 {
-                    insert_Label_List(&((*assembler)->label_head), label, IC + DC - 1); /* Might cause an error (*assembler)->label_head */
+                    /* Add the label to the label list with its data address */
+                    insert_Label_List(label_end, label, DC , type);
                 }
                 /* Examine the .string directive for errors */
                 error += String_Examine(line + label_skip + strlen(".string"), line_counter);
                 if(error == TRUE){
+                    /* Record the payload when string pooling is enabled */
+                    if((*assembler)->options->pool_strings == TRUE){
+                        add_to_string_pool(&((*assembler)->string_head), line + skip, DC);
+                    }
                     /* Extract the string data into the instruction list */
-                    extract_String(&((*assembler)->instruction_head), line + skip, &DC);
+                    extract_String(instruction_end, line + skip, &DC);
                 }
                 break;
 
@@ -797,14 +1102,47 @@ void firstpass(ASSEMBLER_TABLE **assembler, char *file_name ,char * file_name_no
                 /* Handle .data directive */
                 if (label_skip != NO_LABEL)
                 {
-                    /* Add the label to the label list */
-                    insert_Label_List(&((*assembler)->label_head), label,IC + DC - 1); /* Might cause an error (*assembler)->label_head */
+                    /* Add the label to the label list with its data address */
+                    insert_Label_List(label_end, label, DC , type);
                 }
                 /* Examine the .data directive for errors */
                 error += Data_Examine(line + label_skip + strlen(".data") , line_counter);
                 if(error == TRUE){
                     /* Extract the data values into the instruction list */
-                    extract_Data(&((*assembler)->instruction_head), line + skip, &DC);
+                    extract_Data(instruction_end, line + skip, &DC);
+                }
+                break;
+
+            case IS_FILL:
+            case IS_ZERO:
+                /* Handle .fill and .zero directives */
+                if (label_skip != NO_LABEL)
+                {
+                    /* Add the label to the label list with its data address */
+                    insert_Label_List(label_end, label, DC , type);
+                }
+                /* Examine the directive for errors */
+                error += Fill_Examine(line + skip , type , line_counter , MEMORY_SIZE - (IC + DC - 1));
+                if(error == TRUE){
+                    /* Record the whole run as a single instruction node */
+                    extract_Fill(instruction_end, line + skip, type, &DC);
+                }
+                break;
+
+            case IS_INCBIN:
+                /* Handle .incbin directive */
+                if (label_skip != NO_LABEL)
+                {
+                    /* Add the label to the label list with its data address */
+                    insert_Label_List(label_end, label, DC , type);
+                }
+                /* Examine the .incbin directive for errors */
+                error += Incbin_Examine(line + skip , line_counter);
+                if(error == TRUE){
+                    /* Copy the binary file straight into the instruction list */
+                    if(extract_Incbin(instruction_end, (*assembler)->file_name, line + skip, &DC, MEMORY_SIZE - (IC + DC - 1), line_counter) == TRUE){
+                        error = FALSE;
+                    }
                 }
                 break;
 
@@ -813,13 +1151,13 @@ void firstpass(ASSEMBLER_TABLE **assembler, char *file_name ,char * file_name_no
                 if (label_skip != NO_LABEL)
                 {
                     /* Add the label to the label list with IC */
-                    insert_Label_List(&((*assembler)->label_head), label, IC ); /* Might cause an error (*assembler)->label_head */
+                    insert_Label_List(label_end, label, IC , type); /* Might cause an error (*assembler)->label_head */
                 }
                 /* Examine the command for errors */
                 error += Command_Examine(command , line + label_skip + strlen(command->name), line_counter,registers);
                 if(error == TRUE){
                     /* Convert the command into machine code */
-                    convert_Command(&((*assembler)->command_head), registers, line + skip, command, &IC , line_counter);
+                    convert_Command(command_end, registers, line + skip, command, &IC , line_counter);
                 }
                 break;
 
@@ -830,11 +1168,22 @@ void firstpass(ASSEMBLER_TABLE **assembler, char *file_name ,char * file_name_no
             default:
                 /* Handle undefined instructions (lines that don't match any valid directive or command) */
                 if(line[0] != '\n'){
-                    printf("Line %d: undefined instruction\n", line_counter);
+                    print_error(UNDEFINED_INSTRUCTION_NAME, line_counter);
                 }
 
         }
 
+        /* Move the ends past the nodes the line added */
+        while(*label_end != NULL){
+            label_end = &((*label_end)->next);
+        }
+        while(*command_end != NULL){
+            command_end = &((*command_end)->next);
+        }
+        while(*instruction_end != NULL){
+            instruction_end = &((*instruction_end)->next);
+        }
+
         /* Reset variables for the next line */
         label_skip = 0;
         error_flag += error;
@@ -844,13 +1193,13 @@ void firstpass(ASSEMBLER_TABLE **assembler, char *file_name ,char * file_name_no
         memset(label, '\0', sizeof(label));
         memset(line, '\0', sizeof(line));
     }
-    /* Close the file after processing */
-    fclose(fptr);
-    fptr = NULL;
-
-    /* If no errors were encountered, proceed to the second pass */
-    if(error_flag == TRUE){
-        Second_Pass(assembler ,file_name_no_ending , IC , DC);
+    /* The code and the data must fit in memory together */
+    if(IC + DC - 1 > MEMORY_SIZE){
+        print_error(PROGRAM_TOO_LARGE, NO_LINE);
+        error_flag = FALSE;
     }
+    *IC_out = IC;
+    *DC_out = DC;
+    return error_flag;
 }
 
@@ -20,7 +20,7 @@ BOOLEAN compare_With_Other_Lists(char *label, ASSEMBLER_TABLE *assembler)
     {
         if (strcmp(label, assembler->macro_head->macro_name) == 0)
         {
-            printf("%s %s\n",label, LABEL_ALREADY_DEFINED);
+            report_error(LABEL_ALREADY_DEFINED , label , NO_LINE);
             result += FALSE;
         }
         assembler->macro_head = assembler->macro_head->next;
@@ -31,7 +31,7 @@ BOOLEAN compare_With_Other_Lists(char *label, ASSEMBLER_TABLE *assembler)
     {
         if (strcmp(label, (assembler)->label_head->label) == 0)
         {
-            printf("%s %s\n",label, LABEL_ALREADY_DEFINED);
+            report_error(LABEL_ALREADY_DEFINED , label , NO_LINE);
             result += FALSE;
         }
         assembler->label_head = assembler->label_head->next;
@@ -42,14 +42,12 @@ BOOLEAN compare_With_Other_Lists(char *label, ASSEMBLER_TABLE *assembler)
     {
         if (strcmp(label, (assembler)->extern_head->label) == 0)
         {
-            printf("%s %s\n",label, LABEL_ALREADY_DEFINED);
+            report_error(LABEL_ALREADY_DEFINED , label , NO_LINE);
             result += FALSE;
         }
         assembler->extern_head = assembler->extern_head->next;
     }
 
-  
-
     return result;
 }
 
@@ -463,6 +461,7 @@ BOOLEAN Data_Examine(char * line , int line_counter){
     BOOLEAN result = TRUE;
     int i = 0;
     char * char_num = 0;
+    char * cursor = NULL;
     int num;
     char temp[MAX_FILE_LINE_LENGTH];
     memset(temp , '\0' , sizeof(temp));
@@ -491,7 +490,8 @@ BOOLEAN Data_Examine(char * line , int line_counter){
     }
     
     /* Tokenize the line to extract individual numbers separated by commas */
-    char_num = strtok(temp , ",");
+    cursor = temp;
+    char_num = next_Token(&cursor , ",");
     while(char_num != NULL){
         /* Validate each extracted number */
         result += Valid_Num_Examine(char_num , line_counter);
@@ -504,7 +504,7 @@ BOOLEAN Data_Examine(char * line , int line_counter){
             }
         }
         /* Move to the next number in the list */
-        char_num = strtok(NULL , ",");                 
+        char_num = next_Token(&cursor , ",");                 
     }
                              
     return result;
@@ -550,6 +550,153 @@ BOOLEAN Valid_Num_Examine( char  * char_num , int line_counter){
 }
 
 
+/**
+ * @brief Examines a `.fill` or `.zero` directive in the assembly code for validity.
+ *
+ * This function checks the operands of a run directive:
+ * - `.fill` expects exactly two numbers separated by a comma (the run length and the value).
+ * - `.zero` expects a single run length.
+ * - The run length must be positive and fit in the words left in memory.
+ * - The value must be within the 15-bit range, like a `.data` number.
+ *
+ * If any of these conditions are violated, appropriate error messages are printed, and the function
+ * returns `FALSE`. Otherwise, it returns `TRUE`.
+ *
+ * @param line The operands of the directive (after the directive name).
+ * @param type The directive type (IS_FILL or IS_ZERO).
+ * @param line_counter The current line number (used for error reporting).
+ * @param words_left Number of words left in memory after the code and data so far.
+ * @return Returns TRUE if the directive is valid, or FALSE if an error is detected.
+ */
+BOOLEAN Fill_Examine(char * line , int type , int line_counter , int words_left){
+    BOOLEAN result = TRUE;
+    char * char_value = NULL;
+    int num;
+    char temp[MAX_FILE_LINE_LENGTH];
+    memset(temp , '\0' , sizeof(temp));
+    strcpy(temp, line);
+
+    /* Check if the directive has a minimum size */
+    if(strlen(line) < MIN_DATA_SIZE){
+        print_error(MISSING_NUMBER, line_counter);
+        return FALSE;
+    }
+
+    /* Split the run length from the value */
+    char_value = strchr(temp , ',');
+    if(type == IS_FILL){
+        if(char_value == NULL){
+            print_error(MISSING_PARAMETER, line_counter);
+            return FALSE;
+        }
+        *char_value = '\0';
+        char_value++;
+        /* .fill takes exactly two operands */
+        if(strchr(char_value , ',') != NULL){
+            print_error(INVALID_COMMA, line_counter);
+            return FALSE;
+        }
+    }
+    else if(char_value != NULL){
+        /* .zero takes a single operand */
+        print_error(INVALID_COMMA, line_counter);
+        return FALSE;
+    }
+
+    /* Validate the run length */
+    result += Valid_Num_Examine(temp , line_counter);
+    if(result == TRUE){
+        num = atoi(temp);
+        if(num <= 0){
+            print_error(INVALID_FILL_COUNT, line_counter);
+            result = FALSE;
+        }
+        else if(num > words_left){
+            print_error(PROGRAM_TOO_LARGE, line_counter);
+            result = FALSE;
+        }
+    }
+
+    /* Validate the value of a .fill run */
+    if(type == IS_FILL && Valid_Num_Examine(char_value , line_counter) == TRUE){
+        num = atoi(char_value);
+        if(num >= MAX_VALUE_FOR_15_BITS || num <= MIN_VALUE_FOR_15_BITS){
+            print_error(NUMBER_OUT_OF_BOUND, line_counter);
+            result = FALSE;
+        }
+    }
+    else if(type == IS_FILL){
+        result = FALSE;
+    }
+
+    return result;
+}
+
+
+/**
+ * @brief Examines an `.incbin` directive in the assembly code for validity.
+ *
+ * This function checks the operands of a binary include:
+ * - The file name must be enclosed in double quotes.
+ * - An optional offset and an optional length may follow, each preceded by a comma.
+ * - The offset and length must be non-negative numbers.
+ *
+ * The file itself is opened only once, by `extract_Incbin`, which checks the range.
+ *
+ * If any of these conditions are violated, appropriate error messages are printed, and the function
+ * returns `FALSE`. Otherwise, it returns `TRUE`.
+ *
+ * @param line The operands of the directive (after the directive name).
+ * @param line_counter The current line number (used for error reporting).
+ * @return Returns TRUE if the directive is valid, or FALSE if an error is detected.
+ */
+BOOLEAN Incbin_Examine(char * line , int line_counter){
+    BOOLEAN result = TRUE;
+    char temp[MAX_FILE_LINE_LENGTH];
+    char * operands = NULL , * char_length = NULL;
+    memset(temp , '\0' , sizeof(temp));
+    strcpy(temp, line);
+
+    /* Check that the file name is enclosed in double quotes */
+    if(temp[0] != '"' || strchr(temp + 1 , '"') == NULL){
+        print_error(MISSING_QUOTE, line_counter);
+        return FALSE;
+    }
+    operands = strchr(temp + 1 , '"');
+    *operands = '\0';
+    operands++;
+    if(temp[1] == '\0'){
+        print_error(INVALID_INCBIN_OPERANDS, line_counter);
+        return FALSE;
+    }
+
+    /* Check the optional offset and length */
+    if(*operands != '\n' && *operands != '\0'){
+        if(*operands != ',' || *(operands + 1) == '-'){
+            print_error(INVALID_INCBIN_OPERANDS, line_counter);
+            return FALSE;
+        }
+        operands++;
+        char_length = strchr(operands , ',');
+        if(char_length != NULL){
+            *char_length = '\0';
+            char_length++;
+            if(*char_length == '-' || strchr(char_length , ',') != NULL){
+                print_error(INVALID_INCBIN_OPERANDS, line_counter);
+                return FALSE;
+            }
+            result += Valid_Num_Examine(char_length , line_counter);
+        }
+        result += Valid_Num_Examine(operands , line_counter);
+        if(result != TRUE){
+            return FALSE;
+        }
+    }
+
+    return result;
+}
+
+
 /**
  * @brief Examines the validity of an `.extern` directive in assembly code.
  *
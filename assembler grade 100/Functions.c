@@ -81,7 +81,8 @@ BOOLEAN Reserved_Words_Check(char * line , const char * error_message , int line
     }
 
     /* Check if label matches assembler directives */
-    if( strcmp(label , ".data" ) == 0 || strcmp(label , ".string" ) == 0  || strcmp(label , ".entry" ) == 0  || strcmp(label , ".extern" ) == 0 ){
+    if( strcmp(label , ".data" ) == 0 || strcmp(label , ".string" ) == 0  || strcmp(label , ".entry" ) == 0  || strcmp(label , ".extern" ) == 0
+        || strcmp(label , ".fill" ) == 0 || strcmp(label , ".zero" ) == 0 || strcmp(label , ".incbin" ) == 0 || strcmp(label , ".include" ) == 0 ){
         print_error(error_message , line_count);
         result = FALSE;     
     }
@@ -97,23 +98,17 @@ BOOLEAN Reserved_Words_Check(char * line , const char * error_message , int line
 
 
 /**
- * @brief Prints an error message with an optional line number.
+ * @brief Reports an error message with an optional line number.
  *
- * This function handles the printing of error messages to the console. If a valid
- * line number is provided, it is included in the output; otherwise, only the error
- * message is printed.
+ * This function adds the error to the diagnostics of the file being assembled, which
+ * are written once the file is done. Errors reported outside of a file are printed
+ * right away.
  *
- * @param error_message The error message to print.
+ * @param error_message The error message to report.
  * @param line The line number associated with the error (or NO_LINE if not applicable).
  */
 void print_error(const char *error_message, int  line){
-    if (line != NO_LINE) {
-        /* Print the error message along with the line number */
-        printf("Line: %d , Error: %s\n", line , error_message);
-    } else {
-        /* Print the error message without a line number */
-        printf("Error: %s\n", error_message);
-    }
+    report_error(error_message , NULL , line);
 }
 
 /**
@@ -147,8 +142,8 @@ void free_macro_list(MACRO_LIST **head){
     MACRO_LIST *temp;
     /* Loop through the macro list and free each node */
     while (*head != NULL) {
-        /* Free the macro content associated with each macro */
-        if((*head)->head_content->next != NULL){
+        /* Free the macro content associated with each macro, unless it belongs to the include cache */
+        if((*head)->shared == FALSE && (*head)->head_content != NULL && (*head)->head_content->next != NULL){
             free_macro_content(&((*head)->head_content->next));
         }
         temp = *head;
@@ -278,12 +273,33 @@ void free_machine_code_instruction(MACHINE_CODE_INSTRUCTION **head){
     while (*head != NULL) {
         temp = *head;
         *head = (*head)->next;
+        /* Free the words copied by .incbin, if any */
+        free(temp->words);
         free(temp);
         temp = NULL;
     }
     
 }
 
+/**
+ * @brief Frees the memory allocated for the STRING_POOL list.
+ *
+ * This function frees all the memory used by the STRING_POOL linked list.
+ *
+ * @param head Pointer to the head of the STRING_POOL list.
+ */
+void free_string_pool(STRING_POOL **head){
+    STRING_POOL *temp;
+    /* Loop through the string pool and free each node */
+    while (*head != NULL) {
+        temp = *head;
+        *head = (*head)->next;
+        free(temp);
+        temp = NULL;
+    }
+
+}
+
 /**
  * @brief Frees all memory associated with an ASSEMBLER_TABLE.
  *
@@ -298,7 +314,7 @@ void free_assembler_table(ASSEMBLER_TABLE **table){
     }
 
     /* Free each component of the assembler table if it is not NULL */
-    if((*table)->macro_head != NULL && (*table)->macro_head->head_content != NULL && (*table)->macro_head->head_content->next != NULL){
+    if((*table)->macro_head != NULL && (*table)->macro_head->shared == FALSE && (*table)->macro_head->head_content != NULL && (*table)->macro_head->head_content->next != NULL){
         free_macro_content(&(*table)->macro_head->head_content->next);
     }
     if ((*table)->macro_head != NULL && (*table)->macro_head->next != NULL  ) {
@@ -332,6 +348,10 @@ void free_assembler_table(ASSEMBLER_TABLE **table){
         free_machine_code_instruction(&((*table)->instruction_head->next));
     }
 
+    if ((*table)->string_head != NULL) {
+        free_string_pool(&((*table)->string_head));
+    }
+
     /* Free the table itself */
     free(*table);
     *table = NULL;
@@ -383,4 +403,32 @@ char * add_suffix(char * file_name , char * ending){
    
     /* Return the new file name with the suffix */
     return new_name;
+}
+
+/**
+ * @brief Returns the next token of a string, like strtok but without hidden state.
+ *
+ * Leading delimiters are skipped and the token is null terminated in place. The position
+ * after the token is kept in the cursor of the caller, so files can be tokenized by
+ * several threads at once.
+ *
+ * @param cursor Pointer to the position in the string, updated past the token.
+ * @param delimiters The characters separating the tokens.
+ * @return Pointer to the token, or NULL when no token is left.
+ */
+char * next_Token(char ** cursor , const char * delimiters){
+    char * start = *cursor + strspn(*cursor , delimiters);
+    char * end = NULL;
+
+    if(*start == '\0'){
+        *cursor = start;
+        return NULL;
+    }
+    end = start + strcspn(start , delimiters);
+    if(*end != '\0'){
+        *end = '\0';
+        end++;
+    }
+    *cursor = end;
+    return start;
 }
\ No newline at end of file
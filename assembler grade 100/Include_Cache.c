@@ -0,0 +1,256 @@
+#include "assembler.h"
+
+/* Included files already preprocessed by this process */
+INCLUDE_FILE * include_cache = NULL;
+
+/* Guards the include cache, shared by the workers of a batch run */
+pthread_mutex_t include_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Looks up an unchanged file in the include cache (the cache lock must be held).
+ *
+ * @param path Path of the included file.
+ * @param file_stat Status of the file on disk.
+ * @return Pointer to the cached file, or NULL if it is not cached.
+ */
+INCLUDE_FILE * find_Included_File(char * path , struct stat * file_stat){
+    INCLUDE_FILE * ptr = NULL;
+
+    for(ptr = include_cache ; ptr != NULL ; ptr = ptr->next){
+        if(strcmp(ptr->path , path) == 0 && ptr->mtime == file_stat->st_mtime && ptr->size == (long)file_stat->st_size){
+            return ptr;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Frees a single include cache entry.
+ *
+ * @param entry Pointer to the entry.
+ */
+void free_Included_File(INCLUDE_FILE * entry){
+    if(entry->macro_head != NULL && entry->macro_head->head_content != NULL && entry->macro_head->head_content->next != NULL){
+        free_macro_content(&entry->macro_head->head_content->next);
+    }
+    free_macro_list(&entry->macro_head);
+    free(entry->errors);
+    free(entry->text);
+    free(entry);
+}
+
+/**
+ * @brief Returns the preprocessed form of an included file.
+ *
+ * The file is looked up in the include cache by its path, modification time and size.
+ * On a miss it is preprocessed once (whitespaces and comments removed, macros collected
+ * and expanded, nested includes resolved) into memory and added to the cache, so every
+ * later include of the same unchanged file costs no parsing. A file found in the input
+ * archive is read from there, and never changes during the run.
+ *
+ * The errors found while preprocessing the file are recorded in the cache entry, each
+ * labelled with the file it is in, instead of going to the file that happened to include
+ * it first; include_File reports them to every includer.
+ *
+ * @param path Path of the included file.
+ * @param options Options of the run.
+ * @param depth Include depth of the file.
+ * @return Pointer to the cached file, or NULL if the file cannot be read.
+ */
+INCLUDE_FILE * get_Included_File(char * path , ASSEMBLER_OPTIONS * options , int depth){
+    int i;
+    INCLUDE_FILE * entry = NULL , * ptr = NULL;
+    ASSEMBLER_TABLE * table = NULL;
+    AM_WRITER * writer = NULL;
+    DIAGNOSTICS * includer = get_current_diagnostics();
+    DIAGNOSTICS errors;
+    LINE_SOURCE source;
+    ARCHIVE_MEMBER * member = find_Archive_Member(path);
+    struct stat file_stat;
+    FILE * fptr = NULL;
+
+    if(member != NULL){
+        memset(&file_stat , 0 , sizeof(file_stat));
+        file_stat.st_size = member->size;
+    }
+    else if(stat(path , &file_stat) != 0){
+        return NULL;
+    }
+    /* Serve the file from the cache when it did not change */
+    pthread_mutex_lock(&include_cache_lock);
+    ptr = find_Included_File(path , &file_stat);
+    pthread_mutex_unlock(&include_cache_lock);
+    if(ptr != NULL){
+        return ptr;
+    }
+
+    if(member == NULL){
+        fptr = fopen(path , "r");
+        if(fptr == NULL){
+            return NULL;
+        }
+    }
+    entry = generic_malloc(sizeof(INCLUDE_FILE));
+    memset(entry->path , '\0' , sizeof(entry->path));
+    strcpy(entry->path , path);
+    entry->mtime = file_stat.st_mtime;
+    entry->size = file_stat.st_size;
+    entry->next = NULL;
+
+    /* Record the errors of the file, with the error limit of the includer */
+    open_diagnostics(&errors);
+    errors.recording = TRUE;
+    errors.max_errors = (includer != NULL) ? includer->max_errors : NO_ERROR_LIMIT;
+    errors.limit_reached = FALSE;
+    set_current_diagnostics(&errors);
+
+    /* Preprocess the file into memory, with a table of its own for its macros */
+    table = generic_malloc(sizeof(ASSEMBLER_TABLE));
+    memset(table , 0 , sizeof(ASSEMBLER_TABLE));
+    table->options = options;
+    writer = generic_malloc(sizeof(AM_WRITER));
+    am_writer_open_memory(writer);
+
+    source.fptr = fptr;
+    source.text = (member != NULL) ? (char *)member->text : NULL;
+    source.length = (member != NULL) ? member->size : 0;
+    source.position = 0;
+    source.ring = NULL;
+    entry->valid = Pre_Proc_Lines(&source , &table , writer , depth);
+    am_writer_close(writer);
+    /* A file cut short by the error limit is not complete */
+    if(errors.limit_reached == TRUE){
+        entry->valid = FALSE;
+    }
+    set_current_diagnostics(includer);
+    for(i = 0 ; i < errors.count ; i++){
+        if(errors.entries[i].file[0] == '\0'){
+            strcpy(errors.entries[i].file , path);
+        }
+    }
+    entry->errors = errors.entries;
+    entry->error_count = errors.count;
+    errors.entries = NULL;
+    free_diagnostics(&errors);
+    entry->text = writer->buffer;
+    entry->length = writer->length;
+    entry->macro_head = table->macro_head;
+
+    free(writer);
+    free(table);
+    if(fptr != NULL){
+        fclose(fptr);
+    }
+
+    /* Add the file at the end of the cache, unless another worker added it meanwhile */
+    pthread_mutex_lock(&include_cache_lock);
+    ptr = find_Included_File(path , &file_stat);
+    if(ptr != NULL){
+        pthread_mutex_unlock(&include_cache_lock);
+        free_Included_File(entry);
+        return ptr;
+    }
+    if(include_cache == NULL){
+        include_cache = entry;
+    }
+    else{
+        ptr = include_cache;
+        while(ptr->next != NULL){
+            ptr = ptr->next;
+        }
+        ptr->next = entry;
+    }
+    pthread_mutex_unlock(&include_cache_lock);
+    return entry;
+}
+
+/**
+ * @brief Handles an `.include "file"` directive.
+ *
+ * The preprocessed lines of the included file are written in place of the directive,
+ * straight from the include cache, and its macros become available to the including
+ * file. The imported macros share their content with the cache.
+ *
+ * @param head_table Pointer to the assembler table of the including file.
+ * @param writer_am The writer receiving the preprocessed lines.
+ * @param line The directive, without whitespaces.
+ * @param line_count The line number of the directive.
+ * @param depth Include depth of the including file.
+ * @return TRUE if the file was included, FALSE otherwise.
+ */
+BOOLEAN include_File(ASSEMBLER_TABLE ** head_table , AM_WRITER * writer_am , char * line , int line_count , int depth){
+    char path[MAX_FILE_LINE_LENGTH] , macro_name[MAX_FILE_LINE_LENGTH] , * end = NULL;
+    INCLUDE_FILE * included = NULL;
+    MACRO_LIST * ptr = NULL , * existing = NULL;
+    BOOLEAN result = TRUE;
+    int i;
+
+    /* The directive is .include"path" with nothing after the closing quote */
+    line += strlen(".include");
+    end = strrchr(line , '"');
+    if(line[0] != '"' || end == NULL || end - line < 2 || (end[1] != '\n' && end[1] != '\0')){
+        print_error(INVALID_INCLUDE , line_count);
+        return FALSE;
+    }
+    memset(path , '\0' , sizeof(path));
+    strncpy(path , line + 1 , end - line - 1);
+
+    if(depth + 1 > MAX_INCLUDE_DEPTH){
+        print_error(INCLUDE_TOO_DEEP , line_count);
+        return FALSE;
+    }
+    included = get_Included_File(path , (*head_table)->options , depth + 1);
+    if(included == NULL){
+        report_error(FAILED_TO_OPEN_INCLUDE_FILE , path , line_count);
+        return FALSE;
+    }
+    /* The errors of the included file, then, once at the directive of the assembled file, that it has errors */
+    for(i = 0 ; i < included->error_count ; i++){
+        report_diagnostic(&included->errors[i]);
+    }
+    if(included->valid == FALSE){
+        if(depth == 0){
+            report_error(INCLUDED_FILE_HAS_ERRORS , path , line_count);
+        }
+        return FALSE;
+    }
+
+    /* Import the macros of the included file */
+    for(ptr = included->macro_head ; ptr != NULL ; ptr = ptr->next){
+        existing = find_macro((*head_table)->macro_head , ptr->macro_name);
+        /* The same file included again brings the same macros */
+        if(existing != NULL && existing->head_content == ptr->head_content){
+            continue;
+        }
+        if(existing != NULL){
+            memset(macro_name , '\0' , sizeof(macro_name));
+            strncpy(macro_name , ptr->macro_name , strcspn(ptr->macro_name , "\n"));
+            report_error(MACRO_NAME_ALREADY_DEFINED , macro_name , line_count);
+            result = FALSE;
+            continue;
+        }
+        add_to_macro_list(&((*head_table)->macro_head) , &((*head_table)->macro_filter) , ptr->macro_name , ptr->head_content);
+        existing = (*head_table)->macro_head;
+        while(existing->next != NULL){
+            existing = existing->next;
+        }
+        existing->shared = TRUE;
+    }
+
+    /* The lines of the included file are written from the cache without copying */
+    am_writer_add(writer_am , included->text , included->length , FALSE);
+    return result;
+}
+
+/**
+ * @brief Frees the include cache of the process.
+ */
+void free_include_cache(void){
+    INCLUDE_FILE * temp = NULL;
+
+    while(include_cache != NULL){
+        temp = include_cache;
+        include_cache = include_cache->next;
+        free_Included_File(temp);
+    }
+}
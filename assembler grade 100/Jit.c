@@ -0,0 +1,885 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "jit.h"
+
+/* Host register holding a register of the machine */
+#define JIT_HOST(reg) (JIT_R8 + (reg))
+
+/* Offset of a field of the JIT, from rbp */
+#define JIT_FIELD(field) ((long)offsetof(JIT , field))
+
+/* Offset of a register of the machine in the cells, from rbx */
+#define JIT_REGISTER_CELL(reg) (2L * (SIM_MEMORY_SIZE + (reg)))
+
+/* Condition codes of jcc */
+#define JIT_BELOW 2
+#define JIT_ABOVE_EQUAL 3
+#define JIT_EQUAL 4
+#define JIT_NOT_EQUAL 5
+#define JIT_ABOVE 7
+#define JIT_ALWAYS -1
+
+/* Opcodes (with their /digit when they have one) */
+#define JIT_ADD 0x01
+#define JIT_SUB 0x29
+#define JIT_AND 0x21
+#define JIT_XOR 0x31
+#define JIT_CMP 0x39
+#define JIT_MOV_STORE 0x89
+#define JIT_MOV_LOAD 0x8B
+#define JIT_CMP_LOAD 0x3B
+#define JIT_ALU_IMMEDIATE 0x81
+#define JIT_ALU_IMMEDIATE8 0x80
+#define JIT_MOV_IMMEDIATE 0xC7
+#define JIT_MOVZX16 0x0FB7
+#define JIT_SETE 0x0F94
+#define JIT_TEST 0x85
+#define JIT_UNARY 0xF7
+#define JIT_INDIRECT 0xFF
+#define JIT_DIGIT_ADD 0
+#define JIT_DIGIT_SUB 5
+#define JIT_DIGIT_AND 4
+#define JIT_DIGIT_CMP 7
+#define JIT_DIGIT_NOT 2
+#define JIT_DIGIT_CALL 2
+#define JIT_DIGIT_JMP 4
+
+#if defined(__x86_64__)
+
+/**
+ * @brief Appends a byte to the native code.
+ *
+ * @param jit The JIT.
+ * @param byte The byte.
+ */
+void emit_Byte(JIT * jit , unsigned int byte){
+    jit->buffer[jit->used++] = (unsigned char)byte;
+}
+
+/**
+ * @brief Appends a little-endian 32-bit number to the native code.
+ *
+ * @param jit The JIT.
+ * @param value The number.
+ */
+void emit_U32(JIT * jit , unsigned long value){
+    emit_Byte(jit , value & 0xFF);
+    emit_Byte(jit , (value >> 8) & 0xFF);
+    emit_Byte(jit , (value >> 16) & 0xFF);
+    emit_Byte(jit , (value >> 24) & 0xFF);
+}
+
+/**
+ * @brief Appends the REX prefix and the opcode of an instruction.
+ *
+ * @param jit The JIT.
+ * @param wide Nonzero for a 64-bit operation.
+ * @param opcode One or two bytes of opcode.
+ * @param reg Register of the reg field.
+ * @param index Register of the SIB index, or -1.
+ * @param base Register of the r/m field or of the SIB base.
+ */
+void emit_Opcode(JIT * jit , int wide , unsigned int opcode , int reg , int index , int base){
+    unsigned int rex = 0x40 | (wide ? 8 : 0) | ((reg & 8) ? 4 : 0) | ((index >= 0 && (index & 8)) ? 2 : 0) | ((base & 8) ? 1 : 0);
+
+    if(rex != 0x40){
+        emit_Byte(jit , rex);
+    }
+    if(opcode > 0xFF){
+        emit_Byte(jit , opcode >> 8);
+    }
+    emit_Byte(jit , opcode & 0xFF);
+}
+
+/**
+ * @brief Appends an instruction whose operands are two registers.
+ *
+ * @param jit The JIT.
+ * @param wide Nonzero for a 64-bit operation.
+ * @param opcode The opcode.
+ * @param reg Register (or /digit) of the reg field.
+ * @param rm Register of the r/m field.
+ */
+void emit_Op_Register(JIT * jit , int wide , unsigned int opcode , int reg , int rm){
+    emit_Opcode(jit , wide , opcode , reg , -1 , rm);
+    emit_Byte(jit , 0xC0 | ((reg & 7) << 3) | (rm & 7));
+}
+
+/**
+ * @brief Appends an instruction with a memory operand [base + index * 2^scale + displacement].
+ *
+ * @param jit The JIT.
+ * @param prefix 0x66 for a 16-bit operation, 0 otherwise.
+ * @param wide Nonzero for a 64-bit operation.
+ * @param opcode The opcode.
+ * @param reg Register (or /digit) of the reg field.
+ * @param base Base register.
+ * @param index Index register, or -1.
+ * @param scale Log2 of the scale of the index.
+ * @param displacement The displacement.
+ */
+void emit_Op_Memory(JIT * jit , unsigned int prefix , int wide , unsigned int opcode , int reg , int base , int index , int scale , long displacement){
+    if(prefix != 0){
+        emit_Byte(jit , prefix);
+    }
+    emit_Opcode(jit , wide , opcode , reg , index , base);
+    if(index >= 0 || (base & 7) == JIT_RSP){
+        emit_Byte(jit , 0x80 | ((reg & 7) << 3) | JIT_RSP);
+        emit_Byte(jit , (scale << 6) | (((index >= 0) ? index : JIT_RSP) & 7) << 3 | (base & 7));
+    }
+    else{
+        emit_Byte(jit , 0x80 | ((reg & 7) << 3) | (base & 7));
+    }
+    emit_U32(jit , (unsigned long)displacement);
+}
+
+/**
+ * @brief Appends a jump (or a conditional jump) to native code already written.
+ *
+ * @param jit The JIT.
+ * @param condition Condition code, or JIT_ALWAYS.
+ * @param target The native code jumped to.
+ */
+void emit_Jump(JIT * jit , int condition , const unsigned char * target){
+    if(condition == JIT_ALWAYS){
+        emit_Byte(jit , 0xE9);
+    }
+    else{
+        emit_Byte(jit , 0x0F);
+        emit_Byte(jit , 0x80 | condition);
+    }
+    emit_U32(jit , (unsigned long)(target - (jit->buffer + jit->used + 4)));
+}
+
+/**
+ * @brief Appends a short conditional jump over the code that follows, to patch with patch_Skip.
+ *
+ * @param jit The JIT.
+ * @param condition Condition code.
+ * @return Position of the displacement.
+ */
+unsigned long emit_Skip(JIT * jit , int condition){
+    emit_Byte(jit , 0x70 | condition);
+    emit_Byte(jit , 0);
+    return jit->used - 1;
+}
+
+/**
+ * @brief Makes a short jump appended by emit_Skip land at the end of the native code.
+ *
+ * @param jit The JIT.
+ * @param position Position of the displacement.
+ */
+void patch_Skip(JIT * jit , unsigned long position){
+    jit->buffer[position] = (unsigned char)(jit->used - position - 1);
+}
+
+/**
+ * @brief Appends mov reg, imm32.
+ *
+ * @param jit The JIT.
+ * @param reg The register.
+ * @param value The number.
+ */
+void emit_Move_Immediate(JIT * jit , int reg , unsigned long value){
+    emit_Op_Register(jit , 0 , JIT_MOV_IMMEDIATE , 0 , reg);
+    emit_U32(jit , value);
+}
+
+/**
+ * @brief Appends an ALU operation of a register and a 32-bit number (add, sub, and or cmp).
+ *
+ * @param jit The JIT.
+ * @param digit The /digit of the operation.
+ * @param reg The register.
+ * @param value The number.
+ */
+void emit_Alu_Immediate(JIT * jit , int digit , int reg , unsigned long value){
+    emit_Op_Register(jit , 0 , JIT_ALU_IMMEDIATE , digit , reg);
+    emit_U32(jit , value);
+}
+
+/**
+ * @brief Appends the code saving the registers r0 to r7 to the cells, or loading them from the cells.
+ *
+ * @param jit The JIT.
+ * @param save Nonzero to save, zero to load.
+ */
+void emit_Registers(JIT * jit , int save){
+    int reg;
+
+    for(reg = 0 ; reg < SIM_REGISTERS ; reg++){
+        if(save){
+            emit_Op_Memory(jit , 0x66 , 0 , JIT_MOV_STORE , JIT_HOST(reg) , JIT_RBX , -1 , 0 , JIT_REGISTER_CELL(reg));
+        }
+        else{
+            emit_Op_Memory(jit , 0 , 0 , JIT_MOVZX16 , JIT_HOST(reg) , JIT_RBX , -1 , 0 , JIT_REGISTER_CELL(reg));
+        }
+    }
+}
+
+/**
+ * @brief Appends a call of a function of the simulator, taking the simulator and esi, the registers saved around it.
+ *
+ * @param jit The JIT.
+ * @param function The function.
+ */
+void emit_Call(JIT * jit , void (*function)(void)){
+    unsigned char address[8];
+    int i;
+
+    memcpy(address , &function , sizeof(address));
+    emit_Registers(jit , 1);
+    emit_Op_Memory(jit , 0 , 1 , JIT_MOV_LOAD , JIT_RDI , JIT_RBP , -1 , 0 , JIT_FIELD(sim));
+    /* mov rax, imm64 */
+    emit_Byte(jit , 0x48);
+    emit_Byte(jit , 0xB8);
+    for(i = 0 ; i < 8 ; i++){
+        emit_Byte(jit , address[i]);
+    }
+    emit_Op_Register(jit , 0 , JIT_INDIRECT , JIT_DIGIT_CALL , JIT_RAX);
+    emit_Registers(jit , 0);
+}
+
+/**
+ * @brief Appends the code going back to run_Jit.
+ *
+ * @param jit The JIT.
+ * @param status Why native code stops (JIT_HALTED to JIT_FLUSH).
+ * @param pc Address where it stops, or -1 when eax holds it.
+ * @param executed Number of instructions of the block that ran, whose steps are kept (the others are given back), or -1 to give none back.
+ */
+void emit_Exit(JIT * jit , unsigned int status , long pc , int executed){
+    if(executed >= 0){
+        emit_Op_Memory(jit , 0 , 1 , JIT_ALU_IMMEDIATE , JIT_DIGIT_ADD , JIT_RBP , -1 , 0 , JIT_FIELD(budget));
+        jit->refund_at[jit->refunds] = jit->used;
+        jit->refund_executed[jit->refunds++] = (unsigned int)executed;
+        emit_U32(jit , 0);
+    }
+    emit_Op_Memory(jit , 0 , 0 , JIT_MOV_IMMEDIATE , 0 , JIT_RBP , -1 , 0 , JIT_FIELD(status));
+    emit_U32(jit , status);
+    if(pc >= 0){
+        emit_Move_Immediate(jit , JIT_RAX , (unsigned long)pc);
+    }
+    emit_Jump(jit , JIT_ALWAYS , jit->leave);
+}
+
+/**
+ * @brief Returns the number the native code of an operand is built from.
+ *
+ * @param sim The simulator.
+ * @param mode Addressing mode of the operand.
+ * @param cell Cell of the operand, as decoded.
+ * @param index Index of the operand, as decoded.
+ * @return The immediate value, the address of a direct operand, or the register.
+ */
+unsigned int jit_Operand(const SIMULATOR * sim , int mode , const unsigned short * cell , const unsigned short * index){
+    switch(mode){
+        case SIM_IMMEDIATE:
+            return *cell;
+        case SIM_DIRECT:
+            return (unsigned int)(cell - sim->cells);
+        case SIM_INDIRECT:
+            return (unsigned int)(index - sim->registers);
+        default:
+            return (unsigned int)(cell - sim->registers);
+    }
+}
+
+/**
+ * @brief Appends the code loading an operand into a host register (rcx is used by an indirect operand).
+ *
+ * @param jit The JIT.
+ * @param mode Addressing mode of the operand.
+ * @param value Number of the operand (see jit_Operand).
+ * @param host The host register.
+ */
+void emit_Load(JIT * jit , int mode , unsigned int value , int host){
+    switch(mode){
+        case SIM_IMMEDIATE:
+            emit_Move_Immediate(jit , host , value);
+            break;
+        case SIM_DIRECT:
+            emit_Op_Memory(jit , 0 , 0 , JIT_MOVZX16 , host , JIT_RBX , -1 , 0 , 2L * value);
+            break;
+        case SIM_INDIRECT:
+            emit_Op_Register(jit , 0 , JIT_MOV_STORE , JIT_HOST(value) , JIT_RCX);
+            emit_Alu_Immediate(jit , JIT_DIGIT_AND , JIT_RCX , SIM_ADDRESS_MASK);
+            emit_Op_Memory(jit , 0 , 0 , JIT_MOVZX16 , host , JIT_RBX , JIT_RCX , 1 , 0);
+            break;
+        default:
+            emit_Op_Register(jit , 0 , JIT_MOV_STORE , JIT_HOST(value) , host);
+            break;
+    }
+}
+
+/**
+ * @brief Appends the code storing eax to the target operand (rcx holds the address of an indirect one).
+ *
+ * When the word stored belongs to a translated block, native code stops after the store.
+ *
+ * @param jit The JIT.
+ * @param mode Addressing mode of the operand.
+ * @param value Number of the operand (see jit_Operand).
+ * @param next Address of the next instruction.
+ * @param executed Number of instructions of the block that ran, with this one.
+ */
+void emit_Store(JIT * jit , int mode , unsigned int value , unsigned int next , int executed){
+    unsigned long skip;
+
+    if(mode == SIM_REGISTER){
+        emit_Op_Register(jit , 0 , JIT_MOV_STORE , JIT_RAX , JIT_HOST(value));
+        return;
+    }
+    if(mode == SIM_DIRECT){
+        emit_Op_Memory(jit , 0x66 , 0 , JIT_MOV_STORE , JIT_RAX , JIT_RBX , -1 , 0 , 2L * value);
+        emit_Op_Memory(jit , 0 , 0 , JIT_ALU_IMMEDIATE8 , JIT_DIGIT_CMP , JIT_RBP , -1 , 0 , JIT_FIELD(translated) + value);
+    }
+    else{
+        emit_Op_Memory(jit , 0x66 , 0 , JIT_MOV_STORE , JIT_RAX , JIT_RBX , JIT_RCX , 1 , 0);
+        emit_Op_Memory(jit , 0 , 0 , JIT_ALU_IMMEDIATE8 , JIT_DIGIT_CMP , JIT_RBP , JIT_RCX , 0 , JIT_FIELD(translated));
+    }
+    emit_Byte(jit , 0);
+    skip = emit_Skip(jit , JIT_EQUAL);
+    emit_Exit(jit , JIT_FLUSH , (long)next , executed);
+    patch_Skip(jit , skip);
+}
+
+/**
+ * @brief Appends the code putting the address a jmp, bne or jsr jumps to in eax.
+ *
+ * @param jit The JIT.
+ * @param mode Addressing mode of the operand.
+ * @param value Number of the operand (see jit_Operand).
+ */
+void emit_Jump_Address(JIT * jit , int mode , unsigned int value){
+    if(mode == SIM_DIRECT){
+        emit_Move_Immediate(jit , JIT_RAX , value);
+    }
+    else{
+        emit_Op_Register(jit , 0 , JIT_MOV_STORE , JIT_HOST(value) , JIT_RAX);
+        emit_Alu_Immediate(jit , JIT_DIGIT_AND , JIT_RAX , SIM_ADDRESS_MASK);
+    }
+}
+
+/**
+ * @brief Appends the native code of an instruction.
+ *
+ * @param jit The JIT.
+ * @param address Address of the instruction.
+ * @param instruction The decoded instruction.
+ * @param executed Number of instructions of the block before this one.
+ * @return Nonzero if the instruction ends the block.
+ */
+int emit_Instruction(JIT * jit , unsigned int address , const SIM_INSTRUCTION * instruction , int executed){
+    const SIMULATOR * sim = jit->sim;
+    unsigned int next = address + instruction->length;
+    unsigned int source = 0;
+    unsigned int target = 0;
+    int target_host;
+    unsigned long skip;
+
+    if(instruction->source_mode != SIM_NO_OPERAND){
+        source = jit_Operand(sim , instruction->source_mode , instruction->source , instruction->source_index);
+    }
+    if(instruction->target_mode != SIM_NO_OPERAND){
+        target = jit_Operand(sim , instruction->target_mode , instruction->target , instruction->target_index);
+    }
+    target_host = (instruction->target_mode == SIM_REGISTER) ? JIT_HOST(target) : JIT_RAX;
+
+    switch(instruction->plain){
+        case SIM_MOV:
+            if(instruction->source_mode == SIM_REGISTER && instruction->target_mode == SIM_REGISTER){
+                emit_Op_Register(jit , 0 , JIT_MOV_STORE , JIT_HOST(source) , JIT_HOST(target));
+                break;
+            }
+            emit_Load(jit , instruction->source_mode , source , JIT_RAX);
+            if(instruction->target_mode == SIM_INDIRECT){
+                emit_Load(jit , SIM_REGISTER , target , JIT_RCX);
+                emit_Alu_Immediate(jit , JIT_DIGIT_AND , JIT_RCX , SIM_ADDRESS_MASK);
+            }
+            emit_Store(jit , instruction->target_mode , target , next , executed + 1);
+            break;
+        case SIM_CMP:
+            emit_Load(jit , instruction->source_mode , source , JIT_RAX);
+            if(instruction->target_mode == SIM_REGISTER){
+                emit_Op_Register(jit , 0 , JIT_CMP , JIT_HOST(target) , JIT_RAX);
+            }
+            else{
+                emit_Load(jit , instruction->target_mode , target , JIT_RDX);
+                emit_Op_Register(jit , 0 , JIT_CMP , JIT_RDX , JIT_RAX);
+            }
+            emit_Op_Memory(jit , 0 , 0 , JIT_SETE , 0 , JIT_RBP , -1 , 0 , JIT_FIELD(zero_flag));
+            break;
+        case SIM_ADD:
+        case SIM_SUB:
+        case SIM_LEA:
+        case SIM_CLR:
+        case SIM_NOT:
+        case SIM_INC:
+        case SIM_DEC:
+        case SIM_RED:
+            /* The value goes in edx, the target is updated in its host register or in eax */
+            if(instruction->plain == SIM_ADD || instruction->plain == SIM_SUB){
+                emit_Load(jit , instruction->source_mode , source , JIT_RDX);
+            }
+            else if(instruction->plain == SIM_RED){
+                emit_Call(jit , (void (*)(void))jit_Read);
+                target_host = JIT_RAX;
+            }
+            if(instruction->target_mode == SIM_INDIRECT){
+                emit_Load(jit , SIM_REGISTER , target , JIT_RCX);
+                emit_Alu_Immediate(jit , JIT_DIGIT_AND , JIT_RCX , SIM_ADDRESS_MASK);
+            }
+            if(instruction->plain != SIM_LEA && instruction->plain != SIM_CLR && instruction->plain != SIM_RED && target_host == JIT_RAX){
+                if(instruction->target_mode == SIM_INDIRECT){
+                    emit_Op_Memory(jit , 0 , 0 , JIT_MOVZX16 , JIT_RAX , JIT_RBX , JIT_RCX , 1 , 0);
+                }
+                else{
+                    emit_Load(jit , instruction->target_mode , target , JIT_RAX);
+                }
+            }
+            switch(instruction->plain){
+                case SIM_ADD:
+                    emit_Op_Register(jit , 0 , JIT_ADD , JIT_RDX , target_host);
+                    break;
+                case SIM_SUB:
+                    emit_Op_Register(jit , 0 , JIT_SUB , JIT_RDX , target_host);
+                    break;
+                case SIM_LEA:
+                    emit_Move_Immediate(jit , target_host , instruction->address);
+                    break;
+                case SIM_CLR:
+                    emit_Op_Register(jit , 0 , JIT_XOR , target_host , target_host);
+                    break;
+                case SIM_NOT:
+                    emit_Op_Register(jit , 0 , JIT_UNARY , JIT_DIGIT_NOT , target_host);
+                    break;
+                case SIM_INC:
+                    emit_Alu_Immediate(jit , JIT_DIGIT_ADD , target_host , 1);
+                    break;
+                case SIM_DEC:
+                    emit_Alu_Immediate(jit , JIT_DIGIT_SUB , target_host , 1);
+                    break;
+            }
+            emit_Alu_Immediate(jit , JIT_DIGIT_AND , target_host , SIM_WORD_MASK);
+            if(target_host == JIT_RAX){
+                emit_Store(jit , instruction->target_mode , target , next , executed + 1);
+            }
+            break;
+        case SIM_PRN:
+            emit_Load(jit , instruction->target_mode , target , JIT_RSI);
+            emit_Call(jit , (void (*)(void))jit_Print);
+            break;
+        case SIM_JMP:
+            emit_Jump_Address(jit , instruction->target_mode , target);
+            emit_Jump(jit , JIT_ALWAYS , jit->dispatch);
+            return 1;
+        case SIM_BNE:
+            emit_Op_Memory(jit , 0 , 0 , JIT_ALU_IMMEDIATE8 , JIT_DIGIT_CMP , JIT_RBP , -1 , 0 , JIT_FIELD(zero_flag));
+            emit_Byte(jit , 0);
+            skip = emit_Skip(jit , JIT_NOT_EQUAL);
+            emit_Jump_Address(jit , instruction->target_mode , target);
+            emit_Jump(jit , JIT_ALWAYS , jit->dispatch);
+            patch_Skip(jit , skip);
+            emit_Move_Immediate(jit , JIT_RAX , next);
+            emit_Jump(jit , JIT_ALWAYS , jit->dispatch);
+            return 1;
+        case SIM_JSR:
+            /* A full stack is reported by the interpreter */
+            emit_Op_Memory(jit , 0 , 0 , JIT_MOV_LOAD , JIT_RCX , JIT_RBP , -1 , 0 , JIT_FIELD(stack_pointer));
+            emit_Op_Memory(jit , 0 , 0 , JIT_CMP_LOAD , JIT_RCX , JIT_RBP , -1 , 0 , JIT_FIELD(image_end));
+            skip = emit_Skip(jit , JIT_ABOVE);
+            emit_Exit(jit , JIT_INTERPRET , (long)address , executed);
+            patch_Skip(jit , skip);
+            emit_Alu_Immediate(jit , JIT_DIGIT_SUB , JIT_RCX , 1);
+            emit_Op_Memory(jit , 0 , 0 , JIT_MOV_STORE , JIT_RCX , JIT_RBP , -1 , 0 , JIT_FIELD(stack_pointer));
+            emit_Op_Memory(jit , 0x66 , 0 , JIT_MOV_IMMEDIATE , 0 , JIT_RBX , JIT_RCX , 1 , 0);
+            emit_Byte(jit , next & 0xFF);
+            emit_Byte(jit , (next >> 8) & 0xFF);
+            emit_Jump_Address(jit , instruction->target_mode , target);
+            emit_Op_Memory(jit , 0 , 0 , JIT_ALU_IMMEDIATE8 , JIT_DIGIT_CMP , JIT_RBP , JIT_RCX , 0 , JIT_FIELD(translated));
+            emit_Byte(jit , 0);
+            skip = emit_Skip(jit , JIT_EQUAL);
+            emit_Exit(jit , JIT_FLUSH , -1 , executed + 1);
+            patch_Skip(jit , skip);
+            emit_Jump(jit , JIT_ALWAYS , jit->dispatch);
+            return 1;
+        case SIM_RTS:
+            /* An empty stack is reported by the interpreter */
+            emit_Op_Memory(jit , 0 , 0 , JIT_MOV_LOAD , JIT_RCX , JIT_RBP , -1 , 0 , JIT_FIELD(stack_pointer));
+            emit_Alu_Immediate(jit , JIT_DIGIT_CMP , JIT_RCX , SIM_MEMORY_SIZE);
+            skip = emit_Skip(jit , JIT_BELOW);
+            emit_Exit(jit , JIT_INTERPRET , (long)address , executed);
+            patch_Skip(jit , skip);
+            emit_Op_Memory(jit , 0 , 0 , JIT_MOVZX16 , JIT_RAX , JIT_RBX , JIT_RCX , 1 , 0);
+            emit_Alu_Immediate(jit , JIT_DIGIT_ADD , JIT_RCX , 1);
+            emit_Op_Memory(jit , 0 , 0 , JIT_MOV_STORE , JIT_RCX , JIT_RBP , -1 , 0 , JIT_FIELD(stack_pointer));
+            emit_Alu_Immediate(jit , JIT_DIGIT_AND , JIT_RAX , SIM_ADDRESS_MASK);
+            emit_Jump(jit , JIT_ALWAYS , jit->dispatch);
+            return 1;
+        default:
+            emit_Exit(jit , JIT_HALTED , (long)address , executed + 1);
+            return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Appends the native code shared by the blocks: entering a block, going on at an address, and leaving.
+ *
+ * @param jit The JIT.
+ */
+void emit_Stubs(JIT * jit){
+    static const int saved[] = {JIT_RBX , JIT_RBP , 12 , 13 , 14 , 15};
+    unsigned long skip;
+    int i;
+
+    /* enter(jit, block): saves the registers the caller keeps, 8 more bytes align the stack */
+    jit->enter = jit->buffer + jit->used;
+    for(i = 0 ; i < 6 ; i++){
+        if(saved[i] & 8){
+            emit_Byte(jit , 0x41);
+        }
+        emit_Byte(jit , 0x50 | (saved[i] & 7));
+    }
+    emit_Op_Register(jit , 1 , JIT_ALU_IMMEDIATE , JIT_DIGIT_SUB , JIT_RSP);
+    emit_U32(jit , 8);
+    emit_Op_Register(jit , 1 , JIT_MOV_STORE , JIT_RDI , JIT_RBP);
+    emit_Op_Memory(jit , 0 , 1 , JIT_MOV_LOAD , JIT_RBX , JIT_RBP , -1 , 0 , JIT_FIELD(cells));
+    emit_Registers(jit , 0);
+    emit_Op_Register(jit , 0 , JIT_INDIRECT , JIT_DIGIT_JMP , JIT_RSI);
+
+    /* dispatch: goes on at the translated block of the address in eax, or leaves */
+    jit->dispatch = jit->buffer + jit->used;
+    emit_Op_Register(jit , 0 , JIT_MOV_STORE , JIT_RAX , JIT_RCX);
+    emit_Op_Memory(jit , 0 , 1 , JIT_MOV_LOAD , JIT_RDX , JIT_RBP , JIT_RCX , 3 , JIT_FIELD(code));
+    emit_Op_Register(jit , 1 , JIT_TEST , JIT_RDX , JIT_RDX);
+    skip = emit_Skip(jit , JIT_EQUAL);
+    emit_Op_Register(jit , 0 , JIT_INDIRECT , JIT_DIGIT_JMP , JIT_RDX);
+    patch_Skip(jit , skip);
+
+    /* leave: keeps the address in eax and the registers, and returns */
+    jit->leave = jit->buffer + jit->used;
+    emit_Op_Memory(jit , 0 , 0 , JIT_MOV_STORE , JIT_RAX , JIT_RBP , -1 , 0 , JIT_FIELD(pc));
+    emit_Registers(jit , 1);
+    emit_Op_Register(jit , 1 , JIT_ALU_IMMEDIATE , JIT_DIGIT_ADD , JIT_RSP);
+    emit_U32(jit , 8);
+    for(i = 5 ; i >= 0 ; i--){
+        if(saved[i] & 8){
+            emit_Byte(jit , 0x41);
+        }
+        emit_Byte(jit , 0x58 | (saved[i] & 7));
+    }
+    emit_Byte(jit , 0xC3);
+    jit->stubs_size = jit->used;
+}
+
+/**
+ * @brief Creates the JIT of a simulator and maps its buffer.
+ *
+ * @param sim The simulator.
+ * @return The JIT (to free with free_Jit), or NULL if the host is not x86-64 or the buffer cannot be mapped.
+ */
+JIT * create_Jit(SIMULATOR * sim){
+    JIT * jit = calloc(1 , sizeof(JIT));
+    void * buffer;
+    int fd;
+
+    if(jit == NULL){
+        return NULL;
+    }
+    /* An anonymous mapping, through /dev/zero (MAP_ANONYMOUS is not ANSI), writable until code runs */
+    fd = open("/dev/zero" , O_RDWR);
+    if(fd < 0){
+        free(jit);
+        return NULL;
+    }
+    buffer = mmap(NULL , JIT_BUFFER_SIZE , PROT_READ | PROT_WRITE , MAP_PRIVATE , fd , 0);
+    close(fd);
+    if(buffer == MAP_FAILED){
+        free(jit);
+        return NULL;
+    }
+    jit->buffer = buffer;
+    jit->writable = 1;
+    jit->sim = sim;
+    jit->cells = sim->cells;
+    emit_Stubs(jit);
+    return jit;
+}
+
+/**
+ * @brief Makes the buffer of a JIT writable to translate blocks, or executable to run them.
+ *
+ * The protection only changes when it differs, so running blocks already translated
+ * costs no system call.
+ *
+ * @param jit The JIT.
+ * @param writable Nonzero for writable, 0 for read-only and executable.
+ * @return 0 on success, 1 if the protection cannot be changed.
+ */
+int protect_Jit(JIT * jit , int writable){
+    if((jit->writable != 0) == (writable != 0)){
+        return 0;
+    }
+    if(mprotect(jit->buffer , JIT_BUFFER_SIZE , writable ? PROT_READ | PROT_WRITE : PROT_READ | PROT_EXEC) != 0){
+        return 1;
+    }
+    jit->writable = writable;
+    return 0;
+}
+
+/**
+ * @brief Throws every translation away.
+ *
+ * @param jit The JIT.
+ */
+void flush_Jit(JIT * jit){
+    memset(jit->code , 0 , sizeof(jit->code));
+    memset(jit->translated , 0 , sizeof(jit->translated));
+    jit->used = jit->stubs_size;
+    jit->flushes++;
+}
+
+/**
+ * @brief Translates the block starting at an address.
+ *
+ * @param jit The JIT.
+ * @param address Address of the block.
+ * @return The native code of the block, or NULL if its first instruction cannot be translated or the buffer cannot be made writable.
+ */
+unsigned char * translate_Block(JIT * jit , unsigned int address){
+    SIMULATOR * sim = jit->sim;
+    SIM_INSTRUCTION * instruction;
+    unsigned char * block;
+    unsigned long budget_at[2];
+    unsigned int pc = address;
+    unsigned int i;
+    int count = 0;
+    int end = 0;
+
+    decode_Instruction(sim , address);
+    if(sim->program[address].handler == SIM_ILLEGAL || protect_Jit(jit , 1) != 0){
+        return NULL;
+    }
+    if(JIT_BUFFER_SIZE - jit->used < (JIT_MAX_BLOCK + 1) * JIT_MAX_INSTRUCTION_SIZE){
+        flush_Jit(jit);
+    }
+    block = jit->buffer + jit->used;
+    jit->refunds = 0;
+
+    /* The block takes its steps from the budget, or leaves the first one to the interpreter */
+    emit_Op_Memory(jit , 0 , 1 , JIT_ALU_IMMEDIATE , JIT_DIGIT_CMP , JIT_RBP , -1 , 0 , JIT_FIELD(budget));
+    budget_at[0] = jit->used;
+    emit_U32(jit , 0);
+    i = emit_Skip(jit , JIT_ABOVE_EQUAL);
+    emit_Exit(jit , JIT_INTERPRET , (long)address , -1);
+    patch_Skip(jit , i);
+    emit_Op_Memory(jit , 0 , 1 , JIT_ALU_IMMEDIATE , JIT_DIGIT_SUB , JIT_RBP , -1 , 0 , JIT_FIELD(budget));
+    budget_at[1] = jit->used;
+    emit_U32(jit , 0);
+
+    while(!end){
+        instruction = &sim->program[pc];
+        if(pc != address){
+            decode_Instruction(sim , pc);
+        }
+        if(instruction->handler == SIM_ILLEGAL || count == JIT_MAX_BLOCK){
+            /* The next block starts here */
+            emit_Move_Immediate(jit , JIT_RAX , pc);
+            emit_Jump(jit , JIT_ALWAYS , jit->dispatch);
+            break;
+        }
+        for(i = pc ; i < pc + instruction->length ; i++){
+            jit->translated[i] = 1;
+        }
+        end = emit_Instruction(jit , pc , instruction , count);
+        count++;
+        pc += instruction->length;
+        if(!end && pc >= SIM_MEMORY_SIZE){
+            emit_Move_Immediate(jit , JIT_RAX , pc);
+            emit_Jump(jit , JIT_ALWAYS , jit->dispatch);
+            end = 1;
+        }
+    }
+
+    for(i = 0 ; i < 2 ; i++){
+        jit->buffer[budget_at[i]] = (unsigned char)count;
+    }
+    for(i = 0 ; i < jit->refunds ; i++){
+        jit->buffer[jit->refund_at[i]] = (unsigned char)(count - jit->refund_executed[i]);
+    }
+    jit->code[address] = block;
+    jit->blocks++;
+    return block;
+}
+
+/**
+ * @brief Runs the program of the simulator until it stops, as run_Simulator does.
+ *
+ * @param jit The JIT.
+ * @param start Address of the first instruction.
+ * @return SIM_HALTED when stop runs, or the error that stopped the run (sim->pc is its address).
+ */
+int run_Jit(JIT * jit , unsigned int start){
+    SIMULATOR * sim = jit->sim;
+    void (*enter)(JIT * , unsigned char *);
+    unsigned long max_steps = sim->max_steps;
+    unsigned long steps = sim->steps;
+    unsigned long initial;
+    unsigned long before;
+    unsigned char * block;
+    unsigned int pc = start & SIM_ADDRESS_MASK;
+    unsigned int i;
+    int result = -1;
+
+    memcpy(&enter , &jit->enter , sizeof(enter));
+    jit->budget = (max_steps != 0) ? max_steps : ULONG_MAX;
+    initial = jit->budget;
+    jit->stack_pointer = sim->stack_pointer;
+    jit->image_end = sim->image_end;
+    jit->zero_flag = (unsigned char)(sim->zero_flag != 0);
+    flush_Jit(jit);
+    jit->blocks = 0;
+    jit->flushes = 0;
+
+    while(result < 0){
+        if(pc >= SIM_MEMORY_SIZE){
+            result = SIM_OUT_OF_MEMORY;
+            break;
+        }
+        if(jit->budget == 0){
+            result = SIM_STEP_LIMIT;
+            break;
+        }
+        block = (jit->code[pc] != NULL) ? jit->code[pc] : translate_Block(jit , pc);
+        jit->status = JIT_INTERPRET;
+        jit->pc = pc;
+        if(block != NULL && protect_Jit(jit , 0) == 0){
+            jit->status = JIT_CONTINUE;
+            enter(jit , block);
+        }
+        pc = jit->pc;
+
+        switch(jit->status){
+            case JIT_HALTED:
+                result = SIM_HALTED;
+                break;
+            case JIT_FLUSH:
+                flush_Jit(jit);
+                break;
+            case JIT_INTERPRET:
+                if(jit->budget == 0){
+                    break;
+                }
+                /* One instruction runs in the interpreter; native code did not invalidate its decoding */
+                for(i = 0 ; i < SIM_MEMORY_SIZE ; i++){
+                    sim->program[i].handler = SIM_DECODE;
+                }
+                sim->stack_pointer = jit->stack_pointer;
+                sim->zero_flag = jit->zero_flag;
+                sim->max_steps = 1;
+                before = sim->steps;
+                result = run_Simulator(sim , pc);
+                jit->budget -= sim->steps - before;
+                jit->stack_pointer = sim->stack_pointer;
+                jit->zero_flag = (unsigned char)(sim->zero_flag != 0);
+                pc = sim->pc;
+                if(result == SIM_STEP_LIMIT){
+                    result = -1;
+                }
+                flush_Jit(jit);
+                break;
+        }
+    }
+
+    sim->max_steps = max_steps;
+    sim->steps = steps + (initial - jit->budget);
+    sim->pc = pc;
+    sim->stack_pointer = jit->stack_pointer;
+    sim->zero_flag = jit->zero_flag;
+    return result;
+}
+
+/**
+ * @brief Unmaps the buffer of a JIT and frees it.
+ *
+ * @param jit The JIT, or NULL.
+ */
+void free_Jit(JIT * jit){
+    if(jit != NULL){
+        munmap(jit->buffer , JIT_BUFFER_SIZE);
+        free(jit);
+    }
+}
+
+#else
+
+/**
+ * @brief Creates the JIT of a simulator; the host is not x86-64, so there is none.
+ *
+ * @param sim The simulator.
+ * @return NULL.
+ */
+JIT * create_Jit(SIMULATOR * sim){
+    (void)sim;
+    return NULL;
+}
+
+/**
+ * @brief Runs the program in the interpreter (there is no JIT on this host).
+ *
+ * @param jit The JIT.
+ * @param start Address of the first instruction.
+ * @return The result of run_Simulator.
+ */
+int run_Jit(JIT * jit , unsigned int start){
+    return run_Simulator(jit->sim , start);
+}
+
+/**
+ * @brief Frees a JIT.
+ *
+ * @param jit The JIT, or NULL.
+ */
+void free_Jit(JIT * jit){
+    free(jit);
+}
+
+#endif
+
+/**
+ * @brief Writes a number for prn, called from native code.
+ *
+ * @param sim The simulator.
+ * @param word The word to write.
+ */
+void jit_Print(SIMULATOR * sim , unsigned int word){
+    fprintf(sim->output , "%d\n" , sim_Signed(word));
+}
+
+/**
+ * @brief Reads a character for red, called from native code.
+ *
+ * @param sim The simulator.
+ * @return The character as a word, SIM_WORD_MASK (-1) at the end of the input.
+ */
+unsigned int jit_Read(SIMULATOR * sim){
+    int c = getc(sim->input);
+
+    if(c == EOF){
+        return SIM_WORD_MASK;
+    }
+    sim->input_read++;
+    if(sim->record != NULL){
+        putc(c , sim->record);
+    }
+    return (unsigned int)c;
+}
@@ -0,0 +1,330 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "library.h"
+
+/**
+ * @brief Writes objects as a library file.
+ *
+ * Each object is encoded as a binary object file, and each entry symbol is placed in the
+ * hash table, which has at least twice as many slots as symbols so probes stay short.
+ *
+ * @param file_name Name of the file.
+ * @param images The objects.
+ * @param names Names of the members.
+ * @param count Number of objects.
+ * @param report Stream the errors are written to.
+ * @return 0 on success, 1 if a symbol is defined by two members or the file cannot be written.
+ */
+int write_Library(const char * file_name , const OBJECT_IMAGE * images , char ** names , unsigned int count , FILE * report){
+    LIBRARY_HEADER header;
+    LIBRARY_MEMBER * members = NULL;
+    LIBRARY_SLOT * slots = NULL;
+    char ** data = NULL;
+    long * sizes = NULL;
+    char * strings = NULL;
+    char padding[LIBRARY_ALIGNMENT];
+    unsigned long symbol_count = 0 , slot_count = LIBRARY_MIN_SLOTS , strings_size = 0;
+    unsigned long hash , slot , name_offset , index_size , offset;
+    unsigned int i , j;
+    int status = 0;
+    FILE * fp = NULL;
+
+    for(i = 0 ; i < count ; i++){
+        strings_size += strlen(names[i]) + 1;
+        for(j = 0 ; j < images[i].entry_count ; j++){
+            strings_size += strlen(images[i].entry_names[j]) + 1;
+        }
+        symbol_count += images[i].entry_count;
+    }
+    while(slot_count < 2 * symbol_count){
+        slot_count *= 2;
+    }
+    members = malloc(sizeof(LIBRARY_MEMBER) * (count + 1));
+    slots = malloc(sizeof(LIBRARY_SLOT) * slot_count);
+    strings = malloc(strings_size + 1);
+    data = calloc(count + 1 , sizeof(char *));
+    sizes = calloc(count + 1 , sizeof(long));
+    if(members == NULL || slots == NULL || strings == NULL || data == NULL || sizes == NULL){
+        fprintf(report , "Error: Memory allocation failed\n");
+        free(data);
+        free(sizes);
+        free(strings);
+        free(slots);
+        free(members);
+        return 1;
+    }
+
+    /* The names of the members, then the symbols, each symbol placed in the index */
+    strings_size = 0;
+    memset(slots , 0 , sizeof(LIBRARY_SLOT) * slot_count);
+    for(i = 0 ; i < slot_count ; i++){
+        object_put_u32(slots[i].member , LIBRARY_EMPTY_SLOT);
+    }
+    for(i = 0 ; i < count ; i++){
+        object_put_u32(members[i].name_offset , strings_size);
+        strcpy(strings + strings_size , names[i]);
+        strings_size += strlen(names[i]) + 1;
+    }
+    for(i = 0 ; i < count ; i++){
+        for(j = 0 ; j < images[i].entry_count ; j++){
+            hash = symbol_Hash(images[i].entry_names[j]);
+            slot = hash & (slot_count - 1);
+            while(object_u32(slots[slot].member) != LIBRARY_EMPTY_SLOT &&
+                  (object_u32(slots[slot].hash) != hash || strcmp(strings + object_u32(slots[slot].name_offset) , images[i].entry_names[j]) != 0)){
+                slot = (slot + 1) & (slot_count - 1);
+            }
+            if(object_u32(slots[slot].member) != LIBRARY_EMPTY_SLOT){
+                fprintf(report , "Error: Symbol %s is defined in both %s and %s\n" , images[i].entry_names[j] , names[object_u32(slots[slot].member)] , names[i]);
+                status = 1;
+                continue;
+            }
+            name_offset = strings_size;
+            strcpy(strings + strings_size , images[i].entry_names[j]);
+            strings_size += strlen(images[i].entry_names[j]) + 1;
+            object_put_u32(slots[slot].name_offset , name_offset);
+            object_put_u32(slots[slot].hash , hash);
+            object_put_u32(slots[slot].member , i);
+        }
+    }
+
+    /* The members follow the index, each on a multiple of the alignment */
+    index_size = sizeof(LIBRARY_HEADER) + sizeof(LIBRARY_MEMBER) * count + sizeof(LIBRARY_SLOT) * slot_count + strings_size;
+    offset = (index_size + LIBRARY_ALIGNMENT - 1) / LIBRARY_ALIGNMENT * LIBRARY_ALIGNMENT;
+    for(i = 0 ; status == 0 && i < count ; i++){
+        data[i] = object_Encode(&images[i] , &sizes[i]);
+        if(data[i] == NULL){
+            fprintf(report , "Error: Memory allocation failed\n");
+            status = 1;
+            break;
+        }
+        object_put_u32(members[i].offset , offset);
+        object_put_u32(members[i].size , sizes[i]);
+        offset = (offset + sizes[i] + LIBRARY_ALIGNMENT - 1) / LIBRARY_ALIGNMENT * LIBRARY_ALIGNMENT;
+    }
+
+    if(status == 0){
+        memcpy(header.magic , LIBRARY_MAGIC , sizeof(header.magic));
+        object_put_u32(header.version , LIBRARY_VERSION);
+        object_put_u32(header.member_count , count);
+        object_put_u32(header.symbol_count , symbol_count);
+        object_put_u32(header.slot_count , slot_count);
+        object_put_u32(header.members_offset , sizeof(LIBRARY_HEADER));
+        object_put_u32(header.slots_offset , sizeof(LIBRARY_HEADER) + sizeof(LIBRARY_MEMBER) * count);
+        object_put_u32(header.strings_offset , sizeof(LIBRARY_HEADER) + sizeof(LIBRARY_MEMBER) * count + sizeof(LIBRARY_SLOT) * slot_count);
+        object_put_u32(header.strings_size , strings_size);
+        object_put_u32(header.index_size , index_size);
+        object_put_u32(header.file_size , offset);
+        memset(padding , 0 , sizeof(padding));
+
+        fp = fopen(file_name , "wb");
+        if(fp == NULL){
+            fprintf(report , "Error: Failed to write file %s\n" , file_name);
+            status = 1;
+        }
+    }
+    if(fp != NULL){
+        fwrite(&header , sizeof(LIBRARY_HEADER) , 1 , fp);
+        fwrite(members , sizeof(LIBRARY_MEMBER) , count , fp);
+        fwrite(slots , sizeof(LIBRARY_SLOT) , slot_count , fp);
+        fwrite(strings , 1 , strings_size , fp);
+        fwrite(padding , 1 , (LIBRARY_ALIGNMENT - index_size % LIBRARY_ALIGNMENT) % LIBRARY_ALIGNMENT , fp);
+        for(i = 0 ; i < count ; i++){
+            fwrite(data[i] , 1 , sizes[i] , fp);
+            fwrite(padding , 1 , (LIBRARY_ALIGNMENT - sizes[i] % LIBRARY_ALIGNMENT) % LIBRARY_ALIGNMENT , fp);
+        }
+        if(ferror(fp) != 0 || fclose(fp) != 0){
+            fprintf(report , "Error: Failed to write file %s\n" , file_name);
+            status = 1;
+        }
+    }
+
+    for(i = 0 ; i < count ; i++){
+        free(data[i]);
+    }
+    free(data);
+    free(sizes);
+    free(strings);
+    free(slots);
+    free(members);
+    return status;
+}
+
+/**
+ * @brief Opens a library file, maps its index and checks its header and tables.
+ *
+ * Only the index is mapped; the members are mapped one by one with load_Library_Member.
+ * Every offset and count is checked, and the index must have an empty slot, so lookups
+ * need no checks and always end.
+ *
+ * @param file_name Name of the file.
+ * @return Pointer to the library, or NULL if the file cannot be read or is not a valid library.
+ */
+LIBRARY_FILE * load_Library(const char * file_name){
+    LIBRARY_HEADER header;
+    LIBRARY_FILE * library = NULL;
+    struct stat file_stat;
+    unsigned long members_offset , slots_offset , strings_offset , offset , size , occupied = 0;
+    unsigned int i;
+    int fd;
+
+    fd = open(file_name , O_RDONLY);
+    if(fd < 0){
+        return NULL;
+    }
+    if(fstat(fd , &file_stat) != 0 || read(fd , &header , sizeof(LIBRARY_HEADER)) != (long)sizeof(LIBRARY_HEADER) ||
+       memcmp(header.magic , LIBRARY_MAGIC , sizeof(header.magic)) != 0 || object_u32(header.version) != LIBRARY_VERSION ||
+       object_u32(header.file_size) != (unsigned long)file_stat.st_size ||
+       object_u32(header.index_size) < sizeof(LIBRARY_HEADER) || object_u32(header.index_size) > (unsigned long)file_stat.st_size){
+        close(fd);
+        return NULL;
+    }
+    library = malloc(sizeof(LIBRARY_FILE));
+    if(library == NULL){
+        close(fd);
+        return NULL;
+    }
+    library->fd = fd;
+    library->file_size = file_stat.st_size;
+    library->index_size = object_u32(header.index_size);
+    library->index = mmap(NULL , library->index_size , PROT_READ , MAP_PRIVATE , fd , 0);
+    if(library->index == MAP_FAILED){
+        close(fd);
+        free(library);
+        return NULL;
+    }
+    library->member_count = object_u32(header.member_count);
+    library->symbol_count = object_u32(header.symbol_count);
+    library->slot_count = object_u32(header.slot_count);
+    library->strings_size = object_u32(header.strings_size);
+    members_offset = object_u32(header.members_offset);
+    slots_offset = object_u32(header.slots_offset);
+    strings_offset = object_u32(header.strings_offset);
+
+    /* The tables must follow each other inside the index */
+    if(library->member_count > (unsigned long)library->index_size || library->slot_count > (unsigned long)library->index_size ||
+       library->slot_count == 0 || (library->slot_count & (library->slot_count - 1)) != 0 ||
+       members_offset < sizeof(LIBRARY_HEADER) || members_offset + sizeof(LIBRARY_MEMBER) * library->member_count > slots_offset ||
+       slots_offset + sizeof(LIBRARY_SLOT) * library->slot_count > strings_offset ||
+       strings_offset + library->strings_size > (unsigned long)library->index_size || library->strings_size == 0){
+        close_Library(&library);
+        return NULL;
+    }
+    library->members = (const LIBRARY_MEMBER *)((const char *)library->index + members_offset);
+    library->slots = (const LIBRARY_SLOT *)((const char *)library->index + slots_offset);
+    library->strings = (const char *)library->index + strings_offset;
+    if(library->strings[library->strings_size - 1] != '\0'){
+        close_Library(&library);
+        return NULL;
+    }
+
+    /* Every member lies inside the file, and every name starts inside the strings */
+    for(i = 0 ; i < library->member_count ; i++){
+        offset = object_u32(library->members[i].offset);
+        size = object_u32(library->members[i].size);
+        if(object_u32(library->members[i].name_offset) >= library->strings_size ||
+           offset > (unsigned long)library->file_size || size > (unsigned long)library->file_size - offset){
+            close_Library(&library);
+            return NULL;
+        }
+    }
+    for(i = 0 ; i < library->slot_count ; i++){
+        if(object_u32(library->slots[i].member) == LIBRARY_EMPTY_SLOT){
+            continue;
+        }
+        occupied++;
+        if(object_u32(library->slots[i].member) >= library->member_count || object_u32(library->slots[i].name_offset) >= library->strings_size){
+            close_Library(&library);
+            return NULL;
+        }
+    }
+    if(occupied != library->symbol_count || occupied >= library->slot_count){
+        close_Library(&library);
+        return NULL;
+    }
+    return library;
+}
+
+/**
+ * @brief Finds the member defining a symbol.
+ *
+ * @param library The library.
+ * @param name Name of the symbol.
+ * @return Index of the member, or -1 if no member defines the symbol.
+ */
+long find_Library_Symbol(const LIBRARY_FILE * library , const char * name){
+    unsigned long hash = symbol_Hash(name);
+    unsigned long slot = hash & (library->slot_count - 1);
+    const LIBRARY_SLOT * entry = NULL;
+
+    while(1){
+        entry = &library->slots[slot];
+        if(object_u32(entry->member) == LIBRARY_EMPTY_SLOT){
+            return -1;
+        }
+        if(object_u32(entry->hash) == hash && strcmp(library->strings + object_u32(entry->name_offset) , name) == 0){
+            return object_u32(entry->member);
+        }
+        slot = (slot + 1) & (library->slot_count - 1);
+    }
+}
+
+/**
+ * @brief Finds a member by name.
+ *
+ * @param library The library.
+ * @param name Name of the member.
+ * @return Index of the member, or -1 if there is no such member.
+ */
+long find_Library_Member(const LIBRARY_FILE * library , const char * name){
+    unsigned int i;
+
+    for(i = 0 ; i < library->member_count ; i++){
+        if(strcmp(library_Member_Name(library , i) , name) == 0){
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Returns the name of a member.
+ *
+ * @param library The library.
+ * @param member Index of the member.
+ * @return The null terminated name.
+ */
+const char * library_Member_Name(const LIBRARY_FILE * library , unsigned int member){
+    return library->strings + object_u32(library->members[member].name_offset);
+}
+
+/**
+ * @brief Maps a member of a library.
+ *
+ * @param library The library.
+ * @param member Index of the member.
+ * @return The mapped object (to unload with unload_Object), or NULL if it is not a valid object.
+ */
+OBJECT_FILE * load_Library_Member(const LIBRARY_FILE * library , unsigned int member){
+    return map_Object(library->fd , object_u32(library->members[member].offset) , object_u32(library->members[member].size));
+}
+
+/**
+ * @brief Unmaps and closes a library file.
+ *
+ * @param library Pointer to the library pointer (set to NULL).
+ */
+void close_Library(LIBRARY_FILE ** library){
+    if(*library == NULL){
+        return;
+    }
+    munmap((*library)->index , (*library)->index_size);
+    close((*library)->fd);
+    free(*library);
+    *library = NULL;
+}
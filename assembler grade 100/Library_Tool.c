@@ -0,0 +1,176 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "library.h"
+
+/*
+ * objlib: packs assembled objects into an indexed library, and looks symbols up in it.
+ *
+ *   objlib create LIB MODULE...   packs the modules (base names of .ob, .ent and .ext
+ *                                 files, or .obj files) into LIB
+ *   objlib list LIB               lists the members and the symbols they define
+ *   objlib find LIB SYMBOL...     shows the member defining each symbol
+ *   objlib extract LIB MEMBER...  writes MEMBER.ob, MEMBER.ent and MEMBER.ext
+ *
+ * Each member is named after its module, without directory and .obj extension. Looking
+ * a symbol up maps only the index of the library, and each member is mapped on its own.
+ */
+
+/**
+ * @brief Returns the member name of a module: its name without directory and .obj extension.
+ *
+ * @param module Name of the module.
+ * @return The member name (to free), or NULL if memory ran out.
+ */
+char * member_Name(const char * module){
+    const char * base = strrchr(module , '/');
+    size_t extension = strlen(OBJECT_EXTENSION);
+    char * name = NULL;
+
+    name = object_File_Name((base != NULL) ? base + 1 : module , "");
+    if(name != NULL && strlen(name) > extension && strcmp(name + strlen(name) - extension , OBJECT_EXTENSION) == 0){
+        name[strlen(name) - extension] = '\0';
+    }
+    return name;
+}
+
+/**
+ * @brief Packs modules into a library.
+ *
+ * @param file_name Name of the library.
+ * @param modules Names of the modules.
+ * @param count Number of modules.
+ * @return 0 on success, 1 otherwise.
+ */
+int create_Library(const char * file_name , char ** modules , unsigned int count){
+    OBJECT_IMAGE * images = calloc(count + 1 , sizeof(OBJECT_IMAGE));
+    char ** names = calloc(count + 1 , sizeof(char *));
+    unsigned int i;
+    int status = 0;
+
+    if(images == NULL || names == NULL){
+        fprintf(stderr , "Error: Memory allocation failed\n");
+        free(images);
+        free(names);
+        return 1;
+    }
+    for(i = 0 ; i < count ; i++){
+        names[i] = member_Name(modules[i]);
+        if(names[i] == NULL || read_Object(modules[i] , &images[i]) != 0){
+            fprintf(stderr , "Error: Failed to read the object files of %s\n" , modules[i]);
+            status = 1;
+        }
+    }
+    if(status == 0){
+        status = write_Library(file_name , images , names , count , stderr);
+    }
+    for(i = 0 ; i < count ; i++){
+        free_Object_Image(&images[i]);
+        free(names[i]);
+    }
+    free(images);
+    free(names);
+    return status;
+}
+
+/**
+ * @brief Lists the members of a library and the symbols they define.
+ *
+ * @param library The library.
+ * @return 0 on success, 1 if a member is not a valid object.
+ */
+int list_Library(const LIBRARY_FILE * library){
+    OBJECT_FILE * object = NULL;
+    unsigned int i , j;
+
+    for(i = 0 ; i < library->member_count ; i++){
+        object = load_Library_Member(library , i);
+        if(object == NULL){
+            fprintf(stderr , "Error: Member %s is not a valid binary object\n" , library_Member_Name(library , i));
+            return 1;
+        }
+        printf("%s\t%u words:" , library_Member_Name(library , i) , object->code_count + object->data_count);
+        for(j = 0 ; j < object->entry_count ; j++){
+            printf(" %s" , object_Symbol_Name(object , &object->entries[j]));
+        }
+        printf("\n");
+        unload_Object(&object);
+    }
+    return 0;
+}
+
+/**
+ * @brief Writes a member of a library as the .ob, .ent and .ext files.
+ *
+ * @param library The library.
+ * @param name Name of the member.
+ * @return 0 on success, 1 otherwise.
+ */
+int extract_Member(const LIBRARY_FILE * library , const char * name){
+    OBJECT_FILE * object = NULL;
+    OBJECT_IMAGE image;
+    long member = find_Library_Member(library , name);
+    int status = 1;
+
+    memset(&image , 0 , sizeof(OBJECT_IMAGE));
+    if(member < 0){
+        fprintf(stderr , "Error: No member %s in the library\n" , name);
+        return 1;
+    }
+    object = load_Library_Member(library , member);
+    if(object == NULL){
+        fprintf(stderr , "Error: Member %s is not a valid binary object\n" , name);
+    }
+    else if(object_To_Image(object , &image) != 0){
+        fprintf(stderr , "Error: Memory allocation failed\n");
+    }
+    else if(write_Text_Object(&image , name) != 0){
+        fprintf(stderr , "Error: Failed to write the object files of %s\n" , name);
+    }
+    else{
+        status = 0;
+    }
+    free_Object_Image(&image);
+    unload_Object(&object);
+    return status;
+}
+
+int main(int argc , char * argv[]){
+    LIBRARY_FILE * library = NULL;
+    long member;
+    int status = 0;
+    int i;
+
+    if(argc < 3 || (strcmp(argv[1] , "list") != 0 && argc < 4) ||
+       (strcmp(argv[1] , "create") != 0 && strcmp(argv[1] , "list") != 0 && strcmp(argv[1] , "find") != 0 && strcmp(argv[1] , "extract") != 0)){
+        fprintf(stderr , "Usage: %s create LIB MODULE... | list LIB | find LIB SYMBOL... | extract LIB MEMBER...\n" , argv[0]);
+        return 1;
+    }
+    if(strcmp(argv[1] , "create") == 0){
+        return create_Library(argv[2] , argv + 3 , argc - 3);
+    }
+
+    library = load_Library(argv[2]);
+    if(library == NULL){
+        fprintf(stderr , "Error: %s is not a valid library\n" , argv[2]);
+        return 1;
+    }
+    if(strcmp(argv[1] , "list") == 0){
+        status = list_Library(library);
+    }
+    for(i = 3 ; strcmp(argv[1] , "find") == 0 && i < argc ; i++){
+        member = find_Library_Symbol(library , argv[i]);
+        if(member < 0){
+            fprintf(stderr , "Error: Symbol %s is not defined in %s\n" , argv[i] , argv[2]);
+            status = 1;
+        }
+        else{
+            printf("%s\t%s\n" , argv[i] , library_Member_Name(library , member));
+        }
+    }
+    for(i = 3 ; strcmp(argv[1] , "extract") == 0 && i < argc ; i++){
+        status |= extract_Member(library , argv[i]);
+    }
+    close_Library(&library);
+    return status;
+}
@@ -0,0 +1,865 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "linker.h"
+
+/*
+ * linker: links the objects written by the assembler into one image.
+ *
+ *   linker [-o OUT] [--binary] [-j N] [--strip] [--root=SYM]... [--library=FILE]... MODULE...
+ *
+ * Each MODULE is the base name of the .ob, .ent and .ext files of a source, or the name
+ * of a binary object file (.obj). The linked image is written to OUT.ob, with the entries
+ * of all the modules, at their linked addresses, in OUT.ent. Every extern reference is
+ * resolved, so no OUT.ext is written. With --binary, OUT.obj is written as well.
+ *
+ * The relocation table NAME.rel, written by the assembler with --relocatable, is used
+ * when it is there: only the words it lists are relocated.
+ *
+ * With -j N, N workers share each phase of the link; the output is the same for any N.
+ *
+ * With --strip (implied by --root), the modules no root symbol reaches are left out of
+ * the image, and the words and entries saved are reported.
+ *
+ * With --library=FILE, the symbols no module defines are looked up in the library FILE
+ * (written by objlib), and only the members defining them are mapped and linked.
+ */
+
+/**
+ * @brief Returns the shard of the symbol table holding a symbol.
+ *
+ * The top bits of the hash choose the shard, the low bits the slot in the shard.
+ *
+ * @param hash Hash of the name of the symbol.
+ * @return Index of the shard.
+ */
+unsigned int symbol_Shard(unsigned long hash){
+    return (unsigned int)(hash >> (OBJECT_HASH_BITS - LINK_SHARD_BITS)) & (LINK_SHARDS - 1);
+}
+
+/**
+ * @brief Creates an empty symbol table.
+ *
+ * The table has at least twice as many slots as symbols, so probes stay short.
+ *
+ * @param table The table.
+ * @param count Number of symbols the table will hold.
+ * @return 0 on success, 1 if memory ran out.
+ */
+int create_Symbol_Table(SYMBOL_TABLE * table , unsigned long count){
+    table->capacity = 16;
+    while(table->capacity < 2 * count){
+        table->capacity *= 2;
+    }
+    table->count = 0;
+    table->duplicates = 0;
+    table->slots = calloc(table->capacity , sizeof(LINK_SYMBOL));
+    table->status = (table->slots != NULL) ? 0 : 1;
+    return table->status;
+}
+
+/**
+ * @brief Finds the slot of a symbol, or the empty slot where it belongs.
+ *
+ * @param table The table.
+ * @param name Name of the symbol.
+ * @param hash Hash of the name.
+ * @return The slot.
+ */
+LINK_SYMBOL * find_Symbol_Slot(const SYMBOL_TABLE * table , const char * name , unsigned long hash){
+    unsigned long i = hash & (table->capacity - 1);
+
+    while(table->slots[i].name != NULL && (table->slots[i].hash != hash || strcmp(table->slots[i].name , name) != 0)){
+        i = (i + 1) & (table->capacity - 1);
+    }
+    return &table->slots[i];
+}
+
+/**
+ * @brief Finds a symbol in the global symbol table.
+ *
+ * @param linker The link.
+ * @param name Name of the symbol.
+ * @return The symbol, or NULL if no module defines it.
+ */
+LINK_SYMBOL * find_Symbol(const LINKER * linker , const char * name){
+    unsigned long hash = symbol_Hash(name);
+    LINK_SYMBOL * slot = find_Symbol_Slot(&linker->shards[symbol_Shard(hash)] , name , hash);
+
+    return (slot->name != NULL) ? slot : NULL;
+}
+
+/**
+ * @brief Frees a symbol table.
+ *
+ * @param table The table.
+ */
+void free_Symbol_Table(SYMBOL_TABLE * table){
+    free(table->slots);
+    table->slots = NULL;
+    table->capacity = 0;
+    table->count = 0;
+}
+
+/**
+ * @brief Reads a module, from NAME.obj when the name ends with .obj, from NAME.ob, NAME.ent and NAME.ext otherwise, with its relocation table NAME.rel if there is one.
+ *
+ * @param module The module, its name set.
+ * @return 0 on success, 1 if the module cannot be read.
+ */
+int load_Module(LINK_MODULE * module){
+    size_t length = strlen(module->name);
+    size_t extension = strlen(OBJECT_EXTENSION);
+    char * file_name = NULL;
+    int status = read_Object(module->name , &module->image);
+
+    if(length > extension && strcmp(module->name + length - extension , OBJECT_EXTENSION) == 0){
+        length -= extension;
+    }
+
+    /* The relocation table is next to the object, with the same base name */
+    file_name = object_File_Name(module->name , RELOCATION_EXTENSION);
+    if(file_name == NULL){
+        return 1;
+    }
+    strcpy(file_name + length , RELOCATION_EXTENSION);
+    if(status == 0 && access(file_name , F_OK) == 0){
+        module->has_relocations = 1;
+        status = read_Relocations(file_name , &module->relocations , &module->relocation_count);
+    }
+    free(file_name);
+    return status;
+}
+
+/**
+ * @brief Hashes the entries of a module and groups them by shard.
+ *
+ * @param module The module.
+ * @return 0 on success, 1 if memory ran out.
+ */
+int hash_Entries(LINK_MODULE * module){
+    unsigned int next[LINK_SHARDS];
+    unsigned int count = module->image.entry_count;
+    unsigned int i , shard;
+
+    module->entry_hashes = malloc(sizeof(unsigned long) * (count + 1));
+    module->shard_entries = malloc(sizeof(unsigned int) * (count + 1));
+    if(module->entry_hashes == NULL || module->shard_entries == NULL){
+        return 1;
+    }
+
+    /* Count the entries of each shard, then place them after the entries of the shards before */
+    memset(module->shard_start , 0 , sizeof(module->shard_start));
+    for(i = 0 ; i < count ; i++){
+        module->entry_hashes[i] = symbol_Hash(module->image.entry_names[i]);
+        module->shard_start[symbol_Shard(module->entry_hashes[i]) + 1]++;
+    }
+    for(shard = 0 ; shard < LINK_SHARDS ; shard++){
+        module->shard_start[shard + 1] += module->shard_start[shard];
+        next[shard] = module->shard_start[shard];
+    }
+    for(i = 0 ; i < count ; i++){
+        module->shard_entries[next[symbol_Shard(module->entry_hashes[i])]++] = i;
+    }
+    return 0;
+}
+
+/**
+ * @brief Converts an address of a module to its linked address.
+ *
+ * @param module The module.
+ * @param address The address in the module.
+ * @return The linked address.
+ */
+unsigned int relocate_Address(const LINK_MODULE * module , unsigned int address){
+    unsigned int offset = address - module->image.load_address;
+
+    if(offset < module->image.code_count){
+        return module->code_base + offset;
+    }
+    return module->data_base + (offset - module->image.code_count);
+}
+
+/**
+ * @brief Relocates a relocatable code word of a module into the linked image.
+ *
+ * @param module The module.
+ * @param offset Index of the word in the code of the module.
+ * @param code The code of the module in the linked image.
+ * @param report Stream the errors are written to, or NULL.
+ * @return 0 on success, 1 if the word is not relocatable or refers outside of its module.
+ */
+int relocate_Word(const LINK_MODULE * module , unsigned int offset , unsigned short * code , FILE * report){
+    const OBJECT_IMAGE * image = &module->image;
+    unsigned int address;
+
+    if(offset >= image->code_count || (image->words[offset] & LINK_ARE_MASK) != LINK_RELOCATABLE){
+        if(report != NULL){
+            fprintf(report , "Error: Word %u of %s is not relocatable\n" , image->load_address + offset , module->name);
+        }
+        return 1;
+    }
+    address = image->words[offset] >> LINK_ADDRESS_SHIFT;
+    if(address < image->load_address || address >= image->load_address + image->code_count + image->data_count){
+        if(report != NULL){
+            fprintf(report , "Error: Word %u of %s refers outside of its module\n" , image->load_address + offset , module->name);
+        }
+        return 1;
+    }
+    code[offset] = (relocate_Address(module , address) << LINK_ADDRESS_SHIFT) | LINK_RELOCATABLE;
+    return 0;
+}
+
+/**
+ * @brief Marks a module as linked and pushes it on the stack of modules to visit.
+ *
+ * @param linker The link.
+ * @param index Index of the module.
+ * @param stack The stack.
+ * @param top Pointer to the number of modules on the stack.
+ */
+void keep_Module(LINKER * linker , unsigned int index , unsigned int * stack , unsigned int * top){
+    if(linker->modules[index].kept == 0){
+        linker->modules[index].kept = 1;
+        stack[(*top)++] = index;
+    }
+}
+
+/**
+ * @brief Marks the modules reachable from the root symbols through the extern references, and the entries to keep.
+ *
+ * Each module is visited once and each extern reference looked up once, so the walk
+ * takes linear time. Without roots, the first module and all its entries are the roots.
+ *
+ * @param linker The link.
+ * @return 0 on success, 1 if a root symbol is not defined or memory ran out.
+ */
+int mark_Reachable(LINKER * linker){
+    LINK_MODULE * module = NULL;
+    LINK_SYMBOL * symbol = NULL;
+    unsigned int * stack = malloc(sizeof(unsigned int) * (linker->count + 1));
+    unsigned int top = 0 , i , j;
+    int status = 0;
+
+    if(stack == NULL){
+        fprintf(stderr , "Error: Memory allocation failed\n");
+        return 1;
+    }
+    for(i = 0 ; i < linker->count ; i++){
+        linker->modules[i].kept = 0;
+    }
+
+    /* The roots */
+    if(linker->root_count == 0){
+        keep_Module(linker , 0 , stack , &top);
+        for(j = 0 ; j < linker->modules[0].image.entry_count ; j++){
+            find_Symbol(linker , linker->modules[0].image.entry_names[j])->referenced = 1;
+        }
+    }
+    for(i = 0 ; i < linker->root_count ; i++){
+        symbol = find_Symbol(linker , linker->roots[i]);
+        if(symbol == NULL){
+            fprintf(stderr , "Error: Root symbol %s is not defined by any module\n" , linker->roots[i]);
+            status = 1;
+            continue;
+        }
+        symbol->referenced = 1;
+        keep_Module(linker , symbol->module , stack , &top);
+    }
+
+    /* The modules defining the symbols a linked module refers to */
+    while(top > 0){
+        module = &linker->modules[stack[--top]];
+        for(j = 0 ; j < module->image.extern_count ; j++){
+            symbol = find_Symbol(linker , module->image.extern_names[j]);
+            if(symbol != NULL){
+                symbol->referenced = 1;
+                keep_Module(linker , symbol->module , stack , &top);
+            }
+        }
+    }
+    free(stack);
+
+    /* The entries nobody refers to are dropped */
+    for(i = 0 ; status == 0 && i < linker->count ; i++){
+        module = &linker->modules[i];
+        if(module->kept == 0){
+            continue;
+        }
+        module->entry_kept = malloc(module->image.entry_count + 1);
+        if(module->entry_kept == NULL){
+            fprintf(stderr , "Error: Memory allocation failed\n");
+            return 1;
+        }
+        for(j = 0 ; j < module->image.entry_count ; j++){
+            module->entry_kept[j] = (unsigned char)find_Symbol(linker , module->image.entry_names[j])->referenced;
+        }
+    }
+    return status;
+}
+
+/**
+ * @brief Writes how much of the image was stripped.
+ *
+ * Each word takes two bytes in the loaded image.
+ *
+ * @param linker The link.
+ */
+void report_Stripped(const LINKER * linker){
+    const LINK_MODULE * module = NULL;
+    unsigned long words = 0 , entries = 0;
+    unsigned int modules = 0 , i , j;
+
+    for(i = 0 ; i < linker->count ; i++){
+        module = &linker->modules[i];
+        if(module->kept == 0){
+            modules++;
+            words += module->image.code_count + module->image.data_count;
+            entries += module->image.entry_count;
+            continue;
+        }
+        for(j = 0 ; j < module->image.entry_count ; j++){
+            entries += (module->entry_kept[j] == 0) ? 1 : 0;
+        }
+    }
+    printf("Stripped %u of %u modules: %lu words (%lu bytes) and %lu entries\n" , modules , linker->count , words , 2 * words , entries);
+}
+
+/**
+ * @brief Places the code, data and entries of the linked modules in the linked image, at the prefix sums of their sizes.
+ *
+ * @param linker The link.
+ * @return 0 on success, 1 if the image does not fit in the memory or memory ran out.
+ */
+int layout_Modules(LINKER * linker){
+    OBJECT_IMAGE * linked = &linker->linked;
+    LINK_MODULE * module = NULL;
+    unsigned long code_count = 0 , data_count = 0 , entry_count = 0;
+    unsigned int i , j;
+
+    for(i = 0 ; i < linker->count ; i++){
+        module = &linker->modules[i];
+        if(module->kept == 0){
+            continue;
+        }
+        module->entry_base = entry_count;
+        code_count += module->image.code_count;
+        data_count += module->image.data_count;
+        for(j = 0 ; j < module->image.entry_count ; j++){
+            entry_count += (module->entry_kept == NULL || module->entry_kept[j] != 0) ? 1 : 0;
+        }
+    }
+    if(OBJECT_LOAD_ADDRESS + code_count + data_count > LINK_MAX_ADDRESS + 1){
+        fprintf(stderr , "Error: The linked image has %lu words, more than the memory holds\n" , code_count + data_count);
+        return 1;
+    }
+
+    linked->load_address = OBJECT_LOAD_ADDRESS;
+    linked->code_count = code_count;
+    linked->data_count = data_count;
+    code_count = OBJECT_LOAD_ADDRESS;
+    for(i = 0 ; i < linker->count ; i++){
+        if(linker->modules[i].kept != 0){
+            linker->modules[i].code_base = code_count;
+            code_count += linker->modules[i].image.code_count;
+        }
+    }
+    for(i = 0 ; i < linker->count ; i++){
+        if(linker->modules[i].kept != 0){
+            linker->modules[i].data_base = code_count;
+            code_count += linker->modules[i].image.data_count;
+        }
+    }
+
+    linked->words = malloc(sizeof(unsigned short) * (linked->code_count + linked->data_count + 1));
+    linked->entry_names = calloc(entry_count + 1 , sizeof(char *));
+    linked->entry_addresses = malloc(sizeof(unsigned int) * (entry_count + 1));
+    linked->entry_count = entry_count;
+    if(linked->words == NULL || linked->entry_names == NULL || linked->entry_addresses == NULL){
+        fprintf(stderr , "Error: Memory allocation failed\n");
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Fills a shard of the global symbol table with the entries of all the modules, in module order.
+ *
+ * Only the worker of the shard writes it, and the first definition of a symbol is the
+ * one kept, so the table is the same whichever worker fills it.
+ *
+ * @param linker The link.
+ * @param shard Index of the shard.
+ */
+void merge_Shard(LINKER * linker , unsigned int shard){
+    SYMBOL_TABLE * table = &linker->shards[shard];
+    LINK_MODULE * module = NULL;
+    LINK_SYMBOL * slot = NULL;
+    unsigned long count = 0;
+    unsigned int i , k , entry;
+
+    for(i = 0 ; i < linker->count ; i++){
+        count += linker->modules[i].shard_start[shard + 1] - linker->modules[i].shard_start[shard];
+    }
+    if(create_Symbol_Table(table , count) != 0){
+        return;
+    }
+
+    for(i = 0 ; i < linker->count ; i++){
+        module = &linker->modules[i];
+        for(k = module->shard_start[shard] ; k < module->shard_start[shard + 1] ; k++){
+            entry = module->shard_entries[k];
+            slot = find_Symbol_Slot(table , module->image.entry_names[entry] , module->entry_hashes[entry]);
+            if(slot->name != NULL){
+                table->duplicates++;
+                continue;
+            }
+            slot->name = module->image.entry_names[entry];
+            slot->hash = module->entry_hashes[entry];
+            slot->address = module->image.entry_addresses[entry];
+            slot->module = i;
+            slot->entry = entry;
+            table->count++;
+        }
+    }
+}
+
+/**
+ * @brief Checks the global symbol table after it is filled, reporting the symbols defined more than once.
+ *
+ * @param linker The link.
+ * @return 0 if the table is complete and every symbol is defined once, 1 otherwise.
+ */
+int check_Symbol_Table(const LINKER * linker){
+    unsigned long duplicates = 0;
+    unsigned int i;
+
+    for(i = 0 ; i < LINK_SHARDS ; i++){
+        if(linker->shards[i].status != 0){
+            fprintf(stderr , "Error: Memory allocation failed\n");
+            return 1;
+        }
+        duplicates += linker->shards[i].duplicates;
+    }
+    return (duplicates > 0) ? report_Duplicates(linker) : 0;
+}
+
+/**
+ * @brief Adds a member of a library to the modules of the link.
+ *
+ * Only this member of the library is mapped, and only while it is copied.
+ *
+ * @param linker The link.
+ * @param library Index of the library.
+ * @param member Index of the member.
+ * @return 0 on success, 1 if the member is not a valid object or memory ran out.
+ */
+int add_Library_Member(LINKER * linker , unsigned int library , unsigned int member){
+    LINK_MODULE * grown = NULL;
+    LINK_MODULE * module = NULL;
+    OBJECT_FILE * object = NULL;
+    int status;
+
+    if(linker->count == linker->capacity){
+        grown = realloc(linker->modules , sizeof(LINK_MODULE) * 2 * linker->capacity);
+        if(grown == NULL){
+            fprintf(stderr , "Error: Memory allocation failed\n");
+            return 1;
+        }
+        linker->modules = grown;
+        linker->capacity *= 2;
+    }
+    module = &linker->modules[linker->count];
+    memset(module , 0 , sizeof(LINK_MODULE));
+    module->name = library_Member_Name(linker->libraries[library] , member);
+    module->kept = 1;
+    linker->count++;
+    linker->members_added[library][member] = 1;
+
+    object = load_Library_Member(linker->libraries[library] , member);
+    if(object == NULL){
+        fprintf(stderr , "Error: Library member %s is not a valid binary object\n" , module->name);
+        return 1;
+    }
+    status = object_To_Image(object , &module->image);
+    unload_Object(&object);
+    if(status == 0){
+        status = hash_Entries(module);
+    }
+    if(status != 0){
+        fprintf(stderr , "Error: Memory allocation failed\n");
+    }
+    return status;
+}
+
+/**
+ * @brief Adds the library members defining the symbols no module defines, then rebuilds the global symbol table.
+ *
+ * The modules added are scanned in turn, so the members they need are added as well.
+ *
+ * @param linker The link.
+ * @return 0 on success, 1 if a member cannot be added or the table cannot be rebuilt.
+ */
+int resolve_Libraries(LINKER * linker){
+    const char * name = NULL;
+    unsigned int added = 0 , i , j , k;
+    long member = -1;
+
+    /* The modules added go to the end, and are scanned like the others */
+    for(i = 0 ; i < linker->count ; i++){
+        for(j = 0 ; j < linker->modules[i].image.extern_count ; j++){
+            name = linker->modules[i].image.extern_names[j];
+            if(find_Symbol(linker , name) != NULL){
+                continue;
+            }
+            for(k = 0 ; k < linker->library_count ; k++){
+                member = find_Library_Symbol(linker->libraries[k] , name);
+                if(member >= 0){
+                    break;
+                }
+            }
+            if(k == linker->library_count || linker->members_added[k][member] != 0){
+                continue;
+            }
+            if(add_Library_Member(linker , k , member) != 0){
+                return 1;
+            }
+            added++;
+        }
+    }
+
+    if(added == 0){
+        return 0;
+    }
+    for(i = 0 ; i < LINK_SHARDS ; i++){
+        free_Symbol_Table(&linker->shards[i]);
+    }
+    run_Link_Phase(linker , LINK_MERGE , LINK_SHARDS);
+    return check_Symbol_Table(linker);
+}
+
+/**
+ * @brief Reports the symbols defined more than once, in module order.
+ *
+ * @param linker The link.
+ * @return 0 if every symbol is defined once, 1 otherwise.
+ */
+int report_Duplicates(const LINKER * linker){
+    const LINK_MODULE * module = NULL;
+    const LINK_SYMBOL * symbol = NULL;
+    unsigned int i , j;
+    int status = 0;
+
+    for(i = 0 ; i < linker->count ; i++){
+        module = &linker->modules[i];
+        for(j = 0 ; j < module->image.entry_count ; j++){
+            symbol = find_Symbol(linker , module->image.entry_names[j]);
+            if(symbol->module != i || symbol->entry != j){
+                fprintf(stderr , "Error: Symbol %s is defined in both %s and %s\n" , symbol->name , linker->modules[symbol->module].name , module->name);
+                status = 1;
+            }
+        }
+    }
+    return status;
+}
+
+/**
+ * @brief Copies the words and entries of a module to the linked image, relocating its relocatable words and patching its extern references.
+ *
+ * The module writes only its own part of the linked image, so the modules can be
+ * linked at the same time.
+ *
+ * @param linker The link.
+ * @param index Index of the module.
+ * @param report Stream the errors are written to, or NULL.
+ * @return 0 on success, 1 if a reference cannot be resolved.
+ */
+int link_Module(LINKER * linker , unsigned int index , FILE * report){
+    LINK_MODULE * module = &linker->modules[index];
+    OBJECT_IMAGE * linked = &linker->linked;
+    const OBJECT_IMAGE * image = &module->image;
+    unsigned short * code = linked->words + (module->code_base - linked->load_address);
+    unsigned short * data = linked->words + (module->data_base - linked->load_address);
+    unsigned long entry;
+    unsigned int i , offset;
+    int status = 0;
+    const LINK_SYMBOL * symbol = NULL;
+
+    memcpy(code , image->words , sizeof(unsigned short) * image->code_count);
+    memcpy(data , image->words + image->code_count , sizeof(unsigned short) * image->data_count);
+
+    /* The code words referring to labels of the module move with it */
+    if(module->has_relocations){
+        for(i = 0 ; i < module->relocation_count ; i++){
+            status |= relocate_Word(module , module->relocations[i] - image->load_address , code , report);
+        }
+    }
+    else{
+        for(i = 0 ; i < image->code_count ; i++){
+            if((image->words[i] & LINK_ARE_MASK) == LINK_RELOCATABLE){
+                status |= relocate_Word(module , i , code , report);
+            }
+        }
+    }
+
+    /* The extern references take the address of the entry defining the symbol */
+    for(i = 0 ; i < image->extern_count ; i++){
+        offset = image->extern_addresses[i] - image->load_address;
+        if(offset >= image->code_count || (image->words[offset] & LINK_ARE_MASK) != LINK_EXTERNAL){
+            if(report != NULL){
+                fprintf(report , "Error: Reference to %s at %u of %s is not an extern word\n" , image->extern_names[i] , image->extern_addresses[i] , module->name);
+            }
+            status = 1;
+            continue;
+        }
+        symbol = find_Symbol(linker , image->extern_names[i]);
+        if(symbol == NULL){
+            if(report != NULL){
+                fprintf(report , "Error: Undefined symbol %s referenced by %s\n" , image->extern_names[i] , module->name);
+            }
+            status = 1;
+            continue;
+        }
+        code[offset] = (relocate_Address(&linker->modules[symbol->module] , symbol->address) << LINK_ADDRESS_SHIFT) | LINK_RELOCATABLE;
+    }
+
+    /* The entries of the module follow the entries of the modules before it */
+    entry = module->entry_base;
+    for(i = 0 ; i < image->entry_count ; i++){
+        if(module->entry_kept != NULL && module->entry_kept[i] == 0){
+            continue;
+        }
+        free(linked->entry_names[entry]);
+        linked->entry_names[entry] = object_File_Name(image->entry_names[i] , "");
+        linked->entry_addresses[entry] = relocate_Address(module , image->entry_addresses[i]);
+        if(linked->entry_names[entry++] == NULL){
+            if(report != NULL){
+                fprintf(report , "Error: Memory allocation failed\n");
+            }
+            status = 1;
+        }
+    }
+    return status;
+}
+
+/**
+ * @brief Runs a phase on one module or shard.
+ *
+ * @param linker The link.
+ * @param index Index of the module or shard.
+ */
+void run_Link_Item(LINKER * linker , unsigned int index){
+    LINK_MODULE * module = NULL;
+
+    if(linker->phase == LINK_MERGE){
+        merge_Shard(linker , index);
+        return;
+    }
+    module = &linker->modules[index];
+    if(linker->phase == LINK_LOAD){
+        module->status = load_Module(module);
+        if(module->status == 0){
+            module->status = hash_Entries(module);
+        }
+    }
+    else if(module->kept != 0){
+        module->status = link_Module(linker , index , NULL);
+    }
+}
+
+/**
+ * @brief Takes modules or shards of the current phase and runs them until none is left.
+ *
+ * @param argument The link (LINKER *).
+ * @return NULL.
+ */
+void * link_Worker(void * argument){
+    LINKER * linker = argument;
+    unsigned int first , last , i;
+
+    while(1){
+        pthread_mutex_lock(&linker->lock);
+        first = linker->next;
+        last = (linker->total - first > LINK_CHUNK) ? first + LINK_CHUNK : linker->total;
+        linker->next = last;
+        pthread_mutex_unlock(&linker->lock);
+        if(first == last){
+            return NULL;
+        }
+        for(i = first ; i < last ; i++){
+            run_Link_Item(linker , i);
+        }
+    }
+}
+
+/**
+ * @brief Runs a phase on all the modules or shards with the workers of the link.
+ *
+ * The calling thread is one of the workers; if a thread cannot be started, the other
+ * workers take its share.
+ *
+ * @param linker The link.
+ * @param phase The phase.
+ * @param total Number of modules or shards.
+ */
+void run_Link_Phase(LINKER * linker , int phase , unsigned int total){
+    pthread_t threads[LINK_MAX_JOBS];
+    int started = 0;
+    int i;
+
+    linker->phase = phase;
+    linker->next = 0;
+    linker->total = total;
+    for(i = 1 ; i < linker->jobs ; i++){
+        if(pthread_create(&threads[started] , NULL , link_Worker , linker) == 0){
+            started++;
+        }
+    }
+    link_Worker(linker);
+    for(i = 0 ; i < started ; i++){
+        pthread_join(threads[i] , NULL);
+    }
+}
+
+int main(int argc , char * argv[]){
+    LINKER linker;
+    const char * output = LINK_DEFAULT_OUTPUT;
+    char * file_name = NULL;
+    unsigned int i;
+    int binary = 0;
+    int status = 0;
+
+    memset(&linker , 0 , sizeof(LINKER));
+    linker.jobs = 1;
+    linker.modules = calloc(argc , sizeof(LINK_MODULE));
+    linker.capacity = argc;
+    linker.roots = calloc(argc , sizeof(char *));
+    linker.libraries = calloc(argc , sizeof(LIBRARY_FILE *));
+    linker.members_added = calloc(argc , sizeof(unsigned char *));
+    if(linker.modules == NULL || linker.roots == NULL || linker.libraries == NULL || linker.members_added == NULL){
+        fprintf(stderr , "Error: Memory allocation failed\n");
+        return 1;
+    }
+    for(i = 1 ; i < (unsigned int)argc ; i++){
+        if(strcmp(argv[i] , "-o") == 0 && i + 1 < (unsigned int)argc){
+            output = argv[++i];
+        }
+        else if(strcmp(argv[i] , "-j") == 0 && i + 1 < (unsigned int)argc){
+            linker.jobs = atoi(argv[++i]);
+            if(strspn(argv[i] , "0123456789") != strlen(argv[i]) || linker.jobs < 1 || linker.jobs > LINK_MAX_JOBS){
+                fprintf(stderr , "Error: Invalid number of jobs, it must be between 1 and %d\n" , LINK_MAX_JOBS);
+                status = 1;
+                break;
+            }
+        }
+        else if(strcmp(argv[i] , "--binary") == 0){
+            binary = 1;
+        }
+        else if(strcmp(argv[i] , "--strip") == 0){
+            linker.strip = 1;
+        }
+        else if(strncmp(argv[i] , "--root=" , strlen("--root=")) == 0 && argv[i][strlen("--root=")] != '\0'){
+            linker.strip = 1;
+            linker.roots[linker.root_count++] = argv[i] + strlen("--root=");
+        }
+        else if(strncmp(argv[i] , "--library=" , strlen("--library=")) == 0 && argv[i][strlen("--library=")] != '\0'){
+            linker.libraries[linker.library_count] = load_Library(argv[i] + strlen("--library="));
+            if(linker.libraries[linker.library_count] == NULL){
+                fprintf(stderr , "Error: %s is not a valid library\n" , argv[i] + strlen("--library="));
+                status = 1;
+                break;
+            }
+            linker.members_added[linker.library_count] = calloc(linker.libraries[linker.library_count]->member_count + 1 , 1);
+            if(linker.members_added[linker.library_count++] == NULL){
+                fprintf(stderr , "Error: Memory allocation failed\n");
+                status = 1;
+                break;
+            }
+        }
+        else{
+            linker.modules[linker.count].kept = 1;
+            linker.modules[linker.count++].name = argv[i];
+        }
+    }
+    if(status == 0 && linker.count == 0){
+        fprintf(stderr , "Usage: %s [-o OUT] [--binary] [-j N] [--strip] [--root=SYM]... [--library=FILE]... MODULE...\n" , argv[0]);
+        status = 1;
+    }
+    pthread_mutex_init(&linker.lock , NULL);
+
+    /* Read the modules */
+    if(status == 0){
+        run_Link_Phase(&linker , LINK_LOAD , linker.count);
+        for(i = 0 ; i < linker.count ; i++){
+            if(linker.modules[i].status != 0){
+                fprintf(stderr , "Error: Failed to read the object files of %s\n" , linker.modules[i].name);
+                status = 1;
+            }
+        }
+    }
+    /* Build the symbol table, then add the library members defining the symbols still undefined */
+    if(status == 0){
+        run_Link_Phase(&linker , LINK_MERGE , LINK_SHARDS);
+        status = check_Symbol_Table(&linker);
+    }
+    if(status == 0 && linker.library_count > 0){
+        status = resolve_Libraries(&linker);
+    }
+    /* Leave out the modules no root reaches */
+    if(status == 0 && linker.strip){
+        status = mark_Reachable(&linker);
+    }
+    /* Place the modules */
+    if(status == 0){
+        status = layout_Modules(&linker);
+    }
+    /* Relocate and patch the words, then report the errors of the modules in order */
+    if(status == 0){
+        run_Link_Phase(&linker , LINK_PATCH , linker.count);
+        for(i = 0 ; i < linker.count ; i++){
+            if(linker.modules[i].kept != 0 && linker.modules[i].status != 0){
+                link_Module(&linker , i , stderr);
+                status = 1;
+            }
+        }
+    }
+
+    if(status == 0 && write_Text_Object(&linker.linked , output) != 0){
+        fprintf(stderr , "Error: Failed to write the object files of %s\n" , output);
+        status = 1;
+    }
+    if(status == 0 && binary){
+        file_name = object_File_Name(output , OBJECT_EXTENSION);
+        if(file_name == NULL || write_Binary_Object(&linker.linked , file_name) != 0){
+            fprintf(stderr , "Error: Failed to write file %s%s\n" , output , OBJECT_EXTENSION);
+            status = 1;
+        }
+        free(file_name);
+    }
+    if(status == 0 && linker.strip){
+        report_Stripped(&linker);
+    }
+
+    for(i = 0 ; i < linker.count ; i++){
+        free_Object_Image(&linker.modules[i].image);
+        free(linker.modules[i].relocations);
+        free(linker.modules[i].entry_hashes);
+        free(linker.modules[i].shard_entries);
+        free(linker.modules[i].entry_kept);
+    }
+    for(i = 0 ; i < LINK_SHARDS ; i++){
+        free_Symbol_Table(&linker.shards[i]);
+    }
+    for(i = 0 ; i < linker.library_count ; i++){
+        close_Library(&linker.libraries[i]);
+        free(linker.members_added[i]);
+    }
+    free(linker.libraries);
+    free(linker.members_added);
+    free(linker.modules);
+    free(linker.roots);
+    free_Object_Image(&linker.linked);
+    pthread_mutex_destroy(&linker.lock);
+    return (status == 0) ? 0 : 1;
+}
@@ -0,0 +1,332 @@
+#include "assembler.h"
+
+/**
+ * @brief Computes the hash of a macro name for the name table of a macro library.
+ *
+ * @param name The macro name.
+ * @return The FNV-1a hash of the name.
+ */
+unsigned int macro_library_hash(char * name){
+    unsigned long hash = 2166136261UL;
+
+    while(*name != '\0'){
+        hash = ((hash ^ (unsigned char)*name) * 16777619UL) & 0xFFFFFFFFUL;
+        name++;
+    }
+    return (unsigned int)hash;
+}
+
+/**
+ * @brief Reads the macro definitions of a library source file.
+ *
+ * The source file may only contain macro definitions and empty lines. Each definition
+ * is checked the same way the preprocessor checks it, and the valid ones are added to
+ * the macro list.
+ *
+ * @param head Pointer to the head of the macro list (shared by all the sources of the library).
+ * @param filter Bloom filter of the macro names.
+ * @param file_name Name of the source file, without the ".as" suffix.
+ * @return TRUE if all the definitions are valid, FALSE otherwise.
+ */
+BOOLEAN collect_Library_Macros(MACRO_LIST ** head , MACRO_FILTER * filter , char * file_name){
+    char line[MAX_FILE_LINE_LENGTH] , macro_name[MAX_FILE_LINE_LENGTH] , * line_clean = NULL , * file_as = NULL;
+    FILE * fptr_as;
+    int type , line_count = 1;
+    BOOLEAN error_flag , final_result = TRUE;
+    MACRO_CONTENT * head_content = NULL;
+
+    if(File_Name_Check(file_name) == FALSE){
+        return FALSE;
+    }
+    file_as = add_suffix(file_name , ".as");
+    fptr_as = fopen(file_as , "r");
+    free(file_as);
+    if(fptr_as == NULL){
+        print_error(FAILED_TO_OPEN_FILE , NO_LINE);
+        return FALSE;
+    }
+
+    memset(line , '\0' , sizeof(line));
+    while(fgets(line , sizeof(line) , fptr_as) != NULL && diagnostics_limit_reached() == FALSE){
+        line_clean = remove_white_spaces(line);
+        type = line_type(line_clean , NULL , filter , NULL , line_clean);
+
+        if(type == MACRO_DECLARATION){
+            error_flag = Macro_Name_Check(line_clean + strlen("macr") , *head , NULL , line_count);
+            memset(macro_name , '\0' , sizeof(macro_name));
+            strcpy(macro_name , line_clean + strlen("macr"));
+            head_content = NULL;
+            free(line_clean);
+            line_clean = NULL;
+
+            /* Save the macro content until endmacr is found */
+            type = NONE;
+            while(type != END_MACR && fgets(line , sizeof(line) , fptr_as) != NULL){
+                line_count++;
+                line_clean = remove_white_spaces(line);
+                type = line_type(line_clean , NULL , filter , NULL , line_clean);
+                if(type == END_MACR){
+                    error_flag += End_Macr_Check(line_clean + strlen("endmacr") , line_count);
+                }
+                else if(error_flag == TRUE){
+                    add_content_to_list(&head_content , line_clean);
+                }
+                free(line_clean);
+                line_clean = NULL;
+            }
+            if(type != END_MACR){
+                print_error(MISSING_END_OF_MACRO , line_count);
+                error_flag = FALSE;
+            }
+
+            if(error_flag == TRUE){
+                add_to_macro_list(head , filter , macro_name , head_content);
+            }
+            else{
+                free_macro_content(&head_content);
+                final_result = FALSE;
+            }
+        }
+        else if(type != EMPTY_LINE){
+            /* A library holds nothing but macro definitions */
+            print_error(NOT_A_MACRO_DEFINITION , line_count);
+            final_result = FALSE;
+        }
+
+        free(line_clean);
+        line_clean = NULL;
+        line_count++;
+        memset(line , '\0' , sizeof(line));
+    }
+    fclose(fptr_as);
+    return final_result;
+}
+
+/**
+ * @brief Frees the macros read from library sources.
+ *
+ * Each macro read by `collect_Library_Macros` owns its whole content list.
+ *
+ * @param head Pointer to the head of the macro list.
+ */
+void free_Library_Macros(MACRO_LIST ** head){
+    MACRO_LIST * temp;
+
+    while(*head != NULL){
+        free_macro_content(&((*head)->head_content));
+        temp = *head;
+        *head = (*head)->next;
+        free(temp);
+    }
+}
+
+/**
+ * @brief Writes a list of macros as a binary macro library.
+ *
+ * The file holds a MACRO_LIBRARY_HEADER, the hash buckets of the name table, one
+ * MACRO_LIBRARY_ENTRY per macro and the text area. Each name is stored null terminated,
+ * followed by the body of the macro as one contiguous block of lines.
+ *
+ * @param head Pointer to the head of the macro list.
+ * @param file_name Name of the library file to write.
+ * @return TRUE if the library was written, FALSE otherwise.
+ */
+BOOLEAN write_Macro_Library(MACRO_LIST * head , char * file_name){
+    MACRO_LIBRARY_HEADER header;
+    MACRO_LIBRARY_ENTRY * entries = NULL;
+    unsigned int * buckets = NULL;
+    char * text = NULL;
+    unsigned int text_size = 0 , i , bucket;
+    MACRO_LIST * ptr = NULL;
+    MACRO_CONTENT * content = NULL;
+    FILE * fptr;
+    BOOLEAN result = TRUE;
+
+    memset(&header , 0 , sizeof(header));
+    memcpy(header.magic , MACRO_LIBRARY_MAGIC , sizeof(header.magic));
+
+    /* Size the tables and the text area */
+    for(ptr = head ; ptr != NULL ; ptr = ptr->next){
+        header.macro_count++;
+        text_size += strlen(ptr->macro_name) + 1;
+        for(content = ptr->head_content ; content != NULL ; content = content->next){
+            text_size += content->length;
+        }
+    }
+    /* Keep the buckets at most half full */
+    header.bucket_count = MACRO_LIBRARY_MIN_BUCKETS;
+    while(header.bucket_count < 2 * header.macro_count){
+        header.bucket_count *= 2;
+    }
+    header.text_offset = sizeof(header) + header.bucket_count * sizeof(unsigned int) + header.macro_count * sizeof(MACRO_LIBRARY_ENTRY);
+    header.file_size = header.text_offset + text_size;
+
+    buckets = generic_malloc(header.bucket_count * sizeof(unsigned int));
+    entries = generic_malloc((header.macro_count + 1) * sizeof(MACRO_LIBRARY_ENTRY));
+    text = generic_malloc(text_size + 1);
+    memset(buckets , 0 , header.bucket_count * sizeof(unsigned int));
+
+    /* Fill the entries and chain them into the buckets */
+    text_size = 0;
+    for(ptr = head , i = 0 ; ptr != NULL ; ptr = ptr->next , i++){
+        entries[i].name_offset = text_size;
+        entries[i].name_length = strlen(ptr->macro_name);
+        strcpy(text + text_size , ptr->macro_name);
+        text_size += entries[i].name_length + 1;
+
+        entries[i].body_offset = text_size;
+        for(content = ptr->head_content ; content != NULL ; content = content->next){
+            memcpy(text + text_size , content->line , content->length);
+            text_size += content->length;
+        }
+        entries[i].body_length = text_size - entries[i].body_offset;
+
+        bucket = macro_library_hash(ptr->macro_name) & (header.bucket_count - 1);
+        entries[i].next = buckets[bucket];
+        buckets[bucket] = i + 1;
+    }
+
+    fptr = fopen(file_name , "wb");
+    if(fptr == NULL){
+        print_error(FAILED_TO_OPEN_FILE , NO_LINE);
+        result = FALSE;
+    }
+    else{
+        if(fwrite(&header , sizeof(header) , 1 , fptr) != 1 ||
+           fwrite(buckets , sizeof(unsigned int) , header.bucket_count , fptr) != header.bucket_count ||
+           fwrite(entries , sizeof(MACRO_LIBRARY_ENTRY) , header.macro_count , fptr) != header.macro_count ||
+           fwrite(text , 1 , text_size , fptr) != text_size){
+            result = FALSE;
+        }
+        if(fclose(fptr) != 0 || result == FALSE){
+            print_error(FAILED_TO_WRITE_FILE , NO_LINE);
+            remove(file_name);
+            result = FALSE;
+        }
+    }
+
+    free(buckets);
+    free(entries);
+    free(text);
+    return result;
+}
+
+/**
+ * @brief Maps a binary macro library into memory.
+ *
+ * The file is mapped read only and checked once, so it can be shared by all the
+ * files (and threads) of a run without copying or parsing any definition. A Bloom
+ * filter of the macro names is built at the same time, so a line that calls no macro of
+ * the library is rejected without searching its name table.
+ *
+ * @param file_name Name of the library file.
+ * @return Pointer to the loaded library, or NULL if the file cannot be used.
+ */
+MACRO_LIBRARY * load_Macro_Library(char * file_name){
+    MACRO_LIBRARY * library = NULL;
+    MACRO_LIBRARY_HEADER * header = NULL;
+    MACRO_LIBRARY_ENTRY * entry = NULL;
+    struct stat file_stat;
+    void * data;
+    unsigned int i , text_size;
+    int fd;
+
+    fd = open(file_name , O_RDONLY);
+    if(fd < 0){
+        print_error(FAILED_TO_OPEN_FILE , NO_LINE);
+        return NULL;
+    }
+    if(fstat(fd , &file_stat) != 0 || file_stat.st_size < (long)sizeof(MACRO_LIBRARY_HEADER)){
+        close(fd);
+        print_error(INVALID_MACRO_LIBRARY , NO_LINE);
+        return NULL;
+    }
+    data = mmap(NULL , file_stat.st_size , PROT_READ , MAP_PRIVATE , fd , 0);
+    close(fd);
+    if(data == MAP_FAILED){
+        print_error(FAILED_TO_OPEN_FILE , NO_LINE);
+        return NULL;
+    }
+
+    library = generic_malloc(sizeof(MACRO_LIBRARY));
+    library->data = data;
+    library->size = file_stat.st_size;
+    header = library->header = data;
+    library->buckets = (unsigned int *)((char *)data + sizeof(MACRO_LIBRARY_HEADER));
+    library->entries = (MACRO_LIBRARY_ENTRY *)(library->buckets + header->bucket_count);
+    library->text = (char *)data + header->text_offset;
+
+    /* Check the header before trusting any offset */
+    if(memcmp(header->magic , MACRO_LIBRARY_MAGIC , sizeof(header->magic)) != 0 ||
+       header->file_size != (unsigned long)file_stat.st_size ||
+       header->bucket_count == 0 || (header->bucket_count & (header->bucket_count - 1)) != 0 ||
+       header->bucket_count > header->file_size / sizeof(unsigned int) ||
+       header->macro_count > header->file_size / sizeof(MACRO_LIBRARY_ENTRY) ||
+       header->text_offset != sizeof(MACRO_LIBRARY_HEADER) + header->bucket_count * sizeof(unsigned int) + header->macro_count * sizeof(MACRO_LIBRARY_ENTRY) ||
+       header->text_offset > header->file_size){
+        print_error(INVALID_MACRO_LIBRARY , NO_LINE);
+        unload_Macro_Library(&library);
+        return NULL;
+    }
+    /* Check that every bucket, name and body lies inside the file, and fill the Bloom filter of the names */
+    memset(&library->filter , 0 , sizeof(library->filter));
+    text_size = header->file_size - header->text_offset;
+    for(i = 0 ; i < header->bucket_count ; i++){
+        if(library->buckets[i] > header->macro_count){
+            print_error(INVALID_MACRO_LIBRARY , NO_LINE);
+            unload_Macro_Library(&library);
+            return NULL;
+        }
+    }
+    for(i = 0 ; i < header->macro_count ; i++){
+        entry = &library->entries[i];
+        if(entry->next > header->macro_count || entry->name_offset >= text_size ||
+           entry->name_length >= text_size - entry->name_offset || library->text[entry->name_offset + entry->name_length] != '\0' ||
+           entry->body_offset > text_size || entry->body_length > text_size - entry->body_offset){
+            print_error(INVALID_MACRO_LIBRARY , NO_LINE);
+            unload_Macro_Library(&library);
+            return NULL;
+        }
+        macro_filter_add(&library->filter , library->text + entry->name_offset);
+    }
+    return library;
+}
+
+/**
+ * @brief Finds a macro by name in a macro library.
+ *
+ * @param library Pointer to the library (may be NULL).
+ * @param name_to_find The name of the macro to search for.
+ * @return Pointer to the entry of the macro, or NULL if not found.
+ */
+MACRO_LIBRARY_ENTRY * find_Library_Macro(MACRO_LIBRARY * library , char * name_to_find){
+    unsigned int index , steps = 0;
+
+    if(library == NULL){
+        return NULL;
+    }
+    index = library->buckets[macro_library_hash(name_to_find) & (library->header->bucket_count - 1)];
+    /* Follow the chain of the bucket (bounded, in case the file chains in a loop) */
+    while(index != 0 && steps <= library->header->macro_count){
+        if(strcmp(library->text + library->entries[index - 1].name_offset , name_to_find) == 0){
+            return &library->entries[index - 1];
+        }
+        index = library->entries[index - 1].next;
+        steps++;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Unmaps a macro library and frees its descriptor.
+ *
+ * @param library Pointer to the library pointer (set to NULL).
+ */
+void unload_Macro_Library(MACRO_LIBRARY ** library){
+    if(library == NULL || *library == NULL){
+        return;
+    }
+    munmap((*library)->data , (*library)->size);
+    free(*library);
+    *library = NULL;
+}
@@ -0,0 +1,232 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "object.h"
+
+/*
+ * obconv: converts between the textual object files (.ob, .ent, .ext) and the binary
+ * object file (.obj), and reads the output archives of the assembler.
+ *
+ *   obconv to-binary NAME                reads NAME.ob, NAME.ent and NAME.ext, writes NAME.obj
+ *   obconv to-text NAME                  reads NAME.obj, writes NAME.ob, NAME.ent and NAME.ext
+ *   obconv list ARCHIVE                  lists the members of an archive written with
+ *                                        --output-archive, with their sizes
+ *   obconv extract ARCHIVE [MEMBER...]   writes the members (all of them by default) as files
+ *
+ * The text files are written byte for byte the way the assembler writes them, so
+ * converting an object both ways gives back the same files.
+ */
+
+/**
+ * @brief Reads a little-endian 64-bit number of an output archive.
+ *
+ * @param bytes The eight bytes of the number.
+ * @return The number.
+ */
+unsigned long archive_u64(const unsigned char * bytes){
+    return (unsigned long)object_u32(bytes) | (((unsigned long)object_u32(bytes + 4) << 16) << 16);
+}
+
+/**
+ * @brief Checks that a member name stays below the current directory once extracted.
+ *
+ * @param name The member name.
+ * @return 1 if the name is safe to extract, 0 otherwise.
+ */
+int safe_Member_Name(const char * name){
+    const char * part = name;
+
+    if(name[0] == '\0' || name[0] == '/'){
+        return 0;
+    }
+    while(part != NULL){
+        if(strncmp(part , ".." , 2) == 0 && (part[2] == '/' || part[2] == '\0')){
+            return 0;
+        }
+        part = strchr(part , '/');
+        part = (part != NULL) ? part + 1 : NULL;
+    }
+    return 1;
+}
+
+/**
+ * @brief Lists or extracts the members of an output archive of the assembler.
+ *
+ * The archive is mapped and its index checked entry by entry, so a truncated or foreign
+ * file is rejected instead of being read past its end. Each member is written with a
+ * single call, straight from the mapping.
+ *
+ * @param file_name Name of the archive.
+ * @param extract 0 to list the members, 1 to write them as files.
+ * @param members Names of the members to extract, or NULL for all of them.
+ * @param count Number of names.
+ * @return 0 on success, 1 otherwise.
+ */
+int read_Result_Archive(const char * file_name , int extract , char ** members , int count){
+    const unsigned char * data = NULL , * entry = NULL;
+    unsigned long member_count , index_offset , offset , length , name_length , position , i;
+    char * name = NULL , * found = NULL;
+    struct stat file_stat;
+    FILE * output = NULL;
+    long size;
+    int fd , j , status = 0;
+
+    fd = open(file_name , O_RDONLY);
+    if(fd < 0 || fstat(fd , &file_stat) != 0 || file_stat.st_size < ARCHIVE_HEADER_SIZE){
+        fprintf(stderr , "Error: %s is not a valid output archive\n" , file_name);
+        if(fd >= 0){
+            close(fd);
+        }
+        return 1;
+    }
+    size = file_stat.st_size;
+    data = mmap(NULL , size , PROT_READ , MAP_PRIVATE , fd , 0);
+    close(fd);
+    if(data == MAP_FAILED){
+        fprintf(stderr , "Error: Failed to read %s\n" , file_name);
+        return 1;
+    }
+    member_count = object_u32(data + 8);
+    index_offset = archive_u64(data + 16);
+    if(memcmp(data , ARCHIVE_MAGIC , 4) != 0 || object_u32(data + 4) != ARCHIVE_VERSION ||
+       index_offset < ARCHIVE_HEADER_SIZE || index_offset > (unsigned long)size){
+        fprintf(stderr , "Error: %s is not a valid output archive\n" , file_name);
+        munmap((void *)data , size);
+        return 1;
+    }
+    found = calloc(count + 1 , 1);
+    if(found == NULL){
+        fprintf(stderr , "Error: Memory allocation failed\n");
+        munmap((void *)data , size);
+        return 1;
+    }
+
+    position = index_offset;
+    for(i = 0 ; i < member_count && status == 0 ; i++){
+        /* Each entry and its member must lie inside the file */
+        if(position + ARCHIVE_INDEX_ENTRY_SIZE > (unsigned long)size){
+            status = 1;
+            break;
+        }
+        entry = data + position;
+        offset = archive_u64(entry);
+        length = archive_u64(entry + 8);
+        name_length = object_u32(entry + 16);
+        position += ARCHIVE_INDEX_ENTRY_SIZE;
+        if(name_length > (unsigned long)size - position || offset < ARCHIVE_HEADER_SIZE ||
+           offset > index_offset || length > index_offset - offset){
+            status = 1;
+            break;
+        }
+        name = malloc(name_length + 1);
+        if(name == NULL){
+            fprintf(stderr , "Error: Memory allocation failed\n");
+            free(found);
+            munmap((void *)data , size);
+            return 1;
+        }
+        memcpy(name , data + position , name_length);
+        name[name_length] = '\0';
+        position += name_length;
+
+        if(extract == 0){
+            printf("%s %lu\n" , name , length);
+        }
+        else{
+            for(j = 0 ; j < count && strcmp(members[j] , name) != 0 ; j++);
+            if(count == 0 || j < count){
+                if(j < count){
+                    found[j] = 1;
+                }
+                if(safe_Member_Name(name) == 0){
+                    fprintf(stderr , "Error: Member %s would be written outside the current directory\n" , name);
+                    status = 2;
+                }
+                else if((output = fopen(name , "wb")) == NULL ||
+                        fwrite(data + offset , 1 , length , output) != length || fclose(output) != 0){
+                    fprintf(stderr , "Error: Failed to write file %s\n" , name);
+                    status = 2;
+                }
+                output = NULL;
+            }
+        }
+        free(name);
+    }
+    if(status == 1){
+        fprintf(stderr , "Error: %s is not a valid output archive\n" , file_name);
+    }
+    for(j = 0 ; j < count && status == 0 ; j++){
+        if(found[j] == 0){
+            fprintf(stderr , "Error: No member %s in %s\n" , members[j] , file_name);
+            status = 2;
+        }
+    }
+    free(found);
+    munmap((void *)data , size);
+    return (status == 0) ? 0 : 1;
+}
+
+int main(int argc , char * argv[]){
+    OBJECT_IMAGE image;
+    OBJECT_FILE * object = NULL;
+    char * file_name = NULL;
+    int status = 1;
+
+    if(argc == 3 && strcmp(argv[1] , "list") == 0){
+        return read_Result_Archive(argv[2] , 0 , NULL , 0);
+    }
+    if(argc >= 3 && strcmp(argv[1] , "extract") == 0){
+        return read_Result_Archive(argv[2] , 1 , argv + 3 , argc - 3);
+    }
+    if(argc != 3 || (strcmp(argv[1] , "to-binary") != 0 && strcmp(argv[1] , "to-text") != 0)){
+        fprintf(stderr , "Usage: %s to-binary|to-text NAME\n       %s list ARCHIVE\n       %s extract ARCHIVE [MEMBER...]\n" , argv[0] , argv[0] , argv[0]);
+        return 1;
+    }
+
+    file_name = object_File_Name(argv[2] , OBJECT_EXTENSION);
+    if(file_name == NULL){
+        fprintf(stderr , "Error: Memory allocation failed\n");
+        return 1;
+    }
+
+    if(strcmp(argv[1] , "to-binary") == 0){
+        if(read_Text_Object(argv[2] , &image) != 0){
+            fprintf(stderr , "Error: Failed to read the object files of %s\n" , argv[2]);
+        }
+        else if(write_Binary_Object(&image , file_name) != 0){
+            fprintf(stderr , "Error: Failed to write file %s\n" , file_name);
+        }
+        else{
+            status = 0;
+        }
+        free_Object_Image(&image);
+    }
+    else{
+        object = load_Object(file_name);
+        if(object == NULL){
+            fprintf(stderr , "Error: %s is not a valid binary object file\n" , file_name);
+        }
+        else if(object_To_Image(object , &image) != 0){
+            fprintf(stderr , "Error: Memory allocation failed\n");
+            free_Object_Image(&image);
+        }
+        else{
+            if(write_Text_Object(&image , argv[2]) != 0){
+                fprintf(stderr , "Error: Failed to write the object files of %s\n" , argv[2]);
+            }
+            else{
+                status = 0;
+            }
+            free_Object_Image(&image);
+        }
+        unload_Object(&object);
+    }
+
+    free(file_name);
+    return status;
+}
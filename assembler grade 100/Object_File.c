@@ -0,0 +1,607 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "object.h"
+
+/**
+ * @brief Reads a little-endian 32-bit number.
+ *
+ * @param bytes The four bytes of the number.
+ * @return The number.
+ */
+unsigned int object_u32(const unsigned char * bytes){
+    return (unsigned int)bytes[0] | ((unsigned int)bytes[1] << 8) | ((unsigned int)bytes[2] << 16) | ((unsigned int)bytes[3] << 24);
+}
+
+/**
+ * @brief Stores a number as a little-endian 32-bit number.
+ *
+ * @param bytes The four bytes receiving the number.
+ * @param value The number.
+ */
+void object_put_u32(unsigned char * bytes , unsigned int value){
+    bytes[0] = value & 0xFF;
+    bytes[1] = (value >> 8) & 0xFF;
+    bytes[2] = (value >> 16) & 0xFF;
+    bytes[3] = (value >> 24) & 0xFF;
+}
+
+/**
+ * @brief Encodes an object into the bytes of a binary object file.
+ *
+ * The symbol names are stored once each in the order of the symbols, and the words
+ * start at an even offset.
+ *
+ * @param image The object.
+ * @param size Pointer receiving the size of the file.
+ * @return The bytes of the file (to free), or NULL if memory ran out.
+ */
+char * object_Encode(const OBJECT_IMAGE * image , long * size){
+    OBJECT_HEADER * header = NULL;
+    OBJECT_SYMBOL * symbol = NULL;
+    unsigned int symbol_count = image->entry_count + image->extern_count;
+    unsigned int word_count = image->code_count + image->data_count;
+    long strings_offset , strings_size = 0 , words_offset , name_offset = 0;
+    unsigned int i;
+    char * name = NULL;
+    char * data = NULL;
+
+    for(i = 0 ; i < symbol_count ; i++){
+        name = (i < image->entry_count) ? image->entry_names[i] : image->extern_names[i - image->entry_count];
+        strings_size += strlen(name) + 1;
+    }
+    strings_offset = sizeof(OBJECT_HEADER) + symbol_count * sizeof(OBJECT_SYMBOL);
+    words_offset = strings_offset + strings_size + ((strings_offset + strings_size) % 2);
+    *size = words_offset + 2L * word_count;
+
+    data = calloc(*size , 1);
+    if(data == NULL){
+        return NULL;
+    }
+    header = (OBJECT_HEADER *)data;
+    memcpy(header->magic , OBJECT_MAGIC , sizeof(header->magic));
+    object_put_u32(header->version , OBJECT_VERSION);
+    object_put_u32(header->load_address , image->load_address);
+    object_put_u32(header->code_count , image->code_count);
+    object_put_u32(header->data_count , image->data_count);
+    object_put_u32(header->entry_count , image->entry_count);
+    object_put_u32(header->extern_count , image->extern_count);
+    object_put_u32(header->strings_offset , strings_offset);
+    object_put_u32(header->strings_size , strings_size);
+    object_put_u32(header->words_offset , words_offset);
+    object_put_u32(header->file_size , *size);
+
+    symbol = (OBJECT_SYMBOL *)(data + sizeof(OBJECT_HEADER));
+    for(i = 0 ; i < symbol_count ; i++){
+        name = (i < image->entry_count) ? image->entry_names[i] : image->extern_names[i - image->entry_count];
+        object_put_u32(symbol[i].name_offset , name_offset);
+        object_put_u32(symbol[i].address , (i < image->entry_count) ? image->entry_addresses[i] : image->extern_addresses[i - image->entry_count]);
+        strcpy(data + strings_offset + name_offset , name);
+        name_offset += strlen(name) + 1;
+    }
+
+    for(i = 0 ; i < word_count ; i++){
+        data[words_offset + 2L * i] = image->words[i] & 0xFF;
+        data[words_offset + 2L * i + 1] = (image->words[i] >> 8) & 0xFF;
+    }
+    return data;
+}
+
+/**
+ * @brief Maps a binary object stored in a file and checks its header and tables.
+ *
+ * @param fd Descriptor of the file.
+ * The mapping starts at the page holding the first byte of the object, so an object
+ * can be mapped from anywhere in a larger file.
+ *
+ * @param offset Offset of the object in the file.
+ * @param size Size of the object.
+ * @return Pointer to the mapped object, or NULL if it cannot be mapped or is not a valid object.
+ */
+OBJECT_FILE * map_Object(int fd , long offset , long size){
+    OBJECT_FILE * object = NULL;
+    const OBJECT_HEADER * header = NULL;
+    unsigned long symbols_end , strings_offset , strings_size , words_offset , word_count;
+    unsigned int i , name_offset;
+    long page_offset = offset % sysconf(_SC_PAGESIZE);
+    void * mapping = NULL;
+    void * data = NULL;
+
+    if(size < (long)sizeof(OBJECT_HEADER)){
+        return NULL;
+    }
+    mapping = mmap(NULL , size + page_offset , PROT_READ , MAP_PRIVATE , fd , offset - page_offset);
+    if(mapping == MAP_FAILED){
+        return NULL;
+    }
+    data = (char *)mapping + page_offset;
+
+    header = (const OBJECT_HEADER *)data;
+    object = malloc(sizeof(OBJECT_FILE));
+    if(object == NULL || memcmp(header->magic , OBJECT_MAGIC , sizeof(header->magic)) != 0 ||
+       object_u32(header->version) != OBJECT_VERSION || object_u32(header->file_size) != (unsigned long)size){
+        free(object);
+        munmap(mapping , size + page_offset);
+        return NULL;
+    }
+    object->mapping = mapping;
+    object->mapping_size = size + page_offset;
+    object->data = data;
+    object->size = size;
+    object->header = header;
+    object->load_address = object_u32(header->load_address);
+    object->code_count = object_u32(header->code_count);
+    object->data_count = object_u32(header->data_count);
+    object->entry_count = object_u32(header->entry_count);
+    object->extern_count = object_u32(header->extern_count);
+
+    /* The tables must follow each other inside the file */
+    symbols_end = sizeof(OBJECT_HEADER) + ((unsigned long)object->entry_count + object->extern_count) * sizeof(OBJECT_SYMBOL);
+    strings_offset = object_u32(header->strings_offset);
+    strings_size = object_u32(header->strings_size);
+    words_offset = object_u32(header->words_offset);
+    word_count = (unsigned long)object->code_count + object->data_count;
+    if(object->entry_count > (unsigned long)object->size || object->extern_count > (unsigned long)object->size ||
+       strings_offset < symbols_end || strings_offset + strings_size > words_offset ||
+       words_offset > (unsigned long)object->size || word_count > ((unsigned long)object->size - words_offset) / 2 ||
+       (strings_size > 0 && ((const char *)data)[strings_offset + strings_size - 1] != '\0')){
+        unload_Object(&object);
+        return NULL;
+    }
+    object->entries = (const OBJECT_SYMBOL *)((const char *)data + sizeof(OBJECT_HEADER));
+    object->externs = object->entries + object->entry_count;
+    object->strings = (const char *)data + strings_offset;
+    object->strings_size = strings_size;
+    object->words = (const unsigned char *)data + words_offset;
+
+    /* Every name starts inside the strings, which end with a null character */
+    for(i = 0 ; i < object->entry_count + object->extern_count ; i++){
+        name_offset = object_u32(object->entries[i].name_offset);
+        if(name_offset >= strings_size){
+            unload_Object(&object);
+            return NULL;
+        }
+    }
+    return object;
+}
+
+/**
+ * @brief Maps a binary object file and checks its header and tables.
+ *
+ * Every offset and count is checked against the size of the file, and every symbol
+ * name must end inside the strings, so the object can then be used without checks.
+ *
+ * @param file_name Name of the file.
+ * @return Pointer to the mapped object, or NULL if the file cannot be read or is not a valid object.
+ */
+OBJECT_FILE * load_Object(const char * file_name){
+    OBJECT_FILE * object = NULL;
+    struct stat file_stat;
+    int fd;
+
+    fd = open(file_name , O_RDONLY);
+    if(fd < 0){
+        return NULL;
+    }
+    if(fstat(fd , &file_stat) == 0){
+        object = map_Object(fd , 0 , file_stat.st_size);
+    }
+    close(fd);
+    return object;
+}
+
+/**
+ * @brief Returns a word of a mapped object.
+ *
+ * @param object The mapped object.
+ * @param index Index of the word (its address minus the load address).
+ * @return The word.
+ */
+unsigned short object_Word(const OBJECT_FILE * object , unsigned int index){
+    return (unsigned short)(object->words[2L * index] | (object->words[2L * index + 1] << 8));
+}
+
+/**
+ * @brief Returns the name of a symbol of a mapped object.
+ *
+ * @param object The mapped object.
+ * @param symbol The symbol.
+ * @return The null terminated name.
+ */
+const char * object_Symbol_Name(const OBJECT_FILE * object , const OBJECT_SYMBOL * symbol){
+    return object->strings + object_u32(symbol->name_offset);
+}
+
+/**
+ * @brief Unmaps a binary object file.
+ *
+ * @param object Pointer to the object pointer (set to NULL).
+ */
+void unload_Object(OBJECT_FILE ** object){
+    if(*object == NULL){
+        return;
+    }
+    munmap((*object)->mapping , (*object)->mapping_size);
+    free(*object);
+    *object = NULL;
+}
+
+/**
+ * @brief Hashes a symbol name.
+ *
+ * @param name The name.
+ * @return The hash.
+ */
+unsigned long symbol_Hash(const char * name){
+    unsigned long hash = OBJECT_HASH_OFFSET;
+
+    while(*name != '\0'){
+        hash ^= (unsigned char)*name++;
+        hash = (hash * OBJECT_HASH_PRIME) & 0xFFFFFFFFUL;
+    }
+    return hash;
+}
+
+/**
+ * @brief Builds a file name from a base name and a suffix.
+ *
+ * @param name The base name.
+ * @param suffix The suffix.
+ * @return The file name (to free), or NULL if memory ran out.
+ */
+char * object_File_Name(const char * name , const char * suffix){
+    char * file_name = malloc(strlen(name) + strlen(suffix) + 1);
+
+    if(file_name != NULL){
+        strcpy(file_name , name);
+        strcat(file_name , suffix);
+    }
+    return file_name;
+}
+
+/**
+ * @brief Frees the memory of an object image (its words, symbol names and addresses).
+ *
+ * @param image The object.
+ */
+void free_Object_Image(OBJECT_IMAGE * image){
+    unsigned int i;
+
+    for(i = 0 ; image->entry_names != NULL && i < image->entry_count ; i++){
+        free(image->entry_names[i]);
+    }
+    for(i = 0 ; image->extern_names != NULL && i < image->extern_count ; i++){
+        free(image->extern_names[i]);
+    }
+    free(image->entry_names);
+    free(image->entry_addresses);
+    free(image->extern_names);
+    free(image->extern_addresses);
+    free(image->words);
+    memset(image , 0 , sizeof(OBJECT_IMAGE));
+}
+
+/**
+ * @brief Reads the symbols of a .ent or .ext file.
+ *
+ * A missing file has no symbols, the way the assembler removes empty files.
+ *
+ * @param file_name Name of the file.
+ * @param names Pointer receiving the names (to free, with each name).
+ * @param addresses Pointer receiving the addresses (to free).
+ * @param count Pointer receiving the number of symbols.
+ * @return 0 on success, 1 if the file cannot be read.
+ */
+int read_Symbols(const char * file_name , char *** names , unsigned int ** addresses , unsigned int * count){
+    char name[MAX_SYMBOL_NAME];
+    unsigned int capacity = 0;
+    unsigned int address;
+    char ** grown_names = NULL;
+    unsigned int * grown_addresses = NULL;
+    FILE * fp = fopen(file_name , "r");
+
+    *names = NULL;
+    *addresses = NULL;
+    *count = 0;
+    if(fp == NULL){
+        return (errno == ENOENT) ? 0 : 1;
+    }
+    while(fscanf(fp , "%80s %u" , name , &address) == 2){
+        if(*count == capacity){
+            capacity = 2 * capacity + 8;
+            grown_names = realloc(*names , sizeof(char *) * capacity);
+            if(grown_names != NULL){
+                *names = grown_names;
+            }
+            grown_addresses = realloc(*addresses , sizeof(unsigned int) * capacity);
+            if(grown_addresses != NULL){
+                *addresses = grown_addresses;
+            }
+            if(grown_names == NULL || grown_addresses == NULL){
+                fclose(fp);
+                return 1;
+            }
+        }
+        (*names)[*count] = object_File_Name(name , "");
+        if((*names)[*count] == NULL){
+            fclose(fp);
+            return 1;
+        }
+        (*addresses)[(*count)++] = address;
+    }
+    /* Only the trailing space may follow the last symbol */
+    if(fscanf(fp , "%80s" , name) == 1){
+        fclose(fp);
+        return 1;
+    }
+    fclose(fp);
+    return 0;
+}
+
+/**
+ * @brief Reads an object from the .ob, .ent and .ext files written by the assembler.
+ *
+ * @param name Base name of the files.
+ * @param image Pointer receiving the object (to free with free_Object_Image).
+ * @return 0 on success, 1 if a file is missing or malformed.
+ */
+int read_Text_Object(const char * name , OBJECT_IMAGE * image){
+    char * file_name = NULL;
+    unsigned int word_count , i , address , word;
+    int status = 0;
+    FILE * fp = NULL;
+
+    memset(image , 0 , sizeof(OBJECT_IMAGE));
+    image->load_address = OBJECT_LOAD_ADDRESS;
+
+    file_name = object_File_Name(name , ".ob");
+    fp = (file_name != NULL) ? fopen(file_name , "r") : NULL;
+    free(file_name);
+    if(fp == NULL || fscanf(fp , "%u %u" , &image->code_count , &image->data_count) != 2){
+        if(fp != NULL){
+            fclose(fp);
+        }
+        return 1;
+    }
+
+    /* The words follow one another from the load address */
+    word_count = image->code_count + image->data_count;
+    image->words = malloc(sizeof(unsigned short) * (word_count + 1));
+    for(i = 0 ; image->words != NULL && i < word_count && status == 0 ; i++){
+        if(fscanf(fp , "%u %o" , &address , &word) != 2 || address != image->load_address + i || word > 0xFFFF){
+            status = 1;
+        }
+        else{
+            image->words[i] = word;
+        }
+    }
+    fclose(fp);
+    if(image->words == NULL || status != 0){
+        return 1;
+    }
+
+    file_name = object_File_Name(name , ".ent");
+    status += (file_name == NULL) ? 1 : read_Symbols(file_name , &image->entry_names , &image->entry_addresses , &image->entry_count);
+    free(file_name);
+    file_name = object_File_Name(name , ".ext");
+    status += (file_name == NULL) ? 1 : read_Symbols(file_name , &image->extern_names , &image->extern_addresses , &image->extern_count);
+    free(file_name);
+    return status;
+}
+
+/**
+ * @brief Reads the relocation table of an object (.rel).
+ *
+ * @param file_name Name of the file.
+ * @param addresses Pointer receiving the addresses of the relocatable words, in increasing order (to free).
+ * @param count Pointer receiving the number of addresses.
+ * @return 0 on success, 1 if the file cannot be read or is malformed.
+ */
+int read_Relocations(const char * file_name , unsigned int ** addresses , unsigned int * count){
+    unsigned int capacity = 0;
+    unsigned int address;
+    unsigned int * grown = NULL;
+    char rest[2];
+    FILE * fp = fopen(file_name , "r");
+
+    *addresses = NULL;
+    *count = 0;
+    if(fp == NULL){
+        return 1;
+    }
+    while(fscanf(fp , "%u" , &address) == 1){
+        if(*count > 0 && address <= (*addresses)[*count - 1]){
+            fclose(fp);
+            return 1;
+        }
+        if(*count == capacity){
+            capacity = 2 * capacity + 64;
+            grown = realloc(*addresses , sizeof(unsigned int) * capacity);
+            if(grown == NULL){
+                fclose(fp);
+                return 1;
+            }
+            *addresses = grown;
+        }
+        (*addresses)[(*count)++] = address;
+    }
+    if(fscanf(fp , "%1s" , rest) == 1){
+        fclose(fp);
+        return 1;
+    }
+    fclose(fp);
+    return 0;
+}
+
+/**
+ * @brief Copies the symbols of a mapped object into arrays.
+ *
+ * @param object The mapped object.
+ * @param symbols The symbols.
+ * @param count Number of symbols.
+ * @param names Pointer receiving the names (to free, with each name).
+ * @param addresses Pointer receiving the addresses (to free).
+ * @return 0 on success, 1 if memory ran out.
+ */
+int copy_Symbols(const OBJECT_FILE * object , const OBJECT_SYMBOL * symbols , unsigned int count , char *** names , unsigned int ** addresses){
+    unsigned int i;
+
+    *names = calloc(count + 1 , sizeof(char *));
+    *addresses = malloc(sizeof(unsigned int) * (count + 1));
+    if(*names == NULL || *addresses == NULL){
+        return 1;
+    }
+    for(i = 0 ; i < count ; i++){
+        (*names)[i] = object_File_Name(object_Symbol_Name(object , &symbols[i]) , "");
+        (*addresses)[i] = object_u32(symbols[i].address);
+        if((*names)[i] == NULL){
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Copies a mapped binary object into an object image.
+ *
+ * @param object The mapped object.
+ * @param image Pointer receiving the object (to free with free_Object_Image).
+ * @return 0 on success, 1 if memory ran out.
+ */
+int object_To_Image(const OBJECT_FILE * object , OBJECT_IMAGE * image){
+    unsigned int i;
+    int status = 0;
+
+    memset(image , 0 , sizeof(OBJECT_IMAGE));
+    image->load_address = object->load_address;
+    image->code_count = object->code_count;
+    image->data_count = object->data_count;
+    image->words = malloc(sizeof(unsigned short) * (object->code_count + object->data_count + 1));
+    if(image->words == NULL){
+        return 1;
+    }
+    for(i = 0 ; i < object->code_count + object->data_count ; i++){
+        image->words[i] = object_Word(object , i);
+    }
+    image->entry_count = object->entry_count;
+    status += copy_Symbols(object , object->entries , object->entry_count , &image->entry_names , &image->entry_addresses);
+    image->extern_count = object->extern_count;
+    status += copy_Symbols(object , object->externs , object->extern_count , &image->extern_names , &image->extern_addresses);
+    return status;
+}
+
+/**
+ * @brief Reads an object from NAME.obj when the name ends with .obj, from NAME.ob, NAME.ent and NAME.ext otherwise.
+ *
+ * @param name Name of the binary object file, or base name of the text files.
+ * @param image Pointer receiving the object (to free with free_Object_Image).
+ * @return 0 on success, 1 if the object cannot be read.
+ */
+int read_Object(const char * name , OBJECT_IMAGE * image){
+    size_t length = strlen(name);
+    size_t extension = strlen(OBJECT_EXTENSION);
+    OBJECT_FILE * object = NULL;
+    int status;
+
+    if(length > extension && strcmp(name + length - extension , OBJECT_EXTENSION) == 0){
+        memset(image , 0 , sizeof(OBJECT_IMAGE));
+        object = load_Object(name);
+        if(object == NULL){
+            return 1;
+        }
+        status = object_To_Image(object , image);
+        unload_Object(&object);
+        return status;
+    }
+    return read_Text_Object(name , image);
+}
+
+/**
+ * @brief Writes symbols to a .ent or .ext file, or removes the file when there are none.
+ *
+ * @param names Names of the symbols.
+ * @param addresses Addresses of the symbols.
+ * @param count Number of symbols.
+ * @param file_name Name of the file.
+ * @return 0 on success, 1 if the file cannot be written.
+ */
+int write_Symbols(char ** names , const unsigned int * addresses , unsigned int count , const char * file_name){
+    unsigned int i;
+    FILE * fp = NULL;
+
+    if(count == 0){
+        return (remove(file_name) == 0 || errno == ENOENT) ? 0 : 1;
+    }
+    fp = fopen(file_name , "w");
+    if(fp == NULL){
+        return 1;
+    }
+    for(i = 0 ; i < count ; i++){
+        fprintf(fp , "%s\t0%u\n " , names[i] , addresses[i]);
+    }
+    return (fclose(fp) == 0) ? 0 : 1;
+}
+
+/**
+ * @brief Writes an object as the .ob, .ent and .ext files, byte for byte the way the assembler writes them.
+ *
+ * @param image The object.
+ * @param name Base name of the files.
+ * @return 0 on success, 1 if a file cannot be written.
+ */
+int write_Text_Object(const OBJECT_IMAGE * image , const char * name){
+    char * file_name = NULL;
+    unsigned int i;
+    int status = 0;
+    FILE * fp = NULL;
+
+    file_name = object_File_Name(name , ".ob");
+    fp = (file_name != NULL) ? fopen(file_name , "w") : NULL;
+    free(file_name);
+    if(fp == NULL){
+        return 1;
+    }
+    fprintf(fp , "\n\t%u %u\n" , image->code_count , image->data_count);
+    for(i = 0 ; i < image->code_count + image->data_count ; i++){
+        fprintf(fp , "0%u\t%05o\n" , image->load_address + i , image->words[i]);
+    }
+    status += (fclose(fp) == 0) ? 0 : 1;
+
+    file_name = object_File_Name(name , ".ent");
+    status += (file_name == NULL) ? 1 : write_Symbols(image->entry_names , image->entry_addresses , image->entry_count , file_name);
+    free(file_name);
+    file_name = object_File_Name(name , ".ext");
+    status += (file_name == NULL) ? 1 : write_Symbols(image->extern_names , image->extern_addresses , image->extern_count , file_name);
+    free(file_name);
+    return status;
+}
+
+/**
+ * @brief Writes an object as a binary object file.
+ *
+ * @param image The object.
+ * @param file_name Name of the file.
+ * @return 0 on success, 1 if the file cannot be written.
+ */
+int write_Binary_Object(const OBJECT_IMAGE * image , const char * file_name){
+    char * data = NULL;
+    long size;
+    size_t written;
+    int status = 1;
+    FILE * fp = NULL;
+
+    data = object_Encode(image , &size);
+    fp = (data != NULL) ? fopen(file_name , "wb") : NULL;
+    if(fp != NULL){
+        written = fwrite(data , 1 , size , fp);
+        status = (fclose(fp) == 0 && written == (size_t)size) ? 0 : 1;
+    }
+    free(data);
+    return status;
+}
@@ -0,0 +1,362 @@
+#include "assembler.h"
+
+/**
+ * @brief Creates an empty line ring.
+ *
+ * @return Pointer to the new ring.
+ */
+LINE_RING * create_line_ring(void){
+    LINE_RING * ring = generic_malloc(sizeof(LINE_RING));
+
+    ring->head = 0;
+    ring->tail = 0;
+    ring->closed = 0;
+    ring->cancelled = 0;
+    ring->producer_waiting = 0;
+    ring->consumer_waiting = 0;
+    pthread_mutex_init(&ring->lock , NULL);
+    pthread_cond_init(&ring->not_full , NULL);
+    pthread_cond_init(&ring->not_empty , NULL);
+    return ring;
+}
+
+/**
+ * @brief Adds a view to a ring, waiting while the ring is full.
+ *
+ * Only the producer calls this function. A full ring puts the producer to sleep until
+ * the consumer frees a slot, instead of spinning on a core the other stages need.
+ *
+ * @param ring Pointer to the ring.
+ * @param text First character of the line.
+ * @param length Number of characters of the line.
+ * @return TRUE if the view was added, FALSE if the consumer stopped reading.
+ */
+BOOLEAN line_ring_push(LINE_RING * ring , const char * text , int length){
+    pthread_mutex_lock(&ring->lock);
+    /* Wait for the consumer to free a slot (back-pressure) */
+    while(ring->tail - ring->head == LINE_RING_SIZE && ring->cancelled == 0){
+        ring->producer_waiting = 1;
+        pthread_cond_wait(&ring->not_full , &ring->lock);
+        ring->producer_waiting = 0;
+    }
+    if(ring->cancelled != 0){
+        pthread_mutex_unlock(&ring->lock);
+        return FALSE;
+    }
+    ring->slots[ring->tail % LINE_RING_SIZE].text = text;
+    ring->slots[ring->tail % LINE_RING_SIZE].length = length;
+    ring->tail++;
+    /* Wake the consumer once half a ring is ready, so the stages switch less often */
+    if(ring->consumer_waiting != 0 && ring->tail - ring->head >= LINE_RING_WAKE){
+        pthread_cond_signal(&ring->not_empty);
+    }
+    pthread_mutex_unlock(&ring->lock);
+    return TRUE;
+}
+
+/**
+ * @brief Takes the next view from a ring, waiting while the ring is empty.
+ *
+ * Only the consumer calls this function. An empty ring puts the consumer to sleep until
+ * the producer adds a view or closes the ring.
+ *
+ * @param ring Pointer to the ring.
+ * @param view Pointer receiving the view.
+ * @return TRUE if a view was taken, FALSE once the ring is closed and empty.
+ */
+BOOLEAN line_ring_pop(LINE_RING * ring , LINE_VIEW * view){
+    pthread_mutex_lock(&ring->lock);
+    /* Wait for the producer to add a view */
+    while(ring->tail == ring->head && ring->closed == 0){
+        ring->consumer_waiting = 1;
+        pthread_cond_wait(&ring->not_empty , &ring->lock);
+        ring->consumer_waiting = 0;
+    }
+    /* The views added before the ring was closed are still taken */
+    if(ring->tail == ring->head){
+        pthread_mutex_unlock(&ring->lock);
+        return FALSE;
+    }
+    *view = ring->slots[ring->head % LINE_RING_SIZE];
+    ring->head++;
+    /* Wake the producer once half a ring is free */
+    if(ring->producer_waiting != 0 && ring->tail - ring->head <= LINE_RING_SIZE - LINE_RING_WAKE){
+        pthread_cond_signal(&ring->not_full);
+    }
+    pthread_mutex_unlock(&ring->lock);
+    return TRUE;
+}
+
+/**
+ * @brief Marks the end of the views of a ring (called by the producer).
+ *
+ * A consumer waiting on an empty ring wakes up and sees the end.
+ *
+ * @param ring Pointer to the ring.
+ */
+void line_ring_close(LINE_RING * ring){
+    pthread_mutex_lock(&ring->lock);
+    ring->closed = 1;
+    pthread_cond_signal(&ring->not_empty);
+    pthread_mutex_unlock(&ring->lock);
+}
+
+/**
+ * @brief Tells the producer of a ring that no more views are read (called by the consumer).
+ *
+ * A producer waiting on a full ring returns, and later views are dropped.
+ *
+ * @param ring Pointer to the ring.
+ */
+void line_ring_cancel(LINE_RING * ring){
+    pthread_mutex_lock(&ring->lock);
+    ring->cancelled = 1;
+    pthread_cond_signal(&ring->not_full);
+    pthread_mutex_unlock(&ring->lock);
+}
+
+/**
+ * @brief Frees a line ring once both of its stages are done with it.
+ *
+ * @param ring Pointer to the ring.
+ */
+void free_line_ring(LINE_RING * ring){
+    pthread_cond_destroy(&ring->not_empty);
+    pthread_cond_destroy(&ring->not_full);
+    pthread_mutex_destroy(&ring->lock);
+    free(ring);
+}
+
+/**
+ * @brief Copies text into an arena, where it stays until the arena is freed.
+ *
+ * Only the producing stage copies into its arena, so no locking is needed.
+ *
+ * @param arena Pointer to the arena.
+ * @param text The text to copy.
+ * @param length Number of characters to copy.
+ * @return Pointer to the copy.
+ */
+char * arena_copy(TEXT_ARENA * arena , const char * text , int length){
+    TEXT_BLOCK * block = arena->tail;
+    char * copy = NULL;
+
+    /* Start a new block when the current one is full */
+    if(block == NULL || block->used + length > block->size){
+        block = generic_malloc(sizeof(TEXT_BLOCK));
+        block->size = (length > TEXT_ARENA_BLOCK_SIZE) ? length : TEXT_ARENA_BLOCK_SIZE;
+        block->text = generic_malloc(block->size);
+        block->used = 0;
+        block->next = NULL;
+        if(arena->tail == NULL){
+            arena->head = block;
+        }
+        else{
+            arena->tail->next = block;
+        }
+        arena->tail = block;
+    }
+    copy = block->text + block->used;
+    memcpy(copy , text , length);
+    block->used += length;
+    return copy;
+}
+
+/**
+ * @brief Frees the blocks of an arena.
+ *
+ * @param arena Pointer to the arena.
+ */
+void free_arena(TEXT_ARENA * arena){
+    TEXT_BLOCK * temp = NULL;
+
+    while(arena->head != NULL){
+        temp = arena->head;
+        arena->head = arena->head->next;
+        free(temp->text);
+        free(temp);
+    }
+    arena->tail = NULL;
+}
+
+/**
+ * @brief Reads the next line of a source, the way fgets reads a line of a file.
+ *
+ * A file source is read with fgets and a text source is cut the same way. A ring source
+ * takes the next view of the previous stage, which was already cut the way fgets cuts lines.
+ *
+ * @param source The source to read.
+ * @param line Buffer receiving the null terminated line.
+ * @param size Size of the buffer.
+ * @return The buffer, or NULL at the end of the source.
+ */
+char * read_Line(LINE_SOURCE * source , char * line , int size){
+    LINE_VIEW view;
+    int length;
+
+    if(source->fptr != NULL){
+        return fgets(line , size , source->fptr);
+    }
+    if(source->text != NULL){
+        if(source->position >= source->length){
+            return NULL;
+        }
+        /* Up to size - 1 characters, ending after the first '\n' */
+        for(length = 0 ; length < size - 1 && source->position < source->length ; length++){
+            line[length] = source->text[source->position++];
+            if(line[length] == '\n'){
+                length++;
+                break;
+            }
+        }
+        line[length] = '\0';
+        return line;
+    }
+    if(line_ring_pop(source->ring , &view) == FALSE){
+        return NULL;
+    }
+    length = (view.length < size - 1) ? view.length : size - 1;
+    memcpy(line , view.text , length);
+    line[length] = '\0';
+    return line;
+}
+
+/**
+ * @brief Reader stage: reads the lines of the source file (or of its prefetched text) into the first ring.
+ *
+ * @param argument Pointer to the PIPELINE.
+ * @return NULL.
+ */
+void * reader_Stage(void * argument){
+    PIPELINE * pipeline = argument;
+    char line[MAX_FILE_LINE_LENGTH];
+    int length;
+
+    memset(line , '\0' , sizeof(line));
+    while(read_Line(pipeline->input , line , sizeof(line)) != NULL){
+        length = strlen(line);
+        /* Stop once the preprocessor stopped reading */
+        if(line_ring_push(pipeline->source_lines , arena_copy(&pipeline->source_arena , line , length) , length) == FALSE){
+            break;
+        }
+        memset(line , '\0' , sizeof(line));
+    }
+    line_ring_close(pipeline->source_lines);
+    return NULL;
+}
+
+/**
+ * @brief Preprocessor stage: expands the lines of the first ring into the .am file and the second ring.
+ *
+ * The stage reports into the diagnostics of the file, the way the sequential
+ * preprocessor does.
+ *
+ * @param argument Pointer to the PIPELINE.
+ * @return NULL.
+ */
+void * pre_Proc_Stage(void * argument){
+    PIPELINE * pipeline = argument;
+    LINE_SOURCE source;
+
+    set_current_diagnostics(pipeline->diagnostics);
+    source.fptr = NULL;
+    source.text = NULL;
+    source.ring = pipeline->source_lines;
+    pipeline->result = Pre_Proc_Lines(&source , pipeline->head_table , pipeline->writer_am , 0);
+
+    /* Stop the reader when the preprocessor stopped early */
+    line_ring_cancel(pipeline->source_lines);
+
+    am_writer_add(pipeline->writer_am , "\n" , strlen("\n") , FALSE);
+    if(am_writer_close(pipeline->writer_am) == FALSE){
+        print_error(FAILED_TO_WRITE_FILE , NO_LINE);
+        pipeline->result = FALSE;
+    }
+    line_ring_close(pipeline->expanded_lines);
+    return NULL;
+}
+
+/**
+ * @brief Assembles a file with reading, preprocessing and parsing running in three threads.
+ *
+ * The reader thread feeds the source lines to the preprocessor thread, which writes the
+ * `.am` file and forwards the same lines to the calling thread, which runs the first
+ * pass on them. The first pass reports into a buffer of its own: its diagnostics and
+ * results are kept only if the preprocessor succeeded, so the output is the same as
+ * when the stages run one after the other.
+ *
+ * @param head_table Pointer to the assembler table of the file.
+ * @param input The source file, open or prefetched (closed by the caller).
+ * @param writer_am The open writer of the .am file, or a memory writer when the outputs are bundled.
+ * @param file_am Name of the .am file.
+ * @param file_name Name of the source file, without suffix.
+ */
+void Pre_Proc_Pipeline(ASSEMBLER_TABLE ** head_table , LINE_SOURCE * input , AM_WRITER * writer_am , char * file_am , char * file_name){
+    PIPELINE pipeline;
+    pthread_t reader , pre_proc;
+    DIAGNOSTICS parse_diagnostics;
+    LINE_SOURCE source;
+    int IC = 100 , DC = 1;
+    BOOLEAN error_flag = TRUE;
+
+    pipeline.input = input;
+    pipeline.head_table = head_table;
+    pipeline.writer_am = writer_am;
+    pipeline.source_lines = create_line_ring();
+    pipeline.expanded_lines = create_line_ring();
+    pipeline.source_arena.head = pipeline.source_arena.tail = NULL;
+    pipeline.expanded_arena.head = pipeline.expanded_arena.tail = NULL;
+    pipeline.diagnostics = get_current_diagnostics();
+    pipeline.result = TRUE;
+
+    /* The preprocessor forwards every line it writes to the parser */
+    writer_am->forward = pipeline.expanded_lines;
+    writer_am->arena = &pipeline.expanded_arena;
+
+    /* The parser (this thread) reports into a buffer of its own */
+    open_diagnostics(&parse_diagnostics);
+    begin_diagnostics(&parse_diagnostics , pipeline.diagnostics->file_name , (*head_table)->options);
+
+    if(pthread_create(&reader , NULL , reader_Stage , &pipeline) != 0 ||
+       pthread_create(&pre_proc , NULL , pre_Proc_Stage , &pipeline) != 0){
+        print_error(FAILED_TO_START_THREAD , NO_LINE);
+        exit(1);
+    }
+
+    source.fptr = NULL;
+    source.text = NULL;
+    source.ring = pipeline.expanded_lines;
+    error_flag = First_Pass_Lines(head_table , &source , &IC , &DC);
+
+    /* Let the preprocessor finish the .am file when the parser stopped early */
+    line_ring_cancel(pipeline.expanded_lines);
+    pthread_join(pre_proc , NULL);
+    pthread_join(reader , NULL);
+
+    set_current_diagnostics(pipeline.diagnostics);
+    /* A .am collected in memory (bundled outputs) is not written */
+    if(writer_am->fd < 0){
+        free(writer_am->buffer);
+    }
+
+    if(pipeline.result == FALSE){
+        /* Same as the sequential path: remove the output and skip the first pass */
+        if(writer_am->fd >= 0 && remove(file_am) != 0){
+            print_error(FAILED_TO_REMOVE_FILE , NO_LINE);
+            exit(1);
+        }
+    }
+    else{
+        append_diagnostics(pipeline.diagnostics , &parse_diagnostics);
+        if(error_flag == TRUE){
+            finish_First_Pass(head_table , file_name , IC , DC);
+        }
+    }
+    free(writer_am);
+
+    free_diagnostics(&parse_diagnostics);
+    free_arena(&pipeline.source_arena);
+    free_arena(&pipeline.expanded_arena);
+    free_line_ring(pipeline.source_lines);
+    free_line_ring(pipeline.expanded_lines);
+}
@@ -4,13 +4,15 @@
  * @brief Adds a new macro to the macro list.
  * 
  * This function allocates memory for a new macro node and appends it to the end 
- * of the macro list. The macro contains a name and content linked list.
+ * of the macro list. The macro contains a name and content linked list. The name
+ * is also added to the Bloom filter of the file.
  * 
  * @param head Pointer to the head of the macro list.
+ * @param filter Bloom filter of the macro names.
  * @param macro_name Name of the macro to be added.
  * @param head_content Pointer to the content of the macro.
  */
-void add_to_macro_list(MACRO_LIST ** head ,char * macro_name ,MACRO_CONTENT * head_content){
+void add_to_macro_list(MACRO_LIST ** head , MACRO_FILTER * filter ,char * macro_name ,MACRO_CONTENT * head_content){
     MACRO_LIST * ptr = NULL;
     /* Allocate memory for a new macro node */
     MACRO_LIST * new_node = generic_malloc(sizeof(MACRO_LIST));
@@ -18,7 +20,9 @@ void add_to_macro_list(MACRO_LIST ** head ,char * macro_name ,MACRO_CONTENT * he
     /* Copy the macro name to the new node */
     strcpy( new_node->macro_name , macro_name);
     new_node->head_content = head_content;
+    new_node->shared = FALSE;
     new_node->next = NULL;
+    macro_filter_add(filter , macro_name);
 
     /* If the macro list is empty, set the new node as the head */
     if(*head == NULL){
@@ -49,6 +53,7 @@ void add_content_to_list(MACRO_CONTENT ** head_content , char *line_to_add){
     memset(content_to_add->line , '\0' , sizeof(content_to_add->line));
     /* Copy the line of content to the new node */
     strcpy(content_to_add->line , line_to_add);
+    content_to_add->length = strlen(content_to_add->line);
     content_to_add->next = NULL;
     /* If the content list is empty, set the new node as the head */
     if( *head_content == NULL){
@@ -139,6 +144,81 @@ MACRO_LIST * find_macro(MACRO_LIST * head , char * name_to_find){
     return NULL;/* Return NULL if macro not found */
 }
 
+/**
+ * @brief Computes the two base hashes of a macro name for the Bloom filter.
+ *
+ * The name is scanned once, for an FNV-1a and a djb2 hash; the bits of the filter are
+ * then derived from them by double hashing, the i-th at `first + i * second`.
+ *
+ * @param name The macro name.
+ * @param first Receives the first base hash (FNV-1a).
+ * @param second Receives the second base hash (djb2, made odd).
+ */
+void macro_filter_hash(char * name , unsigned long * first , unsigned long * second){
+    unsigned long fnv = 2166136261UL , djb = 5381;
+
+    while(*name != '\0'){
+        fnv = ((fnv ^ (unsigned char)*name) * 16777619UL) & 0xFFFFFFFFUL;
+        djb = ((djb << 5) + djb + (unsigned char)*name) & 0xFFFFFFFFUL;
+        name++;
+    }
+    *first = fnv;
+    *second = djb | 1;
+}
+
+/**
+ * @brief Adds a macro name to the Bloom filter.
+ *
+ * @param filter Pointer to the Bloom filter.
+ * @param name The macro name.
+ */
+void macro_filter_add(MACRO_FILTER * filter , char * name){
+    unsigned long first , second;
+    unsigned int bit;
+    int i;
+
+    macro_filter_hash(name , &first , &second);
+    for(i = 0 ; i < MACRO_FILTER_HASHES ; i++){
+        bit = (unsigned int)((first + i * second) % MACRO_FILTER_BITS);
+        filter->bits[bit / CHAR_BIT] |= (unsigned char)(1 << (bit % CHAR_BIT));
+    }
+}
+
+/**
+ * @brief Checks whether a name whose base hashes are known may be in the Bloom filter.
+ *
+ * @param filter Pointer to the Bloom filter.
+ * @param first First base hash of the name (from macro_filter_hash).
+ * @param second Second base hash of the name.
+ * @return TRUE if the name may be a macro name, FALSE if it is surely not one.
+ */
+BOOLEAN macro_filter_test(MACRO_FILTER * filter , unsigned long first , unsigned long second){
+    unsigned int bit;
+    int i;
+
+    for(i = 0 ; i < MACRO_FILTER_HASHES ; i++){
+        bit = (unsigned int)((first + i * second) % MACRO_FILTER_BITS);
+        if((filter->bits[bit / CHAR_BIT] & (1 << (bit % CHAR_BIT))) == 0){
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/**
+ * @brief Checks whether a name may be in the Bloom filter.
+ *
+ * @param filter Pointer to the Bloom filter.
+ * @param name The name to check.
+ * @return TRUE if the name may be a macro name, FALSE if it is surely not one.
+ */
+BOOLEAN macro_filter_may_contain(MACRO_FILTER * filter , char * name){
+    unsigned long first , second;
+
+    macro_filter_hash(name , &first , &second);
+    return macro_filter_test(filter , first , second);
+}
+
 /**
  * @brief Determines the type of a line in the assembler code.
  * 
@@ -147,14 +227,24 @@ MACRO_LIST * find_macro(MACRO_LIST * head , char * name_to_find){
  * - END_MACR
  * - EMPTY_LINE
  * - MACRO_CALL
+ * - INCLUDE_DIRECTIVE
  * - NONE (default, if the line does not match any of the previous categories)
  * 
+ * A macro call is looked up in the macro list only when the Bloom filter says the
+ * line may be a macro name, so ordinary lines skip the search. The precompiled library
+ * of the run has a Bloom filter of its own, tested with the same hashes of the line,
+ * before its hashed name table is searched.
+ *
  * @param line The original line of text.
  * @param head Pointer to the macro list head.
+ * @param filter Bloom filter of the macro names.
+ * @param library Pointer to the macro library of the run, or NULL.
  * @param line_clean Cleaned line without whitespaces.
  * @return The type of the line as an integer value.
  */
-int line_type(char * line , MACRO_LIST *head , char *line_clean){
+int line_type(char * line , MACRO_LIST *head , MACRO_FILTER * filter , MACRO_LIBRARY * library , char *line_clean){
+    unsigned long first , second;
+
      /* Check if the line is a macro declaration */
     if(strncmp(line , "macr" , strlen("macr")) == 0){
         return MACRO_DECLARATION;
@@ -167,8 +257,18 @@ int line_type(char * line , MACRO_LIST *head , char *line_clean){
     if(line[0] == '\0' || line[0] == '\n'){
         return EMPTY_LINE;
     }
+    /* Check for an include directive */
+    if(strncmp(line , ".include" , strlen(".include")) == 0){
+        return INCLUDE_DIRECTIVE;
+    }
     /* Check if the line calls an existing macro */
-    if(find_macro(head , line_clean) != NULL){
+    macro_filter_hash(line_clean , &first , &second);
+    if(macro_filter_test(filter , first , second) == TRUE && find_macro(head , line_clean) != NULL){
+        return MACRO_CALL;
+    }
+    /* Check if the line calls a macro of the library */
+    if(library != NULL && macro_filter_test(&library->filter , first , second) == TRUE &&
+       find_Library_Macro(library , line_clean) != NULL){
         return MACRO_CALL;
     }
     /* Default case if no conditions are met (ordinary line)*/
@@ -176,57 +276,41 @@ int line_type(char * line , MACRO_LIST *head , char *line_clean){
 }
 
 /**
- * @brief Handles the pre-processing phase of the assembler.
- * 
- * This function reads an assembly source file, processes macros, and writes the 
- * processed content to a new file with ".am" suffix. It also handles macro 
- * declaration and calls, while reporting errors and cleaning up as necessary.
- * 
- * @param head_table Pointer to the assembler table containing macros and other information.
- * @param file_name Name of the source file to process.
+ * @brief Preprocesses the lines of an open source file.
+ *
+ * This function reads the lines of the source, collects macro declarations into the
+ * macro list of the table, expands macro calls and `.include` directives, and hands
+ * the resulting lines to the writer. Ordinary lines are passed over without copying,
+ * and macro calls refer to the stored macro bodies.
+ *
+ * @param source The source to read (a file or the ring of the reader stage).
+ * @param head_table Pointer to the assembler table holding the macro list.
+ * @param writer_am The writer receiving the preprocessed lines.
+ * @param depth Include depth of the source (0 for the file being assembled).
+ * @return TRUE if the lines are valid, FALSE otherwise.
  */
-void Pre_Proc(ASSEMBLER_TABLE ** head_table , char *file_name){
-    char * file_am ,* file_as,  line[MAX_FILE_LINE_LENGTH] ,* line_clean , macro_name[MAX_FILE_LINE_LENGTH];
-    FILE * fptr_am , * fptr_as;
+BOOLEAN Pre_Proc_Lines(LINE_SOURCE * source , ASSEMBLER_TABLE ** head_table , AM_WRITER * writer_am , int depth){
+    char line[MAX_FILE_LINE_LENGTH] ,* line_clean = NULL , macro_name[MAX_FILE_LINE_LENGTH];
     int type = NONE ,  line_count = 1;
     BOOLEAN error_flag = TRUE , final_result = TRUE;
    
     MACRO_CONTENT *head_content = NULL;
     MACRO_LIST * head_macro= NULL;
+    MACRO_LIBRARY_ENTRY * library_macro = NULL;
   
     memset(line , '\0',sizeof(line));
     memset(macro_name , '\0',sizeof(macro_name));
-    if(File_Name_Check(file_name) == FALSE){
-        return;
-    }
-    /* Add file suffixes for the input and output files */
-    file_as = add_suffix(file_name , ".as");
-    file_am = add_suffix(file_name , ".am");
-
-    /* Open the source file for reading */
-    fptr_as  = fopen(file_as , "r");
-
-    if(fptr_as == NULL){
-        print_error(FAILED_TO_OPEN_FILE , NO_LINE);
-        exit(1);
-    }
-    /* Open the output file for writing */
-    fptr_am = fopen(file_am , "w");
-    if(fptr_am == NULL){
-        print_error(FAILED_TO_OPEN_FILE , NO_LINE);
-        exit(1);
-    }
 
-    /* Main loop to scan the source file line by line */
-    while(fgets(line , sizeof(line) , fptr_as) != NULL){
+    /* Main loop to scan the source file line by line, until the error limit of the file is reached */
+    while(read_Line(source , line , sizeof(line)) != NULL && diagnostics_limit_reached() == FALSE){
         line_clean = remove_white_spaces(line);
         /* Determine the type of the line */
-        type = line_type(line_clean , ((*head_table)->macro_head) , line_clean);
+        type = line_type(line_clean , ((*head_table)->macro_head) , &((*head_table)->macro_filter) , (*head_table)->options->macro_library , line_clean);
         
         switch(type){
             case MACRO_DECLARATION:
                 /* Check macro name validity and handle error flags */
-                error_flag += Macro_Name_Check(line_clean + strlen("macr"),  ((*head_table)->macro_head) , line_count);
+                error_flag += Macro_Name_Check(line_clean + strlen("macr"),  ((*head_table)->macro_head) , (*head_table)->options->macro_library , line_count);
                 if(error_flag >= FALSE){
                     final_result = FALSE;
                 }
@@ -238,11 +322,11 @@ void Pre_Proc(ASSEMBLER_TABLE ** head_table , char *file_name){
                 line_clean = NULL;
                 memset(line , '\0',sizeof(line));
                 /* Save macro content until endmacr is found */
-                while(fgets(line , sizeof(line) , fptr_as) != NULL && type != END_MACR){
+                while(read_Line(source , line , sizeof(line)) != NULL && type != END_MACR){
                     line_count++;
                     line_clean = remove_white_spaces(line);
 
-                    type = line_type(line_clean , ((*head_table)->macro_head) , line_clean);
+                    type = line_type(line_clean , ((*head_table)->macro_head) , &((*head_table)->macro_filter) , (*head_table)->options->macro_library , line_clean);
                    
                     if(type == END_MACR){
                          /* Check for the validity of the macro end line */
@@ -265,7 +349,7 @@ void Pre_Proc(ASSEMBLER_TABLE ** head_table , char *file_name){
                 }
                 /* Add the macro to the macro list if no errors occurred */
                 if(error_flag == TRUE){
-                    add_to_macro_list( &((*head_table)->macro_head) , macro_name ,head_content);
+                    add_to_macro_list( &((*head_table)->macro_head) , &((*head_table)->macro_filter) , macro_name ,head_content);
                 }
                 
                 break;
@@ -276,10 +360,22 @@ void Pre_Proc(ASSEMBLER_TABLE ** head_table , char *file_name){
                 if(head_macro != NULL){
                     head_content =  head_macro->head_content;
                     while(head_content != NULL){
-                        fprintf(fptr_am ,"%s" ,head_content->line );
+                        am_writer_add(writer_am , head_content->line , head_content->length , FALSE);
                         head_content = head_content->next;
                     }
                 }
+                else{
+                    /* The body of a library macro is written straight from the mapped file */
+                    library_macro = find_Library_Macro((*head_table)->options->macro_library , line_clean);
+                    am_writer_add(writer_am , (*head_table)->options->macro_library->text + library_macro->body_offset , library_macro->body_length , FALSE);
+                }
+                break;
+
+            case INCLUDE_DIRECTIVE:
+                /* Write the lines of the included file and import its macros */
+                if(include_File(head_table , writer_am , line_clean , line_count , depth) == FALSE){
+                    final_result = FALSE;
+                }
                 break;
 
             case EMPTY_LINE:
@@ -287,8 +383,9 @@ void Pre_Proc(ASSEMBLER_TABLE ** head_table , char *file_name){
                 break;  
 
             case NONE:
-                /* Write the ordinary line from the source to the output file */
-                fprintf(fptr_am ,"%s" ,line_clean);
+                /* Hand the ordinary line to the writer, which frees it once written */
+                am_writer_add(writer_am , line_clean , strlen(line_clean) , TRUE);
+                line_clean = NULL;
                 break;  
         }
 
@@ -299,16 +396,139 @@ void Pre_Proc(ASSEMBLER_TABLE ** head_table , char *file_name){
         line_clean = NULL;
         error_flag = TRUE;
     }
-    line_count = 0;
     free(line_clean);
     line_clean = NULL;
+    return final_result;
+}
+
+/**
+ * @brief Handles the pre-processing phase of the assembler.
+ * 
+ * This function reads an assembly source file, processes macros and includes, and writes
+ * the processed content to a new file with ".am" suffix, while reporting errors and
+ * cleaning up as necessary.
+ *
+ * With asynchronous I/O the source is taken from the files read ahead, and the `.am`
+ * file is collected in memory: the first pass reads it from there and its write is
+ * submitted to the I/O backend instead of being written and read back.
+ * 
+ * @param head_table Pointer to the assembler table containing macros and other information.
+ * @param file_name Name of the source file to process.
+ */
+void Pre_Proc(ASSEMBLER_TABLE ** head_table , char *file_name){
+    char * file_am ,* file_as;
+    FILE * fptr_as = NULL;
+    IO_REQUEST * prefetched = NULL;
+    AM_WRITER * writer_am = NULL;
+    LINE_SOURCE source , am_source;
+    BOOLEAN final_result = TRUE , error_flag = TRUE;
+    BOOLEAN async_io = (*head_table)->options->async_io;
+    BOOLEAN bundled = (*head_table)->options->bundle_outputs;
+    ARCHIVE_MEMBER * member = NULL;
+    int IC = 100 , DC = 1;
+
+    if(File_Name_Check(file_name) == FALSE){
+        return;
+    }
+    /* Add file suffixes for the input and output files */
+    file_as = add_suffix(file_name , ".as");
+    file_am = add_suffix(file_name , ".am");
+
+    /* Read standard input or the input archive, take the source from the files read ahead, or open it for reading */
+    if(strcmp(file_name , STDIN_NAME) == 0){
+        fptr_as = stdin;
+    }
+    else if((member = find_Archive_Member(file_as)) == NULL){
+        prefetched = io_take_prefetched(file_as);
+    }
+    if(fptr_as == NULL && member == NULL && prefetched == NULL){
+        fptr_as  = fopen(file_as , "r");
+
+        if(fptr_as == NULL){
+            print_error(FAILED_TO_OPEN_FILE , NO_LINE);
+            exit(1);
+        }
+    }
+    source.fptr = fptr_as;
+    source.text = (prefetched != NULL) ? prefetched->text : NULL;
+    source.length = (prefetched != NULL) ? prefetched->length : 0;
+    if(member != NULL){
+        source.text = (char *)member->text;
+        source.length = member->size;
+    }
+    source.position = 0;
+    source.ring = NULL;
+
+    /* Open the output file for writing, or collect it in memory (it is never written when the outputs are bundled) */
+    writer_am = generic_malloc(sizeof(AM_WRITER));
+    if(bundled == TRUE || (async_io == TRUE && (*head_table)->options->pipeline == FALSE)){
+        am_writer_open_memory(writer_am);
+    }
+    else if(am_writer_open(writer_am , file_am) == FALSE){
+        print_error(FAILED_TO_OPEN_FILE , NO_LINE);
+        exit(1);
+    }
+
+    /* Read, preprocess and parse the file in three threads when asked to */
+    if((*head_table)->options->pipeline == TRUE){
+        Pre_Proc_Pipeline(head_table , &source , writer_am , file_am , file_name);
+        if(fptr_as != NULL && fptr_as != stdin){
+            fclose(fptr_as);
+        }
+        io_release(prefetched);
+        free(file_as);
+        free(file_am);
+        return;
+    }
+
+    final_result = Pre_Proc_Lines(&source , head_table , writer_am , 0);
 
     free(file_as);
     file_as = NULL;
-    fprintf(fptr_am ,"%s" ,"\n");
+    am_writer_add(writer_am , "\n" , strlen("\n") , FALSE);
+
+    if(am_writer_close(writer_am) == FALSE){
+        print_error(FAILED_TO_WRITE_FILE , NO_LINE);
+        final_result = FALSE;
+    }
+    if(fptr_as != NULL && fptr_as != stdin){
+        fclose(fptr_as);
+    }
+    io_release(prefetched);
 
-    fclose(fptr_am);
-    fclose(fptr_as);
+    /* The .am file was collected in memory: parse it from there, then write it */
+    if(writer_am->fd < 0){
+        if(final_result == FALSE){
+            free(writer_am->buffer);
+            /* Only an output of an earlier run may be left */
+            if(bundled == FALSE && remove(file_am) != 0 && errno != ENOENT){
+                print_error(FAILED_TO_REMOVE_FILE , NO_LINE);
+                exit(1);
+            }
+        }
+        else{
+            am_source.fptr = NULL;
+            am_source.text = writer_am->buffer;
+            am_source.length = writer_am->length;
+            am_source.position = 0;
+            am_source.ring = NULL;
+            error_flag = First_Pass_Lines(head_table , &am_source , &IC , &DC);
+            if(bundled == TRUE){
+                free(writer_am->buffer);
+            }
+            else{
+                io_write_file(file_am , writer_am->buffer , writer_am->length);
+            }
+            if(error_flag == TRUE){
+                finish_First_Pass(head_table , file_name , IC , DC);
+            }
+        }
+        free(writer_am);
+        free(file_am);
+        return;
+    }
+    free(writer_am);
+    writer_am = NULL;
    
     /* If there was an error, remove the output file */
     if(final_result == FALSE){
@@ -26,14 +26,16 @@ BOOLEAN End_Macr_Check(char * line , int line_count){
  * 
  * This function validates a macro name by checking its length, ensuring it doesn't 
  * start with a digit, and confirming it contains only alphanumeric characters or underscores.
- * It also checks if the macro name is already defined or if it's a reserved word.
+ * It also checks if the macro name is already defined (in the file or in the macro
+ * library of the run) or if it's a reserved word.
  * 
  * @param line Pointer to the macro name.
  * @param head Pointer to the head of the macro list to check for duplicate names.
+ * @param library Pointer to the macro library of the run, or NULL.
  * @param line_count The current line number in the source file.
  * @return BOOLEAN indicating whether the macro name is valid (TRUE) or not (FALSE).
  */
-BOOLEAN Macro_Name_Check(char * line ,MACRO_LIST * head , int line_count){
+BOOLEAN Macro_Name_Check(char * line ,MACRO_LIST * head , MACRO_LIBRARY * library , int line_count){
     BOOLEAN result = TRUE;
     int i = 0;
 
@@ -69,6 +71,11 @@ BOOLEAN Macro_Name_Check(char * line ,MACRO_LIST * head , int line_count){
         }
         head = head->next;
     }
+    /* Check if the macro name is already defined by the macro library */
+    if(find_Library_Macro(library , line) != NULL){
+        print_error(MACRO_NAME_ALREADY_DEFINED ,line_count);
+        return FALSE;
+    }
     /* Check if the macro name is a reserved word */
     result += Reserved_Words_Check(line, CANNOT_BE_RESERVED_WORD ,  line_count);
 
@@ -0,0 +1,276 @@
+#include "assembler.h"
+
+/**
+ * @brief Orders batch files largest first, keeping the command line order of equal sizes.
+ *
+ * @param first Pointer to a BATCH_FILE pointer.
+ * @param second Pointer to a BATCH_FILE pointer.
+ * @return Negative, zero or positive, as qsort expects.
+ */
+int compare_Batch_Files(const void * first , const void * second){
+    BATCH_FILE * a = *(BATCH_FILE **)first;
+    BATCH_FILE * b = *(BATCH_FILE **)second;
+
+    if(a->size != b->size){
+        return (a->size > b->size) ? -1 : 1;
+    }
+    /* The files are in one array, in command line order */
+    return (a < b) ? -1 : (a > b);
+}
+
+/**
+ * @brief Takes the next file from the head of the queue of its owner.
+ *
+ * @param queue Pointer to the queue.
+ * @return Pointer to the file, or NULL if the queue is empty.
+ */
+BATCH_FILE * take_File(WORK_QUEUE * queue){
+    BATCH_FILE * file = NULL;
+
+    pthread_mutex_lock(&queue->lock);
+    if(queue->head < queue->tail){
+        file = queue->files[queue->head++];
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return file;
+}
+
+/**
+ * @brief Steals a file from the tail of the queue of another worker.
+ *
+ * The owner works from the large files at the head, so the thief takes the small
+ * files at the tail and the two rarely meet.
+ *
+ * @param queue Pointer to the queue.
+ * @return Pointer to the file, or NULL if the queue is empty.
+ */
+BATCH_FILE * steal_File(WORK_QUEUE * queue){
+    BATCH_FILE * file = NULL;
+
+    pthread_mutex_lock(&queue->lock);
+    if(queue->head < queue->tail){
+        file = queue->files[--queue->tail];
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return file;
+}
+
+/**
+ * @brief Reads ahead the next files at the head of a queue.
+ *
+ * Does nothing without asynchronous I/O. A file read ahead and then stolen by another
+ * worker is still found by name when it is assembled.
+ *
+ * @param queue Pointer to the queue.
+ * @param depth Number of files to read ahead.
+ */
+void prefetch_Queue(WORK_QUEUE * queue , int depth){
+    char * names[MAX_PREFETCH_DEPTH];
+    int count = 0 , i;
+
+    pthread_mutex_lock(&queue->lock);
+    for(i = queue->head ; i < queue->tail && count < depth ; i++){
+        names[count++] = queue->files[i]->name;
+    }
+    pthread_mutex_unlock(&queue->lock);
+    for(i = 0 ; i < count ; i++){
+        io_prefetch(names[i]);
+    }
+}
+
+/**
+ * @brief Marks a file as assembled and writes the diagnostics that are due.
+ *
+ * The diagnostics are written in command line order: those of a file wait until every
+ * earlier file is done, so the output does not depend on the number of workers.
+ *
+ * @param scheduler Pointer to the scheduler.
+ * @param file Pointer to the assembled file.
+ */
+void finish_Batch_File(SCHEDULER * scheduler , BATCH_FILE * file){
+    BATCH_FILE * next = NULL;
+
+    pthread_mutex_lock(&scheduler->output_lock);
+    file->done = TRUE;
+    while(scheduler->next_output < scheduler->file_count){
+        next = &scheduler->files[scheduler->next_output];
+        if(next->done == FALSE){
+            break;
+        }
+        flush_diagnostics(&next->diagnostics);
+        free_diagnostics(&next->diagnostics);
+        scheduler->next_output++;
+    }
+    pthread_mutex_unlock(&scheduler->output_lock);
+}
+
+/**
+ * @brief Returns the seconds elapsed since a time.
+ *
+ * @param start The start time.
+ * @return The elapsed seconds.
+ */
+double elapsed_Seconds(struct timeval * start){
+    struct timeval now;
+
+    gettimeofday(&now , NULL);
+    return (now.tv_sec - start->tv_sec) + (now.tv_usec - start->tv_usec) / 1000000.0;
+}
+
+/**
+ * @brief Finds the next file of a worker: from its own queue, or else stolen from another queue.
+ *
+ * @param worker Pointer to the worker.
+ * @param stolen Set to TRUE if the file was stolen, FALSE otherwise.
+ * @return Pointer to the file, or NULL once every queue is empty.
+ */
+BATCH_FILE * next_Batch_File(WORKER * worker , BOOLEAN * stolen){
+    SCHEDULER * scheduler = worker->scheduler;
+    BATCH_FILE * file = take_File(&worker->queue);
+    int i;
+
+    *stolen = FALSE;
+    /* Visit the other workers, starting with the next one */
+    for(i = 1 ; file == NULL && i < scheduler->worker_count ; i++){
+        file = steal_File(&scheduler->workers[(worker->id + i) % scheduler->worker_count].queue);
+        *stolen = (file != NULL) ? TRUE : FALSE;
+    }
+    return file;
+}
+
+/**
+ * @brief Main loop of a worker: assembles its own files, then steals from the others.
+ *
+ * No file is added once the workers start, so a worker stops when every queue is empty.
+ *
+ * @param argument Pointer to the WORKER.
+ * @return NULL.
+ */
+void * worker_Main(void * argument){
+    WORKER * worker = argument;
+    SCHEDULER * scheduler = worker->scheduler;
+    BATCH_FILE * file = NULL;
+    struct timeval start;
+    BOOLEAN stolen;
+
+    file = next_Batch_File(worker , &stolen);
+    while(file != NULL){
+        /* Read the next files of the queue while this one is assembled */
+        prefetch_Queue(&worker->queue , scheduler->options->async_io == TRUE ? scheduler->options->prefetch_depth : 0);
+        gettimeofday(&start , NULL);
+        begin_diagnostics(&file->diagnostics , file->name , scheduler->options);
+        assemble_File(file->name , scheduler->options);
+        set_current_diagnostics(NULL);
+        worker->busy_seconds += elapsed_Seconds(&start);
+        worker->files_done++;
+        worker->files_stolen += (stolen == TRUE) ? 1 : 0;
+        worker->bytes_done += file->size;
+
+        finish_Batch_File(scheduler , file);
+        file = next_Batch_File(worker , &stolen);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Assembles a batch of files with a pool of work-stealing workers.
+ *
+ * The files are sorted largest first by the size of their source and dealt round robin
+ * to the queues of the workers, so every worker starts on one of the largest files and
+ * the many small files fill the gaps at the end. A worker whose queue is empty steals
+ * from the others. With `--stats`, the utilization of each worker is written to stderr.
+ *
+ * @param names Names of the source files, without the ".as" suffix.
+ * @param count Number of files.
+ * @param options Options of the run (number of workers and statistics).
+ */
+void run_Batch(char ** names , int count , ASSEMBLER_OPTIONS * options){
+    SCHEDULER scheduler;
+    BATCH_FILE ** sorted = NULL;
+    WORKER * worker = NULL;
+    struct stat file_stat;
+    struct timeval start;
+    double wall;
+    char * file_as = NULL;
+    ARCHIVE_MEMBER * member = NULL;
+    int i;
+
+    gettimeofday(&start , NULL);
+    scheduler.options = options;
+    scheduler.file_count = count;
+    scheduler.worker_count = (options->jobs < count) ? options->jobs : count;
+    if(scheduler.worker_count < 1){
+        scheduler.worker_count = 1;
+    }
+    scheduler.next_output = 0;
+    pthread_mutex_init(&scheduler.output_lock , NULL);
+
+    /* Measure the files */
+    scheduler.files = generic_malloc((count + 1) * sizeof(BATCH_FILE));
+    sorted = generic_malloc((count + 1) * sizeof(BATCH_FILE *));
+    for(i = 0 ; i < count ; i++){
+        scheduler.files[i].name = names[i];
+        file_as = add_suffix(names[i] , ".as");
+        member = find_Archive_Member(file_as);
+        if(member != NULL){
+            scheduler.files[i].size = member->size;
+        }
+        else{
+            scheduler.files[i].size = (stat(file_as , &file_stat) == 0) ? (long)file_stat.st_size : 0;
+        }
+        free(file_as);
+        open_diagnostics(&scheduler.files[i].diagnostics);
+        scheduler.files[i].done = FALSE;
+        sorted[i] = &scheduler.files[i];
+    }
+    qsort(sorted , count , sizeof(BATCH_FILE *) , compare_Batch_Files);
+
+    /* Deal the files round robin, so each queue is sorted largest first too */
+    scheduler.workers = generic_malloc(scheduler.worker_count * sizeof(WORKER));
+    for(i = 0 ; i < scheduler.worker_count ; i++){
+        worker = &scheduler.workers[i];
+        worker->scheduler = &scheduler;
+        worker->id = i;
+        worker->files_done = 0;
+        worker->files_stolen = 0;
+        worker->bytes_done = 0;
+        worker->busy_seconds = 0;
+        pthread_mutex_init(&worker->queue.lock , NULL);
+        worker->queue.files = generic_malloc((count / scheduler.worker_count + 1) * sizeof(BATCH_FILE *));
+        worker->queue.head = 0;
+        worker->queue.tail = 0;
+    }
+    for(i = 0 ; i < count ; i++){
+        worker = &scheduler.workers[i % scheduler.worker_count];
+        worker->queue.files[worker->queue.tail++] = sorted[i];
+    }
+
+    for(i = 0 ; i < scheduler.worker_count ; i++){
+        if(pthread_create(&scheduler.workers[i].thread , NULL , worker_Main , &scheduler.workers[i]) != 0){
+            print_error(FAILED_TO_START_THREAD , NO_LINE);
+            exit(1);
+        }
+    }
+    for(i = 0 ; i < scheduler.worker_count ; i++){
+        pthread_join(scheduler.workers[i].thread , NULL);
+    }
+    wall = elapsed_Seconds(&start);
+
+    if(options->stats == TRUE){
+        for(i = 0 ; i < scheduler.worker_count ; i++){
+            worker = &scheduler.workers[i];
+            fprintf(stderr , "Worker %d: %d files (%d stolen) , %ld bytes , busy %.3fs of %.3fs (%.1f%%)\n" ,
+                    worker->id , worker->files_done , worker->files_stolen , worker->bytes_done ,
+                    worker->busy_seconds , wall , (wall > 0) ? 100.0 * worker->busy_seconds / wall : 100.0);
+        }
+    }
+
+    for(i = 0 ; i < scheduler.worker_count ; i++){
+        pthread_mutex_destroy(&scheduler.workers[i].queue.lock);
+        free(scheduler.workers[i].queue.files);
+    }
+    pthread_mutex_destroy(&scheduler.output_lock);
+    free(scheduler.workers);
+    free(scheduler.files);
+    free(sorted);
+}
@@ -33,15 +33,15 @@ void add_addr_to_list(ADDRESS_LIST ** addr_list ,int addr){
  * @brief Checks if a label exists in the label or extern list.
  * 
  * This function searches for a given label in the label list and extern list. If the label is 
- * found, it returns TRUE. If the label is not found, it prints an error and returns FALSE.
+ * found, it returns TRUE. If the label is not found, it reports an error and returns FALSE.
  * 
  * @param head_label Pointer to the head of the label list.
  * @param head_extern Pointer to the head of the extern list.
- * @param addr The line number for error reporting.
+ * @param line The line number for error reporting.
  * @param label The label name to check.
  * @return BOOLEAN indicating if the label exists (TRUE) or not (FALSE).
  */
-BOOLEAN Check_If_Label_Exist(LABEL_LIST * head_label,EXTERN_LIST * head_extern , int addr,char * label){
+BOOLEAN Check_If_Label_Exist(LABEL_LIST * head_label,EXTERN_LIST * head_extern , int line,char * label){
     BOOLEAN result = FALSE;
 
     /* Search for the label in the label list */
@@ -61,9 +61,9 @@ BOOLEAN Check_If_Label_Exist(LABEL_LIST * head_label,EXTERN_LIST * head_extern ,
         head_extern = head_extern->next; 
     }
 
-    /* If the label was not found, print an error */
+    /* If the label was not found, report an error */
     if(result == FALSE){
-        printf("Line: %d Label is not defined , and the label name: %s \n",addr , label);
+        report_error(LABEL_NOT_DEFINED , label , line);
     }
 
     return result;
@@ -91,11 +91,11 @@ void Second_Pass(ASSEMBLER_TABLE ** assembler_table , char * file_name , int IC
     BOOLEAN error_flag = TRUE;
 
     /* Iterate through the machine code list and resolve labels */
-    while(ptr_mach_code != NULL){
+    while(ptr_mach_code != NULL && diagnostics_limit_reached() == FALSE){
          /* Check if the mila is marked for the second pass */
         if(ptr_mach_code->binary_code.mila == MARK_FOR_SECOND_PASS){
             /* Verify if the label exists in either the label or extern list */
-            error_flag += Check_If_Label_Exist((*assembler_table)->label_head ,(*assembler_table)->extern_head ,ptr_mach_code->addr,ptr_mach_code->label);
+            error_flag += Check_If_Label_Exist((*assembler_table)->label_head ,(*assembler_table)->extern_head ,ptr_mach_code->line,ptr_mach_code->label);
             
             /* Check if the label is in the label list */
             while(ptr_label != NULL){
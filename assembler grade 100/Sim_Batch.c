@@ -0,0 +1,210 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include "simulator.h"
+#include "jit.h"
+
+/**
+ * @brief Reads the list of input files of a batch, one name per line (empty lines are skipped).
+ *
+ * @param list_name Name of the list.
+ * @param batch The batch receiving its runs.
+ * @return 0 on success, 1 if the list cannot be read or is empty.
+ */
+int read_Batch_List(const char * list_name , SIM_BATCH * batch){
+    FILE * list = fopen(list_name , "r");
+    char line[SIM_MAX_PATH];
+    SIM_BATCH_RUN * runs;
+    unsigned int capacity = 0;
+    size_t length;
+
+    batch->runs = NULL;
+    batch->count = 0;
+    if(list == NULL){
+        fprintf(stderr , "Error: Failed to open the list of inputs %s\n" , list_name);
+        return 1;
+    }
+    while(fgets(line , sizeof(line) , list) != NULL){
+        length = strcspn(line , "\r\n");
+        if(line[length] == '\0' && !feof(list)){
+            fprintf(stderr , "Error: A line of %s is too long\n" , list_name);
+            fclose(list);
+            return 1;
+        }
+        line[length] = '\0';
+        if(length == 0){
+            continue;
+        }
+        if(batch->count == capacity){
+            capacity = (capacity == 0) ? 64 : capacity * 2;
+            runs = realloc(batch->runs , capacity * sizeof(SIM_BATCH_RUN));
+            if(runs == NULL){
+                fprintf(stderr , "Error: Memory allocation failed\n");
+                fclose(list);
+                return 1;
+            }
+            batch->runs = runs;
+        }
+        batch->runs[batch->count].input = malloc(length + 1);
+        if(batch->runs[batch->count].input == NULL){
+            fprintf(stderr , "Error: Memory allocation failed\n");
+            fclose(list);
+            return 1;
+        }
+        strcpy(batch->runs[batch->count].input , line);
+        batch->runs[batch->count].result = SIM_NOT_RUN;
+        batch->runs[batch->count].steps = 0;
+        batch->runs[batch->count].pc = 0;
+        batch->count++;
+    }
+    fclose(list);
+    if(batch->count == 0){
+        fprintf(stderr , "Error: The list of inputs %s is empty\n" , list_name);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Runs one run of a batch on the machine of a worker.
+ *
+ * @param batch The batch.
+ * @param run The run.
+ * @param sim The machine of the worker.
+ * @param jit The JIT of the worker, or NULL.
+ * @param input_buffer Buffer of the input file.
+ * @param output_buffer Buffer of the output file.
+ */
+void run_Batch_Item(SIM_BATCH * batch , SIM_BATCH_RUN * run , SIMULATOR * sim , struct JIT * jit , char * input_buffer , char * output_buffer){
+    char * output_name = malloc(strlen(run->input) + strlen(".out") + 1);
+    FILE * input = fopen(run->input , "r");
+    FILE * output = NULL;
+
+    if(output_name != NULL && input != NULL){
+        strcpy(output_name , run->input);
+        strcat(output_name , ".out");
+        output = fopen(output_name , "w");
+    }
+    if(output != NULL){
+        setvbuf(input , input_buffer , _IOFBF , SIM_BATCH_BUFFER);
+        setvbuf(output , output_buffer , _IOFBF , SIM_BATCH_BUFFER);
+        clone_Simulator(sim , batch->sim);
+        skip_Input(input , sim->input_read);
+        sim->input = input;
+        sim->output = output;
+        sim->record = NULL;
+        run->result = (jit != NULL) ? run_Jit(jit , batch->start) : run_Simulator(sim , batch->start);
+        run->steps = sim->steps - batch->sim->steps;
+        run->pc = sim->pc;
+        fclose(output);
+    }
+    if(input != NULL){
+        fclose(input);
+    }
+    free(output_name);
+}
+
+/**
+ * @brief Takes runs of a batch and runs them until none is left.
+ *
+ * A worker that cannot get its machine or buffers takes no run; the other workers take them.
+ *
+ * @param argument The batch (SIM_BATCH *).
+ * @return NULL.
+ */
+void * batch_Worker(void * argument){
+    SIM_BATCH * batch = argument;
+    SIMULATOR * sim = malloc(sizeof(SIMULATOR));
+    char * input_buffer = malloc(SIM_BATCH_BUFFER);
+    char * output_buffer = malloc(SIM_BATCH_BUFFER);
+    JIT * jit = NULL;
+    unsigned int index;
+
+    if(sim != NULL && batch->use_jit){
+        clone_Simulator(sim , batch->sim);
+        jit = create_Jit(sim);
+    }
+    while(sim != NULL && input_buffer != NULL && output_buffer != NULL && (jit != NULL || !batch->use_jit)){
+        pthread_mutex_lock(&batch->lock);
+        index = batch->next;
+        if(index < batch->count){
+            batch->next++;
+        }
+        pthread_mutex_unlock(&batch->lock);
+        if(index == batch->count){
+            break;
+        }
+        run_Batch_Item(batch , &batch->runs[index] , sim , jit , input_buffer , output_buffer);
+    }
+    free_Jit(jit);
+    free(output_buffer);
+    free(input_buffer);
+    free(sim);
+    return NULL;
+}
+
+/**
+ * @brief Runs a batch with its workers, then writes the result of each run to the standard output and the throughput to the standard error.
+ *
+ * The calling thread is one of the workers; if a thread cannot be started, the other
+ * workers take its share. Each run is written on a line: its input file, its result,
+ * the number of instructions it ran and the address where it stopped.
+ *
+ * @param batch The batch.
+ * @return 0 if every run halted, 1 otherwise.
+ */
+int run_Sim_Batch(SIM_BATCH * batch){
+    pthread_t threads[SIM_MAX_JOBS];
+    struct timeval begin , end;
+    unsigned long steps = 0;
+    unsigned int halted = 0;
+    unsigned int i;
+    double seconds;
+    int started = 0;
+
+    batch->next = 0;
+    pthread_mutex_init(&batch->lock , NULL);
+    gettimeofday(&begin , NULL);
+    for(i = 1 ; i < (unsigned int)batch->jobs ; i++){
+        if(pthread_create(&threads[started] , NULL , batch_Worker , batch) == 0){
+            started++;
+        }
+    }
+    batch_Worker(batch);
+    for(i = 0 ; i < (unsigned int)started ; i++){
+        pthread_join(threads[i] , NULL);
+    }
+    gettimeofday(&end , NULL);
+    pthread_mutex_destroy(&batch->lock);
+    seconds = (end.tv_sec - begin.tv_sec) + (end.tv_usec - begin.tv_usec) / 1000000.0;
+
+    for(i = 0 ; i < batch->count ; i++){
+        printf("%s\t%s\t%lu\t%u\n" , batch->runs[i].input , sim_Result_Name(batch->runs[i].result) , batch->runs[i].steps , batch->runs[i].pc);
+        steps += batch->runs[i].steps;
+        halted += batch->runs[i].result == SIM_HALTED;
+    }
+    fflush(stdout);
+    fprintf(stderr , "%u runs (%u halted) on %d workers: %lu instructions in %.3f seconds" , batch->count , halted , started + 1 , steps , seconds);
+    if(seconds > 0){
+        fprintf(stderr , " (%.1f runs and %.1f million instructions per second)" , batch->count / seconds , steps / seconds / 1000000.0);
+    }
+    fprintf(stderr , "\n");
+    return halted != batch->count;
+}
+
+/**
+ * @brief Frees the runs of a batch.
+ *
+ * @param batch The batch.
+ */
+void free_Sim_Batch(SIM_BATCH * batch){
+    unsigned int i;
+
+    for(i = 0 ; i < batch->count ; i++){
+        free(batch->runs[i].input);
+    }
+    free(batch->runs);
+    batch->runs = NULL;
+    batch->count = 0;
+}
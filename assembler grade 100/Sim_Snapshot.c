@@ -0,0 +1,179 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "simulator.h"
+
+/**
+ * @brief Stores a number as a little-endian 64-bit number, low half first.
+ *
+ * @param bytes The eight bytes receiving the number.
+ * @param value The number.
+ */
+void snapshot_put_u64(unsigned char * bytes , unsigned long value){
+    object_put_u32(bytes , (unsigned int)(value & 0xFFFFFFFFUL));
+    object_put_u32(bytes + 4 , (unsigned int)((value >> 16) >> 16));
+}
+
+/**
+ * @brief Reads a little-endian 64-bit number, low half first.
+ *
+ * @param bytes The eight bytes of the number.
+ * @return The number.
+ */
+unsigned long snapshot_u64(const unsigned char * bytes){
+    return (unsigned long)object_u32(bytes) | (((unsigned long)object_u32(bytes + 4) << 16) << 16);
+}
+
+/**
+ * @brief Takes a snapshot of a machine.
+ *
+ * @param sim The simulator.
+ * @param snapshot The snapshot.
+ */
+void take_Snapshot(const SIMULATOR * sim , SIM_SNAPSHOT * snapshot){
+    memcpy(snapshot->cells , sim->cells , sizeof(snapshot->cells));
+    snapshot->pc = sim->pc;
+    snapshot->stack_pointer = sim->stack_pointer;
+    snapshot->image_end = sim->image_end;
+    snapshot->zero_flag = sim->zero_flag != 0;
+    snapshot->steps = sim->steps;
+    snapshot->input_read = sim->input_read;
+}
+
+/**
+ * @brief Puts a machine back in the state of a snapshot; its instructions are decoded when they run.
+ *
+ * @param sim The simulator.
+ * @param snapshot The snapshot.
+ */
+void restore_Snapshot(SIMULATOR * sim , const SIM_SNAPSHOT * snapshot){
+    memcpy(sim->cells , snapshot->cells , sizeof(sim->cells));
+    reset_Program(sim);
+    sim->pc = snapshot->pc;
+    sim->stack_pointer = snapshot->stack_pointer;
+    sim->image_end = snapshot->image_end;
+    sim->zero_flag = snapshot->zero_flag;
+    sim->steps = snapshot->steps;
+    sim->input_read = snapshot->input_read;
+}
+
+/**
+ * @brief Writes a snapshot file.
+ *
+ * @param snapshot The snapshot.
+ * @param file_name Name of the file.
+ * @return 0 on success, 1 if the file cannot be written.
+ */
+int write_Snapshot(const SIM_SNAPSHOT * snapshot , const char * file_name){
+    SIM_SNAPSHOT_HEADER header;
+    unsigned char word[2];
+    unsigned int first = 0;
+    unsigned int last = SIM_MEMORY_SIZE;
+    unsigned int i;
+    int status = 0;
+    FILE * fp;
+
+    /* Only the memory words from the first to the last that is not 0 */
+    while(first < last && snapshot->cells[first] == 0){
+        first++;
+    }
+    while(last > first && snapshot->cells[last - 1] == 0){
+        last--;
+    }
+    memcpy(header.magic , SIM_SNAPSHOT_MAGIC , sizeof(header.magic));
+    object_put_u32(header.version , SIM_SNAPSHOT_VERSION);
+    object_put_u32(header.pc , snapshot->pc);
+    object_put_u32(header.stack_pointer , snapshot->stack_pointer);
+    object_put_u32(header.image_end , snapshot->image_end);
+    object_put_u32(header.zero_flag , snapshot->zero_flag != 0);
+    for(i = 0 ; i < SIM_REGISTERS ; i++){
+        object_put_u32(header.registers[i] , snapshot->cells[SIM_MEMORY_SIZE + i]);
+    }
+    snapshot_put_u64(header.steps , snapshot->steps);
+    snapshot_put_u64(header.input_read , snapshot->input_read);
+    object_put_u32(header.first_word , first);
+    object_put_u32(header.word_count , last - first);
+    object_put_u32(header.file_size , sizeof(header) + 2 * (last - first));
+
+    fp = fopen(file_name , "wb");
+    if(fp == NULL){
+        return 1;
+    }
+    status |= fwrite(&header , sizeof(header) , 1 , fp) != 1;
+    for(i = first ; i < last ; i++){
+        word[0] = snapshot->cells[i] & 0xFF;
+        word[1] = (snapshot->cells[i] >> 8) & 0xFF;
+        status |= fwrite(word , 1 , 2 , fp) != 2;
+    }
+    status |= fclose(fp) != 0;
+    return status;
+}
+
+/**
+ * @brief Reads a snapshot file.
+ *
+ * @param snapshot The snapshot.
+ * @param file_name Name of the file.
+ * @return 0 on success, 1 if the file cannot be read or is not a valid snapshot.
+ */
+int read_Snapshot(SIM_SNAPSHOT * snapshot , const char * file_name){
+    SIM_SNAPSHOT_HEADER header;
+    unsigned char word[2];
+    unsigned int first , count , i;
+    FILE * fp = fopen(file_name , "rb");
+    int status = 0;
+
+    if(fp == NULL){
+        return 1;
+    }
+    if(fread(&header , sizeof(header) , 1 , fp) != 1 || memcmp(header.magic , SIM_SNAPSHOT_MAGIC , sizeof(header.magic)) != 0 ||
+       object_u32(header.version) != SIM_SNAPSHOT_VERSION){
+        fclose(fp);
+        return 1;
+    }
+    first = object_u32(header.first_word);
+    count = object_u32(header.word_count);
+    snapshot->pc = object_u32(header.pc);
+    snapshot->stack_pointer = object_u32(header.stack_pointer);
+    snapshot->image_end = object_u32(header.image_end);
+    snapshot->zero_flag = object_u32(header.zero_flag) != 0;
+    snapshot->steps = snapshot_u64(header.steps);
+    snapshot->input_read = snapshot_u64(header.input_read);
+    if(first > SIM_MEMORY_SIZE || count > SIM_MEMORY_SIZE - first ||
+       object_u32(header.file_size) != sizeof(header) + 2 * count || snapshot->pc >= SIM_MEMORY_SIZE ||
+       snapshot->stack_pointer > SIM_MEMORY_SIZE || snapshot->image_end > SIM_MEMORY_SIZE){
+        fclose(fp);
+        return 1;
+    }
+
+    memset(snapshot->cells , 0 , sizeof(snapshot->cells));
+    for(i = 0 ; i < SIM_REGISTERS ; i++){
+        snapshot->cells[SIM_MEMORY_SIZE + i] = object_u32(header.registers[i]) & SIM_WORD_MASK;
+    }
+    for(i = 0 ; i < count && status == 0 ; i++){
+        status = fread(word , 1 , 2 , fp) != 2;
+        snapshot->cells[first + i] = (word[0] | (word[1] << 8)) & SIM_WORD_MASK;
+    }
+    if(status == 0 && getc(fp) != EOF){
+        status = 1;
+    }
+    fclose(fp);
+    return status;
+}
+
+/**
+ * @brief Skips the characters of an input a restored machine already read.
+ *
+ * A file is seeked; a pipe or a terminal is read.
+ *
+ * @param input The input.
+ * @param count Number of characters.
+ */
+void skip_Input(FILE * input , unsigned long count){
+    if(count == 0 || fseek(input , (long)count , SEEK_CUR) == 0){
+        return;
+    }
+    while(count > 0 && getc(input) != EOF){
+        count--;
+    }
+}
@@ -0,0 +1,920 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <sys/time.h>
+#include "simulator.h"
+#include "jit.h"
+
+/*
+ * simulator: runs an object written by the assembler or the linker.
+ *
+ *   simulator [--entry=SYM] [--max-steps=N] [--no-fuse] [--jit] [--dump] [--stats] [--profile] [--inputs=LIST [-j N]] [--save=FILE] NAME|--restore=FILE
+ *
+ * NAME is the base name of the .ob, .ent and .ext files, or the name of a binary object
+ * file (.obj). The program starts at the load address, or at the entry SYM, and runs until
+ * stop. red reads a character from the standard input (-1 at its end), prn writes its
+ * operand as a signed number on the standard output.
+ *
+ * An object with extern references cannot run; link it first.
+ *
+ * With --dump, the registers are written to the standard error when the program stops;
+ * with --stats, the number of instructions run and their rate. --no-fuse runs every
+ * instruction alone. --jit runs the program as native code (x86-64 hosts only), see jit.h.
+ *
+ * With --profile, the program runs without fusion first, its output thrown away, then
+ * with fusion, reading the characters the first run read. The fused pairs and the speedup
+ * of the second run over the first are written to the standard error, with how often each
+ * pair ran, counted by a third run (counting slows the runs down, so the timed ones do not).
+ * With --jit too, the second run is the native one.
+ *
+ * With --inputs=LIST, the program runs once for each input file named in LIST (one per
+ * line), N runs at a time with -j N. Each run reads its input file and writes the numbers
+ * of prn to the same name with .out. A line is written for each run on the standard output,
+ * in the order of LIST: the input file, the result (halted, illegal-instruction,
+ * stack-overflow, stack-underflow, out-of-memory, step-limit, or not-run if its files could
+ * not be opened), the number of instructions run and the address where it stopped; the
+ * throughput of the batch is written to the standard error. --dump, --stats, --profile and
+ * --save cannot be used with --inputs.
+ *
+ * With --save=FILE, a snapshot of the machine where the run stopped is written to FILE
+ * (see simulator.h); stopping at the limit of --max-steps is then not an error. With
+ * --restore=FILE instead of NAME, the machine starts in the state of the snapshot FILE, at
+ * its pc, and skips the characters of the input the snapshot already read, so a run (or
+ * each run of a batch) goes on from there without running the instructions before it.
+ */
+
+#if defined(__GNUC__) && !defined(SIM_SWITCH_DISPATCH)
+#define SIM_THREADED
+#endif
+
+/* A handler is a label reached by a computed goto, or a case of the dispatch switch */
+#ifdef SIM_THREADED
+#define SIM_HANDLER(handler , label) label:
+#define SIM_DISPATCH_TO(handler) __extension__ ({ goto *handlers[handler]; })
+#else
+#define SIM_HANDLER(handler , label) case handler:
+#define SIM_DISPATCH_TO(target) do{ handler = (target); goto dispatch; }while(0)
+#endif
+#define SIM_DISPATCH() SIM_DISPATCH_TO(pc->handler)
+
+/* Counts the instruction that just ran and goes on with another */
+#define SIM_NEXT(instruction) do{ pc = (instruction); if(--budget == 0){ goto step_limit; } SIM_DISPATCH(); }while(0)
+
+/* Counts the two instructions of a fused pair that just ran and goes on with another */
+#define SIM_NEXT_PAIR(instruction) do{ pc = (instruction); budget -= 2; if(budget == 0){ goto step_limit; } SIM_DISPATCH(); }while(0)
+
+/* Runs the first instruction of a fused pair alone when the step limit falls between the two */
+#define SIM_CHECK_PAIR() do{ if(budget == 1){ SIM_DISPATCH_TO(pc->plain); } if(count_pairs){ pc->runs++; } }while(0)
+
+/* Cells of the operands of the running instruction; the register of a *r operand wraps around memory */
+#define SIM_SOURCE() (pc->source + (*pc->source_index & SIM_ADDRESS_MASK))
+#define SIM_TARGET() (pc->target + (*pc->target_index & SIM_ADDRESS_MASK))
+
+/* Jump address of a jmp, bne or jsr, and of the jump of a fused pair */
+#define SIM_JUMP(instruction) (program + (((instruction)->address + *(instruction)->target_index) & SIM_ADDRESS_MASK))
+#define SIM_PAIR_JUMP(instruction) (program + (((instruction)->address + *(instruction)->jump_index) & SIM_ADDRESS_MASK))
+
+/* Stores a word, invalidating the instructions and fused pairs that may hold it */
+#define SIM_STORE(cell , value) do{ \
+        *(cell) = (unsigned short)((value) & SIM_WORD_MASK); \
+        if((unsigned long)((cell) - cells) < SIM_MEMORY_SIZE){ \
+            for(span = 0 ; span < SIM_MAX_SPAN ; span++){ \
+                program[(cell) - cells - span].handler = SIM_DECODE; \
+            } \
+        } \
+    }while(0)
+
+/**
+ * @brief Returns the addressing mode of the mode bits of an instruction.
+ *
+ * @param bits The four mode bits of the source or target operand.
+ * @return SIM_IMMEDIATE to SIM_REGISTER, SIM_NO_OPERAND if no bit is set, or SIM_BAD_MODE.
+ */
+int sim_Mode(unsigned int bits){
+    switch(bits){
+        case 0:
+            return SIM_NO_OPERAND;
+        case 1:
+            return SIM_IMMEDIATE;
+        case 2:
+            return SIM_DIRECT;
+        case 4:
+            return SIM_INDIRECT;
+        case 8:
+            return SIM_REGISTER;
+        default:
+            return SIM_BAD_MODE;
+    }
+}
+
+/**
+ * @brief Decodes the cell of an operand.
+ *
+ * @param sim The simulator.
+ * @param mode Addressing mode of the operand.
+ * @param word Operand word.
+ * @param shift Position of the register number in the word.
+ * @param immediate Word of the instruction receiving an immediate value.
+ * @param cell Pointer receiving the cell, or the memory for an indirect operand.
+ * @param index Pointer receiving the register of an indirect operand, or the zero word.
+ * @return 0 on success, 1 if the word is not valid for the mode (an unresolved extern).
+ */
+int decode_Operand(SIMULATOR * sim , int mode , unsigned int word , unsigned int shift , unsigned short * immediate , unsigned short ** cell , unsigned short ** index){
+    unsigned int value = (word >> SIM_VALUE_SHIFT) & SIM_VALUE_MASK;
+
+    *index = &sim->zero;
+    switch(mode){
+        case SIM_IMMEDIATE:
+            /* A 12-bit signed number, widened to a word */
+            *immediate = (unsigned short)(((value & SIM_VALUE_SIGN) ? value | ~SIM_VALUE_MASK : value) & SIM_WORD_MASK);
+            *cell = immediate;
+            return (word & SIM_ARE_MASK) != SIM_ABSOLUTE;
+        case SIM_DIRECT:
+            *cell = &sim->cells[value & SIM_ADDRESS_MASK];
+            return (word & SIM_ARE_MASK) == SIM_EXTERNAL;
+        case SIM_INDIRECT:
+            *cell = sim->cells;
+            *index = &sim->registers[(word >> shift) & SIM_REGISTER_MASK];
+            return (word & SIM_ARE_MASK) != SIM_ABSOLUTE;
+        default:
+            *cell = &sim->registers[(word >> shift) & SIM_REGISTER_MASK];
+            return (word & SIM_ARE_MASK) != SIM_ABSOLUTE;
+    }
+}
+
+/**
+ * @brief Decodes the instruction at an address; it gets the SIM_ILLEGAL handler if it is not valid.
+ *
+ * @param sim The simulator.
+ * @param address Address of the instruction.
+ */
+void decode_Instruction(SIMULATOR * sim , unsigned int address){
+    SIM_INSTRUCTION * instruction = &sim->program[address];
+    unsigned int word = sim->cells[address];
+    unsigned int opcode = (word >> SIM_OPCODE_SHIFT) & SIM_OPCODE_MASK;
+    int source_mode = sim_Mode((word >> SIM_SOURCE_SHIFT) & SIM_MODE_MASK);
+    int target_mode = sim_Mode((word >> SIM_TARGET_SHIFT) & SIM_MODE_MASK);
+    int shared = 0; /* Nonzero if both operands are registers, in one word */
+    int error = 0;
+
+    instruction->handler = SIM_ILLEGAL;
+    instruction->plain = SIM_ILLEGAL;
+    instruction->length = 1;
+    instruction->source_mode = source_mode;
+    instruction->target_mode = target_mode;
+    instruction->source = &sim->zero;
+    instruction->source_index = &sim->zero;
+    instruction->target = &sim->zero;
+    instruction->target_index = &sim->zero;
+    instruction->address = 0;
+    instruction->jump_index = &sim->zero;
+    instruction->next = instruction + 1;
+    instruction->after = instruction + 1;
+    instruction->runs = 0;
+
+    if((word & SIM_ARE_MASK) != SIM_ABSOLUTE || source_mode == SIM_BAD_MODE || target_mode == SIM_BAD_MODE){
+        return;
+    }
+    if(opcode <= SIM_LEA){
+        if(source_mode == SIM_NO_OPERAND || target_mode == SIM_NO_OPERAND){
+            return;
+        }
+        shared = (source_mode == SIM_INDIRECT || source_mode == SIM_REGISTER) && (target_mode == SIM_INDIRECT || target_mode == SIM_REGISTER);
+        instruction->length = shared ? 2 : 3;
+    }
+    else if(opcode < SIM_RTS){
+        if(source_mode != SIM_NO_OPERAND || target_mode == SIM_NO_OPERAND){
+            return;
+        }
+        instruction->length = 2;
+    }
+    else if(source_mode != SIM_NO_OPERAND || target_mode != SIM_NO_OPERAND){
+        return;
+    }
+    if(address + instruction->length > SIM_MEMORY_SIZE){
+        instruction->length = 1;
+        return;
+    }
+
+    if(source_mode != SIM_NO_OPERAND){
+        error |= decode_Operand(sim , source_mode , sim->cells[address + 1] , SIM_SOURCE_REGISTER_SHIFT , &instruction->immediate[0] , &instruction->source , &instruction->source_index);
+    }
+    if(target_mode != SIM_NO_OPERAND){
+        error |= decode_Operand(sim , target_mode , sim->cells[address + instruction->length - 1] , SIM_TARGET_REGISTER_SHIFT , &instruction->immediate[1] , &instruction->target , &instruction->target_index);
+    }
+    /* A shared word holds nothing above its two registers */
+    if(shared && (sim->cells[address + 1] >> (SIM_SOURCE_REGISTER_SHIFT + 3)) != 0){
+        error = 1;
+    }
+
+    switch(opcode){
+        case SIM_CMP:
+        case SIM_PRN:
+            break;
+        case SIM_LEA:
+            error |= source_mode != SIM_DIRECT || target_mode == SIM_IMMEDIATE;
+            instruction->address = (unsigned int)(instruction->source - sim->cells);
+            break;
+        case SIM_JMP:
+        case SIM_BNE:
+        case SIM_JSR:
+            error |= target_mode == SIM_IMMEDIATE;
+            if(target_mode == SIM_DIRECT){
+                instruction->address = (unsigned int)(instruction->target - sim->cells);
+            }
+            else if(target_mode == SIM_REGISTER){
+                /* Jump to the address held by the register, as *r does */
+                instruction->target_index = instruction->target;
+            }
+            break;
+        case SIM_RTS:
+        case SIM_STOP:
+            break;
+        default:
+            error |= target_mode == SIM_IMMEDIATE;
+            break;
+    }
+    if(error){
+        instruction->length = 1;
+        return;
+    }
+    instruction->handler = opcode;
+    instruction->plain = opcode;
+    instruction->next = instruction + instruction->length;
+}
+
+/**
+ * @brief Gives a decoded instruction a fused handler when it starts one of the fused pairs.
+ *
+ * @param sim The simulator.
+ * @param address Address of the instruction.
+ */
+void fuse_Instruction(SIMULATOR * sim , unsigned int address){
+    SIM_INSTRUCTION * first = &sim->program[address];
+    SIM_INSTRUCTION * second = first->next;
+    unsigned int second_address = (unsigned int)(second - sim->program);
+
+    first->handler = first->plain;
+    if(first->plain == SIM_MOV && first->source_mode == SIM_REGISTER && first->target_mode == SIM_REGISTER){
+        first->handler = SIM_MOV_REGISTERS;
+        return;
+    }
+    if((first->plain != SIM_CMP && first->plain != SIM_INC && first->plain != SIM_DEC) || second_address >= SIM_MEMORY_SIZE){
+        return;
+    }
+    if(second->handler == SIM_DECODE){
+        decode_Instruction(sim , second_address);
+    }
+    /* The second instruction may start a fused pair itself, its plain handler is the one that counts */
+    if(second->handler == SIM_ILLEGAL || second->handler == SIM_DECODE){
+        return;
+    }
+    if(first->plain == SIM_CMP && second->plain == SIM_BNE){
+        first->handler = SIM_CMP_BNE;
+    }
+    else if(first->plain == SIM_INC && second->plain == SIM_JMP){
+        first->handler = SIM_INC_JMP;
+    }
+    else if(first->plain == SIM_DEC && second->plain == SIM_JMP){
+        first->handler = SIM_DEC_JMP;
+    }
+    else{
+        return;
+    }
+    /* The first instruction has no address of its own, it keeps the jump of the second */
+    first->address = second->address;
+    first->jump_index = second->target_index;
+    first->after = second->next;
+}
+
+/**
+ * @brief Decodes the instruction at an address, and fuses it with the next one when fusion is on.
+ *
+ * @param sim The simulator.
+ * @param address Address of the instruction.
+ */
+void prepare_Instruction(SIMULATOR * sim , unsigned int address){
+    decode_Instruction(sim , address);
+    if(sim->fuse && sim->program[address].handler != SIM_ILLEGAL){
+        fuse_Instruction(sim , address);
+    }
+}
+
+/**
+ * @brief Returns the name of a handler, as printed by the profile.
+ *
+ * @param handler The handler.
+ * @return The name, e.g. "cmp+bne".
+ */
+const char * sim_Handler_Name(unsigned int handler){
+    static const char * names[SIM_HANDLERS] = {
+        "mov" , "cmp" , "add" , "sub" , "lea" , "clr" , "not" , "inc" , "dec" , "jmp" , "bne" , "red" , "prn" , "jsr" , "rts" , "stop" ,
+        "illegal" , "decode" , "end of memory" , "cmp+bne" , "inc+jmp" , "dec+jmp" , "mov r,r"
+    };
+
+    return (handler < SIM_HANDLERS) ? names[handler] : "?";
+}
+
+/**
+ * @brief Points the registers and the program into the machine, and marks every instruction as not decoded yet.
+ *
+ * @param sim The simulator.
+ */
+void reset_Program(SIMULATOR * sim){
+    unsigned int i;
+
+    sim->registers = sim->cells + SIM_MEMORY_SIZE;
+    sim->zero = 0;
+    sim->program = sim->slots + SIM_MAX_SPAN - 1;
+    for(i = 0 ; i < sizeof(sim->slots) / sizeof(SIM_INSTRUCTION) ; i++){
+        sim->slots[i].handler = SIM_DECODE;
+    }
+    for(i = SIM_MEMORY_SIZE ; i < SIM_MEMORY_SIZE + SIM_MAX_LENGTH ; i++){
+        sim->program[i].handler = SIM_END_OF_MEMORY;
+    }
+}
+
+/**
+ * @brief Loads an object into the memory and decodes its code.
+ *
+ * @param sim The simulator.
+ * @param image The object.
+ * @return 0 on success, 1 if the object does not fit in the memory.
+ */
+int load_Simulator(SIMULATOR * sim , const OBJECT_IMAGE * image){
+    unsigned int i;
+
+    if(image->load_address > SIM_MEMORY_SIZE || image->code_count + image->data_count > SIM_MEMORY_SIZE - image->load_address){
+        return 1;
+    }
+    memset(sim->cells , 0 , sizeof(sim->cells));
+    reset_Program(sim);
+    for(i = 0 ; i < image->code_count + image->data_count ; i++){
+        sim->cells[image->load_address + i] = image->words[i] & SIM_WORD_MASK;
+    }
+    sim->image_end = image->load_address + image->code_count + image->data_count;
+    sim->stack_pointer = SIM_MEMORY_SIZE;
+    sim->zero_flag = 0;
+    sim->pc = image->load_address;
+    sim->steps = 0;
+    sim->input_read = 0;
+
+    /* The code is decoded now, anything else the first time it runs */
+    for(i = image->load_address ; i < image->load_address + image->code_count ; i++){
+        decode_Instruction(sim , i);
+    }
+    if(sim->fuse){
+        for(i = image->load_address ; i < image->load_address + image->code_count ; i++){
+            if(sim->program[i].handler != SIM_ILLEGAL){
+                fuse_Instruction(sim , i);
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Copies a loaded machine, its decoded program pointing into the copy.
+ *
+ * Every pointer of a decoded instruction points into the machine (a cell, the zero word,
+ * an immediate value or another instruction), so it is moved by the distance between the
+ * two machines.
+ *
+ * @param copy The copy.
+ * @param sim The machine copied.
+ */
+void clone_Simulator(SIMULATOR * copy , const SIMULATOR * sim){
+    SIM_INSTRUCTION * instruction;
+    unsigned int i;
+
+    memcpy(copy , sim , sizeof(SIMULATOR));
+    copy->registers = copy->cells + SIM_MEMORY_SIZE;
+    copy->program = copy->slots + SIM_MAX_SPAN - 1;
+    for(i = 0 ; i < sizeof(copy->slots) / sizeof(SIM_INSTRUCTION) ; i++){
+        instruction = &copy->slots[i];
+        if(instruction->handler == SIM_DECODE || instruction->handler == SIM_END_OF_MEMORY){
+            continue;
+        }
+        instruction->source = (unsigned short *)((char *)copy + ((const char *)instruction->source - (const char *)sim));
+        instruction->source_index = (unsigned short *)((char *)copy + ((const char *)instruction->source_index - (const char *)sim));
+        instruction->target = (unsigned short *)((char *)copy + ((const char *)instruction->target - (const char *)sim));
+        instruction->target_index = (unsigned short *)((char *)copy + ((const char *)instruction->target_index - (const char *)sim));
+        instruction->jump_index = (unsigned short *)((char *)copy + ((const char *)instruction->jump_index - (const char *)sim));
+        instruction->next = copy->slots + (instruction->next - sim->slots);
+        instruction->after = copy->slots + (instruction->after - sim->slots);
+    }
+}
+
+/**
+ * @brief Runs the program until it stops.
+ *
+ * @param sim The simulator, with its program loaded.
+ * @param start Address of the first instruction.
+ * @return SIM_HALTED when stop runs, or the error that stopped the run (sim->pc is its address).
+ */
+int run_Simulator(SIMULATOR * sim , unsigned int start){
+    unsigned short * cells = sim->cells;
+    SIM_INSTRUCTION * program = sim->program;
+    SIM_INSTRUCTION * pc = program + (start & SIM_ADDRESS_MASK);
+    unsigned long budget = (sim->max_steps != 0) ? sim->max_steps : ULONG_MAX;
+    unsigned long initial = budget;
+    unsigned int stack_pointer = sim->stack_pointer;
+    unsigned int image_end = sim->image_end;
+    int zero_flag = sim->zero_flag;
+    int count_pairs = sim->count_pairs;
+    unsigned short * cell;
+    unsigned int value;
+    int result = SIM_HALTED;
+    int span;
+    int c;
+#ifdef SIM_THREADED
+    const void * handlers[SIM_HANDLERS];
+#else
+    unsigned int handler;
+#endif
+
+#ifdef SIM_THREADED
+    handlers[SIM_MOV] = __extension__ &&run_mov;
+    handlers[SIM_CMP] = __extension__ &&run_cmp;
+    handlers[SIM_ADD] = __extension__ &&run_add;
+    handlers[SIM_SUB] = __extension__ &&run_sub;
+    handlers[SIM_LEA] = __extension__ &&run_lea;
+    handlers[SIM_CLR] = __extension__ &&run_clr;
+    handlers[SIM_NOT] = __extension__ &&run_not;
+    handlers[SIM_INC] = __extension__ &&run_inc;
+    handlers[SIM_DEC] = __extension__ &&run_dec;
+    handlers[SIM_JMP] = __extension__ &&run_jmp;
+    handlers[SIM_BNE] = __extension__ &&run_bne;
+    handlers[SIM_RED] = __extension__ &&run_red;
+    handlers[SIM_PRN] = __extension__ &&run_prn;
+    handlers[SIM_JSR] = __extension__ &&run_jsr;
+    handlers[SIM_RTS] = __extension__ &&run_rts;
+    handlers[SIM_STOP] = __extension__ &&run_stop;
+    handlers[SIM_ILLEGAL] = __extension__ &&run_illegal;
+    handlers[SIM_DECODE] = __extension__ &&run_decode;
+    handlers[SIM_END_OF_MEMORY] = __extension__ &&run_end_of_memory;
+    handlers[SIM_CMP_BNE] = __extension__ &&run_cmp_bne;
+    handlers[SIM_INC_JMP] = __extension__ &&run_inc_jmp;
+    handlers[SIM_DEC_JMP] = __extension__ &&run_dec_jmp;
+    handlers[SIM_MOV_REGISTERS] = __extension__ &&run_mov_registers;
+    SIM_DISPATCH();
+#else
+    handler = pc->handler;
+dispatch:
+    switch(handler){
+#endif
+    SIM_HANDLER(SIM_MOV , run_mov)
+        cell = SIM_TARGET();
+        SIM_STORE(cell , *SIM_SOURCE());
+        SIM_NEXT(pc->next);
+    SIM_HANDLER(SIM_CMP , run_cmp)
+        zero_flag = *SIM_SOURCE() == *SIM_TARGET();
+        SIM_NEXT(pc->next);
+    SIM_HANDLER(SIM_ADD , run_add)
+        cell = SIM_TARGET();
+        SIM_STORE(cell , *cell + *SIM_SOURCE());
+        SIM_NEXT(pc->next);
+    SIM_HANDLER(SIM_SUB , run_sub)
+        cell = SIM_TARGET();
+        SIM_STORE(cell , *cell - *SIM_SOURCE());
+        SIM_NEXT(pc->next);
+    SIM_HANDLER(SIM_LEA , run_lea)
+        cell = SIM_TARGET();
+        SIM_STORE(cell , pc->address);
+        SIM_NEXT(pc->next);
+    SIM_HANDLER(SIM_CLR , run_clr)
+        cell = SIM_TARGET();
+        SIM_STORE(cell , 0);
+        SIM_NEXT(pc->next);
+    SIM_HANDLER(SIM_NOT , run_not)
+        cell = SIM_TARGET();
+        SIM_STORE(cell , ~(unsigned int)*cell);
+        SIM_NEXT(pc->next);
+    SIM_HANDLER(SIM_INC , run_inc)
+        cell = SIM_TARGET();
+        SIM_STORE(cell , *cell + 1);
+        SIM_NEXT(pc->next);
+    SIM_HANDLER(SIM_DEC , run_dec)
+        cell = SIM_TARGET();
+        SIM_STORE(cell , *cell - 1);
+        SIM_NEXT(pc->next);
+    SIM_HANDLER(SIM_JMP , run_jmp)
+        SIM_NEXT(SIM_JUMP(pc));
+    SIM_HANDLER(SIM_BNE , run_bne)
+        SIM_NEXT(zero_flag ? pc->next : SIM_JUMP(pc));
+    SIM_HANDLER(SIM_RED , run_red)
+        c = getc(sim->input);
+        if(c != EOF){
+            sim->input_read++;
+            if(sim->record != NULL){
+                putc(c , sim->record);
+            }
+        }
+        cell = SIM_TARGET();
+        SIM_STORE(cell , (c == EOF) ? SIM_WORD_MASK : (unsigned int)c);
+        SIM_NEXT(pc->next);
+    SIM_HANDLER(SIM_PRN , run_prn)
+        fprintf(sim->output , "%d\n" , sim_Signed(*SIM_TARGET()));
+        SIM_NEXT(pc->next);
+    SIM_HANDLER(SIM_JSR , run_jsr)
+        if(stack_pointer <= image_end){
+            result = SIM_STACK_OVERFLOW;
+            goto done;
+        }
+        cell = &cells[--stack_pointer];
+        SIM_STORE(cell , (unsigned int)(pc->next - program));
+        SIM_NEXT(SIM_JUMP(pc));
+    SIM_HANDLER(SIM_RTS , run_rts)
+        if(stack_pointer >= SIM_MEMORY_SIZE){
+            result = SIM_STACK_UNDERFLOW;
+            goto done;
+        }
+        value = cells[stack_pointer++];
+        SIM_NEXT(program + (value & SIM_ADDRESS_MASK));
+    SIM_HANDLER(SIM_STOP , run_stop)
+        budget--;
+        goto done;
+    SIM_HANDLER(SIM_ILLEGAL , run_illegal)
+        result = SIM_ILLEGAL_INSTRUCTION;
+        goto done;
+    SIM_HANDLER(SIM_DECODE , run_decode)
+        prepare_Instruction(sim , (unsigned int)(pc - program));
+        SIM_DISPATCH();
+    SIM_HANDLER(SIM_END_OF_MEMORY , run_end_of_memory)
+        result = SIM_OUT_OF_MEMORY;
+        goto done;
+    SIM_HANDLER(SIM_CMP_BNE , run_cmp_bne)
+        SIM_CHECK_PAIR();
+        zero_flag = *SIM_SOURCE() == *SIM_TARGET();
+        SIM_NEXT_PAIR(zero_flag ? pc->after : SIM_PAIR_JUMP(pc));
+    SIM_HANDLER(SIM_INC_JMP , run_inc_jmp)
+        SIM_CHECK_PAIR();
+        cell = SIM_TARGET();
+        SIM_STORE(cell , *cell + 1);
+        if(pc->next->handler == SIM_DECODE){
+            /* inc wrote over the jmp, which must be decoded again */
+            SIM_NEXT(pc->next);
+        }
+        SIM_NEXT_PAIR(SIM_PAIR_JUMP(pc));
+    SIM_HANDLER(SIM_DEC_JMP , run_dec_jmp)
+        SIM_CHECK_PAIR();
+        cell = SIM_TARGET();
+        SIM_STORE(cell , *cell - 1);
+        if(pc->next->handler == SIM_DECODE){
+            /* dec wrote over the jmp, which must be decoded again */
+            SIM_NEXT(pc->next);
+        }
+        SIM_NEXT_PAIR(SIM_PAIR_JUMP(pc));
+    SIM_HANDLER(SIM_MOV_REGISTERS , run_mov_registers)
+        /* A register is not memory, nothing to invalidate */
+        *pc->target = *pc->source;
+        SIM_NEXT(pc->next);
+#ifndef SIM_THREADED
+    }
+#endif
+
+step_limit:
+    result = SIM_STEP_LIMIT;
+done:
+    sim->steps += initial - budget;
+    sim->pc = (unsigned int)(pc - program);
+    sim->stack_pointer = stack_pointer;
+    sim->zero_flag = zero_flag;
+    return result;
+}
+
+/**
+ * @brief Returns the name of the result of a run, as printed by a batch.
+ *
+ * @param result SIM_HALTED to SIM_NOT_RUN.
+ * @return The name, e.g. "halted".
+ */
+const char * sim_Result_Name(int result){
+    static const char * names[] = {"halted" , "illegal-instruction" , "stack-overflow" , "stack-underflow" , "out-of-memory" , "step-limit" , "not-run"};
+
+    return (result >= SIM_HALTED && result <= SIM_NOT_RUN) ? names[result] : "?";
+}
+
+/**
+ * @brief Converts a word to a signed number.
+ *
+ * @param word The 15-bit word.
+ * @return The number.
+ */
+int sim_Signed(unsigned int word){
+    word &= SIM_WORD_MASK;
+    return (word & SIM_SIGN_BIT) ? (int)word - (SIM_WORD_MASK + 1) : (int)word;
+}
+
+/**
+ * @brief Writes the profile of a run to the standard error: the fused pairs, how often each ran, and the speedup.
+ *
+ * @param sim The simulator, after a run with fusion counting the fused pairs.
+ * @param baseline_steps Number of instructions of the run without fusion.
+ * @param baseline Seconds of the run without fusion.
+ * @param seconds Seconds of the run with fusion.
+ */
+void report_Profile(const SIMULATOR * sim , unsigned long baseline_steps , double baseline , double seconds){
+    unsigned long sites[SIM_HANDLERS];
+    unsigned long runs[SIM_HANDLERS];
+    unsigned long fused_runs = 0;
+    unsigned int handler;
+    unsigned int i;
+
+    memset(sites , 0 , sizeof(sites));
+    memset(runs , 0 , sizeof(runs));
+    fprintf(stderr , "Fused instructions:\n");
+    for(i = 0 ; i < SIM_MEMORY_SIZE ; i++){
+        handler = sim->program[i].handler;
+        if(handler < SIM_CMP_BNE || handler >= SIM_HANDLERS){
+            continue;
+        }
+        sites[handler]++;
+        if(handler == SIM_MOV_REGISTERS){
+            fprintf(stderr , "  %u\t%s\n" , i , sim_Handler_Name(handler));
+        }
+        else{
+            fprintf(stderr , "  %u\t%s\t%lu runs\n" , i , sim_Handler_Name(handler) , sim->program[i].runs);
+            runs[handler] += sim->program[i].runs;
+            fused_runs += sim->program[i].runs;
+        }
+    }
+    for(handler = SIM_CMP_BNE ; handler < SIM_HANDLERS ; handler++){
+        fprintf(stderr , "%s: %lu sites" , sim_Handler_Name(handler) , sites[handler]);
+        if(handler != SIM_MOV_REGISTERS){
+            fprintf(stderr , ", %lu runs" , runs[handler]);
+        }
+        fprintf(stderr , "\n");
+    }
+    fprintf(stderr , "Without fusion: %lu instructions in %.3f seconds\n" , baseline_steps , baseline);
+    fprintf(stderr , "With fusion: %lu instructions, %lu dispatches, in %.3f seconds\n" , sim->steps , sim->steps - fused_runs , seconds);
+    if(seconds > 0){
+        fprintf(stderr , "Speedup: %.2fx\n" , baseline / seconds);
+    }
+}
+
+int main(int argc , char * argv[]){
+    SIMULATOR * sim = NULL;
+    JIT * jit = NULL;
+    OBJECT_IMAGE image;
+    FILE * input = NULL;
+    FILE * sink = NULL;
+    const char * name = NULL;
+    const char * entry = NULL;
+    const char * inputs = NULL;
+    const char * save = NULL;
+    const char * restore = NULL;
+    SIM_SNAPSHOT snapshot;
+    SIM_BATCH batch;
+    unsigned long baseline_steps = 0;
+    unsigned int start;
+    unsigned int i;
+    struct timeval begin , end;
+    double baseline = 0;
+    double seconds;
+    int dump = 0;
+    int stats = 0;
+    int profile = 0;
+    int use_jit = 0;
+    int result;
+    int status = 0;
+
+    sim = calloc(1 , sizeof(SIMULATOR));
+    if(sim == NULL){
+        fprintf(stderr , "Error: Memory allocation failed\n");
+        return 1;
+    }
+    sim->input = stdin;
+    sim->output = stdout;
+    sim->fuse = 1;
+    batch.jobs = 1;
+    batch.runs = NULL;
+    batch.count = 0;
+    for(i = 1 ; i < (unsigned int)argc ; i++){
+        if(strncmp(argv[i] , "--entry=" , strlen("--entry=")) == 0 && argv[i][strlen("--entry=")] != '\0'){
+            entry = argv[i] + strlen("--entry=");
+        }
+        else if(strncmp(argv[i] , "--max-steps=" , strlen("--max-steps=")) == 0 && argv[i][strlen("--max-steps=")] != '\0'){
+            sim->max_steps = strtoul(argv[i] + strlen("--max-steps=") , NULL , 10);
+            if(strspn(argv[i] + strlen("--max-steps=") , "0123456789") != strlen(argv[i] + strlen("--max-steps=")) || sim->max_steps == 0){
+                fprintf(stderr , "Error: Invalid number of steps, it must be a positive number\n");
+                status = 1;
+            }
+        }
+        else if(strcmp(argv[i] , "--no-fuse") == 0){
+            sim->fuse = 0;
+        }
+        else if(strncmp(argv[i] , "--inputs=" , strlen("--inputs=")) == 0 && argv[i][strlen("--inputs=")] != '\0'){
+            inputs = argv[i] + strlen("--inputs=");
+        }
+        else if(strcmp(argv[i] , "-j") == 0 && i + 1 < (unsigned int)argc){
+            batch.jobs = atoi(argv[++i]);
+            if(strspn(argv[i] , "0123456789") != strlen(argv[i]) || batch.jobs < 1 || batch.jobs > SIM_MAX_JOBS){
+                fprintf(stderr , "Error: Invalid number of jobs, it must be between 1 and %d\n" , SIM_MAX_JOBS);
+                status = 1;
+            }
+        }
+        else if(strncmp(argv[i] , "--save=" , strlen("--save=")) == 0 && argv[i][strlen("--save=")] != '\0'){
+            save = argv[i] + strlen("--save=");
+        }
+        else if(strncmp(argv[i] , "--restore=" , strlen("--restore=")) == 0 && argv[i][strlen("--restore=")] != '\0'){
+            restore = argv[i] + strlen("--restore=");
+        }
+        else if(strcmp(argv[i] , "--jit") == 0){
+            use_jit = 1;
+        }
+        else if(strcmp(argv[i] , "--dump") == 0){
+            dump = 1;
+        }
+        else if(strcmp(argv[i] , "--stats") == 0){
+            stats = 1;
+        }
+        else if(strcmp(argv[i] , "--profile") == 0){
+            profile = 1;
+        }
+        else if(name == NULL && argv[i][0] != '-'){
+            name = argv[i];
+        }
+        else{
+            status = 1;
+        }
+    }
+    if((name == NULL) == (restore == NULL) || status != 0 || (inputs != NULL && (dump || stats || profile || save != NULL)) || (restore != NULL && (entry != NULL || profile))){
+        fprintf(stderr , "Usage: %s [--entry=SYM] [--max-steps=N] [--no-fuse] [--jit] [--dump] [--stats] [--profile] [--inputs=LIST [-j N]] [--save=FILE] NAME|--restore=FILE\n" , argv[0]);
+        free(sim);
+        return 1;
+    }
+
+    memset(&image , 0 , sizeof(image));
+    if(restore != NULL){
+        if(read_Snapshot(&snapshot , restore) != 0){
+            fprintf(stderr , "Error: Failed to read the snapshot %s\n" , restore);
+            status = 1;
+        }
+        else{
+            restore_Snapshot(sim , &snapshot);
+        }
+    }
+    else if(read_Object(name , &image) != 0){
+        fprintf(stderr , "Error: Failed to read the object %s\n" , name);
+        status = 1;
+    }
+    else if(image.extern_count != 0){
+        fprintf(stderr , "Error: %s refers to the extern %s, link it first\n" , name , image.extern_names[0]);
+        status = 1;
+    }
+    else if(load_Simulator(sim , &image) != 0){
+        fprintf(stderr , "Error: %s does not fit in the memory\n" , name);
+        status = 1;
+    }
+    /* The load address, or the pc of the snapshot */
+    start = sim->pc;
+    if(status == 0 && entry != NULL){
+        for(i = 0 ; i < image.entry_count && strcmp(image.entry_names[i] , entry) != 0 ; i++);
+        if(i == image.entry_count){
+            fprintf(stderr , "Error: %s has no entry %s\n" , name , entry);
+            status = 1;
+        }
+        else{
+            start = image.entry_addresses[i];
+        }
+    }
+
+    if(status == 0 && inputs != NULL){
+        /* The runs start from copies of the loaded machine; each worker makes its own JIT */
+        if(use_jit && (jit = create_Jit(sim)) == NULL){
+            fprintf(stderr , "Error: The JIT is not available on this host\n");
+            status = 1;
+        }
+        else if(read_Batch_List(inputs , &batch) != 0){
+            status = 1;
+        }
+        else{
+            batch.sim = sim;
+            batch.start = start;
+            batch.use_jit = use_jit;
+            status = run_Sim_Batch(&batch);
+        }
+        free_Sim_Batch(&batch);
+        free_Jit(jit);
+        free_Object_Image(&image);
+        free(sim);
+        return status;
+    }
+    if(status == 0 && use_jit){
+        jit = create_Jit(sim);
+        if(jit == NULL){
+            fprintf(stderr , "Error: The JIT is not available on this host\n");
+            status = 1;
+        }
+    }
+    if(status == 0 && profile){
+        /* The next runs read the characters the first one read, the output of the first one is thrown away */
+        input = tmpfile();
+        sink = fopen("/dev/null" , "w");
+        if(input == NULL || sink == NULL){
+            fprintf(stderr , "Error: Failed to open the files of the profile\n");
+            status = 1;
+        }
+        else{
+            sim->record = input;
+            sim->output = sink;
+            sim->fuse = 0;
+            load_Simulator(sim , &image);
+            gettimeofday(&begin , NULL);
+            run_Simulator(sim , start);
+            gettimeofday(&end , NULL);
+            baseline = (end.tv_sec - begin.tv_sec) + (end.tv_usec - begin.tv_usec) / 1000000.0;
+            baseline_steps = sim->steps;
+
+            rewind(input);
+            sim->input = input;
+            sim->record = NULL;
+            sim->output = stdout;
+            sim->fuse = 1;
+            load_Simulator(sim , &image);
+        }
+    }
+    if(status != 0){
+        free_Jit(jit);
+        free_Object_Image(&image);
+        if(input != NULL){
+            fclose(input);
+        }
+        if(sink != NULL){
+            fclose(sink);
+        }
+        free(sim);
+        return 1;
+    }
+
+    if(restore != NULL){
+        skip_Input(sim->input , sim->input_read);
+    }
+    gettimeofday(&begin , NULL);
+    result = (jit != NULL) ? run_Jit(jit , start) : run_Simulator(sim , start);
+    gettimeofday(&end , NULL);
+    fflush(sim->output);
+    seconds = (end.tv_sec - begin.tv_sec) + (end.tv_usec - begin.tv_usec) / 1000000.0;
+    if(save != NULL){
+        take_Snapshot(sim , &snapshot);
+        if(write_Snapshot(&snapshot , save) != 0){
+            fprintf(stderr , "Error: Failed to write the snapshot %s\n" , save);
+            status = 1;
+        }
+        else if(result == SIM_STEP_LIMIT){
+            /* The run stopped where it was meant to be saved */
+            result = SIM_HALTED;
+        }
+    }
+
+    switch(result){
+        case SIM_ILLEGAL_INSTRUCTION:
+            fprintf(stderr , "Error: Illegal instruction at address %u\n" , sim->pc);
+            break;
+        case SIM_STACK_OVERFLOW:
+            fprintf(stderr , "Error: Stack overflow at address %u\n" , sim->pc);
+            break;
+        case SIM_STACK_UNDERFLOW:
+            fprintf(stderr , "Error: rts with an empty stack at address %u\n" , sim->pc);
+            break;
+        case SIM_OUT_OF_MEMORY:
+            fprintf(stderr , "Error: The program ran past the end of memory\n");
+            break;
+        case SIM_STEP_LIMIT:
+            fprintf(stderr , "Error: The program did not stop after %lu instructions (at address %u)\n" , sim->steps , sim->pc);
+            break;
+    }
+    if(dump){
+        for(i = 0 ; i < SIM_REGISTERS ; i++){
+            fprintf(stderr , "r%u\t%d\n" , i , sim_Signed(sim->registers[i]));
+        }
+        fprintf(stderr , "pc\t%u\nsp\t%u\nzero\t%d\n" , sim->pc , sim->stack_pointer , sim->zero_flag != 0);
+    }
+    if(stats){
+        fprintf(stderr , "%lu instructions in %.3f seconds" , sim->steps , seconds);
+        if(seconds > 0){
+            fprintf(stderr , " (%.1f million per second)" , sim->steps / seconds / 1000000.0);
+        }
+        fprintf(stderr , "\n");
+        if(jit != NULL){
+            fprintf(stderr , "%lu blocks translated, %lu flushes\n" , jit->blocks , jit->flushes);
+        }
+    }
+    if(profile){
+        rewind(input);
+        sim->output = sink;
+        sim->count_pairs = 1;
+        load_Simulator(sim , &image);
+        run_Simulator(sim , start);
+        report_Profile(sim , baseline_steps , baseline , seconds);
+        fclose(input);
+        fclose(sink);
+    }
+    free_Object_Image(&image);
+    free_Jit(jit);
+
+    free(sim);
+    return result != SIM_HALTED || status != 0;
+}
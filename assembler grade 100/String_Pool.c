@@ -0,0 +1,193 @@
+#include "assembler.h"
+
+/**
+ * @brief Records a `.string` payload for string pooling.
+ *
+ * This function allocates a new STRING_POOL node holding the characters of the string
+ * in reverse order, so that a suffix of a string becomes a prefix of its reversed text,
+ * and appends it to the end of the list.
+ *
+ * @param string_list Pointer to the head of the STRING_POOL list.
+ * @param line The operand of the `.string` directive (including the quotes).
+ * @param address The data address of the first character of the string.
+ */
+void add_to_string_pool(STRING_POOL ** string_list , char * line , int address){
+    STRING_POOL * ptr = NULL;
+    STRING_POOL * new_node = generic_malloc(sizeof(STRING_POOL));
+    int i;
+
+    memset(new_node->reversed , '\0' , sizeof(new_node->reversed));
+    /* The characters lie between the opening quote and the closing quote */
+    new_node->length = strlen(line) - strlen("\"\"\n");
+    for(i = 0 ; i < new_node->length ; i++){
+        new_node->reversed[i] = line[new_node->length - i];
+    }
+    new_node->addr = address;
+    new_node->host = new_node;
+    new_node->next = NULL;
+
+    /* If the list is empty, set the new node as the head */
+    if(*string_list == NULL){
+        *string_list = new_node;
+        return;
+    }
+    /* Traverse the list to append the new node at the end */
+    ptr = *string_list;
+    while(ptr->next != NULL){
+        ptr = ptr->next;
+    }
+    ptr->next = new_node;
+}
+
+/**
+ * @brief Orders pooled strings by their reversed text.
+ *
+ * Used with `qsort` so that every string is directly followed by the strings it is a
+ * suffix of. Identical strings are ordered by decreasing address, which keeps the copy
+ * defined first.
+ *
+ * @param first Pointer to the first STRING_POOL pointer.
+ * @param second Pointer to the second STRING_POOL pointer.
+ * @return Negative, zero or positive like `strcmp`.
+ */
+int compare_Pooled_Strings(const void * first , const void * second){
+    STRING_POOL * first_string = *(STRING_POOL **)first;
+    STRING_POOL * second_string = *(STRING_POOL **)second;
+    int result = strcmp(first_string->reversed , second_string->reversed);
+
+    if(result == 0){
+        result = second_string->addr - first_string->addr;
+    }
+    return result;
+}
+
+/**
+ * @brief Counts the removed strings that start at or before a data address.
+ *
+ * This function performs a binary search over the sorted start addresses.
+ *
+ * @param starts Data addresses of the removed strings, in increasing order.
+ * @param count Number of removed strings.
+ * @param address The data address to look up.
+ * @return The number of entries of `starts` that are less than or equal to `address`.
+ */
+int pooled_Index(int * starts , int count , int address){
+    int low = 0 , high = count , middle;
+
+    while(low < high){
+        middle = (low + high) / 2;
+        if(starts[middle] <= address){
+            low = middle + 1;
+        }
+        else{
+            high = middle;
+        }
+    }
+    return low;
+}
+
+/**
+ * @brief Shares identical `.string` payloads and suffixes in the data image.
+ *
+ * The recorded strings are sorted by their reversed text, so a string that is equal to or
+ * a suffix of another string sorts right before it. Walking the sorted strings from the
+ * end, every such string is attached to the string that holds it (its host), and its words
+ * are removed from the data image. The remaining data words are moved down to close the
+ * gaps, labels of a removed string point into its host, the other data labels are moved
+ * like the words they point at, and the data counter is reduced by the removed words.
+ *
+ * This must run before `relocate_Data_Labels`, while data labels still hold data addresses.
+ *
+ * @param assembler Pointer to the assembler table.
+ * @param DC Pointer to the data counter, reduced by the number of removed words.
+ */
+void pool_Strings(ASSEMBLER_TABLE * assembler , int * DC){
+    STRING_POOL ** sorted = NULL , ** removed_strings = NULL;
+    STRING_POOL * ptr = NULL , * host = NULL;
+    MACHINE_CODE_INSTRUCTION ** node = NULL , * temp = NULL;
+    LABEL_LIST * label = NULL;
+    int * starts = NULL , * removed_before = NULL;
+    int count = 0 , removed_count = 0 , removed = 0 , i , k;
+
+    /* Count the recorded strings */
+    for(ptr = assembler->string_head ; ptr != NULL ; ptr = ptr->next){
+        count++;
+    }
+    if(count < 2){
+        return;
+    }
+
+    /* Sort the strings by their reversed text */
+    sorted = generic_malloc(count * sizeof(STRING_POOL *));
+    for(i = 0 , ptr = assembler->string_head ; ptr != NULL ; ptr = ptr->next , i++){
+        sorted[i] = ptr;
+    }
+    qsort(sorted , count , sizeof(STRING_POOL *) , compare_Pooled_Strings);
+
+    /* A string whose reversed text is a prefix of the next one is a suffix of it */
+    sorted[count - 1]->host = sorted[count - 1];
+    for(i = count - 2 ; i >= 0 ; i--){
+        if(sorted[i]->length <= sorted[i + 1]->length && strncmp(sorted[i]->reversed , sorted[i + 1]->reversed , sorted[i]->length) == 0){
+            sorted[i]->host = sorted[i + 1]->host;
+        }
+        else{
+            sorted[i]->host = sorted[i];
+        }
+    }
+    free(sorted);
+
+    /* Collect the removed strings in address order, with the words removed before each one */
+    starts = generic_malloc((count + 1) * sizeof(int));
+    removed_before = generic_malloc((count + 1) * sizeof(int));
+    removed_strings = generic_malloc(count * sizeof(STRING_POOL *));
+    for(ptr = assembler->string_head ; ptr != NULL ; ptr = ptr->next){
+        if(ptr->host != ptr){
+            starts[removed_count] = ptr->addr;
+            removed_before[removed_count] = removed;
+            removed_strings[removed_count] = ptr;
+            removed += ptr->length + 1;
+            removed_count++;
+        }
+    }
+    removed_before[removed_count] = removed;
+
+    if(removed_count > 0){
+        /* Drop the words of removed strings and move the other words down */
+        node = &(assembler->instruction_head);
+        while(*node != NULL){
+            k = pooled_Index(starts , removed_count , (*node)->addr);
+            if(k > 0 && (*node)->addr < starts[k - 1] + removed_strings[k - 1]->length + 1){
+                temp = *node;
+                *node = temp->next;
+                free(temp);
+            }
+            else{
+                (*node)->addr -= removed_before[k];
+                node = &((*node)->next);
+            }
+        }
+
+        /* Move the data labels along with their words */
+        for(label = assembler->label_head ; label != NULL ; label = label->next){
+            if(is_Data_Label(label) == FALSE){
+                continue;
+            }
+            k = pooled_Index(starts , removed_count , label->addr);
+            if(k > 0 && label->addr == starts[k - 1]){
+                /* The label of a removed string points at the end of its host */
+                host = removed_strings[k - 1]->host;
+                label->addr = host->addr - removed_before[pooled_Index(starts , removed_count , host->addr)];
+                label->addr += host->length - removed_strings[k - 1]->length;
+            }
+            else{
+                label->addr -= removed_before[k];
+            }
+        }
+
+        (*DC) -= removed;
+    }
+
+    free(starts);
+    free(removed_before);
+    free(removed_strings);
+}
@@ -8,9 +8,9 @@
  * 
  * @param binary_code The binary code to be converted and printed.
  * @param addr The address associated with the binary code.
- * @param fp_file Pointer to the file where the output will be printed.
+ * @param fp_file Pointer to the output file where the output will be printed.
  */
-void print_dec_to_file_in_octal(unsigned short binary_code , int addr , FILE * fp_file){
+void print_dec_to_file_in_octal(unsigned short binary_code , int addr , OUTPUT_FILE * fp_file){
     /* Allocate memory for the result string */
     char * result = generic_malloc(MAX_FILE_LINE_LENGTH);
     memset(result , '\0' , MAX_FILE_LINE_LENGTH);
@@ -22,7 +22,7 @@ void print_dec_to_file_in_octal(unsigned short binary_code , int addr , FILE * f
     sprintf(result , "0%d\t%05o\n" , addr , binary_code );
 
     /* Write the formatted string to the output file */
-    fprintf(fp_file , "%s" , result);
+    output_write(fp_file , result);
 
     /* Free the allocated memory */
     free(result);
@@ -34,7 +34,8 @@ void print_dec_to_file_in_octal(unsigned short binary_code , int addr , FILE * f
  * 
  * This function processes the machine code instructions and commands, and writes them into the 
  * object file (.ob) in octal format. It calculates the instruction count (IC) and data count (DC) 
- * for the file header.
+ * for the file header. Runs recorded by `.fill`/`.zero` and blocks copied by `.incbin`
+ * are expanded here, one word per address.
  * 
  * @param instruction_list Pointer to the list of machine code instructions.
  * @param command_list Pointer to the list of machine code commands.
@@ -43,34 +44,187 @@ void print_dec_to_file_in_octal(unsigned short binary_code , int addr , FILE * f
  * @param DC Data count.
  */
 void process_ob_file(MACHINE_CODE_INSTRUCTION *instruction_list , MACHINE_CODE_COMMAND * command_list ,char * ob_file, int IC , int DC){
-    FILE * ob_ptr;
+    OUTPUT_FILE ob_output;
+    OUTPUT_FILE * ob_ptr = &ob_output;
+    char header[MAX_FILE_LINE_LENGTH];
+    int i;
 
-    /* Open the object file for writing */
-    ob_ptr = fopen(ob_file , "w");
-    /* Check if the file opened successfully */
-    if(ob_ptr == NULL){
-        print_error(FAILED_TO_OPEN_FILE , NO_LINE);
-        exit(1);
-    }
+    /* Collect the object file, it is written only if it changed */
+    output_open(ob_ptr);
     /* Write the instruction count and data count to the file */
-    fprintf(ob_ptr,"\n\t%d %d\n" , IC - 100 , DC - 1);
+    sprintf(header , "\n\t%d %d\n" , IC - 100 , DC - 1);
+    output_write(ob_ptr , header);
     
     /* Write the commands to the file in octal format */
     while(command_list != NULL){
         print_dec_to_file_in_octal(command_list->binary_code.mila , command_list->addr , ob_ptr);
         command_list = command_list->next;
     }
-    /* Write the instructions to the file in octal format */
+    /* Write the instructions to the file in octal format, expanding .fill/.zero runs and .incbin blocks */
     while(instruction_list != NULL){
-        print_dec_to_file_in_octal(instruction_list->mila.mila , instruction_list->addr + IC - 1  , ob_ptr);
+        for(i = 0 ; i < instruction_list->count ; i++){
+            if(instruction_list->words != NULL){
+                print_dec_to_file_in_octal(instruction_list->words[i].mila , instruction_list->addr + i + IC - 1  , ob_ptr);
+            }
+            else{
+                print_dec_to_file_in_octal(instruction_list->mila.mila , instruction_list->addr + i + IC - 1  , ob_ptr);
+            }
+        }
         instruction_list = instruction_list->next;
     }
     /* Close the object file */
-    fclose(ob_ptr);
+    output_close(ob_ptr , ob_file);
     /* Free the memory for the object file name */
     free(ob_file);
 }
 
+/**
+ * @brief Processes the binary object (.obj) file: the words, entries and extern references of the .ob, .ent and .ext files.
+ * 
+ * The words are placed by address, with the sign bit removed as in the .ob file, and
+ * every entry and extern address becomes one symbol, in the order of the .ent and .ext
+ * lines. The file is written only if it changed, like the text outputs.
+ * 
+ * @param assembler Pointer to the assembler table structure.
+ * @param obj_file Name of the binary object file to be written.
+ * @param IC Instruction count.
+ * @param DC Data count.
+ */
+void process_obj_file(ASSEMBLER_TABLE * assembler , char * obj_file , int IC , int DC){
+    OUTPUT_FILE obj_output;
+    OBJECT_IMAGE image;
+    MACHINE_CODE_COMMAND * command_list = assembler->command_head;
+    MACHINE_CODE_INSTRUCTION * instruction_list = assembler->instruction_head;
+    ENTRY_LIST * ent_list = NULL;
+    EXTERN_LIST * ext_list = NULL;
+    ADDRESS_LIST * addr_ptr = NULL;
+    unsigned short sign_mask = (unsigned short)~(1U << ((sizeof(unsigned short) * 8) - 1));
+    unsigned int index , count;
+    char * data = NULL;
+    long size;
+    int i;
+
+    image.load_address = OBJECT_LOAD_ADDRESS;
+    image.code_count = IC - 100;
+    image.data_count = DC - 1;
+    image.words = generic_malloc(sizeof(unsigned short) * (image.code_count + image.data_count + 1));
+    memset(image.words , 0 , sizeof(unsigned short) * (image.code_count + image.data_count + 1));
+
+    /* Place the commands and the data words by address */
+    while(command_list != NULL){
+        index = command_list->addr - image.load_address;
+        if(index < image.code_count + image.data_count){
+            image.words[index] = command_list->binary_code.mila & sign_mask;
+        }
+        command_list = command_list->next;
+    }
+    while(instruction_list != NULL){
+        for(i = 0 ; i < instruction_list->count ; i++){
+            index = instruction_list->addr + i + IC - 1 - image.load_address;
+            if(index < image.code_count + image.data_count){
+                image.words[index] = ((instruction_list->words != NULL) ? instruction_list->words[i].mila : instruction_list->mila.mila) & sign_mask;
+            }
+        }
+        instruction_list = instruction_list->next;
+    }
+
+    /* One symbol for each line of the .ent and .ext files */
+    count = 0;
+    for(ent_list = assembler->entry_head ; ent_list != NULL ; ent_list = ent_list->next){
+        for(addr_ptr = ent_list->addr_list ; addr_ptr != NULL ; addr_ptr = addr_ptr->next){
+            count++;
+        }
+    }
+    image.entry_count = count;
+    image.entry_names = generic_malloc(sizeof(char *) * (count + 1));
+    image.entry_addresses = generic_malloc(sizeof(unsigned int) * (count + 1));
+    count = 0;
+    for(ent_list = assembler->entry_head ; ent_list != NULL ; ent_list = ent_list->next){
+        for(addr_ptr = ent_list->addr_list ; addr_ptr != NULL ; addr_ptr = addr_ptr->next){
+            image.entry_names[count] = ent_list->label;
+            image.entry_addresses[count++] = addr_ptr->addr;
+        }
+    }
+    count = 0;
+    for(ext_list = assembler->extern_head ; ext_list != NULL ; ext_list = ext_list->next){
+        for(addr_ptr = ext_list->addr_list ; addr_ptr != NULL ; addr_ptr = addr_ptr->next){
+            count++;
+        }
+    }
+    image.extern_count = count;
+    image.extern_names = generic_malloc(sizeof(char *) * (count + 1));
+    image.extern_addresses = generic_malloc(sizeof(unsigned int) * (count + 1));
+    count = 0;
+    for(ext_list = assembler->extern_head ; ext_list != NULL ; ext_list = ext_list->next){
+        for(addr_ptr = ext_list->addr_list ; addr_ptr != NULL ; addr_ptr = addr_ptr->next){
+            image.extern_names[count] = ext_list->label;
+            image.extern_addresses[count++] = addr_ptr->addr;
+        }
+    }
+
+    data = object_Encode(&image , &size);
+    if(data == NULL){
+        print_error(MEMORY_ALLOCATION_FAILED , NO_LINE);
+        exit(1);
+    }
+
+    /* Collect the binary object file, it is written only if it changed */
+    output_open(&obj_output);
+    output_append(&obj_output , data , size);
+    output_close(&obj_output , obj_file);
+
+    free(data);
+    free(image.words);
+    free(image.entry_names);
+    free(image.entry_addresses);
+    free(image.extern_names);
+    free(image.extern_addresses);
+    free(obj_file);
+}
+
+/**
+ * @brief Processes the relocation table (.rel): the address of every relocatable (R) word of the object file.
+ * 
+ * The second pass marks with R each word holding the address of a label of the file, the
+ * only words that change when the file is placed at another address. Their addresses are
+ * written in increasing order, one per line, so a linker or loader can rebase the object
+ * by patching only these words. If there are none, the file is removed.
+ * 
+ * @param command_list Pointer to the list of machine code commands.
+ * @param rel_file Name of the relocation file to be written.
+ */
+void process_rel_file(MACHINE_CODE_COMMAND * command_list , char * rel_file){
+    OUTPUT_FILE rel_output;
+    OUTPUT_FILE * rel_ptr = &rel_output;
+    int is_empty_file = TRUE;
+    char rel_line[MAX_FILE_LINE_LENGTH];
+
+    /* Collect the relocation file, it is written only if it changed */
+    output_open(rel_ptr);
+
+    while(command_list != NULL){
+        if((command_list->binary_code.mila & (A | R | E)) == R){
+            sprintf(rel_line , "0%d\n" , command_list->addr);
+            output_write(rel_ptr , rel_line);
+            is_empty_file = FALSE;
+        }
+        command_list = command_list->next;
+    }
+
+    /* Remove the file if it's empty */
+    if(is_empty_file == FALSE){
+        output_close(rel_ptr , rel_file);
+    }
+    else{
+        if( output_discard(rel_ptr , rel_file) == FALSE ){  
+            print_error(FAILED_TO_REMOVE_FILE , NO_LINE);
+            exit(1);
+        }
+    }
+
+    free(rel_file);
+}
+
 /**
  * @brief Processes the entry (.ent) file by writing the list of entries and their addresses.
  * 
@@ -81,20 +235,15 @@ void process_ob_file(MACHINE_CODE_INSTRUCTION *instruction_list , MACHINE_CODE_C
  * @param ent_file Name of the entry file to be written.
  */
 void process_ent_file(ENTRY_LIST *ent_list ,char * ent_file){
-    FILE * ent_ptr;
+    OUTPUT_FILE ent_output;
+    OUTPUT_FILE * ent_ptr = &ent_output;
     ADDRESS_LIST * addr_ptr = NULL;
     int is_empty_file = TRUE;
     char ent_line[MAX_FILE_LINE_LENGTH];
     memset(ent_line , '\0',sizeof(ent_line));
 
-    /* Open the entry file for writing */
-    ent_ptr = fopen(ent_file , "w");
-
-    /* Check if the file opened successfully */
-    if(ent_ptr == NULL){
-        print_error(FAILED_TO_OPEN_FILE , NO_LINE);
-        exit(1);
-    }
+    /* Collect the entry file, it is written only if it changed */
+    output_open(ent_ptr);
 
     /* Process each entry and its addresses */
     while(ent_list != NULL){
@@ -102,7 +251,8 @@ void process_ent_file(ENTRY_LIST *ent_list ,char * ent_file){
         while(addr_ptr != NULL){
             /* Format the entry line and write it to the file */
             sprintf(ent_line ,"%s\t0%d\n", ent_list->label , addr_ptr->addr );
-            fprintf(ent_ptr, "%s ", ent_line );
+            strcat(ent_line , " ");
+            output_write(ent_ptr , ent_line);
             is_empty_file = FALSE;
 
             memset(ent_line , '\0',sizeof(ent_line));
@@ -112,11 +262,12 @@ void process_ent_file(ENTRY_LIST *ent_list ,char * ent_file){
         ent_list = ent_list->next;
     }
 
-    fclose(ent_ptr);
-
     /* Remove the file if it's empty */
-    if(is_empty_file == TRUE){
-        if( remove(ent_file) != 0 ){  
+    if(is_empty_file == FALSE){
+        output_close(ent_ptr , ent_file);
+    }
+    else{
+        if( output_discard(ent_ptr , ent_file) == FALSE ){  
             print_error(FAILED_TO_REMOVE_FILE , NO_LINE);
             exit(1);
         }
@@ -136,19 +287,15 @@ void process_ent_file(ENTRY_LIST *ent_list ,char * ent_file){
  * @param ext_file Name of the external file to be written.
  */
 void process_ext_file(EXTERN_LIST *ext_list ,char * ext_file){
-    FILE * ext_ptr;
+    OUTPUT_FILE ext_output;
+    OUTPUT_FILE * ext_ptr = &ext_output;
     ADDRESS_LIST * addr_ptr = NULL;
     int is_empty_file = TRUE;
     char ext_line[MAX_FILE_LINE_LENGTH];
     memset(ext_line , '\0' , sizeof(ext_line));
 
-    /* Open the external file for writing */
-    ext_ptr = fopen(ext_file , "w");
-
-    if(ext_ptr == NULL){
-        print_error(FAILED_TO_OPEN_FILE , NO_LINE);
-        exit(1);
-    }
+    /* Collect the external file, it is written only if it changed */
+    output_open(ext_ptr);
     
     /* Process each external label and its addresses */
     while(ext_list != NULL){
@@ -156,7 +303,8 @@ void process_ext_file(EXTERN_LIST *ext_list ,char * ext_file){
         while(addr_ptr != NULL){
             /* Format the external line and write it to the file */
             sprintf(ext_line,"%s\t0%d\n", ext_list->label , addr_ptr->addr);
-            fprintf(ext_ptr, "%s ", ext_line );
+            strcat(ext_line , " ");
+            output_write(ext_ptr , ext_line);
             is_empty_file = FALSE;
             
             memset(ext_line , '\0' , sizeof(ext_line));
@@ -165,11 +313,12 @@ void process_ext_file(EXTERN_LIST *ext_list ,char * ext_file){
         ext_list = ext_list->next;
     }
 
-    fclose(ext_ptr);
-
     /* Remove the file if it's empty */
-    if(is_empty_file == TRUE){
-        if( remove(ext_file) != 0 ){  
+    if(is_empty_file == FALSE){
+        output_close(ext_ptr , ext_file);
+    }
+    else{
+        if( output_discard(ext_ptr , ext_file) == FALSE ){  
             print_error(FAILED_TO_REMOVE_FILE , NO_LINE);
             exit(1);
         }
@@ -183,6 +332,10 @@ void process_ext_file(EXTERN_LIST *ext_list ,char * ext_file){
  * 
  * This function calls the respective functions to process the object (.ob), entry (.ent), and external (.ext) files. 
  * It takes the assembler table, file name, instruction count (IC), and data count (DC) as input.
+ * With `--binary`, the binary object file (.obj) is written as well, and with `--relocatable` the relocation table (.rel).
+ * Without `--relocatable`, a relocation table left by an earlier run is removed.
+ * A file whose content did not change is not rewritten, so its modification time is kept;
+ * a changed file is written to a temporary file that is renamed over the old one.
  * 
  * @param assembler Pointer to the assembler table structure.
  * @param file_name Name of the file being processed.
@@ -196,5 +349,12 @@ void translationunit(ASSEMBLER_TABLE ** assembler , char *file_name , int IC , i
     process_ent_file( (*assembler)->entry_head , add_suffix(file_name , ".ent") );
     /* Process the external file (.ext) */
     process_ext_file( (*assembler)->extern_head , add_suffix(file_name , ".ext") );
-    
+    /* Process the binary object file (.obj) when asked for */
+    if((*assembler)->options->binary == TRUE){
+        process_obj_file(*assembler , add_suffix(file_name , OBJECT_EXTENSION) , IC , DC);
+    }
+    /* Process the relocation table (.rel) when asked for; otherwise an empty table removes
+     * that of an earlier run, which the linker would still read with the new object */
+    process_rel_file(((*assembler)->options->relocatable == TRUE) ? (*assembler)->command_head : NULL ,
+                     add_suffix(file_name , RELOCATION_EXTENSION));
 }
\ No newline at end of file
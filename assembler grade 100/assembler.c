@@ -1,40 +1,387 @@
 #include "assembler.h"
 
+/**
+ * @brief Applies a single command line option to the options of the run.
+ *
+ * Supported options:
+ * - `-p`, `--pool-strings`: share identical `.string` payloads and suffixes in the data image.
+ * - `--max-errors=N`: stop checking a file after N errors (0 for no limit).
+ * - `--diagnostics=text|json`: write the errors as text lines or as JSON lines.
+ * - `--compile-macros=FILE`: compile the macro definitions of the sources into the macro library FILE.
+ * - `--pipeline`: read, preprocess and parse each file in three concurrent threads.
+ * - `--stats`: report the utilization of each worker of the run.
+ * - `--async-io`: read the next source files ahead and write the output files asynchronously.
+ * - `--prefetch=N`: read N source files ahead (implies `--async-io`).
+ * - `--binary`: also write the binary object file (`.obj`).
+ * - `--relocatable`: also write the relocation table (`.rel`), the address of every relocatable word.
+ * - `--stdout`: write the output files as a framed bundle to stdout, and the errors to stderr.
+ * - `--archive=FILE`: also assemble the `.as` members of the tar archive FILE, read in place.
+ * - `--output-archive=FILE`: write the output files as members of the indexed archive FILE.
+ *
+ * The `-M FILE`, `-j N` and `-o -` options take their value from the next argument and are read by main.
+ *
+ * @param options Pointer to the options to update.
+ * @param option The command line argument (starting with '-').
+ * @return TRUE if the option is known, FALSE otherwise.
+ */
+BOOLEAN parse_Option(ASSEMBLER_OPTIONS * options , char * option){
+    if(strcmp(option , "-p") == 0 || strcmp(option , "--pool-strings") == 0){
+        options->pool_strings = TRUE;
+        return TRUE;
+    }
+    if(strncmp(option , "--max-errors=" , strlen("--max-errors=")) == 0){
+        option += strlen("--max-errors=");
+        /* The limit must be a non negative number */
+        if(*option == '\0' || strspn(option , "0123456789") != strlen(option) || strlen(option) > 9){
+            return FALSE;
+        }
+        options->max_errors = atoi(option);
+        return TRUE;
+    }
+    if(strcmp(option , "--diagnostics=text") == 0){
+        options->diagnostics_format = DIAGNOSTICS_TEXT;
+        return TRUE;
+    }
+    if(strcmp(option , "--diagnostics=json") == 0){
+        options->diagnostics_format = DIAGNOSTICS_JSON;
+        return TRUE;
+    }
+    if(strncmp(option , "--compile-macros=" , strlen("--compile-macros=")) == 0 && option[strlen("--compile-macros=")] != '\0'){
+        options->compile_macros = option + strlen("--compile-macros=");
+        return TRUE;
+    }
+    if(strcmp(option , "--pipeline") == 0){
+        options->pipeline = TRUE;
+        return TRUE;
+    }
+    if(strcmp(option , "--stats") == 0){
+        options->stats = TRUE;
+        return TRUE;
+    }
+    if(strcmp(option , "--stdout") == 0){
+        options->to_stdout = TRUE;
+        return TRUE;
+    }
+    if(strncmp(option , "--archive=" , strlen("--archive=")) == 0 && option[strlen("--archive=")] != '\0'){
+        options->source_archive = option + strlen("--archive=");
+        return TRUE;
+    }
+    if(strncmp(option , "--output-archive=" , strlen("--output-archive=")) == 0 && option[strlen("--output-archive=")] != '\0'){
+        options->result_archive = option + strlen("--output-archive=");
+        return TRUE;
+    }
+    if(strcmp(option , "--binary") == 0){
+        options->binary = TRUE;
+        return TRUE;
+    }
+    if(strcmp(option , "--relocatable") == 0){
+        options->relocatable = TRUE;
+        return TRUE;
+    }
+    if(strcmp(option , "--async-io") == 0){
+        options->async_io = TRUE;
+        return TRUE;
+    }
+    if(strncmp(option , "--prefetch=" , strlen("--prefetch=")) == 0){
+        option += strlen("--prefetch=");
+        if(*option == '\0' || strspn(option , "0123456789") != strlen(option) || strlen(option) > 2 || atoi(option) > MAX_PREFETCH_DEPTH){
+            return FALSE;
+        }
+        options->async_io = TRUE;
+        options->prefetch_depth = atoi(option);
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/**
+ * @brief Checks whether a command line option takes its value from the next argument.
+ *
+ * @param option The command line argument.
+ * @return TRUE for `-M`, `-j` and `-o`, FALSE otherwise.
+ */
+BOOLEAN takes_Value(char * option){
+    if(strcmp(option , "-M") == 0 || strcmp(option , "-j") == 0 || strcmp(option , "-o") == 0){
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/**
+ * @brief Checks whether a command line argument is an option.
+ *
+ * A lone '-' is not an option but the source read from standard input.
+ *
+ * @param argument The command line argument.
+ * @return TRUE if it starts with '-' and is not STDIN_NAME, FALSE for a source file.
+ */
+BOOLEAN is_Option(char * argument){
+    if(argument[0] == '-' && strcmp(argument , STDIN_NAME) != 0){
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/**
+ * @brief Reads ahead the source files of the run from a given file.
+ *
+ * Does nothing without asynchronous I/O.
+ *
+ * @param names Names of the source files, without the ".as" suffix.
+ * @param count Number of files.
+ * @param first Index of the first file to read ahead.
+ * @param depth Number of source files to read ahead.
+ */
+void prefetch_Files(char ** names , int count , int first , int depth){
+    int i;
+
+    for(i = first ; i < count && i < first + depth ; i++){
+        io_prefetch(names[i]);
+    }
+}
+
+/**
+ * @brief Assembles a single source file.
+ *
+ * Memory for the assembler table of the file is allocated here and freed once the file
+ * is done. The errors are collected in the current diagnostics buffer of the caller.
+ *
+ * @param file_name Name of the source file, without the ".as" suffix.
+ * @param options Options of the run.
+ */
+void assemble_File(char * file_name , ASSEMBLER_OPTIONS * options){
+    /* Allocate memory for the assembler table */
+    ASSEMBLER_TABLE * assembler_table = generic_malloc(sizeof(ASSEMBLER_TABLE));
+
+    /* Initialize the heads of various assembler lists to NULL */
+    assembler_table->macro_head = NULL;
+    memset(&assembler_table->macro_filter , 0 , sizeof(assembler_table->macro_filter));
+    assembler_table->label_head = NULL;
+    assembler_table->entry_head = NULL;
+    assembler_table->extern_head = NULL;
+    assembler_table->command_head = NULL;
+    assembler_table->instruction_head = NULL;
+    assembler_table->string_head = NULL;
+    assembler_table->options = options;
+    assembler_table->file_name = (strcmp(file_name , STDIN_NAME) != 0) ? file_name : NULL;
+
+    /* Start the preprocessor phase for the file */
+    Pre_Proc(&assembler_table , file_name);
+
+    /* Free the assembler table memory after processing */
+    free_assembler_table(&assembler_table);
+}
+
 /**
  * @brief Main function of the assembler program.
  * 
  * This function initializes the assembler table for each file passed as a command-line argument.
  * It then processes each file through the preprocessor phase. Memory for the assembler table is 
- * dynamically allocated for each file.
+ * dynamically allocated for each file. Arguments starting with '-' are options and apply to
+ * every file of the run. The errors of each file are collected while it is assembled and
+ * written together once the file is done. With `-M FILE` the precompiled macro library
+ * FILE is mapped once and shared by every file; with `--compile-macros=FILE` the sources
+ * are compiled into such a library instead of being assembled. With `-j N` the files are
+ * assembled by N work-stealing workers, largest file first. With `--stdout` (or `-o -`) no
+ * file is written: the outputs of each file go to stdout as a framed bundle, and a source
+ * named `-` is read from standard input. With `--archive=FILE` the sources inside the tar
+ * archive FILE are assembled too, except a member named like a source of the command
+ * line, which is read from disk instead, and with `--output-archive=FILE` the outputs of every
+ * file are written into the single indexed archive FILE.
  * 
  * @param argc Number of command-line arguments.
- * @param argv Array of command-line arguments, where each element represents a file name.
- * @return 0 on successful completion of the program.
+ * @param argv Array of command-line arguments, where each element represents a file name or an option.
+ * @return 0 on successful completion of the program, 1 if an output file or the output archive could not be written.
  */
 int main(int argc , char ** argv){
    int i;
-   ASSEMBLER_TABLE * assembler_table = NULL;
+   ASSEMBLER_OPTIONS options;
+   DIAGNOSTICS diagnostics;
+   char * macro_library_name = NULL;
+   MACRO_LIST * library_macros = NULL;
+   MACRO_FILTER library_filter;
+   BOOLEAN library_result = TRUE;
+   BOOLEAN written;
+   char ** file_names = NULL;
+   char ** archive_names = NULL;
+   char * file_name = NULL;
+   int file_count = 0 , archive_count;
+
+   /* Default options */
+   options.pool_strings = FALSE;
+   options.max_errors = NO_ERROR_LIMIT;
+   options.diagnostics_format = DIAGNOSTICS_TEXT;
+   options.compile_macros = NULL;
+   options.macro_library = NULL;
+   options.pipeline = FALSE;
+   options.jobs = 1;
+   options.stats = FALSE;
+   options.async_io = FALSE;
+   options.prefetch_depth = IO_PREFETCH_DEPTH;
+   options.binary = FALSE;
+   options.relocatable = FALSE;
+   options.to_stdout = FALSE;
+   options.source_archive = NULL;
+   options.result_archive = NULL;
+
+   /* Errors collected before a fatal error are written on exit */
+   open_diagnostics(&diagnostics);
+   /* The files are assembled one at a time here, so their errors can be written as they come */
+   diagnostics.streaming = TRUE;
+   atexit(flush_current_diagnostics);
+
+   /* Read the options before processing any file */
+   for(i = 1 ; i < argc  ; i++){
+        /* -M takes the name of the macro library from the next argument */
+        if(strcmp(argv[i] , "-M") == 0){
+            if(i + 1 >= argc){
+                print_error(MISSING_PARAMETER , NO_LINE);
+                exit(1);
+            }
+            macro_library_name = argv[++i];
+            continue;
+        }
+        /* -j takes the number of files assembled at once from the next argument */
+        if(strcmp(argv[i] , "-j") == 0){
+            if(i + 1 >= argc){
+                print_error(MISSING_PARAMETER , NO_LINE);
+                exit(1);
+            }
+            i++;
+            if(argv[i][0] == '\0' || strspn(argv[i] , "0123456789") != strlen(argv[i]) || strlen(argv[i]) > 3 ||
+               atoi(argv[i]) < 1 || atoi(argv[i]) > MAX_JOBS){
+                print_error(INVALID_JOBS , NO_LINE);
+                exit(1);
+            }
+            options.jobs = atoi(argv[i]);
+            continue;
+        }
+        /* -o takes the output from the next argument, only stdout is supported */
+        if(strcmp(argv[i] , "-o") == 0){
+            if(i + 1 >= argc){
+                print_error(MISSING_PARAMETER , NO_LINE);
+                exit(1);
+            }
+            if(strcmp(argv[++i] , "-") != 0){
+                print_error(INVALID_OUTPUT , NO_LINE);
+                exit(1);
+            }
+            options.to_stdout = TRUE;
+            continue;
+        }
+        if(is_Option(argv[i]) == TRUE && parse_Option(&options , argv[i]) == FALSE){
+            print_error(UNKNOWN_OPTION , NO_LINE);
+            exit(1);
+        }
+   }
 
-   /* Iterate over each command line argument (file name)*/
+   /* The outputs are collected in bundles when they go to stdout or to an archive */
+   options.bundle_outputs = (options.to_stdout == TRUE || options.result_archive != NULL) ? TRUE : FALSE;
+
+   /* The outputs of standard input have no file to go to */
+   for(i = 1 ; i < argc && options.bundle_outputs == FALSE ; i++){
+        if(strcmp(argv[i] , STDIN_NAME) == 0 && takes_Value(argv[i - 1]) == FALSE){
+            print_error(STDIN_NEEDS_STDOUT , NO_LINE);
+            exit(1);
+        }
+   }
+
+   /* Compile the sources into a macro library instead of assembling them */
+   if(options.compile_macros != NULL){
+        memset(&library_filter , 0 , sizeof(library_filter));
+        for(i = 1 ; i < argc  ; i++){
+            if(is_Option(argv[i]) == TRUE || takes_Value(argv[i - 1]) == TRUE){
+                continue;
+            }
+            begin_diagnostics(&diagnostics , argv[i] , &options);
+            library_result += collect_Library_Macros(&library_macros , &library_filter , argv[i]);
+            flush_diagnostics(&diagnostics);
+        }
+        if(library_result == TRUE){
+            library_result = write_Macro_Library(library_macros , options.compile_macros);
+        }
+        free_Library_Macros(&library_macros);
+        free_diagnostics(&diagnostics);
+        return (library_result == TRUE) ? 0 : 1;
+   }
+
+   /* Start the I/O backend (io_uring, or the synchronous fallback) */
+   io_init(&options);
+
+   /* Map the macro library once for the whole run */
+   if(macro_library_name != NULL){
+        options.macro_library = load_Macro_Library(macro_library_name);
+        if(options.macro_library == NULL){
+            exit(1);
+        }
+   }
+
+   /* Index the input archive and create the output archive once for the whole run */
+   if(options.source_archive != NULL && open_Input_Archive(options.source_archive) == FALSE){
+        exit(1);
+   }
+   if(options.result_archive != NULL && open_Output_Archive(options.result_archive) == FALSE){
+        exit(1);
+   }
+
+   /* The sources of the command line, read from disk even when the input archive has a member of the same name */
+   for(i = 1 ; i < argc  ; i++){
+        if(is_Option(argv[i]) == FALSE && takes_Value(argv[i - 1]) != TRUE && strcmp(argv[i] , STDIN_NAME) != 0){
+            file_name = add_suffix(argv[i] , ".as");
+            hide_Archive_Member(file_name);
+            free(file_name);
+        }
+   }
+   /* Then the other sources of the input archive */
+   archive_count = archive_Source_Names(&archive_names);
+   file_names = generic_malloc((argc + archive_count) * sizeof(char *));
    for(i = 1 ; i < argc  ; i++){
-        /* Allocate memory for the assembler table */
-        assembler_table = generic_malloc(sizeof(ASSEMBLER_TABLE));
-         /* Initialize the heads of various assembler lists to NULL */
-        assembler_table->macro_head = NULL;
-        assembler_table->label_head = NULL;
-        assembler_table->entry_head = NULL;
-        assembler_table->extern_head = NULL;
-        assembler_table->command_head = NULL;
-        assembler_table->instruction_head = NULL;
-   
-        /* Start the preprocessor phase for the current file */
-        Pre_Proc( &assembler_table , argv[i]);
-        
-        /* Free the assembler table memory after processing */
-        free_assembler_table(&assembler_table);
-        
-    }
-    return 0;
+        if(is_Option(argv[i]) == FALSE && takes_Value(argv[i - 1]) != TRUE){
+            file_names[file_count++] = argv[i];
+        }
+   }
+   for(i = 0 ; i < archive_count ; i++){
+        file_names[file_count++] = archive_names[i];
+   }
+
+   /* Spread the files over a pool of workers */
+   if(options.jobs > 1 || options.stats == TRUE){
+        run_Batch(file_names , file_count , &options);
+   }
+   else{
+        /* Iterate over each source file */
+        for(i = 0 ; i < file_count ; i++){
+            /* Read the next source files while this one is assembled */
+            prefetch_Files(file_names , file_count , i , options.prefetch_depth);
+
+            /* Collect the errors of the current file */
+            begin_diagnostics(&diagnostics , file_names[i] , &options);
+
+            /* Assemble the current file */
+            assemble_File(file_names[i] , &options);
+
+            /* Write the errors of the file at once */
+            flush_diagnostics(&diagnostics);
+        }
+   }
+   free(file_names);
+   for(i = 0 ; i < archive_count ; i++){
+        free(archive_names[i]);
+   }
+   free(archive_names);
+
+    /* Wait for the output files still being written, and write the errors of those that failed, outside of any file */
+    begin_diagnostics(&diagnostics , "" , &options);
+    written = io_finish();
+    flush_diagnostics(&diagnostics);
+    free_diagnostics(&diagnostics);
+    if(close_Output_Archive() == FALSE){
+        written = FALSE;
+    }
+    close_Input_Archive();
+    free_include_cache();
+    unload_Macro_Library(&options.macro_library);
+    return (written == TRUE) ? 0 : 1;
 
 }/*End of main*/
 
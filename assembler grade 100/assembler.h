@@ -2,6 +2,17 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <limits.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <errno.h>
+#include "object.h"
 
 /*---------------Define  declaration start-------------------*/
 
@@ -17,6 +28,46 @@
 #define END_MACR 2
 #define EMPTY_LINE 3
 #define MACRO_CALL 4
+#define INCLUDE_DIRECTIVE 5
+
+/* Maximum nesting of .include directives */
+#define MAX_INCLUDE_DEPTH 8
+
+/* In-file pipeline */
+#define LINE_RING_SIZE 4096
+#define LINE_RING_WAKE (LINE_RING_SIZE / 2)
+#define TEXT_ARENA_BLOCK_SIZE 65536L
+
+/* Batch scheduler */
+#define MAX_JOBS 256
+
+/* Asynchronous I/O */
+#define IO_RING_ENTRIES 256
+#define IO_FILE_SLOTS 64
+#define IO_PREFETCH_DEPTH 4
+#define MAX_PREFETCH_DEPTH 64
+#define IO_READ 0
+#define IO_WRITE 1
+#define IO_PATH_LENGTH (MAX_FILE_LINE_LENGTH + 48)
+#define OUTPUT_COMPARE_BLOCK 65536
+
+/* Name of the source read from standard input */
+#define STDIN_NAME "-"
+
+/* Archives of sources (tar); the archive of results is described in object.h */
+#define TAR_BLOCK_SIZE 512
+#define TAR_NAME_LENGTH 257
+
+/* Size of the macro name Bloom filter */
+#define MACRO_FILTER_BITS 1024
+#define MACRO_FILTER_HASHES 3
+
+/* Number of segments the .am writer collects before writing them */
+#define AM_WRITER_SEGMENTS 1024
+
+/* Precompiled macro libraries */
+#define MACRO_LIBRARY_MAGIC "AMH1"
+#define MACRO_LIBRARY_MIN_BUCKETS 8
 
 /* Command and register count */
 #define TOTAL_COMMANDS 16
@@ -30,6 +81,9 @@
 #define IS_COMMAND 50
 #define UNDEFINED_INSTRUCTION 60
 #define IS_ERROR 70
+#define IS_FILL 80
+#define IS_ZERO 90
+#define IS_INCBIN 100
 
 /* Entry and Extern type definitions */
 #define ENTRY 0
@@ -67,9 +121,19 @@
 #define MIN_DATA_SIZE 2
 #define MIN_STR_SIZE 2
 #define MAX_ASCII_VALUE 127
+#define MEMORY_SIZE 4096
 
-/* Error messages */
+/* Diagnostics */
 #define NO_LINE -1
+#define NO_ERROR_LIMIT 0
+#define DIAGNOSTICS_TEXT 0
+#define DIAGNOSTICS_JSON 1
+#define MAX_DIAGNOSTIC_LENGTH 128
+#define MAX_DIAGNOSTIC_OUTPUT (6 * (MAX_FILE_LINE_LENGTH + MAX_DIAGNOSTIC_LENGTH) + 128)
+#define DIAGNOSTIC_CODE_CACHE 64
+#define DIAGNOSTICS_CHUNK 65536
+
+/* Error messages */
 #define FAILED_TO_OPEN_FILE "Failed to open file"
 #define MEMORY_ALLOCATION_FAILED "Failed to allocate memory"
 #define FAILED_TO_REMOVE_FILE "Failed to remove file"
@@ -101,16 +165,47 @@
 #define ALREADY_DEFINED_AS_ENTRY "Already defined entry"
 #define MISSING_LABEL "Missing label"
 #define FILE_LENGTH_EXCEED "Exceeded length for file"
+#define INVALID_FILL_COUNT "Invalid fill count"
+#define INVALID_INCBIN_OPERANDS "Invalid .incbin operands"
+#define FAILED_TO_OPEN_INCBIN_FILE "Failed to open included binary file"
+#define INCBIN_OUT_OF_RANGE "Offset or length beyond the end of the included file"
+#define UNKNOWN_OPTION "Unknown command line option"
+#define LABEL_NOT_DEFINED "Label is not defined"
+#define UNDEFINED_INSTRUCTION_NAME "Undefined instruction"
+#define TOO_MANY_ERRORS "Too many errors, stopped checking the file"
+#define FAILED_TO_WRITE_FILE "Failed to write file"
+#define INVALID_MACRO_LIBRARY "Invalid macro library file"
+#define NOT_A_MACRO_DEFINITION "Only macro definitions are allowed in a macro library"
+#define MISSING_END_OF_MACRO "Missing endmacr"
+#define INVALID_INCLUDE "Invalid .include directive"
+#define FAILED_TO_OPEN_INCLUDE_FILE "Failed to open included file"
+#define INCLUDE_TOO_DEEP "Too many nested .include directives"
+#define INCLUDED_FILE_HAS_ERRORS "Included file has errors"
+#define FAILED_TO_START_THREAD "Failed to start a thread"
+#define INVALID_JOBS "Invalid number of jobs"
+#define INVALID_OUTPUT "Invalid output, only - (standard output) is supported"
+#define STDIN_NEEDS_STDOUT "Standard input can only be assembled with --stdout or --output-archive"
+#define INVALID_ARCHIVE "Invalid archive"
+#define PROGRAM_TOO_LARGE "The program does not fit in memory"
 
 /*------------Define  declaration END----------------*/
 
 /*---------------Data structures declaration start-----------------*/
 
+/**
+ * @brief Enum for boolean values (TRUE/FALSE).
+ */
+typedef enum BOOLEAN{
+     TRUE, /* True value */
+     FALSE /* False value */
+}BOOLEAN;
+
 /**
  * @brief Struct for macro content lines.
  */
 typedef struct MACRO_CONTENT {
     char line[MAX_FILE_LINE_LENGTH]; /* Line of macro content */
+    int length; /* Length of the line */
     struct MACRO_CONTENT * next; /* Pointer to the next line */
 } MACRO_CONTENT;
 
@@ -120,15 +215,27 @@ typedef struct MACRO_CONTENT {
 typedef struct MACRO_LIST {
     char  macro_name [MAX_FILE_LINE_LENGTH]; /* Name of the macro */
     MACRO_CONTENT * head_content; /* Head of macro content */
+    BOOLEAN shared; /* TRUE if the content belongs to the include cache */
     struct MACRO_LIST * next; /* Pointer to the next macro */
 } MACRO_LIST;
 
+/**
+ * @brief Bloom filter of the macro names of a file.
+ *
+ * A line whose bits are not all set cannot be a macro call, so it is classified
+ * without searching the macro list.
+ */
+typedef struct MACRO_FILTER {
+    unsigned char bits[MACRO_FILTER_BITS / CHAR_BIT]; /* Bits set by the hashes of the macro names */
+} MACRO_FILTER;
+
 /**
  * @brief Struct for labels in the label list.
  */
 typedef struct LABEL_LIST{
     char label[MAX_LABEL_SIZE]; /* Label name */
-    int addr;  /* Address of the label */
+    int addr;  /* Address of the label (a data address until the end of the first pass for data labels) */
+    int type; /* Type of the line the label was defined on (IS_COMMAND, IS_DATA, ...) */
     struct LABEL_LIST * next; /* Pointer to the next label */
 } LABEL_LIST;
 
@@ -150,12 +257,100 @@ typedef struct EXTERN_LIST{
 } EXTERN_LIST;
 
 /**
- * @brief Enum for boolean values (TRUE/FALSE).
+ * @brief View of a line held by an earlier pipeline stage.
  */
-typedef enum BOOLEAN{
-     TRUE, /* True value */
-     FALSE /* False value */
-}BOOLEAN;
+typedef struct LINE_VIEW {
+    const char * text; /* First character of the line (not null terminated) */
+    int length; /* Number of characters of the line */
+} LINE_VIEW;
+
+/**
+ * @brief Bounded single-producer/single-consumer ring of line views.
+ *
+ * The producer adds views at `tail` and the consumer takes them at `head`, both under
+ * `lock`. A full ring makes the producer sleep on `not_full` (back-pressure) and an
+ * empty one makes the consumer sleep on `not_empty`. A sleeping side is only woken
+ * once LINE_RING_WAKE views (or slots) are ready, or the ring is closed or cancelled.
+ */
+typedef struct LINE_RING {
+    LINE_VIEW slots[LINE_RING_SIZE]; /* The views, indexed modulo LINE_RING_SIZE */
+    unsigned long head; /* Number of views taken by the consumer */
+    unsigned long tail; /* Number of views added by the producer */
+    int closed; /* Set by the producer after its last view */
+    int cancelled; /* Set by the consumer when it stops reading */
+    int producer_waiting; /* The producer sleeps on a full ring */
+    int consumer_waiting; /* The consumer sleeps on an empty ring */
+    pthread_mutex_t lock; /* Guards the counters and the flags */
+    pthread_cond_t not_full; /* Signalled when a slot is freed or the ring is cancelled */
+    pthread_cond_t not_empty; /* Signalled when a view is added or the ring is closed */
+} LINE_RING;
+
+/**
+ * @brief Block of an append-only text arena.
+ */
+typedef struct TEXT_BLOCK {
+    char * text; /* Characters of the block */
+    long used; /* Number of characters in use */
+    long size; /* Size of the block */
+    struct TEXT_BLOCK * next; /* Pointer to the next block */
+} TEXT_BLOCK;
+
+/**
+ * @brief Append-only storage keeping the lines viewed by the next pipeline stage alive.
+ */
+typedef struct TEXT_ARENA {
+    TEXT_BLOCK * head; /* First block */
+    TEXT_BLOCK * tail; /* Block being filled */
+} TEXT_ARENA;
+
+/**
+ * @brief Where a stage reads its lines from: a file, or the ring of the previous stage.
+ */
+typedef struct LINE_SOURCE {
+    FILE * fptr; /* File to read with fgets, or NULL */
+    char * text; /* Text to read when fptr is NULL (a prefetched file or an in-memory .am), or NULL */
+    long length; /* Length of the text */
+    long position; /* Position of the next line in the text */
+    LINE_RING * ring; /* Ring to read from when fptr and text are NULL */
+} LINE_SOURCE;
+
+/**
+ * @brief Writer of the `.am` file.
+ *
+ * The output is collected as segments referring to source lines and macro bodies,
+ * and written in batches with `writev`.
+ */
+typedef struct AM_WRITER {
+    int fd; /* Descriptor of the output file */
+    struct iovec segments[AM_WRITER_SEGMENTS]; /* Pending segments */
+    char * owned[AM_WRITER_SEGMENTS]; /* Pending text to free once written */
+    int count; /* Number of pending segments */
+    int owned_count; /* Number of pending text to free */
+    BOOLEAN failed; /* TRUE once a write failed */
+    char * buffer; /* Output of a memory writer (fd < 0) */
+    long length; /* Length of the output in the buffer */
+    long capacity; /* Size of the buffer */
+    LINE_RING * forward; /* Ring receiving the output as lines for the next stage, or NULL */
+    TEXT_ARENA * arena; /* Storage of the forwarded lines */
+    char partial[MAX_FILE_LINE_LENGTH]; /* Line being forwarded */
+    int partial_length; /* Length of the line being forwarded */
+} AM_WRITER;
+
+/**
+ * @brief A preprocessed included file, kept in the include cache of the process.
+ */
+typedef struct INCLUDE_FILE {
+    char path[MAX_FILE_LINE_LENGTH]; /* Path of the file as written in the directive */
+    time_t mtime; /* Modification time of the file when it was read */
+    long size; /* Size of the file when it was read */
+    BOOLEAN valid; /* TRUE if the file has no errors */
+    struct DIAGNOSTIC * errors; /* Errors of the file and of its own includes, labelled with their file */
+    int error_count; /* Number of errors */
+    char * text; /* Preprocessed lines of the file */
+    long length; /* Length of the preprocessed lines */
+    struct MACRO_LIST * macro_head; /* Macros declared in the file */
+    struct INCLUDE_FILE * next; /* Pointer to the next cached file */
+} INCLUDE_FILE;
 
 /**
  * @brief Struct for machine code word.
@@ -170,6 +365,7 @@ typedef struct MILA{
  */
 typedef struct MACHINE_CODE_COMMAND{
     int  addr; /* Address of the command */
+    int line; /* Source line the command was read from */
     MILA  binary_code;  /* Binary code for the command */
     char label[MAX_LABEL_SIZE];  /* Label associated with the command */
     int type;  /* Type of command */
@@ -182,21 +378,289 @@ typedef struct MACHINE_CODE_COMMAND{
 typedef struct MACHINE_CODE_INSTRUCTION{
     int addr;/* Address of the instruction */
     MILA  mila;/* Binary code (mila) */
+    int count;/* Number of consecutive words holding mila (1 unless recorded by .fill/.zero) */
+    MILA * words;/* Words copied from an .incbin file (count of them), or NULL */
     struct MACHINE_CODE_INSTRUCTION *next;/* Pointer to the next instruction */
 }MACHINE_CODE_INSTRUCTION;
 
+/**
+ * @brief Struct for a `.string` payload recorded for string pooling.
+ */
+typedef struct STRING_POOL{
+    char reversed[MAX_FILE_LINE_LENGTH]; /* Characters of the string in reverse order */
+    int length; /* Number of characters, without the terminating zero */
+    int addr; /* Data address of the first character */
+    struct STRING_POOL * host; /* Pooled string that holds this one as a suffix (itself if kept) */
+    struct STRING_POOL * next; /* Pointer to the next string */
+} STRING_POOL;
+
+/**
+ * @brief Header of a precompiled macro library file.
+ *
+ * The header is followed by `bucket_count` buckets, `macro_count` entries and the text
+ * area holding the names and bodies. Buckets and `next` hold an entry index plus one,
+ * with 0 ending a chain.
+ */
+typedef struct MACRO_LIBRARY_HEADER{
+    char magic[4]; /* MACRO_LIBRARY_MAGIC */
+    unsigned int bucket_count; /* Number of hash buckets (a power of two) */
+    unsigned int macro_count; /* Number of macros */
+    unsigned int text_offset; /* Offset of the text area from the start of the file */
+    unsigned int file_size; /* Size of the whole file */
+} MACRO_LIBRARY_HEADER;
+
+/**
+ * @brief Entry of a macro in a precompiled macro library.
+ */
+typedef struct MACRO_LIBRARY_ENTRY{
+    unsigned int name_offset; /* Offset of the null terminated name in the text area */
+    unsigned int name_length; /* Length of the name */
+    unsigned int body_offset; /* Offset of the body in the text area */
+    unsigned int body_length; /* Length of the body */
+    unsigned int next; /* Next entry of the bucket plus one, 0 at the end */
+} MACRO_LIBRARY_ENTRY;
+
+/**
+ * @brief A precompiled macro library mapped into memory.
+ */
+typedef struct MACRO_LIBRARY{
+    void * data; /* Start of the mapping */
+    long size; /* Size of the mapping */
+    MACRO_LIBRARY_HEADER * header; /* Header of the file */
+    unsigned int * buckets; /* Hash buckets */
+    MACRO_LIBRARY_ENTRY * entries; /* Macro entries */
+    char * text; /* Names and bodies */
+    MACRO_FILTER filter; /* Bloom filter of the names, built when the library is loaded */
+} MACRO_LIBRARY;
+
+/**
+ * @brief Command line options shared by every file of a run.
+ */
+typedef struct ASSEMBLER_OPTIONS{
+    BOOLEAN pool_strings; /* Share identical .string payloads and suffixes in the data image */
+    int max_errors; /* Number of errors after which checking a file stops (NO_ERROR_LIMIT for no limit) */
+    int diagnostics_format; /* DIAGNOSTICS_TEXT or DIAGNOSTICS_JSON */
+    char * compile_macros; /* Library file to compile the sources into, or NULL to assemble them */
+    MACRO_LIBRARY * macro_library; /* Macro library loaded with -M, shared by every file, or NULL */
+    BOOLEAN pipeline; /* Run reading, preprocessing and parsing of a file in three threads */
+    int jobs; /* Number of files assembled at once (-j) */
+    BOOLEAN async_io; /* Read the sources ahead and write the outputs asynchronously */
+    int prefetch_depth; /* Number of source files read ahead with async_io */
+    BOOLEAN stats; /* Report the utilization of each worker of a batch run */
+    BOOLEAN binary; /* Also write the binary object file (.obj) */
+    BOOLEAN relocatable; /* Also write the relocation table (.rel) */
+    BOOLEAN to_stdout; /* Write the output files as a framed bundle to stdout (--stdout or -o -) */
+    char * source_archive; /* Tar archive the sources are read from (--archive), or NULL */
+    char * result_archive; /* Archive the output files are written to (--output-archive), or NULL */
+    BOOLEAN bundle_outputs; /* Collect the output files in bundles (--stdout or --output-archive) */
+} ASSEMBLER_OPTIONS;
+
+/**
+ * @brief An output file (.ob, .ent, .ext), collected in memory and written only when it changed.
+ */
+typedef struct OUTPUT_FILE {
+    char * text; /* Collected output */
+    long length; /* Length of the collected output */
+    long capacity; /* Size of the text buffer */
+} OUTPUT_FILE;
+
+/**
+ * @brief Struct for a single diagnostic of a file.
+ */
+typedef struct DIAGNOSTIC{
+    int code; /* Error code (index of the message in the error table) */
+    int line; /* Line number, or NO_LINE */
+    char message[MAX_DIAGNOSTIC_LENGTH]; /* Error message, with details if any */
+    char file[MAX_FILE_LINE_LENGTH]; /* Included file the error is in, or empty for the file being assembled */
+} DIAGNOSTIC;
+
+/**
+ * @brief Buffer collecting the diagnostics of the file being assembled.
+ */
+typedef struct DIAGNOSTICS{
+    char file_name[MAX_FILE_LINE_LENGTH]; /* Name of the source file */
+    OUTPUT_FILE text; /* Collected diagnostics, already formatted */
+    int count; /* Number of collected diagnostics */
+    BOOLEAN streaming; /* TRUE to write the text every DIAGNOSTICS_CHUNK bytes (files assembled one at a time) */
+    int max_errors; /* Limit on the number of errors (NO_ERROR_LIMIT for no limit) */
+    int format; /* DIAGNOSTICS_TEXT or DIAGNOSTICS_JSON */
+    BOOLEAN limit_reached; /* TRUE once max_errors errors were collected */
+    FILE * stream; /* Stream the diagnostics are written to (stderr with --stdout) */
+    BOOLEAN bundle_outputs; /* TRUE to collect the output files in the bundle instead of writing them */
+    OUTPUT_FILE bundle; /* Framed output files, written to stdout with the diagnostics */
+    const char * code_messages[DIAGNOSTIC_CODE_CACHE]; /* Error messages whose code was looked up, by address */
+    int codes[DIAGNOSTIC_CODE_CACHE]; /* Codes of those messages */
+    BOOLEAN recording; /* TRUE to keep the diagnostics as entries instead of formatting them */
+    DIAGNOSTIC * entries; /* Kept diagnostics, when recording */
+    int capacity; /* Number of entries the array can hold */
+} DIAGNOSTICS;
+
 /**
  * @brief Assembler table containing macro, label, entry, extern, and machine code data.
  */
 typedef struct ASSEMBLER_TABLE {
     MACRO_LIST *  macro_head;  /* Head of macro list */
+    MACRO_FILTER macro_filter; /* Bloom filter of the macro names */
     LABEL_LIST *  label_head; /* Head of label list */
     ENTRY_LIST * entry_head; /* Head of entry list */
     EXTERN_LIST * extern_head; /* Head of extern list */
     MACHINE_CODE_COMMAND * command_head; /* Head of command list */
     MACHINE_CODE_INSTRUCTION * instruction_head; /* Head of instruction list */
+    STRING_POOL * string_head; /* Head of the .string payloads recorded for pooling */
+    ASSEMBLER_OPTIONS * options; /* Command line options of the run */
+    char * file_name; /* Name of the source file without suffix (.incbin paths are relative to it), or NULL */
 } ASSEMBLER_TABLE;
 
+/**
+ * @brief State shared by the stages of the in-file pipeline.
+ */
+typedef struct PIPELINE {
+    LINE_SOURCE * input; /* Source file, read by the reader stage */
+    ASSEMBLER_TABLE ** head_table; /* Assembler table of the file */
+    AM_WRITER * writer_am; /* Writer of the .am file, forwarding its lines to the parser */
+    LINE_RING * source_lines; /* Lines from the reader to the preprocessor */
+    LINE_RING * expanded_lines; /* Lines from the preprocessor to the parser */
+    TEXT_ARENA source_arena; /* Storage of the lines read by the reader */
+    TEXT_ARENA expanded_arena; /* Storage of the lines forwarded by the preprocessor */
+    DIAGNOSTICS * diagnostics; /* Diagnostics of the preprocessor (those of the file) */
+    BOOLEAN result; /* Result of the preprocessor */
+} PIPELINE;
+
+/**
+ * @brief An asynchronous read or write of a whole file.
+ */
+typedef struct IO_REQUEST {
+    int type; /* IO_READ or IO_WRITE */
+    char path[IO_PATH_LENGTH]; /* Path of the file */
+    char target[IO_PATH_LENGTH]; /* Path the written file is renamed to, or empty */
+    char * text; /* Text read (null terminated), or text to write */
+    long length; /* Length of the text */
+    int slot; /* Registered file slot used by the request, or -1 */
+    int pending; /* Completions still expected from the ring */
+    long result; /* Bytes transferred, or a negative error number */
+    BOOLEAN done; /* TRUE once the request completed */
+    struct IO_REQUEST * next; /* Next request in the same list */
+} IO_REQUEST;
+
+/**
+ * @brief The I/O backend of the process: an io_uring ring, or the synchronous fallback.
+ */
+typedef struct IO_BACKEND {
+    BOOLEAN enabled; /* TRUE when asynchronous I/O was asked for */
+    BOOLEAN uring; /* TRUE when the io_uring ring is set up */
+    int depth; /* Number of source files read ahead */
+    int ring_fd; /* File descriptor of the ring */
+    void * sq_ring; /* Mapped submission ring */
+    long sq_ring_size; /* Size of the submission ring mapping */
+    void * cq_ring; /* Mapped completion ring (the same mapping when the kernel allows it) */
+    long cq_ring_size; /* Size of the completion ring mapping */
+    void * sqes; /* Mapped submission entries */
+    long sqes_size; /* Size of the submission entries mapping */
+    unsigned * sq_tail; /* Tail of the submission ring */
+    unsigned * sq_mask; /* Index mask of the submission ring */
+    unsigned * sq_array; /* Index array of the submission ring */
+    unsigned * cq_head; /* Head of the completion ring */
+    unsigned * cq_tail; /* Tail of the completion ring */
+    unsigned * cq_mask; /* Index mask of the completion ring */
+    void * cqes; /* Completion entries */
+    int unsubmitted; /* Entries queued but not yet taken by the kernel */
+    int slot_used[IO_FILE_SLOTS]; /* 1 for registered file slots in use */
+    pthread_mutex_t lock; /* Guards the rings and the lists */
+    IO_REQUEST * prefetched; /* Source files read ahead */
+    IO_REQUEST * writes; /* Output files being written */
+    int failed_writes; /* Output files that could not be written */
+} IO_BACKEND;
+
+/**
+ * @brief A member of the input archive, read in place from the mapping.
+ */
+typedef struct ARCHIVE_MEMBER {
+    char name[TAR_NAME_LENGTH]; /* Path of the member */
+    const char * text; /* Content of the member, inside the mapping */
+    long size; /* Size of the content */
+} ARCHIVE_MEMBER;
+
+/**
+ * @brief The tar archive the sources are read from.
+ */
+typedef struct INPUT_ARCHIVE {
+    void * data; /* Mapping of the archive */
+    long size; /* Size of the mapping */
+    ARCHIVE_MEMBER * members; /* Regular files, in archive order */
+    int count; /* Number of members */
+    ARCHIVE_MEMBER ** sorted; /* Members sorted by name, for the lookups */
+    int sorted_count; /* Number of members found by the lookups */
+} INPUT_ARCHIVE;
+
+/**
+ * @brief The indexed archive the output files are written to.
+ *
+ * Layout (numbers are little-endian): a header of ARCHIVE_HEADER_SIZE bytes (magic,
+ * version, member count, reserved, 64-bit offset of the index), the contents of the
+ * members one after the other, then the index: for each member a 64-bit offset, a
+ * 64-bit length and a 32-bit name length, followed by the name.
+ */
+typedef struct OUTPUT_ARCHIVE {
+    FILE * fptr; /* The archive being written, or NULL */
+    char * path; /* Path of the archive */
+    long offset; /* Offset of the next member */
+    char ** names; /* Names of the members */
+    long * offsets; /* Offsets of the members */
+    long * lengths; /* Lengths of the members */
+    int count; /* Number of members */
+    int capacity; /* Size of the member arrays */
+    BOOLEAN failed; /* TRUE once a write failed */
+} OUTPUT_ARCHIVE;
+
+/**
+ * @brief A source file of a batch run.
+ */
+typedef struct BATCH_FILE {
+    char * name; /* Name of the file, without the ".as" suffix */
+    long size; /* Size of the source file in bytes (0 if it cannot be read) */
+    DIAGNOSTICS diagnostics; /* Errors of the file, written in command line order */
+    BOOLEAN done; /* TRUE once the file was assembled (guarded by the output lock) */
+} BATCH_FILE;
+
+/**
+ * @brief Double ended queue of files owned by a worker.
+ *
+ * The owner takes files from the head (largest first) and other workers steal from the tail.
+ */
+typedef struct WORK_QUEUE {
+    pthread_mutex_t lock; /* Guards head and tail */
+    BATCH_FILE ** files; /* Files of the queue, largest first */
+    int head; /* Index of the next file taken by the owner */
+    int tail; /* One past the index of the last file */
+} WORK_QUEUE;
+
+/**
+ * @brief A worker thread of a batch run, with its queue and its statistics.
+ */
+typedef struct WORKER {
+    struct SCHEDULER * scheduler; /* The scheduler of the run */
+    int id; /* Number of the worker */
+    pthread_t thread; /* Thread running the worker */
+    WORK_QUEUE queue; /* Files dealt to the worker */
+    int files_done; /* Number of files assembled */
+    int files_stolen; /* Number of those files stolen from other workers */
+    long bytes_done; /* Total size of the files assembled */
+    double busy_seconds; /* Time spent assembling files */
+} WORKER;
+
+/**
+ * @brief State of a batch run spread over several workers.
+ */
+typedef struct SCHEDULER {
+    ASSEMBLER_OPTIONS * options; /* Options of the run */
+    BATCH_FILE * files; /* Files of the run, in command line order */
+    int file_count; /* Number of files */
+    WORKER * workers; /* The workers */
+    int worker_count; /* Number of workers */
+    pthread_mutex_t output_lock; /* Guards the output of the diagnostics */
+    int next_output; /* First file whose diagnostics were not written yet */
+} SCHEDULER;
+
 typedef struct {
     const char *name;/* Name of the command */
     const int code;  /* Command code */
@@ -224,16 +688,64 @@ typedef enum Command_Codes{
 
 /*-----Data structures declaration END------*/
 
+/*-----------Function declaration in assembler.c--------------*/
+
+/**
+ * @brief Applies a single command line option to the options of the run.
+ *
+ * @param options Pointer to the options to update.
+ * @param option The command line argument (starting with '-').
+ * @return TRUE if the option is known, FALSE otherwise.
+ */
+BOOLEAN parse_Option(ASSEMBLER_OPTIONS * options , char * option);
+
+/**
+ * @brief Checks whether a command line option takes its value from the next argument.
+ *
+ * @param option The command line argument.
+ * @return TRUE for `-M`, `-j` and `-o`, FALSE otherwise.
+ */
+BOOLEAN takes_Value(char * option);
+
+/**
+ * @brief Checks whether a command line argument is an option.
+ *
+ * @param argument The command line argument.
+ * @return TRUE if it starts with '-' and is not STDIN_NAME, FALSE for a source file.
+ */
+BOOLEAN is_Option(char * argument);
+
+/**
+ * @brief Reads ahead the source files of the run from a given file.
+ *
+ * Does nothing without asynchronous I/O.
+ *
+ * @param names Names of the source files, without the ".as" suffix.
+ * @param count Number of files.
+ * @param first Index of the first file to read ahead.
+ * @param depth Number of source files to read ahead.
+ */
+void prefetch_Files(char ** names , int count , int first , int depth);
+
+/**
+ * @brief Assembles a single source file.
+ *
+ * @param file_name Name of the source file, without the ".as" suffix.
+ * @param options Options of the run.
+ */
+void assemble_File(char * file_name , ASSEMBLER_OPTIONS * options);
+
 /*-----------Function declaration pre processor--------------*/
 
 /**
  * @brief Adds a new macro to the macro list.
  * 
  * @param head Pointer to the head of the macro list.
+ * @param filter Bloom filter of the macro names, updated with the new name.
  * @param macro_name Name of the macro to be added.
  * @param head_content Pointer to the macro content.
  */
-void add_to_macro_list(MACRO_LIST ** head ,char * macro_name ,MACRO_CONTENT * head_content);
+void add_to_macro_list(MACRO_LIST ** head , MACRO_FILTER * filter ,char * macro_name ,MACRO_CONTENT * head_content);
 
 /**
  * @brief Adds a new line of content to the macro content list.
@@ -260,15 +772,53 @@ char * remove_white_spaces(char * line);
  */
 MACRO_LIST * find_macro(MACRO_LIST * head , char * name_to_find);
 
+/**
+ * @brief Computes the two base hashes of a macro name for the Bloom filter.
+ *
+ * @param name The macro name.
+ * @param first Receives the first base hash (FNV-1a).
+ * @param second Receives the second base hash (djb2, made odd).
+ */
+void macro_filter_hash(char * name , unsigned long * first , unsigned long * second);
+
+/**
+ * @brief Adds a macro name to the Bloom filter.
+ *
+ * @param filter Pointer to the Bloom filter.
+ * @param name The macro name.
+ */
+void macro_filter_add(MACRO_FILTER * filter , char * name);
+
+/**
+ * @brief Checks whether a name may be in the Bloom filter.
+ *
+ * @param filter Pointer to the Bloom filter.
+ * @param name The name to check.
+ * @return TRUE if the name may be a macro name, FALSE if it is surely not one.
+ */
+BOOLEAN macro_filter_may_contain(MACRO_FILTER * filter , char * name);
+
+/**
+ * @brief Checks whether a name whose base hashes are known may be in the Bloom filter.
+ *
+ * @param filter Pointer to the Bloom filter.
+ * @param first First base hash of the name (from macro_filter_hash).
+ * @param second Second base hash of the name.
+ * @return TRUE if the name may be a macro name, FALSE if it is surely not one.
+ */
+BOOLEAN macro_filter_test(MACRO_FILTER * filter , unsigned long first , unsigned long second);
+
 /**
  * @brief Determines the type of a line (macro declaration, macro call, etc.).
  * 
  * @param line Line of code to analyze.
  * @param head Pointer to the macro list.
+ * @param filter Bloom filter of the macro names.
+ * @param library Pointer to the macro library of the run, or NULL.
  * @param macro_name Name of the macro (if any).
  * @return The type of the line.
  */
-int line_type(char * line , MACRO_LIST *head , char *macro_name);
+int line_type(char * line , MACRO_LIST *head , MACRO_FILTER * filter , MACRO_LIBRARY * library , char *macro_name);
 
 /**
  * @brief Preprocesses a file by processing macros.
@@ -278,6 +828,17 @@ int line_type(char * line , MACRO_LIST *head , char *macro_name);
  */
 void Pre_Proc(ASSEMBLER_TABLE ** head_table , char *file_name);
 
+/**
+ * @brief Preprocesses the lines of a source.
+ *
+ * @param source The source to read (a file or the ring of the reader stage).
+ * @param head_table Pointer to the assembler table holding the macro list.
+ * @param writer_am The writer receiving the preprocessed lines.
+ * @param depth Include depth of the source (0 for the file being assembled).
+ * @return TRUE if the lines are valid, FALSE otherwise.
+ */
+BOOLEAN Pre_Proc_Lines(LINE_SOURCE * source , ASSEMBLER_TABLE ** head_table , AM_WRITER * writer_am , int depth);
+
 
 /*-----------Function declaration pre processor errors--------------*/
 
@@ -295,10 +856,11 @@ BOOLEAN End_Macr_Check(char * line , int line_count);
  * 
  * @param line Line to check for the macro name.
  * @param head Pointer to the macro list.
+ * @param library Pointer to the macro library of the run, or NULL.
  * @param line_count Line number for error reporting.
  * @return TRUE if valid, FALSE otherwise.
  */
-BOOLEAN Macro_Name_Check(char * line ,MACRO_LIST * head , int line_count);
+BOOLEAN Macro_Name_Check(char * line ,MACRO_LIST * head , MACRO_LIBRARY * library , int line_count);
 
 /**
 * @brief Check if file name is valid.
@@ -332,11 +894,32 @@ int extract_Label(char *line, char *label, char delimiter , int line_counter);
  * It allocates memory for the new node, initializes the label and address, 
  * and appends the node to the end of the list.
  *
- * @param label_list Pointer to the head of the LABEL_LIST linked list.
+ * @param label_list Pointer to the head of the LABEL_LIST linked list, or to the `next` link of its last node (then appending takes constant time).
  * @param label The label name to insert into the list.
  * @param address The address associated with the label.
+ * @param type The type of the line the label was defined on.
+ */
+void insert_Label_List(LABEL_LIST **label_list, char *label, int address, int type);
+
+/**
+ * @brief Checks whether a label was defined on a data directive.
+ *
+ * @param label Pointer to the label node.
+ * @return TRUE if the label points into the data image, FALSE otherwise.
+ */
+BOOLEAN is_Data_Label(LABEL_LIST *label);
+
+/**
+ * @brief Turns the data addresses of data labels into final memory addresses.
+ *
+ * Data labels are recorded with their data address during the first pass, because the
+ * data image is placed after the code and its start is only known once all the code
+ * was counted.
+ *
+ * @param label_list Head of the LABEL_LIST linked list.
+ * @param IC The final instruction counter.
  */
-void insert_Label_List(LABEL_LIST **label_list, char *label, int address);
+void relocate_Data_Labels(LABEL_LIST *label_list, int IC);
 
 /**
  * @brief Determines the type of line in the assembly source code.
@@ -394,6 +977,20 @@ void insert_Extern_List(EXTERN_LIST **extern_list, char *line ,  int line_counte
  */
 void add_to_instruction_list(MACHINE_CODE_INSTRUCTION **instruction_list , int address , MILA mila);
 
+/**
+ * @brief Adds a run of identical words to the MACHINE_CODE_INSTRUCTION list.
+ *
+ * The run is stored as a single node holding the value and the number of words it covers,
+ * so a `.fill`/`.zero` directive costs the same memory regardless of its length. The run is
+ * only expanded word by word when the object file is written.
+ *
+ * @param instruction_list Pointer to the head of the MACHINE_CODE_INSTRUCTION linked list, or to the `next` link of its last node (then appending takes constant time).
+ * @param address The address of the first word of the run.
+ * @param mila The value stored in every word of the run.
+ * @param count The number of words in the run.
+ */
+void add_run_to_instruction_list(MACHINE_CODE_INSTRUCTION **instruction_list , int address , MILA mila , int count);
+
 /**
  * @brief Extracts a string from a line of assembly and adds it to the instruction list.
  *
@@ -423,6 +1020,40 @@ int extract_String(MACHINE_CODE_INSTRUCTION **instruction_list, char *line, int
  */
 int extract_Data(MACHINE_CODE_INSTRUCTION **instruction_list, char *line, int *address);
 
+/**
+ * @brief Extracts a `.fill` or `.zero` directive and records it as a single run.
+ *
+ * `.fill count,value` reserves `count` words holding `value`, and `.zero count` reserves
+ * `count` words holding zero. The data counter is advanced by `count`.
+ *
+ * @param instruction_list Pointer to the head of the MACHINE_CODE_INSTRUCTION linked list.
+ * @param line The operands of the directive (after the directive name).
+ * @param type The directive type (IS_FILL or IS_ZERO).
+ * @param address Pointer to the current address, which is advanced by the run length.
+ * @return Always returns FALSE to indicate successful extraction.
+ */
+int extract_Fill(MACHINE_CODE_INSTRUCTION **instruction_list, char *line, int type, int *address);
+
+/**
+ * @brief Copies the contents of a binary file into the instruction list.
+ *
+ * `.incbin "file",offset,length` reads `length` bytes of `file` starting at `offset` and
+ * stores them as a single instruction node holding one word per byte (the same layout
+ * `.string` uses for characters). The offset defaults to 0 and the length to the rest of
+ * the file, whose relative path starts from the directory of the source. The data is
+ * never routed through the text parsing of `.data`. The file is mapped once: the range
+ * must lie inside it and fit in the words left in memory, otherwise an error is printed.
+ *
+ * @param instruction_list Pointer to the head of the MACHINE_CODE_INSTRUCTION linked list.
+ * @param source_name Name of the source file, or NULL for standard input.
+ * @param line The operands of the directive (after the directive name).
+ * @param address Pointer to the current address, which is advanced by the number of bytes copied.
+ * @param words_left Number of words left in memory after the code and data so far.
+ * @param line_counter The current line number (used for error reporting).
+ * @return Returns FALSE if the file was copied, TRUE if an error was printed.
+ */
+int extract_Incbin(MACHINE_CODE_INSTRUCTION **instruction_list, char *source_name, char *line, int *address, int words_left, int line_counter);
+
 /**
  * @brief Converts an assembly command line into machine code and adds it to the command list.
  *
@@ -447,13 +1078,14 @@ int convert_Command(MACHINE_CODE_COMMAND **command_list, const char **registers,
  * to the end of the linked list of machine code commands. If the list is empty, the new node 
  * becomes the head.
  *
- * @param command_list Pointer to the head of the MACHINE_CODE_COMMAND linked list.
+ * @param command_list Pointer to the head of the MACHINE_CODE_COMMAND linked list, or to the `next` link of its last node (then appending takes constant time).
  * @param addr The address associated with the command.
  * @param label The label associated with the command, if any.
  * @param binary_code The binary representation of the machine code (MILA).
  * @param type The type of the command (e.g., type of addressing or instruction format).
+ * @param line The source line the command was read from.
  */
-void insert_Command_List(MACHINE_CODE_COMMAND **command_list , int addr, char label[MAX_LABEL_SIZE] , MILA binary_code , int type);
+void insert_Command_List(MACHINE_CODE_COMMAND **command_list , int addr, char label[MAX_LABEL_SIZE] , MILA binary_code , int type , int line);
 
 /**
  * @brief Generates machine code (MILA) for a given command and its operands.
@@ -469,8 +1101,9 @@ void insert_Command_List(MACHINE_CODE_COMMAND **command_list , int addr, char la
  * @param dest_op The destination operand (if applicable).
  * @param type_dest The addressing type of the destination operand.
  * @param IC Pointer to the instruction counter (incremented as new instructions are added).
+ * @param line_counter The source line of the command.
  */
-void generate_Mila(MACHINE_CODE_COMMAND **command_list, CODES command_code, char *src_op, int type_src, char *dest_op, int type_dest, int *IC);
+void generate_Mila(MACHINE_CODE_COMMAND **command_list, CODES command_code, char *src_op, int type_src, char *dest_op, int type_dest, int *IC, int line_counter);
 
 /**
  * @brief Retrieves the integer value of an operand based on its type.
@@ -515,10 +1148,7 @@ unsigned short shift_Bits(unsigned short num,unsigned short steps);
 /**
  * @brief Performs the first pass over the assembly file to process labels, directives, and commands.
  *
- * This function reads the assembly source file line by line, extracting labels, directives, and commands.
- * It performs checks on the syntax of labels, `.entry`, `.extern`, `.string`, `.data`, and commands. 
- * The information is stored in the ASSEMBLER_TABLE, including labels, instructions, and machine code commands.
- * 
+ * This function opens the preprocessed file and runs the first pass over its lines.
  * If the first pass completes without errors, it triggers the second pass.
  *
  * @param assembler Pointer to the ASSEMBLER_TABLE that stores labels, commands, instructions, etc.
@@ -527,6 +1157,30 @@ unsigned short shift_Bits(unsigned short num,unsigned short steps);
  */
 void firstpass(ASSEMBLER_TABLE **assembler, char *file_name ,char * file_name_no_ending);
 
+/**
+ * @brief Runs the first pass over the lines of the preprocessed source.
+ *
+ * Labels, `.entry`, `.extern`, `.string`, `.data`, `.fill`, `.zero`, `.incbin` and commands
+ * are checked and stored in the ASSEMBLER_TABLE.
+ *
+ * @param assembler Pointer to the ASSEMBLER_TABLE.
+ * @param source The preprocessed source (the .am file, or the ring of the preprocessor stage).
+ * @param IC_out Pointer receiving the instruction counter.
+ * @param DC_out Pointer receiving the data counter.
+ * @return TRUE if no errors were found, FALSE otherwise.
+ */
+BOOLEAN First_Pass_Lines(ASSEMBLER_TABLE **assembler , LINE_SOURCE * source , int * IC_out , int * DC_out);
+
+/**
+ * @brief Completes the first pass (string pooling, data placement) and runs the second pass.
+ *
+ * @param assembler Pointer to the ASSEMBLER_TABLE.
+ * @param file_name_no_ending The base name of the file without the file extension.
+ * @param IC The instruction counter at the end of the first pass.
+ * @param DC The data counter at the end of the first pass.
+ */
+void finish_First_Pass(ASSEMBLER_TABLE **assembler , char * file_name_no_ending , int IC , int DC);
+
 
 
 
@@ -692,6 +1346,33 @@ BOOLEAN Data_Examine(char * line , int line_counter);
  */
 BOOLEAN Valid_Num_Examine( char  * char_num , int line_counter);
 
+/**
+ * @brief Examines a `.fill` or `.zero` directive in the assembly code for validity.
+ *
+ * `.fill` expects exactly two numbers separated by a comma (the run length and the value),
+ * and `.zero` expects a single run length. The run length must be positive and fit in
+ * the words left in memory, and the value must fit in 15 bits like a `.data` number.
+ *
+ * @param line The operands of the directive (after the directive name).
+ * @param type The directive type (IS_FILL or IS_ZERO).
+ * @param line_counter The current line number (used for error reporting).
+ * @param words_left Number of words left in memory after the code and data so far.
+ * @return Returns TRUE if the directive is valid, or FALSE if an error is detected.
+ */
+BOOLEAN Fill_Examine(char * line , int type , int line_counter , int words_left);
+
+/**
+ * @brief Examines an `.incbin` directive in the assembly code for validity.
+ *
+ * The file name must be enclosed in double quotes and may be followed by a non-negative
+ * offset and length separated by commas. The file itself is checked by `extract_Incbin`.
+ *
+ * @param line The operands of the directive (after the directive name).
+ * @param line_counter The current line number (used for error reporting).
+ * @return Returns TRUE if the directive is valid, or FALSE if an error is detected.
+ */
+BOOLEAN Incbin_Examine(char * line , int line_counter);
+
 /**
  * @brief Examines the validity of an `.extern` directive in assembly code.
  *
@@ -727,6 +1408,57 @@ BOOLEAN Extern_Examine(char * line , int line_counter , ASSEMBLER_TABLE *assembl
 BOOLEAN Entry_Examine(char * line , int line_counter , ASSEMBLER_TABLE *assembler ,const char **resgisters);
 
 
+/*------------------Function declaration string pool-------------------*/
+
+/**
+ * @brief Records a `.string` payload for string pooling.
+ *
+ * @param string_list Pointer to the head of the STRING_POOL list.
+ * @param line The operand of the `.string` directive (including the quotes).
+ * @param address The data address of the first character of the string.
+ */
+void add_to_string_pool(STRING_POOL ** string_list , char * line , int address);
+
+/**
+ * @brief Orders pooled strings by their reversed text.
+ *
+ * Used with `qsort` so that every string is followed by the strings it is a suffix of.
+ *
+ * @param first Pointer to the first STRING_POOL pointer.
+ * @param second Pointer to the second STRING_POOL pointer.
+ * @return Negative, zero or positive like `strcmp`.
+ */
+int compare_Pooled_Strings(const void * first , const void * second);
+
+/**
+ * @brief Counts the removed strings that start at or before a data address.
+ *
+ * @param starts Data addresses of the removed strings, in increasing order.
+ * @param count Number of removed strings.
+ * @param address The data address to look up.
+ * @return The number of entries of `starts` that are less than or equal to `address`.
+ */
+int pooled_Index(int * starts , int count , int address);
+
+/**
+ * @brief Shares identical `.string` payloads and suffixes in the data image.
+ *
+ * Every recorded string that is equal to, or a suffix of, another recorded string is
+ * removed from the data image. Labels of a removed string point into the copy that holds
+ * it, and the addresses of the remaining data words and data labels are recomputed.
+ *
+ * @param assembler Pointer to the assembler table.
+ * @param DC Pointer to the data counter, reduced by the number of removed words.
+ */
+void pool_Strings(ASSEMBLER_TABLE * assembler , int * DC);
+
+/**
+ * @brief Frees memory allocated for the string pool.
+ *
+ * @param head Pointer to the head of the STRING_POOL list.
+ */
+void free_string_pool(STRING_POOL ** head);
+
 /*------------------Function declaration second pass-------------------*/
 
 /**
@@ -744,15 +1476,15 @@ void add_addr_to_list(ADDRESS_LIST ** addr_list ,int addr);
  * @brief Checks if a label exists in the label or extern lists.
  *
  * This function checks if a label exists in either the label list or
- * the extern list. It also prints an error if the label is not found.
+ * the extern list. It also reports an error if the label is not found.
  *
  * @param head_label Pointer to the head of the label list.
  * @param head_extern Pointer to the head of the extern list.
- * @param addr Address for error reporting.
+ * @param line Source line for error reporting.
  * @param label Name of the label to check.
  * @return TRUE if the label exists, FALSE otherwise.
  */
-BOOLEAN Check_If_Label_Exist(LABEL_LIST * head_label,EXTERN_LIST * head_extern , int addr,char * label);
+BOOLEAN Check_If_Label_Exist(LABEL_LIST * head_label,EXTERN_LIST * head_extern , int line,char * label);
 /**
  * @brief Executes the second pass of the assembler.
  *
@@ -780,7 +1512,7 @@ void Second_Pass(ASSEMBLER_TABLE ** assembler_table , char * file_name , int IC
  * @param addr The address associated with the code.
  * @param fp_file Pointer to the output file.
  */
-void print_dec_to_file_in_octal(unsigned short binary_code , int addr , FILE * fp_file);
+void print_dec_to_file_in_octal(unsigned short binary_code , int addr , OUTPUT_FILE * fp_file);
 
 /**
  * @brief Processes and writes the object file.
@@ -796,6 +1528,26 @@ void print_dec_to_file_in_octal(unsigned short binary_code , int addr , FILE * f
  */
 void process_ob_file(MACHINE_CODE_INSTRUCTION *instruction_list , MACHINE_CODE_COMMAND * command_list ,char * ob_file, int IC , int DC);
 
+/**
+ * @brief Processes the binary object (.obj) file: the words, entries and extern references of the .ob, .ent and .ext files.
+ *
+ * @param assembler Pointer to the assembler table structure.
+ * @param obj_file Name of the binary object file to be written.
+ * @param IC Instruction count.
+ * @param DC Data count.
+ */
+void process_obj_file(ASSEMBLER_TABLE * assembler , char * obj_file , int IC , int DC);
+
+/**
+ * @brief Processes the relocation table (.rel): the address of every relocatable (R) word of the object file.
+ *
+ * If the table is empty, the file is removed.
+ *
+ * @param command_list List of machine code commands.
+ * @param rel_file Name of the relocation file to write.
+ */
+void process_rel_file(MACHINE_CODE_COMMAND * command_list , char * rel_file);
+
 /**
  * @brief Processes and writes the entry file.
  *
@@ -831,127 +1583,975 @@ void process_ext_file(EXTERN_LIST *ext_list ,char * ext_file);
  */
 void translationunit(ASSEMBLER_TABLE ** assembler , char *file_name , int IC , int DC);
 
-/*-------------Function declaration in Functions.c---------------*/
+/*-------------Function declaration in Am_Writer.c---------------*/
 
 /**
- * @brief Checks if a word is a reserved word.
+ * @brief Opens the `.am` output file for writing through segments.
  *
- * This function checks if the given word is a reserved word and prints
- * an error message if so.
- *
- * @param line The word to check.
- * @param error_message Error message to print if the word is reserved.
- * @param line_count Line number for error reporting.
- * @return TRUE if the word is valid, FALSE if it's a reserved word.
+ * @param writer Pointer to the writer to initialize.
+ * @param file_name Name of the output file.
+ * @return TRUE if the file was opened, FALSE otherwise.
  */
-BOOLEAN Reserved_Words_Check(char * line , const char * error_message , int line_count);
+BOOLEAN am_writer_open(AM_WRITER * writer , char * file_name);
 
 /**
- * @brief Prints an error message with the line number.
+ * @brief Prepares a writer that collects the output in memory instead of a file.
  *
- * Prints the specified error message to stderr, with the given line number.
- *
- * @param error_message The error message to print.
- * @param line The line number where the error occurred.
+ * @param writer Pointer to the writer to initialize.
  */
-void print_error(const char *error_message, int line);
+void am_writer_open_memory(AM_WRITER * writer);
 
 /**
- * @brief Frees memory allocated for the assembler table.
+ * @brief Forwards text to the next pipeline stage, cut into lines the way fgets cuts them.
  *
- * This function frees all memory associated with the assembler table,
- * including macros, labels, entries, externals, and machine code.
- *
- * @param table Pointer to the assembler table.
+ * @param writer Pointer to the writer.
+ * @param text The text to forward.
+ * @param length Number of characters of the text.
  */
-void free_assembler_table(ASSEMBLER_TABLE **table);
+void am_writer_forward(AM_WRITER * writer , char * text , int length);
 
 /**
- * @brief Frees memory allocated for machine code instructions.
- *
- * Frees the linked list of machine code instructions.
+ * @brief Adds a segment of text to the output without copying it.
  *
- * @param head Pointer to the head of the machine code instruction list.
+ * @param writer Pointer to the writer.
+ * @param text The text of the segment (must stay valid until the next flush).
+ * @param length Number of characters of the segment.
+ * @param owned TRUE if the writer should free the text after writing it, FALSE otherwise.
  */
-void free_machine_code_instruction(MACHINE_CODE_INSTRUCTION **head);
+void am_writer_add(AM_WRITER * writer , char * text , int length , BOOLEAN owned);
 
 /**
- * @brief Frees memory allocated for machine code commands.
- *
- * Frees the linked list of machine code commands.
+ * @brief Writes all pending segments with `writev` and releases the owned text.
  *
- * @param head Pointer to the head of the machine code command list.
+ * @param writer Pointer to the writer.
  */
-void free_machine_code_command(MACHINE_CODE_COMMAND **head);
+void am_writer_flush(AM_WRITER * writer);
 
 /**
- * @brief Frees memory allocated for the extern list.
+ * @brief Flushes the pending segments and closes the output file.
  *
- * Frees the linked list of extern labels and addresses.
- *
- * @param head Pointer to the head of the extern list.
+ * @param writer Pointer to the writer.
+ * @return TRUE if all the output was written, FALSE otherwise.
  */
-void free_extern_list(EXTERN_LIST **head);
+BOOLEAN am_writer_close(AM_WRITER * writer);
+
+/*-------------Function declaration in Macro_Library.c---------------*/
 
 /**
- * @brief Frees memory allocated for the entry list.
- *
- * Frees the linked list of entry labels and addresses.
+ * @brief Computes the hash of a macro name for the name table of a macro library.
  *
- * @param head Pointer to the head of the entry list.
+ * @param name The macro name.
+ * @return The FNV-1a hash of the name.
  */
-void free_entry_list(ENTRY_LIST **head);
+unsigned int macro_library_hash(char * name);
 
 /**
- * @brief Frees memory allocated for the address list.
- *
- * Frees the linked list of addresses.
+ * @brief Reads the macro definitions of a library source file.
  *
- * @param head Pointer to the head of the address list.
+ * @param head Pointer to the head of the macro list (shared by all the sources of the library).
+ * @param filter Bloom filter of the macro names.
+ * @param file_name Name of the source file, without the ".as" suffix.
+ * @return TRUE if all the definitions are valid, FALSE otherwise.
  */
-void free_address_list(ADDRESS_LIST **head);
+BOOLEAN collect_Library_Macros(MACRO_LIST ** head , MACRO_FILTER * filter , char * file_name);
 
 /**
- * @brief Frees memory allocated for the label list.
+ * @brief Frees the macros read from library sources.
  *
- * Frees the linked list of labels.
- *
- * @param head Pointer to the head of the label list.
+ * @param head Pointer to the head of the macro list.
  */
-void free_label_list(LABEL_LIST **head);
+void free_Library_Macros(MACRO_LIST ** head);
 
 /**
- * @brief Frees memory allocated for the macro list.
- *
- * Frees the linked list of macros.
+ * @brief Writes a list of macros as a binary macro library.
  *
  * @param head Pointer to the head of the macro list.
+ * @param file_name Name of the library file to write.
+ * @return TRUE if the library was written, FALSE otherwise.
  */
-void free_macro_list(MACRO_LIST **head);
+BOOLEAN write_Macro_Library(MACRO_LIST * head , char * file_name);
 
 /**
- * @brief Frees memory allocated for the macro content.
+ * @brief Maps a binary macro library into memory (read only).
  *
- * Frees the linked list of macro content.
+ * @param file_name Name of the library file.
+ * @return Pointer to the loaded library, or NULL if the file cannot be used.
+ */
+MACRO_LIBRARY * load_Macro_Library(char * file_name);
+
+/**
+ * @brief Finds a macro by name in a macro library.
  *
- * @param head Pointer to the head of the macro content list.
+ * @param library Pointer to the library (may be NULL).
+ * @param name_to_find The name of the macro to search for.
+ * @return Pointer to the entry of the macro, or NULL if not found.
  */
-void free_macro_content(MACRO_CONTENT **head);
+MACRO_LIBRARY_ENTRY * find_Library_Macro(MACRO_LIBRARY * library , char * name_to_find);
 
 /**
- * @brief Allocates memory dynamically and checks for allocation failure.
+ * @brief Unmaps a macro library and frees its descriptor.
  *
- * This function allocates memory of the specified size and checks if the allocation
- * was successful. If memory allocation fails, an error message is printed and the
- * program exits.
+ * @param library Pointer to the library pointer (set to NULL).
+ */
+void unload_Macro_Library(MACRO_LIBRARY ** library);
+
+/*-------------Function declaration in Pipeline.c---------------*/
+
+/**
+ * @brief Creates an empty line ring.
  *
- * @param size The size of the memory to allocate (in bytes).
- * @return Pointer to the allocated memory.
+ * @return Pointer to the new ring.
  */
-void * generic_malloc(long size);
+LINE_RING * create_line_ring(void);
 
 /**
- * @brief Adds a suffix to a file name.
+ * @brief Adds a view to a ring, waiting while the ring is full.
+ *
+ * @param ring Pointer to the ring.
+ * @param text First character of the line.
+ * @param length Number of characters of the line.
+ * @return TRUE if the view was added, FALSE if the consumer stopped reading.
+ */
+BOOLEAN line_ring_push(LINE_RING * ring , const char * text , int length);
+
+/**
+ * @brief Takes the next view from a ring, waiting while the ring is empty.
+ *
+ * @param ring Pointer to the ring.
+ * @param view Pointer receiving the view.
+ * @return TRUE if a view was taken, FALSE once the ring is closed and empty.
+ */
+BOOLEAN line_ring_pop(LINE_RING * ring , LINE_VIEW * view);
+
+/**
+ * @brief Marks the end of the views of a ring (called by the producer).
+ *
+ * @param ring Pointer to the ring.
+ */
+void line_ring_close(LINE_RING * ring);
+
+/**
+ * @brief Tells the producer of a ring that no more views are read (called by the consumer).
+ *
+ * @param ring Pointer to the ring.
+ */
+void line_ring_cancel(LINE_RING * ring);
+
+/**
+ * @brief Frees a line ring once both of its stages are done with it.
+ *
+ * @param ring Pointer to the ring.
+ */
+void free_line_ring(LINE_RING * ring);
+
+/**
+ * @brief Copies text into an arena, where it stays until the arena is freed.
+ *
+ * @param arena Pointer to the arena.
+ * @param text The text to copy.
+ * @param length Number of characters to copy.
+ * @return Pointer to the copy.
+ */
+char * arena_copy(TEXT_ARENA * arena , const char * text , int length);
+
+/**
+ * @brief Frees the blocks of an arena.
+ *
+ * @param arena Pointer to the arena.
+ */
+void free_arena(TEXT_ARENA * arena);
+
+/**
+ * @brief Reads the next line of a source, the way fgets reads a line of a file.
+ *
+ * @param source The source to read.
+ * @param line Buffer receiving the null terminated line.
+ * @param size Size of the buffer.
+ * @return The buffer, or NULL at the end of the source.
+ */
+char * read_Line(LINE_SOURCE * source , char * line , int size);
+
+/**
+ * @brief Reader stage: reads the lines of the source file into the first ring.
+ *
+ * @param argument Pointer to the PIPELINE.
+ * @return NULL.
+ */
+void * reader_Stage(void * argument);
+
+/**
+ * @brief Preprocessor stage: expands the lines of the first ring into the .am file and the second ring.
+ *
+ * @param argument Pointer to the PIPELINE.
+ * @return NULL.
+ */
+void * pre_Proc_Stage(void * argument);
+
+/**
+ * @brief Assembles a file with reading, preprocessing and parsing running in three threads.
+ *
+ * @param head_table Pointer to the assembler table of the file.
+ * @param input The source file, open or prefetched (closed by the caller).
+ * @param writer_am The open writer of the .am file, or a memory writer when the outputs are bundled.
+ * @param file_am Name of the .am file.
+ * @param file_name Name of the source file, without suffix.
+ */
+void Pre_Proc_Pipeline(ASSEMBLER_TABLE ** head_table , LINE_SOURCE * input , AM_WRITER * writer_am , char * file_am , char * file_name);
+
+/*-------------Function declaration in Scheduler.c---------------*/
+
+/**
+ * @brief Orders batch files largest first, keeping the command line order of equal sizes.
+ *
+ * @param first Pointer to a BATCH_FILE pointer.
+ * @param second Pointer to a BATCH_FILE pointer.
+ * @return Negative, zero or positive, as qsort expects.
+ */
+int compare_Batch_Files(const void * first , const void * second);
+
+/**
+ * @brief Takes the next file from the head of the queue of its owner.
+ *
+ * @param queue Pointer to the queue.
+ * @return Pointer to the file, or NULL if the queue is empty.
+ */
+BATCH_FILE * take_File(WORK_QUEUE * queue);
+
+/**
+ * @brief Steals a file from the tail of the queue of another worker.
+ *
+ * @param queue Pointer to the queue.
+ * @return Pointer to the file, or NULL if the queue is empty.
+ */
+BATCH_FILE * steal_File(WORK_QUEUE * queue);
+
+/**
+ * @brief Reads ahead the next files at the head of a queue.
+ *
+ * @param queue Pointer to the queue.
+ * @param depth Number of files to read ahead.
+ */
+void prefetch_Queue(WORK_QUEUE * queue , int depth);
+
+/**
+ * @brief Marks a file as assembled and writes the diagnostics that are due.
+ *
+ * @param scheduler Pointer to the scheduler.
+ * @param file Pointer to the assembled file.
+ */
+void finish_Batch_File(SCHEDULER * scheduler , BATCH_FILE * file);
+
+/**
+ * @brief Finds the next file of a worker: from its own queue, or else stolen from another queue.
+ *
+ * @param worker Pointer to the worker.
+ * @param stolen Set to TRUE if the file was stolen, FALSE otherwise.
+ * @return Pointer to the file, or NULL once every queue is empty.
+ */
+BATCH_FILE * next_Batch_File(WORKER * worker , BOOLEAN * stolen);
+
+/**
+ * @brief Returns the seconds elapsed since a time.
+ *
+ * @param start The start time.
+ * @return The elapsed seconds.
+ */
+double elapsed_Seconds(struct timeval * start);
+
+/**
+ * @brief Main loop of a worker: assembles its own files, then steals from the others.
+ *
+ * @param argument Pointer to the WORKER.
+ * @return NULL.
+ */
+void * worker_Main(void * argument);
+
+/**
+ * @brief Assembles a batch of files with a pool of work-stealing workers.
+ *
+ * @param names Names of the source files, without the ".as" suffix.
+ * @param count Number of files.
+ * @param options Options of the run (number of workers and statistics).
+ */
+void run_Batch(char ** names , int count , ASSEMBLER_OPTIONS * options);
+
+/*-------------Function declaration in Async_Io.c---------------*/
+
+/**
+ * @brief Sets up the I/O backend of the run.
+ *
+ * With asynchronous I/O, an io_uring ring is set up with a table of registered file slots,
+ * so a file is opened, read or written and closed by three linked operations submitted at
+ * once. When the ring cannot be set up (an old kernel, a sandbox or another system), the
+ * same requests are served synchronously.
+ *
+ * @param options Options of the run.
+ */
+void io_init(ASSEMBLER_OPTIONS * options);
+
+/**
+ * @brief Sets up the io_uring ring and its registered file slots.
+ *
+ * @return TRUE if the ring is ready, FALSE to use the synchronous fallback.
+ */
+BOOLEAN io_uring_Setup(void);
+
+/**
+ * @brief Unmaps the rings and closes the io_uring file descriptor.
+ */
+void io_uring_Teardown(void);
+
+/**
+ * @brief Hands the queued entries to the kernel and, when asked to, waits for a completion.
+ *
+ * Called with the backend lock held.
+ *
+ * @param wait TRUE to wait for at least one completion, FALSE otherwise.
+ */
+void io_uring_Enter(BOOLEAN wait);
+
+/**
+ * @brief Queues the linked open, read or write, and close operations of a request.
+ *
+ * The file is opened straight into the registered slot of the request, so the read or
+ * write can use it without waiting for the open to complete. The close is hard linked,
+ * so the slot is released even when the read or write fails. Called with the backend lock held.
+ *
+ * @param request Pointer to the request.
+ */
+void io_uring_Queue(IO_REQUEST * request);
+
+/**
+ * @brief Takes the completions from the ring and updates their requests.
+ *
+ * Called with the backend lock held.
+ */
+void io_uring_Reap(void);
+
+/**
+ * @brief Finishes a request whose operations completed.
+ *
+ * A request that failed on the ring (a short transfer, or a kernel without direct
+ * descriptors) is served again synchronously. A replacing write renames its temporary
+ * file over the target. A finished write is released, unless it
+ * failed, in which case it is kept for io_finish to report. Called with the backend lock held.
+ *
+ * @param request Pointer to the request.
+ */
+void io_Complete(IO_REQUEST * request);
+
+/**
+ * @brief Reads or writes the file of a request with plain system calls.
+ *
+ * @param request Pointer to the request.
+ */
+void io_Serve_Sync(IO_REQUEST * request);
+
+/**
+ * @brief Starts a request: on the ring when there is one, synchronously otherwise.
+ *
+ * Waits for a free registered file slot when all of them are in use.
+ *
+ * @param request Pointer to the request.
+ */
+void io_Start(IO_REQUEST * request);
+
+/**
+ * @brief Creates a request for a whole file.
+ *
+ * @param type IO_READ or IO_WRITE.
+ * @param path Path of the file.
+ * @param text The text to write, or NULL for a read.
+ * @param length Length of the text.
+ * @return Pointer to the new request.
+ */
+IO_REQUEST * io_Create(int type , char * path , char * text , long length);
+
+/**
+ * @brief Starts reading a whole file into memory.
+ *
+ * @param path Path of the file.
+ * @return Pointer to the request, or NULL if the file cannot be read.
+ */
+IO_REQUEST * io_read_file(char * path);
+
+/**
+ * @brief Starts writing a whole file, which completes while the assembler goes on.
+ *
+ * @param path Path of the file.
+ * @param text The text to write (owned by the request from now on).
+ * @param length Length of the text.
+ */
+void io_write_file(char * path , char * text , long length);
+
+/**
+ * @brief Starts replacing a file: the text is written to a temporary file, which is then renamed over it.
+ *
+ * @param path Path of the file.
+ * @param text The text to write (owned by the request from now on).
+ * @param length Length of the text.
+ */
+void io_replace_file(char * path , char * text , long length);
+
+/**
+ * @brief Waits for a request to complete.
+ *
+ * The waiting thread holds the backend lock while it waits on the ring, so a completion
+ * is never taken by one thread while another one sleeps waiting for it.
+ *
+ * @param request Pointer to the request.
+ */
+void io_wait(IO_REQUEST * request);
+
+/**
+ * @brief Frees a request and its text.
+ *
+ * @param request Pointer to the request.
+ */
+void io_release(IO_REQUEST * request);
+
+/**
+ * @brief Starts reading a source file ahead of its turn.
+ *
+ * Does nothing without asynchronous I/O, or when the file is already read ahead.
+ *
+ * @param file_name Name of the source file, without the ".as" suffix.
+ */
+void io_prefetch(char * file_name);
+
+/**
+ * @brief Takes a source file that was read ahead.
+ *
+ * @param path Path of the source file.
+ * @return Pointer to the completed request (to release with io_release), or NULL if the
+ * file was not read ahead or could not be read.
+ */
+IO_REQUEST * io_take_prefetched(char * path);
+
+/**
+ * @brief Waits for every write, reports the files that could not be written and shuts the backend down.
+ *
+ * @return TRUE if every output file was written, FALSE otherwise.
+ */
+BOOLEAN io_finish(void);
+
+/**
+ * @brief Starts collecting an output file in memory.
+ *
+ * @param output Pointer to the output file.
+ */
+void output_open(OUTPUT_FILE * output);
+
+/**
+ * @brief Writes a string to an output file.
+ *
+ * @param output Pointer to the output file.
+ * @param text The string to write.
+ */
+void output_write(OUTPUT_FILE * output , char * text);
+
+/**
+ * @brief Writes bytes to an output file.
+ *
+ * @param output Pointer to the output file.
+ * @param text The bytes to write (may hold null characters).
+ * @param length Number of bytes.
+ */
+void output_append(OUTPUT_FILE * output , const char * text , long length);
+
+/**
+ * @brief Checks whether a file already holds exactly the given text.
+ *
+ * The sizes are compared first, so a changed file is usually detected without reading it.
+ *
+ * @param path Path of the file.
+ * @param text The text.
+ * @param length Length of the text.
+ * @return TRUE if the file exists with the same bytes, FALSE otherwise.
+ */
+BOOLEAN file_Has_Content(char * path , char * text , long length);
+
+/**
+ * @brief Builds the name of the temporary file an output is written to before it replaces the file.
+ *
+ * The temporary file is in the same directory, so the rename that replaces the file is atomic.
+ *
+ * @param temp Buffer of IO_PATH_LENGTH characters receiving the name.
+ * @param path Path of the output file.
+ */
+void temp_Path(char * temp , char * path);
+
+/**
+ * @brief Flushes the directory holding a file to disk, so a rename into it survives a crash.
+ *
+ * @param path Path of the file.
+ */
+void sync_Directory(char * path);
+
+/**
+ * @brief Puts a completely written temporary file in place of the file it replaces.
+ *
+ * The temporary file takes the permissions of the replaced file and is flushed to disk
+ * before the rename; the directory is flushed after it.
+ *
+ * @param fd Open descriptor of the temporary file (closed here).
+ * @param temp Path of the temporary file.
+ * @param path Path of the file to replace.
+ * @return TRUE if the file was replaced, FALSE otherwise.
+ */
+BOOLEAN commit_Temp_File(int fd , char * temp , char * path);
+
+/**
+ * @brief Replaces a file with the given text: written to a temporary file, then renamed over it.
+ *
+ * Readers of the file see either the old or the new content, never a partly written file.
+ *
+ * @param path Path of the file.
+ * @param text The text to write.
+ * @param length Length of the text.
+ * @return TRUE if the file was replaced, FALSE otherwise.
+ */
+BOOLEAN replace_File(char * path , char * text , long length);
+
+/**
+ * @brief Closes an output file, writing it only when its content changed.
+ *
+ * An unchanged file keeps its modification time, so tools that rebuild from the outputs
+ * see nothing to do. A changed file is replaced atomically, right away or through the
+ * I/O backend with asynchronous I/O. With `--stdout` the file is added to the bundle of
+ * the current file instead.
+ *
+ * @param output Pointer to the output file.
+ * @param path Path of the file.
+ */
+void output_close(OUTPUT_FILE * output , char * path);
+
+/**
+ * @brief Closes an output file that turned out empty and removes the file of an earlier run.
+ *
+ * With `--stdout` the file is left out of the bundle and nothing is removed.
+ *
+ * @param output Pointer to the output file.
+ * @param path Path of the file.
+ * @return TRUE if no file is left, FALSE if it could not be removed.
+ */
+BOOLEAN output_discard(OUTPUT_FILE * output , char * path);
+
+/*-------------Function declaration in Archive.c---------------*/
+
+/**
+ * @brief Reads a number field of a tar header: octal text, or base-256 for large values.
+ *
+ * @param field The field.
+ * @param length Length of the field.
+ * @return The number, or -1 if the field is not a number.
+ */
+long tar_Number(const unsigned char * field , int length);
+
+/**
+ * @brief Compares two archive members by name (for qsort and bsearch).
+ *
+ * @param first Pointer to the first member pointer.
+ * @param second Pointer to the second member pointer.
+ * @return Negative, zero or positive, like strcmp.
+ */
+int compare_Archive_Members(const void * first , const void * second);
+
+/**
+ * @brief Compares two archive members by name, then by their place in the archive (for qsort).
+ *
+ * @param first Pointer to the first member pointer.
+ * @param second Pointer to the second member pointer.
+ * @return Negative, zero or positive.
+ */
+int order_Archive_Members(const void * first , const void * second);
+
+/**
+ * @brief Maps a tar archive of sources and indexes its members, without extracting them.
+ *
+ * @param path Path of the archive.
+ * @return TRUE if the archive was indexed, FALSE otherwise (the error is reported).
+ */
+BOOLEAN open_Input_Archive(char * path);
+
+/**
+ * @brief Finds a member of the input archive by path.
+ *
+ * @param path Path of the member (e.g. "prog.as").
+ * @return Pointer to the member, or NULL if there is no input archive or no such member.
+ */
+ARCHIVE_MEMBER * find_Archive_Member(char * path);
+
+/**
+ * @brief Hides a member of the input archive, so the file of the same path is read from disk instead.
+ *
+ * @param path Path of the member (e.g. "prog.as").
+ */
+void hide_Archive_Member(char * path);
+
+/**
+ * @brief Collects the names of the sources of the input archive: its ".as" members, without the suffix.
+ *
+ * Hidden members, and members replaced by a later one of the same name, are left out.
+ *
+ * @param names Array receiving the names (to free), in archive order.
+ * @return Number of names.
+ */
+int archive_Source_Names(char *** names);
+
+/**
+ * @brief Unmaps the input archive and frees its index.
+ */
+void close_Input_Archive(void);
+
+/**
+ * @brief Stores a number as a little-endian number of a given size.
+ *
+ * @param bytes The bytes receiving the number.
+ * @param value The number.
+ * @param size Number of bytes.
+ */
+void archive_put_number(unsigned char * bytes , unsigned long value , int size);
+
+/**
+ * @brief Creates the output archive, which receives the bundles of every file.
+ *
+ * @param path Path of the archive.
+ * @return TRUE if the archive was created, FALSE otherwise (the error is reported).
+ */
+BOOLEAN open_Output_Archive(char * path);
+
+/**
+ * @brief Writes a bundle of output files: to the output archive as members, or to stdout.
+ *
+ * @param bundle Pointer to the bundle.
+ */
+void write_Bundle(OUTPUT_FILE * bundle);
+
+/**
+ * @brief Writes the index and the header of the output archive and closes it.
+ *
+ * @return TRUE if the whole archive was written, FALSE otherwise (the error is reported).
+ */
+BOOLEAN close_Output_Archive(void);
+
+/*-------------Function declaration in Include_Cache.c---------------*/
+
+/**
+ * @brief Looks up an unchanged file in the include cache (the cache lock must be held).
+ *
+ * @param path Path of the included file.
+ * @param file_stat Status of the file on disk.
+ * @return Pointer to the cached file, or NULL if it is not cached.
+ */
+INCLUDE_FILE * find_Included_File(char * path , struct stat * file_stat);
+
+/**
+ * @brief Frees a single include cache entry.
+ *
+ * @param entry Pointer to the entry.
+ */
+void free_Included_File(INCLUDE_FILE * entry);
+
+/**
+ * @brief Returns the preprocessed form of an included file.
+ *
+ * @param path Path of the included file.
+ * @param options Options of the run.
+ * @param depth Include depth of the file.
+ * @return Pointer to the cached file, or NULL if the file cannot be read.
+ */
+INCLUDE_FILE * get_Included_File(char * path , ASSEMBLER_OPTIONS * options , int depth);
+
+/**
+ * @brief Handles an `.include "file"` directive.
+ *
+ * @param head_table Pointer to the assembler table of the including file.
+ * @param writer_am The writer receiving the preprocessed lines.
+ * @param line The directive, without whitespaces.
+ * @param line_count The line number of the directive.
+ * @param depth Include depth of the including file.
+ * @return TRUE if the file was included, FALSE otherwise.
+ */
+BOOLEAN include_File(ASSEMBLER_TABLE ** head_table , AM_WRITER * writer_am , char * line , int line_count , int depth);
+
+/**
+ * @brief Frees the include cache of the process.
+ */
+void free_include_cache(void);
+
+/*-------------Function declaration in Diagnostics.c---------------*/
+
+/**
+ * @brief Initializes an empty diagnostics buffer.
+ *
+ * @param diagnostics Pointer to the diagnostics buffer.
+ */
+void open_diagnostics(DIAGNOSTICS * diagnostics);
+
+/**
+ * @brief Prepares a diagnostics buffer for a new file and makes it the current one.
+ *
+ * @param diagnostics Pointer to the diagnostics buffer (reused from file to file).
+ * @param file_name Name of the source file.
+ * @param options Options of the run (error limit and output format).
+ */
+void begin_diagnostics(DIAGNOSTICS * diagnostics , char * file_name , ASSEMBLER_OPTIONS * options);
+
+/**
+ * @brief Appends formatted diagnostics to the text of a diagnostics buffer.
+ *
+ * A streaming buffer writes its text once it fills a chunk. Without memory to grow the
+ * text, the diagnostics are written right away instead.
+ *
+ * @param diagnostics Pointer to the diagnostics buffer.
+ * @param text The formatted diagnostics.
+ * @param length Length of the text.
+ */
+void append_diagnostic_text(DIAGNOSTICS * diagnostics , const char * text , long length);
+
+/**
+ * @brief Adds a diagnostic to the current file.
+ *
+ * Once the error limit of the file is reached, further errors are dropped and
+ * `diagnostics_limit_reached` tells the caller to stop checking the file.
+ *
+ * @param error_message The error message (one of the error message definitions).
+ * @param detail Additional text appended to the message (e.g. a label name), or NULL.
+ * @param line The line number, or NO_LINE.
+ */
+void report_error(const char * error_message , const char * detail , int line);
+
+/**
+ * @brief Adds a diagnostic that is already filled in to the current file.
+ *
+ * @param entry The diagnostic (its code, line, message and file).
+ */
+void report_diagnostic(DIAGNOSTIC * entry);
+
+/**
+ * @brief Returns the code of an error message.
+ *
+ * @param error_message The error message (one of the error message definitions).
+ * @return The code of the message, or 0 for an unknown message.
+ */
+int error_code(const char * error_message);
+
+/**
+ * @brief Returns the code of an error message, remembering it by the address of the message.
+ *
+ * @param diagnostics The diagnostics buffer holding the cache.
+ * @param error_message The error message (one of the error message definitions).
+ * @return The code of the message, or 0 for an unknown message.
+ */
+int diagnostic_code(DIAGNOSTICS * diagnostics , const char * error_message);
+
+/**
+ * @brief Checks whether the current file reached its error limit.
+ *
+ * @return TRUE if checking the current file should stop, FALSE otherwise.
+ */
+BOOLEAN diagnostics_limit_reached(void);
+
+/**
+ * @brief Copies a string into a JSON string literal, escaping special characters.
+ *
+ * @param output Output buffer (at least six times the length of the string, plus three).
+ * @param text The string to copy.
+ * @return The number of characters written.
+ */
+int json_string(char * output , const char * text);
+
+/**
+ * @brief Writes a non-negative number in decimal, padded with zeros to a minimum number of digits.
+ *
+ * @param output Output buffer.
+ * @param value The number.
+ * @param digits Minimum number of digits.
+ * @return The number of characters written.
+ */
+int format_number(char * output , int value , int digits);
+
+/**
+ * @brief Formats a single diagnostic in text or JSON-lines form.
+ *
+ * @param diagnostics The diagnostics buffer the entry belongs to.
+ * @param entry The diagnostic to format.
+ * @param output Output buffer of MAX_DIAGNOSTIC_OUTPUT characters.
+ * @return The number of characters written.
+ */
+int format_diagnostic(DIAGNOSTICS * diagnostics , DIAGNOSTIC * entry , char * output);
+
+/**
+ * @brief Writes all diagnostics of the current file at once, then its bundle of output files, and empties the buffer.
+ *
+ * @param diagnostics Pointer to the diagnostics buffer.
+ */
+void flush_diagnostics(DIAGNOSTICS * diagnostics);
+
+/**
+ * @brief Makes a diagnostics buffer the current one of the calling thread.
+ *
+ * @param diagnostics Pointer to the diagnostics buffer, or NULL for none.
+ */
+void set_current_diagnostics(DIAGNOSTICS * diagnostics);
+
+/**
+ * @brief Returns the current diagnostics buffer of the calling thread.
+ *
+ * @return Pointer to the diagnostics buffer, or NULL outside of a file.
+ */
+DIAGNOSTICS * get_current_diagnostics(void);
+
+/**
+ * @brief Creates the key holding the current diagnostics of each thread.
+ */
+void create_diagnostics_key(void);
+
+/**
+ * @brief Moves the diagnostics of one buffer to the end of another.
+ *
+ * @param diagnostics The buffer receiving the diagnostics.
+ * @param other The buffer whose diagnostics are moved (emptied).
+ */
+void append_diagnostics(DIAGNOSTICS * diagnostics , DIAGNOSTICS * other);
+
+/**
+ * @brief Flushes the current diagnostics buffer, if any.
+ *
+ * Registered with `atexit`, so errors collected before a fatal error are not lost.
+ */
+void flush_current_diagnostics(void);
+
+/**
+ * @brief Frees the memory held by a diagnostics buffer.
+ *
+ * @param diagnostics Pointer to the diagnostics buffer.
+ */
+void free_diagnostics(DIAGNOSTICS * diagnostics);
+
+/*-------------Function declaration in Functions.c---------------*/
+
+/**
+ * @brief Checks if a word is a reserved word.
+ *
+ * This function checks if the given word is a reserved word and prints
+ * an error message if so.
+ *
+ * @param line The word to check.
+ * @param error_message Error message to print if the word is reserved.
+ * @param line_count Line number for error reporting.
+ * @return TRUE if the word is valid, FALSE if it's a reserved word.
+ */
+BOOLEAN Reserved_Words_Check(char * line , const char * error_message , int line_count);
+
+/**
+ * @brief Reports an error message with the line number.
+ *
+ * The error is added to the diagnostics of the current file, or printed right away
+ * when no file is being assembled.
+ *
+ * @param error_message The error message to report.
+ * @param line The line number where the error occurred.
+ */
+void print_error(const char *error_message, int line);
+
+/**
+ * @brief Frees memory allocated for the assembler table.
+ *
+ * This function frees all memory associated with the assembler table,
+ * including macros, labels, entries, externals, and machine code.
+ *
+ * @param table Pointer to the assembler table.
+ */
+void free_assembler_table(ASSEMBLER_TABLE **table);
+
+/**
+ * @brief Frees memory allocated for machine code instructions.
+ *
+ * Frees the linked list of machine code instructions.
+ *
+ * @param head Pointer to the head of the machine code instruction list.
+ */
+void free_machine_code_instruction(MACHINE_CODE_INSTRUCTION **head);
+
+/**
+ * @brief Frees memory allocated for machine code commands.
+ *
+ * Frees the linked list of machine code commands.
+ *
+ * @param head Pointer to the head of the machine code command list.
+ */
+void free_machine_code_command(MACHINE_CODE_COMMAND **head);
+
+/**
+ * @brief Frees memory allocated for the extern list.
+ *
+ * Frees the linked list of extern labels and addresses.
+ *
+ * @param head Pointer to the head of the extern list.
+ */
+void free_extern_list(EXTERN_LIST **head);
+
+/**
+ * @brief Frees memory allocated for the entry list.
+ *
+ * Frees the linked list of entry labels and addresses.
+ *
+ * @param head Pointer to the head of the entry list.
+ */
+void free_entry_list(ENTRY_LIST **head);
+
+/**
+ * @brief Frees memory allocated for the address list.
+ *
+ * Frees the linked list of addresses.
+ *
+ * @param head Pointer to the head of the address list.
+ */
+void free_address_list(ADDRESS_LIST **head);
+
+/**
+ * @brief Frees memory allocated for the label list.
+ *
+ * Frees the linked list of labels.
+ *
+ * @param head Pointer to the head of the label list.
+ */
+void free_label_list(LABEL_LIST **head);
+
+/**
+ * @brief Frees memory allocated for the macro list.
+ *
+ * Frees the linked list of macros.
+ *
+ * @param head Pointer to the head of the macro list.
+ */
+void free_macro_list(MACRO_LIST **head);
+
+/**
+ * @brief Frees memory allocated for the macro content.
+ *
+ * Frees the linked list of macro content.
+ *
+ * @param head Pointer to the head of the macro content list.
+ */
+void free_macro_content(MACRO_CONTENT **head);
+
+/**
+ * @brief Allocates memory dynamically and checks for allocation failure.
+ *
+ * This function allocates memory of the specified size and checks if the allocation
+ * was successful. If memory allocation fails, an error message is printed and the
+ * program exits.
+ *
+ * @param size The size of the memory to allocate (in bytes).
+ * @return Pointer to the allocated memory.
+ */
+void * generic_malloc(long size);
+
+/**
+ * @brief Adds a suffix to a file name.
  *
  * This function creates a new string by appending the specified suffix (file extension)
  * to the provided file name.
@@ -962,3 +2562,16 @@ void * generic_malloc(long size);
  */
 char * add_suffix(char * file_name , char * ending);
 
+/**
+ * @brief Returns the next token of a string, like strtok but without hidden state.
+ *
+ * Leading delimiters are skipped and the token is null terminated in place. The position
+ * after the token is kept in the cursor of the caller, so files can be tokenized by
+ * several threads at once.
+ *
+ * @param cursor Pointer to the position in the string, updated past the token.
+ * @param delimiters The characters separating the tokens.
+ * @return Pointer to the token, or NULL when no token is left.
+ */
+char * next_Token(char ** cursor , const char * delimiters);
+
@@ -0,0 +1,17 @@
+; Calls a subroutine 2000000 times, built from jsr/rts and reg-reg mov
+MAIN: mov #2000, r6
+OUTER: mov #1000, r7
+CALL: jsr SQUARE
+ dec r7
+ cmp r7, #0
+ bne CALL
+ dec r6
+ cmp r6, #0
+ bne OUTER
+ prn r0
+ stop
+SQUARE: mov r7, r1
+ mov r1, r2
+ add r2, r0
+ mov r0, r3
+ rts
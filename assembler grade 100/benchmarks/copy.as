@@ -0,0 +1,23 @@
+; Copies a string 20000 times through *r pointers
+; Built from the cmp/bne and inc/jmp idioms
+MAIN: mov #20, r6
+ROUND: mov #1000, r7
+AGAIN: lea SRC, r1
+ lea DST, r2
+NEXT: mov *r1, *r2
+ cmp *r1, #0
+ bne MORE
+ dec r7
+ cmp r7, #0
+ bne AGAIN
+ dec r6
+ cmp r6, #0
+ bne ROUND
+ prn r5
+ stop
+MORE: inc r1
+ inc r2
+ inc r5
+ jmp NEXT
+SRC: .string "the quick brown fox jumps over the lazy dog"
+DST: .string "-------------------------------------------"
@@ -0,0 +1,18 @@
+; Nested counting loops, built from the cmp/bne and dec/jmp idioms
+; The outer loop runs 2000 times, the inner one 2000 times for each
+macr next_inner
+dec r1
+jmp INNER
+endmacr
+MAIN: mov #2000, r2
+OUTER: mov #2000, r1
+INNER: cmp r1, #0
+ bne BODY
+ dec r2
+ cmp r2, #0
+ bne OUTER
+ prn r3
+ stop
+BODY: add r1, r3
+ mov r3, r4
+ next_inner
@@ -0,0 +1,16 @@
+; Stores through *r2 while r2 runs past the 4095 memory words
+; The address wraps around memory, so the stores land in cells 0 to 9
+MAIN: mov #2047, r2
+ add #2047, r2
+ add #4, r2
+ mov #10, r3
+LOOP: mov #-1, *r2
+ inc r2
+ dec r3
+ cmp #0, r3
+ bne LOOP
+ mov r2, r4
+ sub #9, r4
+ prn *r4
+ prn r2
+ stop
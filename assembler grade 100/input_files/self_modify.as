@@ -0,0 +1,20 @@
+; Rewrites the operand of a prn after it has run, then stores through
+; *r2 with r2 past the last word and reads the cell back through *r4
+; Prints 1, 7, then 5
+MAIN: lea SHOW, r1
+ inc r1
+ mov #2, r3
+SHOW: prn #1
+ mov #60, *r1
+ dec r3
+ cmp #0, r3
+ bne SHOW
+ mov #2047, r2
+ add #2047, r2
+ add #2047, r2
+ add #1866, r2
+ mov #5, *r2
+ mov #2047, r4
+ add #1864, r4
+ prn *r4
+ stop
@@ -0,0 +1,3 @@
+; Includes shared_errors.inc, whose errors are reported here
+.include "shared_errors.inc"
+MAIN: stop
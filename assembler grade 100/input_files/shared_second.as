@@ -0,0 +1,4 @@
+; Includes shared_errors.inc, whose errors are reported here as well
+MAIN: inc r1
+.include "shared_errors.inc"
+ stop
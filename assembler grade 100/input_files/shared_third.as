@@ -0,0 +1,3 @@
+; Includes shared_errors.inc through shared_nested.inc
+.include "shared_nested.inc"
+MAIN: stop
@@ -0,0 +1,337 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include "simulator.h"
+
+/*
+ * JIT: runs the program of a simulator as native x86-64 code.
+ *
+ * A basic block (the instructions from an address up to the first jmp, bne, jsr, rts or
+ * stop) is translated the first time it runs, into a buffer of native code, and kept in
+ * a cache indexed by the address of the block. The buffer is never writable and executable
+ * at once: it is made writable to translate a block, and read-only and executable again
+ * before native code runs, so the JIT also runs on hosts refusing such mappings.
+ * The registers r0 to r7 live in the host registers r8 to r15 while native code runs.
+ * At the end of a block, its next address is
+ * looked up in the cache and the translated block is jumped to, so the code leaves native
+ * code only to translate a block.
+ *
+ * prn and red call functions of the simulator, with the registers saved around the call.
+ * Each block takes its number of instructions from the step budget before it runs; when the
+ * budget is too low, or jsr and rts find the stack full or empty, or the next instruction
+ * cannot be translated, the instruction runs in the interpreter (run_Simulator), so the
+ * results and errors are the same as without the JIT.
+ *
+ * A word written over a translated block throws every translation away; the instruction
+ * after the store goes on in a new translation.
+ *
+ * The JIT is built on x86-64 hosts only; create_Jit returns NULL on others.
+ */
+
+/* Size of the buffer of native code; when it is full, every translation is thrown away */
+#define JIT_BUFFER_SIZE (4 * 1024 * 1024)
+
+/* Maximum number of instructions of a block, and of bytes of native code of one instruction */
+#define JIT_MAX_BLOCK 64
+#define JIT_MAX_INSTRUCTION_SIZE 256
+
+/* Maximum number of exits of a block giving steps back to the budget */
+#define JIT_MAX_REFUNDS (2 * JIT_MAX_BLOCK)
+
+/* Why native code went back to run_Jit */
+#define JIT_CONTINUE 0 /* The next block is not translated yet */
+#define JIT_HALTED 1 /* stop ran */
+#define JIT_INTERPRET 2 /* The instruction at pc must run in the interpreter */
+#define JIT_FLUSH 3 /* A translated word was written over */
+
+/* Host registers, as numbered by the x86-64 encoding */
+#define JIT_RAX 0
+#define JIT_RCX 1
+#define JIT_RDX 2
+#define JIT_RBX 3
+#define JIT_RSP 4
+#define JIT_RBP 5
+#define JIT_RSI 6
+#define JIT_RDI 7
+#define JIT_R8 8
+
+/**
+ * @brief State of the JIT, reached by native code through the host register rbp.
+ */
+typedef struct JIT{
+    SIMULATOR * sim; /* The simulator */
+    unsigned short * cells; /* Memory and registers of the simulator (host register rbx) */
+    unsigned long budget; /* Instructions left to run */
+    unsigned int status; /* JIT_CONTINUE to JIT_FLUSH */
+    unsigned int pc; /* Address where native code stopped */
+    unsigned int stack_pointer; /* Address of the top of the stack */
+    unsigned int image_end; /* Lowest address the stack can reach */
+    unsigned char zero_flag; /* Nonzero if the last cmp found its operands equal */
+    unsigned char * buffer; /* Native code */
+    unsigned long used; /* Bytes of the buffer used */
+    int writable; /* Nonzero while the buffer is writable (and not executable) */
+    unsigned char * enter; /* Native code entering a block: saves the host registers and loads r0 to r7 */
+    unsigned char * dispatch; /* Native code going on at the address in eax */
+    unsigned char * leave; /* Native code going back to run_Jit */
+    unsigned long stubs_size; /* Bytes of enter, dispatch and leave, at the start of the buffer */
+    unsigned long refund_at[JIT_MAX_REFUNDS]; /* Position of the steps given back by each exit of the block being translated */
+    unsigned int refund_executed[JIT_MAX_REFUNDS]; /* Number of instructions run before each of these exits */
+    unsigned int refunds; /* Number of these exits */
+    unsigned long blocks; /* Number of blocks translated */
+    unsigned long flushes; /* Number of times the translations were thrown away */
+    unsigned char translated[SIM_MEMORY_SIZE]; /* Nonzero for each word of a translated block */
+    unsigned char * code[SIM_MEMORY_SIZE + 1]; /* Translated block of each address, or NULL */
+} JIT;
+
+/*-------------Function declaration in Jit.c---------------*/
+
+/**
+ * @brief Appends a byte to the native code.
+ *
+ * @param jit The JIT.
+ * @param byte The byte.
+ */
+void emit_Byte(JIT * jit , unsigned int byte);
+
+/**
+ * @brief Appends a little-endian 32-bit number to the native code.
+ *
+ * @param jit The JIT.
+ * @param value The number.
+ */
+void emit_U32(JIT * jit , unsigned long value);
+
+/**
+ * @brief Appends the REX prefix and the opcode of an instruction.
+ *
+ * @param jit The JIT.
+ * @param wide Nonzero for a 64-bit operation.
+ * @param opcode One or two bytes of opcode.
+ * @param reg Register of the reg field.
+ * @param index Register of the SIB index, or -1.
+ * @param base Register of the r/m field or of the SIB base.
+ */
+void emit_Opcode(JIT * jit , int wide , unsigned int opcode , int reg , int index , int base);
+
+/**
+ * @brief Appends an instruction whose operands are two registers.
+ *
+ * @param jit The JIT.
+ * @param wide Nonzero for a 64-bit operation.
+ * @param opcode The opcode.
+ * @param reg Register (or /digit) of the reg field.
+ * @param rm Register of the r/m field.
+ */
+void emit_Op_Register(JIT * jit , int wide , unsigned int opcode , int reg , int rm);
+
+/**
+ * @brief Appends an instruction with a memory operand [base + index * 2^scale + displacement].
+ *
+ * @param jit The JIT.
+ * @param prefix 0x66 for a 16-bit operation, 0 otherwise.
+ * @param wide Nonzero for a 64-bit operation.
+ * @param opcode The opcode.
+ * @param reg Register (or /digit) of the reg field.
+ * @param base Base register.
+ * @param index Index register, or -1.
+ * @param scale Log2 of the scale of the index.
+ * @param displacement The displacement.
+ */
+void emit_Op_Memory(JIT * jit , unsigned int prefix , int wide , unsigned int opcode , int reg , int base , int index , int scale , long displacement);
+
+/**
+ * @brief Appends a jump (or a conditional jump) to native code already written.
+ *
+ * @param jit The JIT.
+ * @param condition Condition code, or JIT_ALWAYS.
+ * @param target The native code jumped to.
+ */
+void emit_Jump(JIT * jit , int condition , const unsigned char * target);
+
+/**
+ * @brief Appends a short conditional jump over the code that follows, to patch with patch_Skip.
+ *
+ * @param jit The JIT.
+ * @param condition Condition code.
+ * @return Position of the displacement.
+ */
+unsigned long emit_Skip(JIT * jit , int condition);
+
+/**
+ * @brief Makes a short jump appended by emit_Skip land at the end of the native code.
+ *
+ * @param jit The JIT.
+ * @param position Position of the displacement.
+ */
+void patch_Skip(JIT * jit , unsigned long position);
+
+/**
+ * @brief Appends mov reg, imm32.
+ *
+ * @param jit The JIT.
+ * @param reg The register.
+ * @param value The number.
+ */
+void emit_Move_Immediate(JIT * jit , int reg , unsigned long value);
+
+/**
+ * @brief Appends an ALU operation of a register and a 32-bit number (add, sub, and or cmp).
+ *
+ * @param jit The JIT.
+ * @param digit The /digit of the operation.
+ * @param reg The register.
+ * @param value The number.
+ */
+void emit_Alu_Immediate(JIT * jit , int digit , int reg , unsigned long value);
+
+/**
+ * @brief Appends the code saving the registers r0 to r7 to the cells, or loading them from the cells.
+ *
+ * @param jit The JIT.
+ * @param save Nonzero to save, zero to load.
+ */
+void emit_Registers(JIT * jit , int save);
+
+/**
+ * @brief Appends a call of a function of the simulator, taking the simulator and esi, the registers saved around it.
+ *
+ * @param jit The JIT.
+ * @param function The function.
+ */
+void emit_Call(JIT * jit , void (*function)(void));
+
+/**
+ * @brief Appends the code going back to run_Jit.
+ *
+ * @param jit The JIT.
+ * @param status Why native code stops (JIT_HALTED to JIT_FLUSH).
+ * @param pc Address where it stops, or -1 when eax holds it.
+ * @param executed Number of instructions of the block that ran, whose steps are kept (the others are given back), or -1 to give none back.
+ */
+void emit_Exit(JIT * jit , unsigned int status , long pc , int executed);
+
+/**
+ * @brief Returns the number the native code of an operand is built from.
+ *
+ * @param sim The simulator.
+ * @param mode Addressing mode of the operand.
+ * @param cell Cell of the operand, as decoded.
+ * @param index Index of the operand, as decoded.
+ * @return The immediate value, the address of a direct operand, or the register.
+ */
+unsigned int jit_Operand(const SIMULATOR * sim , int mode , const unsigned short * cell , const unsigned short * index);
+
+/**
+ * @brief Appends the code loading an operand into a host register (rcx is used by an indirect operand).
+ *
+ * @param jit The JIT.
+ * @param mode Addressing mode of the operand.
+ * @param value Number of the operand (see jit_Operand).
+ * @param host The host register.
+ */
+void emit_Load(JIT * jit , int mode , unsigned int value , int host);
+
+/**
+ * @brief Appends the code storing eax to the target operand (rcx holds the address of an indirect one).
+ *
+ * @param jit The JIT.
+ * @param mode Addressing mode of the operand.
+ * @param value Number of the operand (see jit_Operand).
+ * @param next Address of the next instruction.
+ * @param executed Number of instructions of the block that ran, with this one.
+ */
+void emit_Store(JIT * jit , int mode , unsigned int value , unsigned int next , int executed);
+
+/**
+ * @brief Appends the code putting the address a jmp, bne or jsr jumps to in eax.
+ *
+ * @param jit The JIT.
+ * @param mode Addressing mode of the operand.
+ * @param value Number of the operand (see jit_Operand).
+ */
+void emit_Jump_Address(JIT * jit , int mode , unsigned int value);
+
+/**
+ * @brief Appends the native code of an instruction.
+ *
+ * @param jit The JIT.
+ * @param address Address of the instruction.
+ * @param instruction The decoded instruction.
+ * @param executed Number of instructions of the block before this one.
+ * @return Nonzero if the instruction ends the block.
+ */
+int emit_Instruction(JIT * jit , unsigned int address , const SIM_INSTRUCTION * instruction , int executed);
+
+/**
+ * @brief Appends the native code shared by the blocks: entering a block, going on at an address, and leaving.
+ *
+ * @param jit The JIT.
+ */
+void emit_Stubs(JIT * jit);
+
+/**
+ * @brief Creates the JIT of a simulator and maps its buffer.
+ *
+ * @param sim The simulator.
+ * @return The JIT (to free with free_Jit), or NULL if the host is not x86-64 or the buffer cannot be mapped.
+ */
+JIT * create_Jit(SIMULATOR * sim);
+
+/**
+ * @brief Makes the buffer of a JIT writable to translate blocks, or executable to run them.
+ *
+ * @param jit The JIT.
+ * @param writable Nonzero for writable, 0 for read-only and executable.
+ * @return 0 on success, 1 if the protection cannot be changed.
+ */
+int protect_Jit(JIT * jit , int writable);
+
+/**
+ * @brief Throws every translation away.
+ *
+ * @param jit The JIT.
+ */
+void flush_Jit(JIT * jit);
+
+/**
+ * @brief Translates the block starting at an address.
+ *
+ * @param jit The JIT.
+ * @param address Address of the block.
+ * @return The native code of the block, or NULL if its first instruction cannot be translated or the buffer cannot be made writable.
+ */
+unsigned char * translate_Block(JIT * jit , unsigned int address);
+
+/**
+ * @brief Runs the program of the simulator until it stops, as run_Simulator does.
+ *
+ * @param jit The JIT.
+ * @param start Address of the first instruction.
+ * @return SIM_HALTED when stop runs, or the error that stopped the run (sim->pc is its address).
+ */
+int run_Jit(JIT * jit , unsigned int start);
+
+/**
+ * @brief Unmaps the buffer of a JIT and frees it.
+ *
+ * @param jit The JIT, or NULL.
+ */
+void free_Jit(JIT * jit);
+
+/**
+ * @brief Writes a number for prn, called from native code.
+ *
+ * @param sim The simulator.
+ * @param word The word to write.
+ */
+void jit_Print(SIMULATOR * sim , unsigned int word);
+
+/**
+ * @brief Reads a character for red, called from native code.
+ *
+ * @param sim The simulator.
+ * @return The character as a word, SIM_WORD_MASK (-1) at the end of the input.
+ */
+unsigned int jit_Read(SIMULATOR * sim);
+
+#endif
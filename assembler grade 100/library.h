@@ -0,0 +1,153 @@
+#ifndef LIBRARY_H
+#define LIBRARY_H
+
+#include <stdio.h>
+#include "object.h"
+
+/*
+ * Object library: many binary objects packed into one file, with a hashed index of
+ * their entry symbols.
+ *
+ * All numbers are little-endian and every table is made of byte arrays:
+ *
+ *   LIBRARY_HEADER
+ *   LIBRARY_MEMBER[member_count]   the members, in the order they were added
+ *   LIBRARY_SLOT[slot_count]       open addressing hash table of the entry symbols
+ *   strings                        null terminated member and symbol names
+ *   members                        one binary object (see object.h) per member
+ *
+ * The header, tables and strings form the index, mapped to look up symbols. A symbol
+ * is found in the slots by its hash (symbol_Hash), probing the next slots until an
+ * empty one, and each member is mapped on its own only when it is needed.
+ */
+
+#define LIBRARY_MAGIC "ALB1"
+#define LIBRARY_VERSION 1
+
+/* Members start on multiples of this */
+#define LIBRARY_ALIGNMENT 8
+
+/* Member of an empty slot */
+#define LIBRARY_EMPTY_SLOT 0xFFFFFFFFUL
+
+/* Smallest number of slots */
+#define LIBRARY_MIN_SLOTS 16
+
+/**
+ * @brief Header of a library file.
+ */
+typedef struct LIBRARY_HEADER{
+    char magic[4]; /* LIBRARY_MAGIC */
+    unsigned char version[4]; /* LIBRARY_VERSION */
+    unsigned char member_count[4]; /* Number of members */
+    unsigned char symbol_count[4]; /* Number of entry symbols */
+    unsigned char slot_count[4]; /* Number of slots, a power of two */
+    unsigned char members_offset[4]; /* Offset of the members table */
+    unsigned char slots_offset[4]; /* Offset of the slots */
+    unsigned char strings_offset[4]; /* Offset of the names */
+    unsigned char strings_size[4]; /* Size of the names */
+    unsigned char index_size[4]; /* Size of the header, tables and names */
+    unsigned char file_size[4]; /* Size of the whole file */
+} LIBRARY_HEADER;
+
+/**
+ * @brief A member of a library file.
+ */
+typedef struct LIBRARY_MEMBER{
+    unsigned char name_offset[4]; /* Offset of the name in the strings */
+    unsigned char offset[4]; /* Offset of the binary object in the file */
+    unsigned char size[4]; /* Size of the binary object */
+} LIBRARY_MEMBER;
+
+/**
+ * @brief A slot of the symbol index of a library file.
+ */
+typedef struct LIBRARY_SLOT{
+    unsigned char name_offset[4]; /* Offset of the name of the symbol in the strings */
+    unsigned char hash[4]; /* Hash of the name */
+    unsigned char member[4]; /* Member defining the symbol, LIBRARY_EMPTY_SLOT for an empty slot */
+} LIBRARY_SLOT;
+
+/**
+ * @brief A library file with its index mapped into memory.
+ */
+typedef struct LIBRARY_FILE{
+    int fd; /* Descriptor of the file, to map the members */
+    void * index; /* Start of the mapping of the index */
+    long index_size; /* Size of the index */
+    long file_size; /* Size of the file */
+    unsigned int member_count; /* Number of members */
+    unsigned int symbol_count; /* Number of entry symbols */
+    unsigned int slot_count; /* Number of slots */
+    const LIBRARY_MEMBER * members; /* The members */
+    const LIBRARY_SLOT * slots; /* The symbol index */
+    const char * strings; /* Member and symbol names */
+    unsigned int strings_size; /* Size of the names */
+} LIBRARY_FILE;
+
+/*-------------Function declaration in Library.c---------------*/
+
+/**
+ * @brief Writes objects as a library file.
+ *
+ * @param file_name Name of the file.
+ * @param images The objects.
+ * @param names Names of the members.
+ * @param count Number of objects.
+ * @param report Stream the errors are written to.
+ * @return 0 on success, 1 if a symbol is defined by two members or the file cannot be written.
+ */
+int write_Library(const char * file_name , const OBJECT_IMAGE * images , char ** names , unsigned int count , FILE * report);
+
+/**
+ * @brief Opens a library file, maps its index and checks its header and tables.
+ *
+ * @param file_name Name of the file.
+ * @return Pointer to the library, or NULL if the file cannot be read or is not a valid library.
+ */
+LIBRARY_FILE * load_Library(const char * file_name);
+
+/**
+ * @brief Finds the member defining a symbol.
+ *
+ * @param library The library.
+ * @param name Name of the symbol.
+ * @return Index of the member, or -1 if no member defines the symbol.
+ */
+long find_Library_Symbol(const LIBRARY_FILE * library , const char * name);
+
+/**
+ * @brief Finds a member by name.
+ *
+ * @param library The library.
+ * @param name Name of the member.
+ * @return Index of the member, or -1 if there is no such member.
+ */
+long find_Library_Member(const LIBRARY_FILE * library , const char * name);
+
+/**
+ * @brief Returns the name of a member.
+ *
+ * @param library The library.
+ * @param member Index of the member.
+ * @return The null terminated name.
+ */
+const char * library_Member_Name(const LIBRARY_FILE * library , unsigned int member);
+
+/**
+ * @brief Maps a member of a library.
+ *
+ * @param library The library.
+ * @param member Index of the member.
+ * @return The mapped object (to unload with unload_Object), or NULL if it is not a valid object.
+ */
+OBJECT_FILE * load_Library_Member(const LIBRARY_FILE * library , unsigned int member);
+
+/**
+ * @brief Unmaps and closes a library file.
+ *
+ * @param library Pointer to the library pointer (set to NULL).
+ */
+void close_Library(LIBRARY_FILE ** library);
+
+#endif
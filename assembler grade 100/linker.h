@@ -0,0 +1,325 @@
+#ifndef LINKER_H
+#define LINKER_H
+
+#include <stdio.h>
+#include <pthread.h>
+#include "library.h"
+
+/*
+ * Linker: joins the objects written by the assembler into one image.
+ *
+ * The code of every module comes first, in the order of the command line, followed by
+ * the data of every module. Each relocatable word (R) is moved with its module, and
+ * each extern reference (E) is patched with the linked address of the entry defining
+ * the symbol in another module.
+ *
+ * A module assembled with --relocatable has a relocation table (.rel) listing its
+ * relocatable words; only these words are patched. Without one, every code word marked
+ * R is relocated.
+ *
+ * Linking runs in phases, the parallel ones split between the workers (-j):
+ *   1. the modules are read, and their entries hashed and grouped by shard (parallel)
+ *   2. each shard of the symbol table is filled by one worker, in module order (parallel)
+ *   3. with --strip, the modules reachable from the root symbols are marked
+ *   4. the base addresses of the modules are the prefix sums of their sizes
+ *   5. the words of each module are relocated and patched into the linked image (parallel)
+ * Every module and shard is handled the same way whichever worker takes it, and the
+ * errors are reported after each phase in module order, so the output does not depend
+ * on the number of workers.
+ *
+ * With --strip, only the modules defining a root symbol (--root=SYM, or the first module
+ * when no root is given), and the modules they reach through their extern references,
+ * are linked. Only the entries that are roots or are referenced by a linked module are
+ * kept in the linked entries.
+ *
+ * With --library=FILE, a symbol that no module defines is looked up in the index of the
+ * library FILE (see library.h), and the member defining it is mapped and linked as one
+ * more module, with the members its own extern references need. The libraries are
+ * searched in the order of the command line.
+ */
+
+/* A, R and E bits of a code word, as written by the assembler */
+#define LINK_ARE_MASK 7
+#define LINK_ABSOLUTE 4
+#define LINK_RELOCATABLE 2
+#define LINK_EXTERNAL 1
+#define LINK_ADDRESS_SHIFT 3
+
+/* Highest address a word can refer to (12 bits) */
+#define LINK_MAX_ADDRESS 4095
+
+/* Base name of the linked files when -o is not given */
+#define LINK_DEFAULT_OUTPUT "linked"
+
+/* The symbol table is split in shards, chosen by the top bits of the hash */
+#define LINK_SHARD_BITS 6
+#define LINK_SHARDS (1 << LINK_SHARD_BITS)
+
+/* Maximum number of workers (-j), and number of modules a worker takes at once */
+#define LINK_MAX_JOBS 256
+#define LINK_CHUNK 16
+
+/* Phases of a link */
+#define LINK_LOAD 0
+#define LINK_MERGE 1
+#define LINK_PATCH 2
+
+/**
+ * @brief A module given to the linker.
+ */
+typedef struct LINK_MODULE{
+    const char * name; /* Base name of the object files, or name of the binary object file */
+    OBJECT_IMAGE image; /* Contents of the object */
+    int has_relocations; /* Nonzero if the module has a relocation table */
+    unsigned int * relocations; /* Addresses of the relocatable words, in increasing order */
+    unsigned int relocation_count; /* Number of relocatable words */
+    unsigned long * entry_hashes; /* Hash of the name of each entry */
+    unsigned int * shard_entries; /* Indexes of the entries, grouped by shard */
+    unsigned int shard_start[LINK_SHARDS + 1]; /* First index in shard_entries of each shard */
+    unsigned int code_base; /* Linked address of the first code word */
+    unsigned int data_base; /* Linked address of the first data word */
+    unsigned long entry_base; /* Index of the first entry of the module in the linked entries */
+    int kept; /* Nonzero if the module is linked */
+    unsigned char * entry_kept; /* Nonzero for each entry kept in the linked entries, NULL to keep them all */
+    int status; /* Nonzero if the last phase failed for the module */
+} LINK_MODULE;
+
+/**
+ * @brief An entry symbol in the global symbol table.
+ */
+typedef struct LINK_SYMBOL{
+    const char * name; /* Name of the symbol, NULL for an empty slot */
+    unsigned long hash; /* Hash of the name */
+    unsigned int address; /* Address in the module defining the symbol */
+    unsigned int module; /* Index of the module defining the symbol */
+    unsigned int entry; /* Index of the entry in the module */
+    int referenced; /* Nonzero if the symbol is a root or is referenced by a linked module */
+} LINK_SYMBOL;
+
+/**
+ * @brief Open addressing hash table of the entry symbols of one shard.
+ */
+typedef struct SYMBOL_TABLE{
+    LINK_SYMBOL * slots; /* capacity slots */
+    unsigned long capacity; /* Number of slots, a power of two */
+    unsigned long count; /* Number of symbols */
+    unsigned long duplicates; /* Number of symbols defined more than once */
+    int status; /* Nonzero if memory ran out */
+} SYMBOL_TABLE;
+
+/**
+ * @brief State of a link, shared by the workers.
+ */
+typedef struct LINKER{
+    LINK_MODULE * modules; /* The modules, in command line order */
+    unsigned int count; /* Number of modules */
+    SYMBOL_TABLE shards[LINK_SHARDS]; /* The global symbol table */
+    OBJECT_IMAGE linked; /* The linked image */
+    int jobs; /* Number of workers */
+    int strip; /* Nonzero to link only the modules reachable from the roots */
+    char ** roots; /* Root symbols (--root) */
+    unsigned int root_count; /* Number of root symbols */
+    unsigned int capacity; /* Number of modules allocated */
+    LIBRARY_FILE ** libraries; /* Libraries searched for undefined symbols (--library) */
+    unsigned char ** members_added; /* For each library, nonzero for each member linked */
+    unsigned int library_count; /* Number of libraries */
+    int phase; /* Current phase (LINK_LOAD, LINK_MERGE or LINK_PATCH) */
+    unsigned int next; /* Next module or shard of the phase to take */
+    unsigned int total; /* Number of modules or shards of the phase */
+    pthread_mutex_t lock; /* Protects next */
+} LINKER;
+
+/*-------------Function declaration in Linker.c---------------*/
+
+/**
+ * @brief Returns the shard of the symbol table holding a symbol.
+ *
+ * @param hash Hash of the name of the symbol.
+ * @return Index of the shard.
+ */
+unsigned int symbol_Shard(unsigned long hash);
+
+/**
+ * @brief Creates an empty symbol table.
+ *
+ * @param table The table.
+ * @param count Number of symbols the table will hold.
+ * @return 0 on success, 1 if memory ran out.
+ */
+int create_Symbol_Table(SYMBOL_TABLE * table , unsigned long count);
+
+/**
+ * @brief Finds the slot of a symbol, or the empty slot where it belongs.
+ *
+ * @param table The table.
+ * @param name Name of the symbol.
+ * @param hash Hash of the name.
+ * @return The slot.
+ */
+LINK_SYMBOL * find_Symbol_Slot(const SYMBOL_TABLE * table , const char * name , unsigned long hash);
+
+/**
+ * @brief Finds a symbol in the global symbol table.
+ *
+ * @param linker The link.
+ * @param name Name of the symbol.
+ * @return The symbol, or NULL if no module defines it.
+ */
+LINK_SYMBOL * find_Symbol(const LINKER * linker , const char * name);
+
+/**
+ * @brief Frees a symbol table.
+ *
+ * @param table The table.
+ */
+void free_Symbol_Table(SYMBOL_TABLE * table);
+
+/**
+ * @brief Reads a module, from NAME.obj when the name ends with .obj, from NAME.ob, NAME.ent and NAME.ext otherwise, with its relocation table NAME.rel if there is one.
+ *
+ * @param module The module, its name set.
+ * @return 0 on success, 1 if the module cannot be read.
+ */
+int load_Module(LINK_MODULE * module);
+
+/**
+ * @brief Hashes the entries of a module and groups them by shard.
+ *
+ * @param module The module.
+ * @return 0 on success, 1 if memory ran out.
+ */
+int hash_Entries(LINK_MODULE * module);
+
+/**
+ * @brief Converts an address of a module to its linked address.
+ *
+ * @param module The module.
+ * @param address The address in the module.
+ * @return The linked address.
+ */
+unsigned int relocate_Address(const LINK_MODULE * module , unsigned int address);
+
+/**
+ * @brief Relocates a relocatable code word of a module into the linked image.
+ *
+ * @param module The module.
+ * @param offset Index of the word in the code of the module.
+ * @param code The code of the module in the linked image.
+ * @param report Stream the errors are written to, or NULL.
+ * @return 0 on success, 1 if the word is not relocatable or refers outside of its module.
+ */
+int relocate_Word(const LINK_MODULE * module , unsigned int offset , unsigned short * code , FILE * report);
+
+/**
+ * @brief Marks a module as linked and pushes it on the stack of modules to visit.
+ *
+ * @param linker The link.
+ * @param index Index of the module.
+ * @param stack The stack.
+ * @param top Pointer to the number of modules on the stack.
+ */
+void keep_Module(LINKER * linker , unsigned int index , unsigned int * stack , unsigned int * top);
+
+/**
+ * @brief Marks the modules reachable from the root symbols through the extern references, and the entries to keep.
+ *
+ * @param linker The link.
+ * @return 0 on success, 1 if a root symbol is not defined or memory ran out.
+ */
+int mark_Reachable(LINKER * linker);
+
+/**
+ * @brief Writes how much of the image was stripped.
+ *
+ * @param linker The link.
+ */
+void report_Stripped(const LINKER * linker);
+
+/**
+ * @brief Places the code, data and entries of the linked modules in the linked image, at the prefix sums of their sizes.
+ *
+ * @param linker The link.
+ * @return 0 on success, 1 if the image does not fit in the memory or memory ran out.
+ */
+int layout_Modules(LINKER * linker);
+
+/**
+ * @brief Fills a shard of the global symbol table with the entries of all the modules, in module order.
+ *
+ * @param linker The link.
+ * @param shard Index of the shard.
+ */
+void merge_Shard(LINKER * linker , unsigned int shard);
+
+/**
+ * @brief Checks the global symbol table after it is filled, reporting the symbols defined more than once.
+ *
+ * @param linker The link.
+ * @return 0 if the table is complete and every symbol is defined once, 1 otherwise.
+ */
+int check_Symbol_Table(const LINKER * linker);
+
+/**
+ * @brief Adds a member of a library to the modules of the link.
+ *
+ * @param linker The link.
+ * @param library Index of the library.
+ * @param member Index of the member.
+ * @return 0 on success, 1 if the member is not a valid object or memory ran out.
+ */
+int add_Library_Member(LINKER * linker , unsigned int library , unsigned int member);
+
+/**
+ * @brief Adds the library members defining the symbols no module defines, then rebuilds the global symbol table.
+ *
+ * The modules added are scanned in turn, so the members they need are added as well.
+ *
+ * @param linker The link.
+ * @return 0 on success, 1 if a member cannot be added or the table cannot be rebuilt.
+ */
+int resolve_Libraries(LINKER * linker);
+
+/**
+ * @brief Reports the symbols defined more than once, in module order.
+ *
+ * @param linker The link.
+ * @return 0 if every symbol is defined once, 1 otherwise.
+ */
+int report_Duplicates(const LINKER * linker);
+
+/**
+ * @brief Copies the words and entries of a module to the linked image, relocating its relocatable words and patching its extern references.
+ *
+ * @param linker The link.
+ * @param index Index of the module.
+ * @param report Stream the errors are written to, or NULL.
+ * @return 0 on success, 1 if a reference cannot be resolved.
+ */
+int link_Module(LINKER * linker , unsigned int index , FILE * report);
+
+/**
+ * @brief Runs a phase on one module or shard.
+ *
+ * @param linker The link.
+ * @param index Index of the module or shard.
+ */
+void run_Link_Item(LINKER * linker , unsigned int index);
+
+/**
+ * @brief Takes modules or shards of the current phase and runs them until none is left.
+ *
+ * @param argument The link (LINKER *).
+ * @return NULL.
+ */
+void * link_Worker(void * argument);
+
+/**
+ * @brief Runs a phase on all the modules or shards with the workers of the link.
+ *
+ * @param linker The link.
+ * @param phase The phase.
+ * @param total Number of modules or shards.
+ */
+void run_Link_Phase(LINKER * linker , int phase , unsigned int total);
+
+#endif
@@ -0,0 +1,287 @@
+#ifndef OBJECT_H
+#define OBJECT_H
+
+/*
+ * Binary object format, written next to the textual .ob file with --binary.
+ *
+ * All numbers are little-endian and every table is made of byte arrays, so the file
+ * can be mapped and used in place on any host, with no parsing:
+ *
+ *   OBJECT_HEADER
+ *   OBJECT_SYMBOL[entry_count]    entries (.ent), in the order of the .ent file
+ *   OBJECT_SYMBOL[extern_count]   extern references (.ext), in the order of the .ext file
+ *   strings                       null terminated symbol names
+ *   words                         (code_count + data_count) 16-bit words, the word of
+ *                                 address load_address + i at index i
+ */
+
+#define OBJECT_MAGIC "AOB1"
+#define OBJECT_VERSION 1
+#define OBJECT_EXTENSION ".obj"
+
+/* Relocation table: the address of each relocatable (R) word of the .ob file, one per line */
+#define RELOCATION_EXTENSION ".rel"
+
+/* Indexed archive of the outputs of the assembler (--output-archive), read by obconv */
+#define ARCHIVE_MAGIC "AAR1"
+#define ARCHIVE_VERSION 1
+#define ARCHIVE_HEADER_SIZE 24
+#define ARCHIVE_INDEX_ENTRY_SIZE 20
+
+/* Address of the first word of an object */
+#define OBJECT_LOAD_ADDRESS 100
+
+/* FNV-1a hash of the symbol names (32 bits) */
+#define OBJECT_HASH_OFFSET 2166136261UL
+#define OBJECT_HASH_PRIME 16777619UL
+#define OBJECT_HASH_BITS 32
+
+/* Maximum number of characters of a symbol name in the .ent and .ext files */
+#define MAX_SYMBOL_NAME 81
+
+/**
+ * @brief Header of a binary object file.
+ */
+typedef struct OBJECT_HEADER{
+    char magic[4]; /* OBJECT_MAGIC */
+    unsigned char version[4]; /* OBJECT_VERSION */
+    unsigned char load_address[4]; /* Address of the first word */
+    unsigned char code_count[4]; /* Number of code words (IC - 100 in the .ob header) */
+    unsigned char data_count[4]; /* Number of data words (DC - 1 in the .ob header) */
+    unsigned char entry_count[4]; /* Number of entry symbols */
+    unsigned char extern_count[4]; /* Number of extern references */
+    unsigned char strings_offset[4]; /* Offset of the symbol names */
+    unsigned char strings_size[4]; /* Size of the symbol names */
+    unsigned char words_offset[4]; /* Offset of the words */
+    unsigned char file_size[4]; /* Size of the whole file */
+} OBJECT_HEADER;
+
+/**
+ * @brief An entry symbol or an extern reference of a binary object file.
+ */
+typedef struct OBJECT_SYMBOL{
+    unsigned char name_offset[4]; /* Offset of the name in the strings */
+    unsigned char address[4]; /* Address of the entry, or address referring to the extern */
+} OBJECT_SYMBOL;
+
+/**
+ * @brief Contents of an object, used to encode a binary object file.
+ */
+typedef struct OBJECT_IMAGE{
+    unsigned int load_address; /* Address of the first word */
+    unsigned int code_count; /* Number of code words */
+    unsigned int data_count; /* Number of data words */
+    unsigned short * words; /* code_count + data_count words */
+    unsigned int entry_count; /* Number of entry symbols */
+    char ** entry_names; /* Names of the entry symbols */
+    unsigned int * entry_addresses; /* Addresses of the entry symbols */
+    unsigned int extern_count; /* Number of extern references */
+    char ** extern_names; /* Names of the extern references */
+    unsigned int * extern_addresses; /* Addresses referring to the externs */
+} OBJECT_IMAGE;
+
+/**
+ * @brief A binary object file mapped into memory.
+ */
+typedef struct OBJECT_FILE{
+    void * mapping; /* Start of the mapping */
+    long mapping_size; /* Size of the mapping */
+    void * data; /* Start of the object in the mapping */
+    long size; /* Size of the object */
+    const OBJECT_HEADER * header; /* Header of the file */
+    unsigned int load_address; /* Address of the first word */
+    unsigned int code_count; /* Number of code words */
+    unsigned int data_count; /* Number of data words */
+    unsigned int entry_count; /* Number of entry symbols */
+    unsigned int extern_count; /* Number of extern references */
+    const OBJECT_SYMBOL * entries; /* Entry symbols */
+    const OBJECT_SYMBOL * externs; /* Extern references */
+    const char * strings; /* Symbol names */
+    unsigned int strings_size; /* Size of the symbol names */
+    const unsigned char * words; /* Little-endian words */
+} OBJECT_FILE;
+
+/*-------------Function declaration in Object_File.c---------------*/
+
+/**
+ * @brief Reads a little-endian 32-bit number.
+ *
+ * @param bytes The four bytes of the number.
+ * @return The number.
+ */
+unsigned int object_u32(const unsigned char * bytes);
+
+/**
+ * @brief Stores a number as a little-endian 32-bit number.
+ *
+ * @param bytes The four bytes receiving the number.
+ * @param value The number.
+ */
+void object_put_u32(unsigned char * bytes , unsigned int value);
+
+/**
+ * @brief Encodes an object into the bytes of a binary object file.
+ *
+ * @param image The object.
+ * @param size Pointer receiving the size of the file.
+ * @return The bytes of the file (to free), or NULL if memory ran out.
+ */
+char * object_Encode(const OBJECT_IMAGE * image , long * size);
+
+/**
+ * @brief Maps a binary object stored in a file and checks its header and tables.
+ *
+ * @param fd Descriptor of the file.
+ * @param offset Offset of the object in the file.
+ * @param size Size of the object.
+ * @return Pointer to the mapped object, or NULL if it cannot be mapped or is not a valid object.
+ */
+OBJECT_FILE * map_Object(int fd , long offset , long size);
+
+/**
+ * @brief Maps a binary object file and checks its header and tables.
+ *
+ * @param file_name Name of the file.
+ * @return Pointer to the mapped object, or NULL if the file cannot be read or is not a valid object.
+ */
+OBJECT_FILE * load_Object(const char * file_name);
+
+/**
+ * @brief Returns a word of a mapped object.
+ *
+ * @param object The mapped object.
+ * @param index Index of the word (its address minus the load address).
+ * @return The word.
+ */
+unsigned short object_Word(const OBJECT_FILE * object , unsigned int index);
+
+/**
+ * @brief Returns the name of a symbol of a mapped object.
+ *
+ * @param object The mapped object.
+ * @param symbol The symbol.
+ * @return The null terminated name.
+ */
+const char * object_Symbol_Name(const OBJECT_FILE * object , const OBJECT_SYMBOL * symbol);
+
+/**
+ * @brief Unmaps a binary object file.
+ *
+ * @param object Pointer to the object pointer (set to NULL).
+ */
+void unload_Object(OBJECT_FILE ** object);
+
+/**
+ * @brief Hashes a symbol name.
+ *
+ * @param name The name.
+ * @return The hash.
+ */
+unsigned long symbol_Hash(const char * name);
+
+/**
+ * @brief Builds a file name from a base name and a suffix.
+ *
+ * @param name The base name.
+ * @param suffix The suffix.
+ * @return The file name (to free), or NULL if memory ran out.
+ */
+char * object_File_Name(const char * name , const char * suffix);
+
+/**
+ * @brief Frees the memory of an object image (its words, symbol names and addresses).
+ *
+ * @param image The object.
+ */
+void free_Object_Image(OBJECT_IMAGE * image);
+
+/**
+ * @brief Reads the symbols of a .ent or .ext file.
+ *
+ * @param file_name Name of the file.
+ * @param names Pointer receiving the names (to free, with each name).
+ * @param addresses Pointer receiving the addresses (to free).
+ * @param count Pointer receiving the number of symbols.
+ * @return 0 on success, 1 if the file cannot be read.
+ */
+int read_Symbols(const char * file_name , char *** names , unsigned int ** addresses , unsigned int * count);
+
+/**
+ * @brief Reads an object from the .ob, .ent and .ext files written by the assembler.
+ *
+ * @param name Base name of the files.
+ * @param image Pointer receiving the object (to free with free_Object_Image).
+ * @return 0 on success, 1 if a file is missing or malformed.
+ */
+int read_Text_Object(const char * name , OBJECT_IMAGE * image);
+
+/**
+ * @brief Reads the relocation table of an object (.rel).
+ *
+ * @param file_name Name of the file.
+ * @param addresses Pointer receiving the addresses of the relocatable words, in increasing order (to free).
+ * @param count Pointer receiving the number of addresses.
+ * @return 0 on success, 1 if the file cannot be read or is malformed.
+ */
+int read_Relocations(const char * file_name , unsigned int ** addresses , unsigned int * count);
+
+/**
+ * @brief Copies the symbols of a mapped object into arrays.
+ *
+ * @param object The mapped object.
+ * @param symbols The symbols.
+ * @param count Number of symbols.
+ * @param names Pointer receiving the names (to free, with each name).
+ * @param addresses Pointer receiving the addresses (to free).
+ * @return 0 on success, 1 if memory ran out.
+ */
+int copy_Symbols(const OBJECT_FILE * object , const OBJECT_SYMBOL * symbols , unsigned int count , char *** names , unsigned int ** addresses);
+
+/**
+ * @brief Copies a mapped binary object into an object image.
+ *
+ * @param object The mapped object.
+ * @param image Pointer receiving the object (to free with free_Object_Image).
+ * @return 0 on success, 1 if memory ran out.
+ */
+int object_To_Image(const OBJECT_FILE * object , OBJECT_IMAGE * image);
+
+/**
+ * @brief Reads an object from NAME.obj when the name ends with .obj, from NAME.ob, NAME.ent and NAME.ext otherwise.
+ *
+ * @param name Name of the binary object file, or base name of the text files.
+ * @param image Pointer receiving the object (to free with free_Object_Image).
+ * @return 0 on success, 1 if the object cannot be read.
+ */
+int read_Object(const char * name , OBJECT_IMAGE * image);
+
+/**
+ * @brief Writes symbols to a .ent or .ext file, or removes the file when there are none.
+ *
+ * @param names Names of the symbols.
+ * @param addresses Addresses of the symbols.
+ * @param count Number of symbols.
+ * @param file_name Name of the file.
+ * @return 0 on success, 1 if the file cannot be written.
+ */
+int write_Symbols(char ** names , const unsigned int * addresses , unsigned int count , const char * file_name);
+
+/**
+ * @brief Writes an object as the .ob, .ent and .ext files, byte for byte the way the assembler writes them.
+ *
+ * @param image The object.
+ * @param name Base name of the files.
+ * @return 0 on success, 1 if a file cannot be written.
+ */
+int write_Text_Object(const OBJECT_IMAGE * image , const char * name);
+
+/**
+ * @brief Writes an object as a binary object file.
+ *
+ * @param image The object.
+ * @param file_name Name of the file.
+ * @return 0 on success, 1 if the file cannot be written.
+ */
+int write_Binary_Object(const OBJECT_IMAGE * image , const char * file_name);
+
+#endif
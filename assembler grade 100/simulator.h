@@ -0,0 +1,456 @@
+#ifndef SIMULATOR_H
+#define SIMULATOR_H
+
+#include <stdio.h>
+#include <pthread.h>
+#include "object.h"
+
+/*
+ * Simulator: runs an object written by the assembler or the linker.
+ *
+ * The machine has SIM_MEMORY_SIZE words of 15 bits, the registers r0 to r7 and a zero
+ * flag set by cmp. The object is loaded at its load address, and the stack of jsr and rts
+ * grows down from the top of memory.
+ *
+ * Every instruction is decoded once into a SIM_INSTRUCTION, kept in an array indexed by
+ * address: its handler, and the cell of each operand (the immediate value kept in the
+ * instruction, the memory word of a direct operand or the register), so running it needs
+ * no decoding. An indirect operand (*r) is the memory word at the address held by its
+ * register. The handlers are dispatched with computed gotos (threaded code) when the
+ * compiler supports them, with a switch otherwise (or when SIM_SWITCH_DISPATCH is defined).
+ *
+ * Unless fusion is turned off, the decoder also fuses the most common pairs of adjacent
+ * instructions (cmp then bne, inc or dec then jmp) into one superinstruction, run with a
+ * single dispatch, and gives mov between two registers a handler of its own. The second
+ * instruction keeps its own decoded entry, so a jump to it runs it alone.
+ *
+ * A word written to memory invalidates the instructions that may hold it, and they are
+ * decoded again before they run, so code that writes over itself runs as on the machine.
+ *
+ * A batch runs the program once for each of many input files, on a pool of workers: the
+ * object is loaded and decoded once, and each run starts from a copy of that machine
+ * (clone_Simulator), so the runs do not share any state. Each worker keeps its own machine
+ * and its own buffers for the input and output files.
+ *
+ * A snapshot keeps the state of a machine: its memory and registers, pc, stack pointer, zero
+ * flag, the number of instructions run and of characters read by red. It is taken in memory
+ * (SIM_SNAPSHOT) and written to a snapshot file. The registers are fields of the header; of
+ * the memory, only the words from the first to the last that is not 0 are written:
+ *
+ *   SIM_SNAPSHOT_HEADER
+ *   words                         word_count 16-bit words, the cell first_word + i at index i
+ *
+ * Restoring a snapshot decodes nothing: every instruction is decoded the first time it runs.
+ */
+
+/* Memory and registers */
+#define SIM_MEMORY_SIZE 4096
+#define SIM_ADDRESS_MASK (SIM_MEMORY_SIZE - 1)
+#define SIM_REGISTERS 8
+#define SIM_WORD_MASK 0x7FFF
+#define SIM_SIGN_BIT 0x4000
+
+/* Maximum number of words of an instruction, and of a fused pair */
+#define SIM_MAX_LENGTH 3
+#define SIM_MAX_SPAN (2 * SIM_MAX_LENGTH)
+
+/* Fields of the first word of an instruction, as written by generate_Mila */
+#define SIM_OPCODE_SHIFT 11
+#define SIM_OPCODE_MASK 15
+#define SIM_SOURCE_SHIFT 7
+#define SIM_TARGET_SHIFT 3
+#define SIM_MODE_MASK 15
+
+/* Fields of an operand word */
+#define SIM_ARE_MASK 7
+#define SIM_ABSOLUTE 4
+#define SIM_RELOCATABLE 2
+#define SIM_EXTERNAL 1
+#define SIM_VALUE_SHIFT 3
+#define SIM_VALUE_MASK 0xFFF
+#define SIM_VALUE_SIGN 0x800
+#define SIM_SOURCE_REGISTER_SHIFT 6
+#define SIM_TARGET_REGISTER_SHIFT 3
+#define SIM_REGISTER_MASK 7
+
+/* Addressing modes (the NUMBER, LABEL, POINTER and REGISTER types of the assembler) */
+#define SIM_NO_OPERAND -1
+#define SIM_IMMEDIATE 0
+#define SIM_DIRECT 1
+#define SIM_INDIRECT 2
+#define SIM_REGISTER 3
+#define SIM_BAD_MODE 4
+
+/* Handlers: the opcodes, then the handlers of the simulator */
+#define SIM_MOV 0
+#define SIM_CMP 1
+#define SIM_ADD 2
+#define SIM_SUB 3
+#define SIM_LEA 4
+#define SIM_CLR 5
+#define SIM_NOT 6
+#define SIM_INC 7
+#define SIM_DEC 8
+#define SIM_JMP 9
+#define SIM_BNE 10
+#define SIM_RED 11
+#define SIM_PRN 12
+#define SIM_JSR 13
+#define SIM_RTS 14
+#define SIM_STOP 15
+#define SIM_ILLEGAL 16 /* Not a valid instruction */
+#define SIM_DECODE 17 /* Not decoded yet, or written over since */
+#define SIM_END_OF_MEMORY 18 /* Past the last address */
+#define SIM_CMP_BNE 19 /* cmp, then bne */
+#define SIM_INC_JMP 20 /* inc, then jmp */
+#define SIM_DEC_JMP 21 /* dec, then jmp */
+#define SIM_MOV_REGISTERS 22 /* mov from a register to a register */
+#define SIM_HANDLERS 23
+
+/* Results of a run */
+#define SIM_HALTED 0
+#define SIM_ILLEGAL_INSTRUCTION 1
+#define SIM_STACK_OVERFLOW 2
+#define SIM_STACK_UNDERFLOW 3
+#define SIM_OUT_OF_MEMORY 4
+#define SIM_STEP_LIMIT 5
+#define SIM_NOT_RUN 6 /* A run of a batch whose files could not be opened */
+
+/* Maximum number of workers of a batch (-j), and size of the buffer of each file of a worker */
+#define SIM_MAX_JOBS 256
+#define SIM_BATCH_BUFFER (64 * 1024)
+
+/* Maximum length of a line of the list of input files of a batch */
+#define SIM_MAX_PATH 1024
+
+#define SIM_SNAPSHOT_MAGIC "SIM1"
+#define SIM_SNAPSHOT_VERSION 2
+
+/**
+ * @brief A decoded instruction.
+ *
+ * The cell of an operand is source + *source_index (target + *target_index): for an
+ * indirect operand, source is the memory and source_index its register; otherwise
+ * source is the cell and source_index points to a word that is always 0.
+ */
+typedef struct SIM_INSTRUCTION{
+    unsigned int handler; /* SIM_MOV to SIM_STOP, or a handler of the simulator */
+    unsigned int plain; /* Handler of the instruction alone, when handler is a fused one */
+    unsigned int length; /* Number of words */
+    int source_mode; /* Addressing mode of the source operand */
+    int target_mode; /* Addressing mode of the target operand */
+    unsigned short * source; /* Cell of the source operand, or the memory */
+    unsigned short * source_index; /* Register of an indirect source operand, or the zero word */
+    unsigned short * target; /* Cell of the target operand, or the memory */
+    unsigned short * target_index; /* Register of an indirect target operand, or the zero word */
+    unsigned int address; /* Source address of lea, jump address of jmp, bne and jsr (plus *target_index), or of the second of a fused pair (plus *jump_index) */
+    unsigned short * jump_index; /* Register of the jump of the second of a fused pair, or the zero word */
+    unsigned short immediate[2]; /* Values of the immediate operands */
+    struct SIM_INSTRUCTION * next; /* Instruction following this one (the second of a fused pair) */
+    struct SIM_INSTRUCTION * after; /* Instruction following a fused pair */
+    unsigned long runs; /* Number of times a fused pair ran, counted with count_pairs */
+} SIM_INSTRUCTION;
+
+/**
+ * @brief State of the simulated machine.
+ */
+typedef struct SIMULATOR{
+    unsigned short cells[SIM_MEMORY_SIZE + SIM_REGISTERS]; /* Memory, then the registers */
+    unsigned short * registers; /* The registers, after the memory in cells */
+    unsigned short zero; /* Always 0, the index of the operands that are not indirect */
+    SIM_INSTRUCTION slots[SIM_MAX_SPAN - 1 + SIM_MEMORY_SIZE + SIM_MAX_LENGTH]; /* Words before address 0 (written over by invalidation), then the program */
+    SIM_INSTRUCTION * program; /* Decoded instruction of each address (slots + SIM_MAX_SPAN - 1) */
+    int fuse; /* Nonzero to fuse pairs of instructions */
+    int count_pairs; /* Nonzero to count the runs of each fused pair (slower) */
+    unsigned int image_end; /* First address after the object, the lowest the stack can reach */
+    unsigned int stack_pointer; /* Address of the top of the stack, SIM_MEMORY_SIZE when empty */
+    int zero_flag; /* Nonzero if the last cmp found its operands equal */
+    unsigned int pc; /* Address of the next instruction, or of the one that stopped the run */
+    unsigned long steps; /* Number of instructions run */
+    unsigned long max_steps; /* Maximum number of instructions of a run, 0 for no limit */
+    unsigned long input_read; /* Number of characters read by red */
+    FILE * input; /* Characters read by red */
+    FILE * record; /* Receives the characters read by red, or NULL */
+    FILE * output; /* Numbers written by prn */
+} SIMULATOR;
+
+/**
+ * @brief State of a machine, restored without decoding.
+ */
+typedef struct SIM_SNAPSHOT{
+    unsigned short cells[SIM_MEMORY_SIZE + SIM_REGISTERS]; /* Memory, then the registers */
+    unsigned int pc; /* Address of the next instruction */
+    unsigned int stack_pointer; /* Address of the top of the stack */
+    unsigned int image_end; /* Lowest address the stack can reach */
+    int zero_flag; /* Nonzero if the last cmp found its operands equal */
+    unsigned long steps; /* Number of instructions run */
+    unsigned long input_read; /* Number of characters read by red */
+} SIM_SNAPSHOT;
+
+/**
+ * @brief Header of a snapshot file; numbers are little-endian, 64-bit ones low half first.
+ */
+typedef struct SIM_SNAPSHOT_HEADER{
+    char magic[4]; /* SIM_SNAPSHOT_MAGIC */
+    unsigned char version[4]; /* SIM_SNAPSHOT_VERSION */
+    unsigned char pc[4]; /* Address of the next instruction */
+    unsigned char stack_pointer[4]; /* Address of the top of the stack */
+    unsigned char image_end[4]; /* Lowest address the stack can reach */
+    unsigned char zero_flag[4]; /* 1 if the last cmp found its operands equal, 0 otherwise */
+    unsigned char registers[SIM_REGISTERS][4]; /* r0 to r7 */
+    unsigned char steps[8]; /* Number of instructions run */
+    unsigned char input_read[8]; /* Number of characters read by red */
+    unsigned char first_word[4]; /* Address of the first memory word of the file */
+    unsigned char word_count[4]; /* Number of memory words of the file, the other words are 0 */
+    unsigned char file_size[4]; /* Size of the whole file */
+} SIM_SNAPSHOT_HEADER;
+
+/* The JIT of a worker of a batch (see jit.h) */
+struct JIT;
+
+/**
+ * @brief A run of a batch.
+ */
+typedef struct SIM_BATCH_RUN{
+    char * input; /* Name of the input file; the output goes to the same name with .out */
+    int result; /* Result of the run, SIM_NOT_RUN until it ran */
+    unsigned long steps; /* Number of instructions run */
+    unsigned int pc; /* Address where the run stopped */
+} SIM_BATCH_RUN;
+
+/**
+ * @brief A batch, shared by its workers.
+ */
+typedef struct SIM_BATCH{
+    const SIMULATOR * sim; /* The loaded machine every run starts from, only read */
+    unsigned int start; /* Address of the first instruction */
+    int use_jit; /* Nonzero to run the program as native code */
+    SIM_BATCH_RUN * runs; /* The runs, in the order of the list */
+    unsigned int count; /* Number of runs */
+    unsigned int next; /* First run no worker took yet */
+    int jobs; /* Number of workers */
+    pthread_mutex_t lock; /* Protects next */
+} SIM_BATCH;
+
+/*-------------Function declaration in Simulator.c---------------*/
+
+/**
+ * @brief Returns the addressing mode of the mode bits of an instruction.
+ *
+ * @param bits The four mode bits of the source or target operand.
+ * @return SIM_IMMEDIATE to SIM_REGISTER, SIM_NO_OPERAND if no bit is set, or SIM_BAD_MODE.
+ */
+int sim_Mode(unsigned int bits);
+
+/**
+ * @brief Decodes the cell of an operand.
+ *
+ * @param sim The simulator.
+ * @param mode Addressing mode of the operand.
+ * @param word Operand word.
+ * @param shift Position of the register number in the word.
+ * @param immediate Word of the instruction receiving an immediate value.
+ * @param cell Pointer receiving the cell, or the memory for an indirect operand.
+ * @param index Pointer receiving the register of an indirect operand, or the zero word.
+ * @return 0 on success, 1 if the word is not valid for the mode (an unresolved extern).
+ */
+int decode_Operand(SIMULATOR * sim , int mode , unsigned int word , unsigned int shift , unsigned short * immediate , unsigned short ** cell , unsigned short ** index);
+
+/**
+ * @brief Decodes the instruction at an address; it gets the SIM_ILLEGAL handler if it is not valid.
+ *
+ * @param sim The simulator.
+ * @param address Address of the instruction.
+ */
+void decode_Instruction(SIMULATOR * sim , unsigned int address);
+
+/**
+ * @brief Gives a decoded instruction a fused handler when it starts one of the fused pairs.
+ *
+ * @param sim The simulator.
+ * @param address Address of the instruction.
+ */
+void fuse_Instruction(SIMULATOR * sim , unsigned int address);
+
+/**
+ * @brief Decodes the instruction at an address, and fuses it with the next one when fusion is on.
+ *
+ * @param sim The simulator.
+ * @param address Address of the instruction.
+ */
+void prepare_Instruction(SIMULATOR * sim , unsigned int address);
+
+/**
+ * @brief Returns the name of a handler, as printed by the profile.
+ *
+ * @param handler The handler.
+ * @return The name, e.g. "cmp+bne".
+ */
+const char * sim_Handler_Name(unsigned int handler);
+
+/**
+ * @brief Points the registers and the program into the machine, and marks every instruction as not decoded yet.
+ *
+ * @param sim The simulator.
+ */
+void reset_Program(SIMULATOR * sim);
+
+/**
+ * @brief Loads an object into the memory and decodes its code.
+ *
+ * @param sim The simulator.
+ * @param image The object.
+ * @return 0 on success, 1 if the object does not fit in the memory.
+ */
+int load_Simulator(SIMULATOR * sim , const OBJECT_IMAGE * image);
+
+/**
+ * @brief Copies a loaded machine, its decoded program pointing into the copy.
+ *
+ * @param copy The copy.
+ * @param sim The machine copied.
+ */
+void clone_Simulator(SIMULATOR * copy , const SIMULATOR * sim);
+
+/**
+ * @brief Runs the program until it stops.
+ *
+ * @param sim The simulator, with its program loaded.
+ * @param start Address of the first instruction.
+ * @return SIM_HALTED when stop runs, or the error that stopped the run (sim->pc is its address).
+ */
+int run_Simulator(SIMULATOR * sim , unsigned int start);
+
+/**
+ * @brief Writes the profile of a run to the standard error: the fused pairs, how often each ran, and the speedup.
+ *
+ * @param sim The simulator, after a run with fusion counting the fused pairs.
+ * @param baseline_steps Number of instructions of the run without fusion.
+ * @param baseline Seconds of the run without fusion.
+ * @param seconds Seconds of the run with fusion.
+ */
+void report_Profile(const SIMULATOR * sim , unsigned long baseline_steps , double baseline , double seconds);
+
+/**
+ * @brief Converts a word to a signed number.
+ *
+ * @param word The 15-bit word.
+ * @return The number.
+ */
+int sim_Signed(unsigned int word);
+
+/**
+ * @brief Returns the name of the result of a run, as printed by a batch.
+ *
+ * @param result SIM_HALTED to SIM_NOT_RUN.
+ * @return The name, e.g. "halted".
+ */
+const char * sim_Result_Name(int result);
+
+/*-------------Function declaration in Sim_Batch.c---------------*/
+
+/**
+ * @brief Reads the list of input files of a batch, one name per line (empty lines are skipped).
+ *
+ * @param list_name Name of the list.
+ * @param batch The batch receiving its runs.
+ * @return 0 on success, 1 if the list cannot be read or is empty.
+ */
+int read_Batch_List(const char * list_name , SIM_BATCH * batch);
+
+/**
+ * @brief Runs one run of a batch on the machine of a worker.
+ *
+ * @param batch The batch.
+ * @param run The run.
+ * @param sim The machine of the worker.
+ * @param jit The JIT of the worker, or NULL.
+ * @param input_buffer Buffer of the input file.
+ * @param output_buffer Buffer of the output file.
+ */
+void run_Batch_Item(SIM_BATCH * batch , SIM_BATCH_RUN * run , SIMULATOR * sim , struct JIT * jit , char * input_buffer , char * output_buffer);
+
+/**
+ * @brief Takes runs of a batch and runs them until none is left.
+ *
+ * @param argument The batch (SIM_BATCH *).
+ * @return NULL.
+ */
+void * batch_Worker(void * argument);
+
+/**
+ * @brief Runs a batch with its workers, then writes the result of each run to the standard output and the throughput to the standard error.
+ *
+ * @param batch The batch.
+ * @return 0 if every run halted, 1 otherwise.
+ */
+int run_Sim_Batch(SIM_BATCH * batch);
+
+/**
+ * @brief Frees the runs of a batch.
+ *
+ * @param batch The batch.
+ */
+void free_Sim_Batch(SIM_BATCH * batch);
+
+/*-------------Function declaration in Sim_Snapshot.c---------------*/
+
+/**
+ * @brief Stores a number as a little-endian 64-bit number, low half first.
+ *
+ * @param bytes The eight bytes receiving the number.
+ * @param value The number.
+ */
+void snapshot_put_u64(unsigned char * bytes , unsigned long value);
+
+/**
+ * @brief Reads a little-endian 64-bit number, low half first.
+ *
+ * @param bytes The eight bytes of the number.
+ * @return The number.
+ */
+unsigned long snapshot_u64(const unsigned char * bytes);
+
+/**
+ * @brief Takes a snapshot of a machine.
+ *
+ * @param sim The simulator.
+ * @param snapshot The snapshot.
+ */
+void take_Snapshot(const SIMULATOR * sim , SIM_SNAPSHOT * snapshot);
+
+/**
+ * @brief Puts a machine back in the state of a snapshot; its instructions are decoded when they run.
+ *
+ * @param sim The simulator.
+ * @param snapshot The snapshot.
+ */
+void restore_Snapshot(SIMULATOR * sim , const SIM_SNAPSHOT * snapshot);
+
+/**
+ * @brief Writes a snapshot file.
+ *
+ * @param snapshot The snapshot.
+ * @param file_name Name of the file.
+ * @return 0 on success, 1 if the file cannot be written.
+ */
+int write_Snapshot(const SIM_SNAPSHOT * snapshot , const char * file_name);
+
+/**
+ * @brief Reads a snapshot file.
+ *
+ * @param snapshot The snapshot.
+ * @param file_name Name of the file.
+ * @return 0 on success, 1 if the file cannot be read or is not a valid snapshot.
+ */
+int read_Snapshot(SIM_SNAPSHOT * snapshot , const char * file_name);
+
+/**
+ * @brief Skips the characters of an input a restored machine already read.
+ *
+ * @param input The input.
+ * @param count Number of characters.
+ */
+void skip_Input(FILE * input , unsigned long count);
+
+#endif